@@ -46,6 +46,22 @@ namespace log4cpp {
                      const std::string& ndc, Priority::Value priority, 
 					 const char* file=0, unsigned line=0);
 
+        /**
+         * Instantiate a LoggingEvent that was recorded earlier, possibly
+         * in a different thread, e.g. by an asynchronous appender.
+         * @param category The category of this event.
+         * @param message  The message of this event.
+         * @param ndc The nested diagnostic context of this event. 
+         * @param priority The priority of this event.
+         * @param file The file name where the event originated.
+         * @param line The line number of the event.
+         * @param threadName The thread in which the event was generated.
+         * @param timeStamp The time at which the event was generated.
+         **/
+        LoggingEvent(const std::string& category, const std::string& message, 
+                     const std::string& ndc, Priority::Value priority, 
+					 const char* file, unsigned line,
+                     const std::string& threadName, const TimeStamp& timeStamp);
 
         /** The category name. */
         const std::string categoryName;
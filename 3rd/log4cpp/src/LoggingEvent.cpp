@@ -27,4 +27,22 @@ namespace log4cpp {
 		line(line),
         threadName(threading::getThreadId()) {
     }
+
+    LoggingEvent::LoggingEvent(const std::string& categoryName, 
+                               const std::string& message,
+                               const std::string& ndc, 
+                               Priority::Value priority,
+							   const char* file,
+							   unsigned line,
+                               const std::string& threadName,
+                               const TimeStamp& timeStamp) :
+        categoryName(categoryName),
+        message(message),
+        ndc(ndc),
+        priority(priority),
+		file(file ? file : ""),
+		line(line),
+        threadName(threadName),
+        timeStamp(timeStamp) {
+    }
 }
@@ -40,8 +40,14 @@
 #include <utMath/BackwardPropagation.h>
 #include <utCalibration/Homography.h>
 #include <utCalibration/Projection.h>
+#include <utCalibration/2D3DPoseEstimationP3P.h>
+#include <utCalibration/2D3DPoseEstimationEPnP.h>
 
 #include <math.h>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
 #include <iostream>
 
 
@@ -336,6 +342,47 @@ Math::ErrorPose computePose(
 
 	bool bInitialized = false;
 	
+	if ( initMethod == EPNP )
+	{
+		bInitialized = estimatePoseEPnP( pose, p2d, p3d, cam );
+		if ( bInitialized )
+		{
+			OPT_LOG_TRACE( "Pose from EPnP: " << pose );
+		}
+		else
+		{
+			OPT_LOG_DEBUG( "EPnP failed (colinear points or only four non-coplanar points?), trying P3P" );
+		}
+	}
+
+	if ( initMethod == MINIMAL_P3P || ( initMethod == EPNP && !bInitialized ) )
+	{
+		// solve for the first three points, disambiguate using all of them
+		Math::Vector< double, 3 > rays[ 3 ];
+		for ( std::size_t i( 0 ); i < 3; i++ )
+			rays[ i ] = viewingRay( p2d[ i ], invK );
+
+		Math::Pose candidates[ 4 ];
+		const std::size_t nSolutions = p3p( rays, &p3d[ 0 ], candidates );
+		double bestError = 0;
+		for ( std::size_t i( 0 ); i < nSolutions; i++ )
+		{
+			const double error = reprojectionError( p2d, p3d, candidates[ i ], cam );
+			OPT_LOG_TRACE( "P3P solution " << i << ": " << candidates[ i ] << ", error " << error );
+			if ( !bInitialized || error < bestError )
+			{
+				pose = candidates[ i ];
+				bestError = error;
+				bInitialized = true;
+			}
+		}
+
+		if ( !bInitialized )
+		{
+			OPT_LOG_DEBUG( "P3P found no solution (degenerate configuration?)" );
+		}
+	}
+
 	if ( initMethod == NONPLANAR_PROJECTION && n_points >= 6 )
 	{
 		// initialize from 3x4 projection matrix
@@ -490,6 +537,202 @@ Math::ErrorPose computePose(
 }
 
 
+namespace {
+
+/** \internal computes K [R|t] as plain array */
+void projectionMatrix( double P[ 3 ][ 4 ], const Math::Pose& pose, const Math::Matrix< double, 3, 3 >& cam )
+{
+	Math::Matrix< double, 3, 3 > R;
+	pose.rotation().toMatrix( R );
+	const Math::Vector< double, 3 >& t( pose.translation() );
+	for ( std::size_t r( 0 ); r < 3; r++ )
+	{
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			P[ r ][ c ] = cam( r, 0 ) * R( 0, c ) + cam( r, 1 ) * R( 1, c ) + cam( r, 2 ) * R( 2, c );
+		P[ r ][ 3 ] = cam( r, 0 ) * t( 0 ) + cam( r, 1 ) * t( 1 ) + cam( r, 2 ) * t( 2 );
+	}
+}
+
+/** \internal squared reprojection error, infinite for points behind the camera */
+inline double squaredReprojectionError( const double P[ 3 ][ 4 ], const Math::Vector< double, 3 >& x, 
+	const Math::Vector< double, 2 >& m )
+{
+	const double w = P[ 2 ][ 0 ] * x( 0 ) + P[ 2 ][ 1 ] * x( 1 ) + P[ 2 ][ 2 ] * x( 2 ) + P[ 2 ][ 3 ];
+	if ( w <= 0 )
+		return std::numeric_limits< double >::infinity();
+	const double du = ( P[ 0 ][ 0 ] * x( 0 ) + P[ 0 ][ 1 ] * x( 1 ) + P[ 0 ][ 2 ] * x( 2 ) + P[ 0 ][ 3 ] ) / w - m( 0 );
+	const double dv = ( P[ 1 ][ 0 ] * x( 0 ) + P[ 1 ][ 1 ] * x( 1 ) + P[ 1 ][ 2 ] * x( 2 ) + P[ 1 ][ 3 ] ) / w - m( 1 );
+	return du * du + dv * dv;
+}
+
+/** \internal marks the inliers of a pose, copies them and sums their squared errors, returns their number */
+std::size_t collectInliers( const Math::Pose& pose, 
+	const std::vector< Math::Vector< double, 2 > >& p2d, const std::vector< Math::Vector< double, 3 > >& p3d,
+	const Math::Matrix< double, 3, 3 >& cam, double fThreshold2, std::vector< bool >& inliers,
+	std::vector< Math::Vector< double, 2 > >& in2d, std::vector< Math::Vector< double, 3 > >& in3d,
+	double& fSquaredError )
+{
+	double P[ 3 ][ 4 ];
+	projectionMatrix( P, pose, cam );
+	in2d.clear();
+	in3d.clear();
+	fSquaredError = 0;
+	for ( std::size_t i( 0 ); i < p2d.size(); i++ )
+	{
+		const double e = squaredReprojectionError( P, p3d[ i ], p2d[ i ] );
+		inliers[ i ] = e < fThreshold2;
+		if ( inliers[ i ] )
+		{
+			in2d.push_back( p2d[ i ] );
+			in3d.push_back( p3d[ i ] );
+			fSquaredError += e;
+		}
+	}
+	return in2d.size();
+}
+
+} // anonymous namespace
+
+
+Math::ErrorPose computePoseRansac(
+		const std::vector< Math::Vector< double, 2 > >& p2d,
+		const std::vector< Math::Vector< double, 3 > >& p3d,
+		const Math::Matrix< double, 3, 3 >& cam,
+		std::vector< bool >& inliers,
+		double& residual,
+		double fThreshold,
+		unsigned nMaxRuns,
+		double fConfidence
+	)
+{
+	const std::size_t n_points( p2d.size() );
+	if ( n_points < 4 || p3d.size() != n_points ) {
+		UBITRACK_THROW( "RANSAC pose estimation requires at least 4 2D-3D correspondences" );
+	}
+
+	OPT_LOG_DEBUG( "Performing RANSAC pose estimation using " << n_points << " points" );
+
+	const double fThreshold2 = fThreshold * fThreshold;
+
+	// viewing rays are computed once for all hypotheses
+	Math::Matrix< double, 3, 3 > invK( Math::invert_matrix( cam ) );
+	std::vector< Math::Vector< double, 3 > > rays( n_points );
+	for ( std::size_t i( 0 ); i < n_points; i++ )
+		rays[ i ] = viewingRay( p2d[ i ], invK );
+
+	Math::Pose bestPose;
+	double fBestScore = std::numeric_limits< double >::infinity();
+	std::size_t nBestInliers = 0;
+	unsigned nRuns = nMaxRuns;
+	unsigned iRun;
+	for ( iRun = 0; iRun < nRuns; iRun++ )
+	{
+		// draw four distinct correspondences: three for P3P, one to reject wrong solutions early
+		std::size_t sample[ 4 ];
+		for ( std::size_t i( 0 ); i < 4; i++ )
+		{
+			bool bUnique;
+			do
+			{
+				sample[ i ] = rand() % n_points;
+				bUnique = true;
+				for ( std::size_t j( 0 ); j < i; j++ )
+					bUnique = bUnique && sample[ j ] != sample[ i ];
+			}
+			while ( !bUnique );
+		}
+
+		Math::Vector< double, 3 > sampleRays[ 3 ];
+		Math::Vector< double, 3 > samplePoints[ 3 ];
+		for ( std::size_t i( 0 ); i < 3; i++ )
+		{
+			sampleRays[ i ] = rays[ sample[ i ] ];
+			samplePoints[ i ] = p3d[ sample[ i ] ];
+		}
+
+		Math::Pose candidates[ 4 ];
+		const std::size_t nSolutions = p3p( sampleRays, samplePoints, candidates );
+		for ( std::size_t s( 0 ); s < nSolutions; s++ )
+		{
+			double P[ 3 ][ 4 ];
+			projectionMatrix( P, candidates[ s ], cam );
+			if ( squaredReprojectionError( P, p3d[ sample[ 3 ] ], p2d[ sample[ 3 ] ] ) >= fThreshold2 )
+				continue;
+
+			// truncated quadratic score, stop as soon as the hypothesis cannot win
+			double fScore = 0;
+			std::size_t nInliers = 0;
+			for ( std::size_t i( 0 ); i < n_points && fScore < fBestScore; i++ )
+			{
+				const double e = squaredReprojectionError( P, p3d[ i ], p2d[ i ] );
+				if ( e < fThreshold2 )
+				{
+					fScore += e;
+					nInliers++;
+				}
+				else
+					fScore += fThreshold2;
+			}
+
+			if ( fScore < fBestScore )
+			{
+				fBestScore = fScore;
+				nBestInliers = nInliers;
+				bestPose = candidates[ s ];
+				OPT_LOG_TRACE( "RANSAC iteration " << iRun + 1 << ": " << nInliers << " inliers, score " << fScore );
+
+				// number of samples needed to draw four inliers with the given confidence
+				const double w = double( nInliers ) / n_points;
+				const double fLogOutlierSample = std::log( 1.0 - w * w * w * w );
+				if ( fLogOutlierSample < 0 )
+				{
+					const double fNeeded = std::ceil( std::log( 1.0 - fConfidence ) / fLogOutlierSample );
+					if ( fNeeded < nRuns )
+						nRuns = std::max( static_cast< unsigned >( fNeeded ), iRun + 1 );
+				}
+			}
+		}
+	}
+
+	OPT_LOG_DEBUG( "RANSAC: " << iRun << " iterations, " << nBestInliers << " inliers" );
+	if ( nBestInliers < 4 ) {
+		UBITRACK_THROW( "RANSAC pose estimation found no consensus set of at least 4 correspondences" );
+	}
+
+	// refine on the consensus set, then once more if the refined pose changes the set
+	inliers.resize( n_points );
+	std::vector< Math::Vector< double, 2 > > in2d;
+	std::vector< Math::Vector< double, 3 > > in3d;
+	in2d.reserve( n_points );
+	in3d.reserve( n_points );
+
+	double fSquaredError;
+	Math::Pose pose( bestPose );
+	const std::size_t nSampleInliers = collectInliers( pose, p2d, p3d, cam, fThreshold2, inliers, in2d, in3d, fSquaredError );
+	Calibration::optimizePose( pose, in2d, in3d, cam );
+
+	std::vector< bool > refinedInliers( n_points );
+	std::size_t nInliers = collectInliers( pose, p2d, p3d, cam, fThreshold2, refinedInliers, in2d, in3d, fSquaredError );
+	if ( refinedInliers != inliers && nInliers >= nSampleInliers )
+	{
+		Calibration::optimizePose( pose, in2d, in3d, cam );
+		nInliers = collectInliers( pose, p2d, p3d, cam, fThreshold2, refinedInliers, in2d, in3d, fSquaredError );
+	}
+
+	// inlier flags, residual and covariance all refer to the returned pose
+	inliers.swap( refinedInliers );
+	OPT_LOG_DEBUG( "Refined pose: " << pose << ", " << nInliers << " inliers, squared error: " << fSquaredError );
+	if ( nInliers < 4 ) {
+		UBITRACK_THROW( "RANSAC pose estimation found no consensus set of at least 4 correspondences" );
+	}
+
+	Math::Matrix< double, 6, 6 > covMatrix( Calibration::singleCameraPoseError( pose, in3d, cam, fSquaredError ) );
+	residual = sqrt( fSquaredError / ( nInliers * 2 ) );
+
+	return Math::ErrorPose( pose, covMatrix );
+}
+
+
 
 #endif // HAVE_LAPACK
 
@@ -127,10 +127,17 @@ UBITRACK_EXPORT Math::Matrix< double, 6, 6 > multipleCameraPoseError( const Math
 /**
  * Initialization type needed for computePose() method.
  * Use \c NONPLANAR_PROJECTION only in case you are sure that points are not coplanar.
+ * \c MINIMAL_P3P computes the pose from the first three correspondences and uses the
+ * remaining ones to select among the up to four solutions. \c EPNP works for planar and
+ * non-planar configurations and uses all points in O(n). If it fails, e.g. for only four
+ * non-coplanar points, \c MINIMAL_P3P is used.
+ * Both fall back to \c PLANAR_HOMOGRAPHY if the configuration is degenerate.
  */
 UBITRACK_EXPORT typedef enum InitializationMethod {
 	PLANAR_HOMOGRAPHY,
-	NONPLANAR_PROJECTION
+	NONPLANAR_PROJECTION,
+	MINIMAL_P3P,
+	EPNP
 } InitializationMethod_t;
 
 
@@ -167,6 +174,37 @@ UBITRACK_EXPORT Math::ErrorPose computePose(
 		bool optimize = true,
 		enum InitializationMethod initMethod = (enum InitializationMethod)PLANAR_HOMOGRAPHY		
 	);
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes a pose given 2D-3D point correspondences that may contain outliers.
+ *
+ * Hypotheses are generated by P3P from random minimal samples and scored by their truncated
+ * reprojection error (MSAC). The number of hypotheses adapts to the inlier ratio of the best
+ * hypothesis found so far. The best pose is refined with \c optimizePose on its consensus set,
+ * and the inlier flags, residual and covariance are computed from the refined pose.
+ * Generating and scoring hypotheses does not allocate memory.
+ *
+ * @param p2D points in image coordinates
+ * @param p3D points in object coordinates
+ * @param cam camera intrinsics matrix
+ * @param inliers receives one flag per correspondence, true for inliers of the returned pose
+ * @param residual RMS reprojection error of the inliers in image coordinates
+ * @param fThreshold maximum reprojection error of inliers in image coordinates
+ * @param nMaxRuns maximum number of minimal samples
+ * @param fConfidence probability with which at least one outlier-free sample is drawn before stopping
+ * @throws Util::Exception if no consensus set of at least four correspondences was found
+ */
+UBITRACK_EXPORT Math::ErrorPose computePoseRansac(
+		const std::vector< Math::Vector< double, 2 > >& p2d,
+		const std::vector< Math::Vector< double, 3 > >& p3d,
+		const Math::Matrix< double, 3, 3 >& cam,
+		std::vector< bool >& inliers,
+		double& residual,
+		double fThreshold = 4.0,
+		unsigned nMaxRuns = 500,
+		double fConfidence = 0.99
+	);
 	
 #endif // HAVE_LAPACK
 	
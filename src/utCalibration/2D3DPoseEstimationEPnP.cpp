@@ -0,0 +1,444 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implements EPnP pose estimation.
+ */
+
+#include "2D3DPoseEstimationEPnP.h"
+
+#include <cmath>
+#include <limits>
+#include <utMath/Functors/MatrixFunctors.h>
+#include <utMath/SymmetricEigen.h>
+#include "AbsoluteOrientation.h"
+
+namespace Ubitrack { namespace Calibration {
+
+namespace {
+
+/** pairs of control points, in the order of the rows of L */
+const int g_pairs4[ 6 ][ 2 ] = { { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 } };
+const int g_pairs3[ 3 ][ 2 ] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+
+/**
+ * Solves the least-squares problem A x = b via the normal equations.
+ * A is given row-wise with \c stride elements per row, of which the columns \c cols are used.
+ */
+bool solveLeastSquares( const double* A, std::size_t nRows, std::size_t stride, const int* cols, std::size_t nCols,
+	const double* b, double* x )
+{
+	double N[ 10 ][ 11 ];
+	for ( std::size_t i = 0; i < nCols; i++ )
+	{
+		for ( std::size_t j = 0; j <= nCols; j++ )
+			N[ i ][ j ] = 0;
+		for ( std::size_t r = 0; r < nRows; r++ )
+		{
+			const double* row = A + r * stride;
+			for ( std::size_t j = 0; j < nCols; j++ )
+				N[ i ][ j ] += row[ cols[ i ] ] * row[ cols[ j ] ];
+			N[ i ][ nCols ] += row[ cols[ i ] ] * b[ r ];
+		}
+	}
+
+	// Gaussian elimination with partial pivoting
+	for ( std::size_t i = 0; i < nCols; i++ )
+	{
+		std::size_t iMax = i;
+		for ( std::size_t r = i + 1; r < nCols; r++ )
+			if ( std::fabs( N[ r ][ i ] ) > std::fabs( N[ iMax ][ i ] ) )
+				iMax = r;
+		if ( std::fabs( N[ iMax ][ i ] ) < 1e-300 )
+			return false;
+		if ( iMax != i )
+			for ( std::size_t j = 0; j <= nCols; j++ )
+				std::swap( N[ i ][ j ], N[ iMax ][ j ] );
+		for ( std::size_t r = i + 1; r < nCols; r++ )
+		{
+			double f = N[ r ][ i ] / N[ i ][ i ];
+			for ( std::size_t j = i; j <= nCols; j++ )
+				N[ r ][ j ] -= f * N[ i ][ j ];
+		}
+	}
+	for ( std::size_t i = nCols; i-- > 0; )
+	{
+		double s = N[ i ][ nCols ];
+		for ( std::size_t j = i + 1; j < nCols; j++ )
+			s -= N[ i ][ j ] * x[ j ];
+		x[ i ] = s / N[ i ][ i ];
+	}
+	return true;
+}
+
+
+/** state of one EPnP problem */
+struct EPnPProblem
+{
+	std::size_t nControl;
+	double cw[ 4 ][ 3 ];
+
+	// barycentric coordinates, normalized image coordinates and object points
+	std::vector< double > alphas;
+	std::vector< double > uv;
+	const std::vector< Math::Vector< double, 3 > >* pPoints;
+
+	// null space vectors of M^T M, smallest eigenvalue first
+	double V[ 4 ][ 12 ];
+
+	// linear system for the betas: L * (b11 b12 b22 b13 b23 b33 b14 b24 b34 b44) = rho
+	double L[ 6 ][ 10 ];
+	double rho[ 6 ];
+
+	std::size_t nPairs() const
+	{ return nControl == 4 ? 6 : 3; }
+
+	/** computes the pose for given betas and returns the squared reprojection error */
+	double computePose( const double* betas, Math::Pose& pose ) const;
+
+	/** Gauss-Newton refinement of the betas */
+	void refineBetas( double* betas ) const;
+};
+
+
+double EPnPProblem::computePose( const double* betas, Math::Pose& pose ) const
+{
+	const std::vector< Math::Vector< double, 3 > >& p3D( *pPoints );
+	const std::size_t n = p3D.size();
+
+	// control points in camera coordinates
+	double cc[ 4 ][ 3 ];
+	for ( std::size_t j = 0; j < nControl; j++ )
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			cc[ j ][ k ] = 0;
+			for ( std::size_t b = 0; b < nControl; b++ )
+				cc[ j ][ k ] += betas[ b ] * V[ b ][ 3 * j + k ];
+		}
+
+	// object points in camera coordinates, accumulate centroids and cross-covariance
+	double mc[ 3 ] = { 0, 0, 0 };
+	double mw[ 3 ] = { 0, 0, 0 };
+	Math::Matrix< double, 3, 3 > H( Math::Matrix< double, 3, 3 >::zeros() );
+	double fSign = 0;
+	std::vector< double > pc( 3 * n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			double s = 0;
+			for ( std::size_t j = 0; j < nControl; j++ )
+				s += alphas[ i * nControl + j ] * cc[ j ][ k ];
+			pc[ 3 * i + k ] = s;
+		}
+		// rays point towards the objects
+		fSign += pc[ 3 * i + 2 ] * ( uv[ 3 * i + 2 ] );
+	}
+	const double s = fSign < 0 ? -1.0 : 1.0;
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			pc[ 3 * i + k ] *= s;
+			mc[ k ] += pc[ 3 * i + k ] / n;
+			mw[ k ] += p3D[ i ]( k ) / n;
+		}
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 3; c++ )
+				H( r, c ) += ( p3D[ i ]( r ) - mw[ r ] ) * ( pc[ 3 * i + c ] - mc[ c ] );
+
+	// rotation from the cross-covariance with Horn's quaternion method
+	const Math::Quaternion q( calculateRotationFromCorrelation( H ) );
+	Math::Matrix< double, 3, 3 > R;
+	q.toMatrix( R );
+
+	Math::Vector< double, 3 > t;
+	for ( std::size_t k = 0; k < 3; k++ )
+		t( k ) = mc[ k ] - ( R( k, 0 ) * mw[ 0 ] + R( k, 1 ) * mw[ 1 ] + R( k, 2 ) * mw[ 2 ] );
+
+	pose = Math::Pose( q, t );
+
+	// reprojection error in normalized image coordinates
+	double fError = 0;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		double x[ 3 ];
+		for ( std::size_t k = 0; k < 3; k++ )
+			x[ k ] = R( k, 0 ) * p3D[ i ]( 0 ) + R( k, 1 ) * p3D[ i ]( 1 ) + R( k, 2 ) * p3D[ i ]( 2 ) + t( k );
+		if ( x[ 2 ] * uv[ 3 * i + 2 ] <= 0 )
+			return std::numeric_limits< double >::max();
+		const double du = x[ 0 ] / x[ 2 ] - uv[ 3 * i ];
+		const double dv = x[ 1 ] / x[ 2 ] - uv[ 3 * i + 1 ];
+		fError += du * du + dv * dv;
+	}
+	return fError;
+}
+
+
+void EPnPProblem::refineBetas( double* betas ) const
+{
+	const std::size_t nb = nControl;
+	const std::size_t nr = nPairs();
+	const int cols[ 4 ] = { 0, 1, 2, 3 };
+
+	for ( int it = 0; it < 5; it++ )
+	{
+		const double* b = betas;
+		const double b3 = nb == 4 ? b[ 3 ] : 0.0;
+		double J[ 6 ][ 4 ];
+		double r[ 6 ];
+		for ( std::size_t i = 0; i < nr; i++ )
+		{
+			const double* l = L[ i ];
+			const double f = l[ 0 ] * b[ 0 ] * b[ 0 ] + l[ 1 ] * b[ 0 ] * b[ 1 ] + l[ 2 ] * b[ 1 ] * b[ 1 ]
+				+ l[ 3 ] * b[ 0 ] * b[ 2 ] + l[ 4 ] * b[ 1 ] * b[ 2 ] + l[ 5 ] * b[ 2 ] * b[ 2 ]
+				+ l[ 6 ] * b[ 0 ] * b3 + l[ 7 ] * b[ 1 ] * b3 + l[ 8 ] * b[ 2 ] * b3 + l[ 9 ] * b3 * b3;
+			r[ i ] = rho[ i ] - f;
+			J[ i ][ 0 ] = 2 * b[ 0 ] * l[ 0 ] + b[ 1 ] * l[ 1 ] + b[ 2 ] * l[ 3 ] + b3 * l[ 6 ];
+			J[ i ][ 1 ] = b[ 0 ] * l[ 1 ] + 2 * b[ 1 ] * l[ 2 ] + b[ 2 ] * l[ 4 ] + b3 * l[ 7 ];
+			J[ i ][ 2 ] = b[ 0 ] * l[ 3 ] + b[ 1 ] * l[ 4 ] + 2 * b[ 2 ] * l[ 5 ] + b3 * l[ 8 ];
+			J[ i ][ 3 ] = b[ 0 ] * l[ 6 ] + b[ 1 ] * l[ 7 ] + b[ 2 ] * l[ 8 ] + 2 * b3 * l[ 9 ];
+		}
+
+		double delta[ 4 ];
+		if ( !solveLeastSquares( &J[ 0 ][ 0 ], nr, 4, cols, nb, r, delta ) )
+			return;
+		for ( std::size_t k = 0; k < nb; k++ )
+			betas[ k ] += delta[ k ];
+	}
+}
+
+
+/** copies the eigenvectors of the up to four smallest eigenvalues of a symmetric matrix to V */
+template< std::size_t N >
+void nullSpace( const double ( &A )[ N ][ N ], double ( &V )[ 4 ][ 12 ] )
+{
+	double ev[ N ];
+	double vecs[ N ][ N ];
+	Math::symmetricEigen( A, ev, vecs );
+	for ( std::size_t b = 0; b < 4; b++ )
+		for ( std::size_t r = 0; r < 12; r++ )
+			V[ b ][ r ] = ( b < N / 3 && r < N ) ? vecs[ r ][ b ] : 0.0;
+}
+
+} // anonymous namespace
+
+
+bool estimatePoseEPnP( Math::Pose& p,
+	const std::vector< Math::Vector< double, 2 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D,
+	const Math::Matrix< double, 3, 3 >& cam )
+{
+	const std::size_t n = p3D.size();
+	if ( n < 4 || p2D.size() != n )
+		return false;
+
+	EPnPProblem prob;
+	prob.pPoints = &p3D;
+
+	// control points from the principal components of the object points
+	double c0[ 3 ] = { 0, 0, 0 };
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t k = 0; k < 3; k++ )
+			c0[ k ] += p3D[ i ]( k ) / n;
+
+	double A[ 3 ][ 3 ] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = r; c < 3; c++ )
+				A[ r ][ c ] += ( p3D[ i ]( r ) - c0[ r ] ) * ( p3D[ i ]( c ) - c0[ c ] );
+	double ev[ 3 ];
+	double cov[ 3 ][ 3 ];
+	Math::symmetricEigen( A, ev, cov );
+	if ( ev[ 1 ] <= 1e-12 * ev[ 2 ] )
+		return false; // colinear
+
+	// planar objects need only three control points
+	prob.nControl = ev[ 0 ] <= 1e-8 * ev[ 2 ] ? 3 : 4;
+
+	// with four non-planar points the null space is four-dimensional, which is not handled
+	if ( prob.nControl == 4 && n < 5 )
+		return false;
+	const std::size_t nc = prob.nControl;
+	double axisLength[ 3 ];
+	for ( std::size_t k = 0; k < 3; k++ )
+		prob.cw[ 0 ][ k ] = c0[ k ];
+	for ( std::size_t j = 1; j < nc; j++ )
+	{
+		// largest principal component first
+		const std::size_t e = 3 - j;
+		axisLength[ j - 1 ] = std::sqrt( ev[ e ] / n );
+		for ( std::size_t k = 0; k < 3; k++ )
+			prob.cw[ j ][ k ] = c0[ k ] + axisLength[ j - 1 ] * cov[ k ][ e ];
+	}
+
+	// barycentric coordinates and normalized image coordinates (third element keeps the sign of the ray)
+	const Math::Matrix< double, 3, 3 > invK( Math::Functors::matrix_inverse()( cam ) );
+	prob.alphas.resize( n * nc );
+	prob.uv.resize( 3 * n );
+	const std::size_t dim = 3 * nc;
+	double MtM[ 12 ][ 12 ];
+	for ( std::size_t r = 0; r < dim; r++ )
+		for ( std::size_t c = r; c < dim; c++ )
+			MtM[ r ][ c ] = 0;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		double* alpha = &prob.alphas[ i * nc ];
+		alpha[ 0 ] = 1;
+		for ( std::size_t j = 1; j < nc; j++ )
+		{
+			const std::size_t e = 3 - j;
+			double d = 0;
+			for ( std::size_t k = 0; k < 3; k++ )
+				d += ( p3D[ i ]( k ) - c0[ k ] ) * cov[ k ][ e ];
+			alpha[ j ] = d / axisLength[ j - 1 ];
+			alpha[ 0 ] -= alpha[ j ];
+		}
+
+		double ray[ 3 ];
+		for ( std::size_t k = 0; k < 3; k++ )
+			ray[ k ] = invK( k, 0 ) * p2D[ i ]( 0 ) + invK( k, 1 ) * p2D[ i ]( 1 ) + invK( k, 2 );
+		if ( ray[ 2 ] == 0 )
+			return false;
+		const double u = ray[ 0 ] / ray[ 2 ];
+		const double v = ray[ 1 ] / ray[ 2 ];
+		prob.uv[ 3 * i ] = u;
+		prob.uv[ 3 * i + 1 ] = v;
+		prob.uv[ 3 * i + 2 ] = ray[ 2 ];
+
+		// two rows of M: alpha_j * ( 1, 0, -u ) and alpha_j * ( 0, 1, -v )
+		double m1[ 12 ], m2[ 12 ];
+		for ( std::size_t j = 0; j < nc; j++ )
+		{
+			m1[ 3 * j ] = alpha[ j ];
+			m1[ 3 * j + 1 ] = 0;
+			m1[ 3 * j + 2 ] = -alpha[ j ] * u;
+			m2[ 3 * j ] = 0;
+			m2[ 3 * j + 1 ] = alpha[ j ];
+			m2[ 3 * j + 2 ] = -alpha[ j ] * v;
+		}
+		for ( std::size_t c = 0; c < dim; c++ )
+			for ( std::size_t r = 0; r <= c; r++ )
+				MtM[ r ][ c ] += m1[ r ] * m1[ c ] + m2[ r ] * m2[ c ];
+	}
+
+	if ( nc == 4 )
+		nullSpace( MtM, prob.V );
+	else
+	{
+		double MtM9[ 9 ][ 9 ];
+		for ( std::size_t r = 0; r < 9; r++ )
+			for ( std::size_t c = r; c < 9; c++ )
+				MtM9[ r ][ c ] = MtM[ r ][ c ];
+		nullSpace( MtM9, prob.V );
+	}
+
+	// distance constraints between control points
+	for ( std::size_t i = 0; i < prob.nPairs(); i++ )
+	{
+		const int a = nc == 4 ? g_pairs4[ i ][ 0 ] : g_pairs3[ i ][ 0 ];
+		const int b = nc == 4 ? g_pairs4[ i ][ 1 ] : g_pairs3[ i ][ 1 ];
+		double dv[ 4 ][ 3 ];
+		prob.rho[ i ] = 0;
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			const double d = prob.cw[ a ][ k ] - prob.cw[ b ][ k ];
+			prob.rho[ i ] += d * d;
+			for ( std::size_t v = 0; v < 4; v++ )
+				dv[ v ][ k ] = prob.V[ v ][ 3 * a + k ] - prob.V[ v ][ 3 * b + k ];
+		}
+		double* l = prob.L[ i ];
+		int idx = 0;
+		for ( std::size_t v2 = 0; v2 < 4; v2++ )
+			for ( std::size_t v1 = 0; v1 <= v2; v1++ )
+			{
+				const double d = dv[ v1 ][ 0 ] * dv[ v2 ][ 0 ] + dv[ v1 ][ 1 ] * dv[ v2 ][ 1 ] + dv[ v1 ][ 2 ] * dv[ v2 ][ 2 ];
+				l[ idx++ ] = v1 == v2 ? d : 2 * d;
+			}
+	}
+
+	// initial betas from three linearizations, each refined and evaluated
+	double fBest = std::numeric_limits< double >::max();
+	const std::size_t nr = prob.nPairs();
+	for ( int approx = 0; approx < 3; approx++ )
+	{
+		double betas[ 4 ] = { 0, 0, 0, 0 };
+		double x[ 5 ];
+		if ( approx == 0 )
+		{
+			// all betas, using only the products with beta1
+			const int cols[ 4 ] = { 0, 1, 3, 6 };
+			if ( !solveLeastSquares( &prob.L[ 0 ][ 0 ], nr, 10, cols, nc, prob.rho, x ) )
+				continue;
+			const double s = x[ 0 ] < 0 ? -1.0 : 1.0;
+			betas[ 0 ] = std::sqrt( s * x[ 0 ] );
+			for ( std::size_t k = 1; k < nc; k++ )
+				betas[ k ] = s * x[ k ] / betas[ 0 ];
+		}
+		else if ( approx == 1 )
+		{
+			// two-dimensional null space
+			const int cols[ 3 ] = { 0, 1, 2 };
+			if ( !solveLeastSquares( &prob.L[ 0 ][ 0 ], nr, 10, cols, 3, prob.rho, x ) )
+				continue;
+			const double s = x[ 0 ] < 0 ? -1.0 : 1.0;
+			betas[ 0 ] = std::sqrt( s * x[ 0 ] );
+			betas[ 1 ] = s * x[ 2 ] > 0 ? std::sqrt( s * x[ 2 ] ) : 0.0;
+			if ( s * x[ 1 ] < 0 )
+				betas[ 0 ] = -betas[ 0 ];
+		}
+		else
+		{
+			// three-dimensional null space, needs six constraints
+			if ( nc != 4 )
+				continue;
+			const int cols[ 5 ] = { 0, 1, 2, 3, 4 };
+			if ( !solveLeastSquares( &prob.L[ 0 ][ 0 ], nr, 10, cols, 5, prob.rho, x ) )
+				continue;
+			const double s = x[ 0 ] < 0 ? -1.0 : 1.0;
+			betas[ 0 ] = std::sqrt( s * x[ 0 ] );
+			betas[ 1 ] = s * x[ 2 ] > 0 ? std::sqrt( s * x[ 2 ] ) : 0.0;
+			if ( s * x[ 1 ] < 0 )
+				betas[ 0 ] = -betas[ 0 ];
+			betas[ 2 ] = betas[ 0 ] != 0 ? s * x[ 3 ] / betas[ 0 ] : 0.0;
+		}
+		if ( betas[ 0 ] == 0 )
+			continue;
+
+		prob.refineBetas( betas );
+
+		Math::Pose pose;
+		const double fError = prob.computePose( betas, pose );
+		if ( fError < fBest )
+		{
+			fBest = fError;
+			p = pose;
+		}
+	}
+
+	return fBest < std::numeric_limits< double >::max();
+}
+
+} } // namespace Ubitrack::Calibration
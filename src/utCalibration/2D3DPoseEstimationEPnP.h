@@ -0,0 +1,63 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Non-iterative O(n) 2D-3D pose estimation (EPnP).
+ */
+
+#ifndef __UBITRACK_CALIBRATION_2D3DPOSEESTIMATION_EPNP_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_2D3DPOSEESTIMATION_EPNP_H_INCLUDED__
+
+#include <vector>
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+
+namespace Ubitrack { namespace Calibration {
+
+/**
+ * @ingroup tracking_algorithms
+ * EPnP pose estimation of Lepetit, Moreno-Noguer and Fua @cite lepetit2009epnp.
+ *
+ * The object points are expressed as weighted sums of four control points (three for planar
+ * objects). The camera coordinates of the control points are found in the null space of a
+ * 12x12 matrix that is accumulated in O(n), and refined by Gauss-Newton on the distances
+ * between the control points. The result is a good starting point for \c optimizePose.
+ *
+ * @param p the estimated pose
+ * @param p2D points in image coordinates
+ * @param p3D points in object coordinates, at least four if coplanar, otherwise at least five
+ * @param cam camera intrinsics matrix
+ * @return false if the configuration is degenerate
+ */
+UBITRACK_EXPORT bool estimatePoseEPnP( Math::Pose& p,
+	const std::vector< Math::Vector< double, 2 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D,
+	const Math::Matrix< double, 3, 3 >& cam );
+
+} } // namespace Ubitrack::Calibration
+
+#endif
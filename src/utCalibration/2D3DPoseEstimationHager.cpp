@@ -32,233 +32,161 @@
 #include "2D3DPoseEstimationHager.h" 
  
 #include <vector>
-#include <numeric>
-#include <iterator>
-#include <algorithm>
-#include <functional>
 
-#include <utMath/MatrixOperations.h>
-#include <utMath/Functors/VectorNFunctors.h>
-#include <utMath/Functors/Vector3Functors.h>
+#include <utMath/Functors/MatrixFunctors.h>
+#include "AbsoluteOrientation.h"
 
-#include <boost/numeric/ublas/matrix_proxy.hpp>
-
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 static log4cpp::Category& optLogger( log4cpp::Category::getInstance( "Ubitrack.Calibration.2D3DPoseEstimation" ) );
 
-#ifdef HAVE_LAPACK
-#include <boost/numeric/bindings/lapack/gesvd.hpp>
-#endif
-// shortcuts to namespaces
-namespace ublas = boost::numeric::ublas;
-
 namespace Ubitrack { namespace Calibration {
 
 #ifdef HAVE_LAPACK
 
+/** \internal y = A x for fixed-size 3x3 matrices */
 template< typename T >
-Math::Vector< T, 3 > calculateCentroid( const std::vector< Math::Vector< T, 3 > > &points )
-{
-	Math::Vector< T, 3 > centroid = std::accumulate( points.begin(), points.end(), Math::Vector< T, 3 > ( 0, 0, 0 ) );
-	return ( centroid / static_cast< T > ( points.size() ) );
-}
-
-template< typename T >
-Math::Vector< T, 3 > shiftToCenter( std::vector < Math::Vector< T, 3 > > &points )
+inline void multiply3x3( Math::Vector< T, 3 >& y, const Math::Matrix< T, 3, 3 >& A, const Math::Vector< T, 3 >& x )
 {
-	Math::Vector< T, 3 > centroid = calculateCentroid< T >( points );
-	std::transform( points.begin(), points.end(), points.begin()
-		, std::bind2nd( Math::Functors::difference_vector< 3, T >(), centroid ) );
-	return centroid;
+	const T y0 = A( 0, 0 ) * x( 0 ) + A( 0, 1 ) * x( 1 ) + A( 0, 2 ) * x( 2 );
+	const T y1 = A( 1, 0 ) * x( 0 ) + A( 1, 1 ) * x( 1 ) + A( 1, 2 ) * x( 2 );
+	const T y2 = A( 2, 0 ) * x( 0 ) + A( 2, 1 ) * x( 1 ) + A( 2, 2 ) * x( 2 );
+	y( 0 ) = y0;
+	y( 1 ) = y1;
+	y( 2 ) = y2;
 }
 
+/** 
+ * \internal 
+ * One step of the orthogonal iteration: projects the camera points onto the lines of sight,
+ * computes the optimal rotation and translation and returns the new object space error.
+ */
 template< typename T >
-Math::Matrix< T, 3, 3 > calculateTFactorMatrix( const std::vector< Math::Matrix< T, 3, 3 > > &los )
+T abskernel( HagerWorkspace< T >& ws, const Math::Matrix< T, 3, 3 >& Tmatrix, Math::Matrix< T, 3, 3 >& Rot, 
+	Math::Quaternion& q, Math::Vector< T, 3 >& Tr )
 {
-	Math::Matrix< T, 3, 3 > tFactorMatrix( Math::Matrix< T, 3, 3 >::zeros() );
-	tFactorMatrix = std::accumulate( los.begin() , los.end(), tFactorMatrix );
-	tFactorMatrix /= los.size();
-	tFactorMatrix = Math::Matrix< T, 3, 3 >::identity() - tFactorMatrix;
-	tFactorMatrix = Math::invert_matrix( tFactorMatrix );
-	return ( tFactorMatrix / los.size() );
-}
+	const std::size_t n( ws.objectPoints.size() );
 
-template< typename T >
-Math::Matrix< T, 3, 3 > absoluteOrientation( const std::vector< Math::Vector< T, 3 > > &pointsA, const std::vector< Math::Vector< T, 3 > > pointsB )
-{
+	// project camera points onto the lines of sight and move them to the center
+	Math::Vector< T, 3 > centroid( 0, 0, 0 );
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		multiply3x3( ws.cameraPoints[ i ], ws.lineOfSight[ i ], ws.cameraPoints[ i ] );
+		centroid += ws.cameraPoints[ i ];
+	}
+	centroid /= static_cast< T >( n );
 
-	std::vector< Math::Matrix< T, 3, 3 > > matrices;
-	matrices.reserve( pointsA.size() );
-	std::transform( pointsA.begin(), pointsA.end(), pointsB.begin(), std::back_inserter( matrices )
-		, Math::Functors::distinct_outer_product< 3, T >() );
-	
+	// compute the optimal estimate of R
+	// object points are already shifted at the beginning and never being changed
 	Math::Matrix< T, 3, 3 > B( Math::Matrix< T, 3, 3 >::zeros() );
-	B = std::accumulate( matrices.begin(), matrices.end(), B );
-	B /= pointsA.size();
-	
-	if ( Math::determinant( B ) < 0 )
-		B *= -1;
-	Math::Matrix< T, 3, 3 > U;
-	Math::Vector< T, 3 > s;
-	Math::Matrix< T, 3, 3 > Vt;
-	
-	boost::numeric::bindings::lapack::gesvd( 'A', 'A', B, s, U, Vt );
-	Math::Matrix< T, 3, 3 > rotation ( ublas::trans( ublas::prod(  U, Vt ) ) );
-	
-	return rotation;
-}
-
-template< typename T >
-void projectPoints( std::vector< Math::Vector< T, 3 > > &pointsImg, Math::Matrix< T, 3, 3 > &Rot, Math::Vector< T, 3 > &Tr, const std::vector< Math::Vector< T, 3 > > &pointsObj )
-{
-	//prepare Matrix
-	Math::Matrix< T, 3, 4 > projection;
-	ublas::subrange( projection, 0, 3, 0, 3 ) = Rot;
-	ublas::column( projection, 3 ) = Tr;
-	
-	//apply transformation
-	std::transform( pointsObj.begin(), pointsObj.end(), pointsImg.begin()
-		, std::bind1st( Math::Functors::transform3x4_vector3< T >(), projection ) );
-}
-
-template< typename T >
-Math::Vector< T, 3 > estimateTranslation( const std::vector< Math::Matrix< T, 3, 3 > > &Vi, const Math::Matrix< T, 3, 3 > &Rot, const std::vector< Math::Vector< T, 3 > > &pointsObj, const Math::Matrix< T, 3, 3 > &TMatrix )
-{
-	std::vector< Math::Vector< T, 3 > > vec_tmp;
-	vec_tmp.reserve( Vi.size() );
-	std::transform( pointsObj.begin(), pointsObj.end(), std::back_inserter( vec_tmp )
-		, std::bind1st( Math::Functors::transform3x3_vector3< T >(), Rot ) );
-	
-	std::transform( Vi.begin(), Vi.end(), vec_tmp.begin(), vec_tmp.begin()
-		, Math::Functors::transform3x3_vector3< T >() );
-	
-	Math::Vector< T, 3 > translation = std::accumulate( vec_tmp.begin(), vec_tmp.end(), Math::Vector< T, 3 >( 0, 0, 0 ) );
-	translation = ublas::prod( TMatrix, translation );
-	return translation;
-}
-
-/** calculation of object-space-error for STL container*/
-template< typename T >
-struct object_space_error
-	: public std::binary_function< Math::Matrix< T, 3, 3 >, Math::Vector< T, 3 >, T >
-{
-public:
-	T operator() ( const Math::Matrix< T, 3, 3 > &matrix, const Math::Vector< T, 3 >& vec ) const
-    {
-		Math::Matrix< T, 3, 3 > tmp( Math::Matrix< T, 3, 3 >::identity() - matrix );
-		Math::Vector< T, 3 > vec_tmp = ublas::prod( tmp, vec );
-		return ublas::inner_prod( vec_tmp, vec_tmp );
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		const Math::Vector< T, 3 >& a( ws.objectPoints[ i ] );
+		Math::Vector< T, 3 >& c( ws.cameraPoints[ i ] );
+		c -= centroid;
+		for ( std::size_t r( 0 ); r < 3; r++ )
+			for ( std::size_t k( 0 ); k < 3; k++ )
+				B( r, k ) += a( r ) * c( k );
 	}
-};
+	// Horn's method always yields a proper rotation, no need to correct for reflections
+	q = calculateRotationFromCorrelation( Math::Matrix< double, 3, 3 >( B ) );
+	q.toMatrix( Rot );
 
-template< typename T >
-T calculateObjectSpaceError( std::vector< Math::Matrix< T, 3, 3 > > &Vi, std::vector< Math::Vector< T, 3 > > &points  )
-{
-	std::vector< T > ose;
-	ose.reserve( Vi.size() );
-	std::transform( Vi.begin(), Vi.end(), points.begin(), std::back_inserter( ose ), object_space_error< T >() );
-	T sum( 0 );
-	return std::accumulate( ose.begin(), ose.end(), sum );
-}
-
-template< typename T >
-T abskernel( const std::vector< Math::Vector< T, 3 > > &pointsObj, std::vector< Math::Vector< T, 3 > > &pointsImg, std::vector< Math::Matrix< T, 3, 3 > > &Vi, Math::Matrix< T, 3, 3 > &Tmatrix, Math::Matrix< T, 3, 3 > &Rot, Math::Vector< T, 3 > &Tr )
-{		
-
-	std::transform( Vi.begin(), Vi.end(), pointsImg.begin(),  pointsImg.begin(), Math::Functors::transform3x4_vector3< T >() );
-
-	// compute the optimal estimate of R
-	shiftToCenter( pointsImg );
-	// Object Points are already shifted at the beginning and never being changed
-	Rot = absoluteOrientation( pointsObj, pointsImg );
-	
-	
 	// compute new approximation of T
-	Tr = estimateTranslation( Vi, Rot, pointsObj, Tmatrix );
-	
-	//project objects points into camera coordinates
-	projectPoints( pointsImg, Rot, Tr,  pointsObj );
-	
+	Math::Vector< T, 3 > sum( 0, 0, 0 );
+	Math::Vector< T, 3 > tmp;
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		multiply3x3( tmp, Rot, ws.objectPoints[ i ] );
+		multiply3x3( tmp, ws.lineOfSight[ i ], tmp );
+		sum += tmp;
+	}
+	multiply3x3( Tr, Tmatrix, sum );
 
-	T error = calculateObjectSpaceError( Vi, pointsImg );
+	// transform object points into camera coordinates and compute the object space error
+	T error( 0 );
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		Math::Vector< T, 3 >& c( ws.cameraPoints[ i ] );
+		multiply3x3( c, Rot, ws.objectPoints[ i ] );
+		c += Tr;
+		multiply3x3( tmp, ws.lineOfSight[ i ], c );
+		tmp -= c;
+		error += tmp( 0 ) * tmp( 0 ) + tmp( 1 ) * tmp( 1 ) + tmp( 2 ) * tmp( 2 );
+	}
 	return error;
 }
 
 
-/** calculation of line-ofsight-projection-matrix for STL container */
-template< typename T >
-struct lineOfSightProjectionMatrix
-	: public std::binary_function< Math::Vector< T, 3 >, T, Math::Matrix< T, 3, 3 > >
-{
-public:
-    Math::Matrix< T, 3, 3 > operator() ( const Math::Vector< T, 3 > &v, const T& d ) const
-    {
-		Math::Matrix< T, 3, 3 > matrix = ublas::outer_prod( v, v );
-		matrix /= d;
-		return matrix;
-    }
-};
-
-
 /** \internal */
 template< typename T > 
-bool estimatePoseImpl( Math::Pose& p, const std::vector< Math::Vector< T, 3 > >& p2D, std::vector< Math::Vector< T, 3 > >& p3D, 
-	const Math::Matrix< T, 3, 3 >& cam, unsigned &nIterations, T &termination_error  )
+bool estimatePoseImpl( Math::Pose& p, const std::vector< Math::Vector< T, 3 > >& p2D, const std::vector< Math::Vector< T, 3 > >& p3D, 
+	unsigned &nIterations, T &termination_error, HagerWorkspace< T >& ws )
 {
-	// image points should already be moved to the center and homogenized
-	// now just copy the image points, since they will be changed during the algorithm
-	std::vector< Math::Vector< T, 3 > > p2Dh;
-	p2Dh.reserve( p2D.size() );
-	p2Dh.assign( p2D.begin(), p2D.end() );
-	
+	const std::size_t n( p3D.size() );
+	if ( n < 3 || p2D.size() != n )
+	{
+		UBITRACK_LOG_DEBUG( optLogger, "Hager pose estimation needs at least three 2D-3D correspondences" );
+		return false;
+	}
+
+	ws.lineOfSight.resize( n );
+	ws.objectPoints.resize( n );
+	ws.cameraPoints.resize( n );
 
 	// move the 3D object points to coordinate center
-	// this could also be done outside. In repreated usage of this algorithm here is a minimal optimization possibility
-	Math::Vector< T, 3 > center = shiftToCenter( p3D );
-	
+	Math::Vector< T, 3 > center( 0, 0, 0 );
+	for ( std::size_t i( 0 ); i < n; i++ )
+		center += p3D[ i ];
+	center /= static_cast< T >( n );
+	for ( std::size_t i( 0 ); i < n; i++ )
+		noalias( ws.objectPoints[ i ] ) = p3D[ i ] - center;
+
+	// line-of-sight projection matrices of the homogenized image points
+	// which are also the first estimate of the points in camera coordinates
+	Math::Matrix< T, 3, 3 > sumV( Math::Matrix< T, 3, 3 >::zeros() );
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		const Math::Vector< T, 3 >& v( p2D[ i ] );
+		const T d( v( 0 ) * v( 0 ) + v( 1 ) * v( 1 ) + v( 2 ) * v( 2 ) );
+		Math::Matrix< T, 3, 3 >& V( ws.lineOfSight[ i ] );
+		for ( std::size_t r( 0 ); r < 3; r++ )
+			for ( std::size_t c( 0 ); c < 3; c++ )
+				V( r, c ) = v( r ) * v( c ) / d;
+		sumV += V;
+		ws.cameraPoints[ i ] = v;
+	}
 
-	//calculate the inner product for each vector
-	std::vector< T > dotProduct;
-	dotProduct.reserve( p2Dh.size() ); 
-	std::transform( p2Dh.begin(), p2Dh.end(), std::back_inserter( dotProduct ), Math::Functors::inner_product< 3, T > () );
-	
-	
-	//Line-of-sight projection matrices
-	std::vector< Math::Matrix< T, 3, 3 > > Vi;
-	Vi.reserve( p2Dh.size() );
-	std::transform( p2Dh.begin(), p2Dh.end(), dotProduct.begin(), std::back_inserter( Vi ), lineOfSightProjectionMatrix< T >() );
-	
-	
-	//Matrix as a factor for estimation of T
-	Math::Matrix< T, 3, 3 > TfactorMatrix ( calculateTFactorMatrix( Vi ) );
+	// matrix as a factor for estimation of T
+	Math::Matrix< T, 3, 3 > TfactorMatrix( Math::Matrix< T, 3, 3 >::identity() - sumV / static_cast< T >( n ) );
+	TfactorMatrix = Math::Functors::matrix_inverse()( TfactorMatrix );
+	TfactorMatrix /= static_cast< T >( n );
 
-		
 	//starting the algorithm loop to estimate R and T
 	Math::Matrix< T, 3, 3 > R;
+	Math::Quaternion q;
 	Math::Vector< T, 3 > Tr;
 	T error_old, error_new;
 	unsigned iterations = 1;
 	bool converging = true;
 	
-	error_new = abskernel( p3D, p2Dh, Vi, TfactorMatrix, R, Tr );
-	LOG4CPP_TRACE( optLogger, "\nError " << error_new << " after " << iterations << " iterations." );
+	error_new = abskernel( ws, TfactorMatrix, R, q, Tr );
+	UBITRACK_LOG_TRACE( optLogger, "\nError " << error_new << " after " << iterations << " iterations." );
 
 	while( converging )
 	{
 		++iterations;
 		error_old = error_new;
 		
-		error_new = abskernel( p3D, p2Dh, Vi, TfactorMatrix, R, Tr );
+		error_new = abskernel( ws, TfactorMatrix, R, q, Tr );
 		
 		//check termination criterias 
 		converging = ( iterations <= nIterations ) && ( termination_error < error_new ) ;
-		LOG4CPP_TRACE( optLogger, "\nError " << error_new << " after " << iterations << " iterations." );
+		UBITRACK_LOG_TRACE( optLogger, "\nError " << error_new << " after " << iterations << " iterations." );
 	}
 
-	center = ublas::prod( R , center );
+	multiply3x3( center, R, center );
 	Tr -= center;
-	p = Math::Pose( Math::Quaternion( R ).normalize(), Tr  );
-	
+	p = Math::Pose( q.normalize(), Tr );
 	
 	// if z-translation is negative invert pose
 	if( Tr( 2 ) > 0 )
@@ -276,19 +204,35 @@ bool estimatePoseImpl( Math::Pose& p, const std::vector< Math::Vector< T, 3 > >&
 
 
 bool estimatePose( Math::Pose& p, std::vector< Math::Vector< float, 3 > > p2D,
-	std::vector< Math::Vector< float, 3 > > p3D, const Math::Matrix< float, 3, 3 >& cam,
+	std::vector< Math::Vector< float, 3 > > p3D, const Math::Matrix< float, 3, 3 >&,
 	unsigned &nIterations, float &error )
 {
-	LOG4CPP_DEBUG( optLogger, "starting Pose Estimate with float values." );
-	return estimatePoseImpl( p, p2D, p3D, cam, nIterations, error );
+	UBITRACK_LOG_DEBUG( optLogger, "starting Pose Estimate with float values." );
+	HagerWorkspace< float > workspace;
+	return estimatePoseImpl( p, p2D, p3D, nIterations, error, workspace );
 }
 
 bool estimatePose( Math::Pose& p, std::vector< Math::Vector< double, 3 > > p2D,
-	std::vector< Math::Vector< double, 3 > > p3D, const Math::Matrix< double, 3, 3 >& cam,
+	std::vector< Math::Vector< double, 3 > > p3D, const Math::Matrix< double, 3, 3 >&,
 	unsigned &nIterations, double &error )
 {
-	LOG4CPP_DEBUG( optLogger, "starting Pose Estimate with double values." );
-	return estimatePoseImpl( p, p2D, p3D, cam, nIterations, error );
+	UBITRACK_LOG_DEBUG( optLogger, "starting Pose Estimate with double values." );
+	HagerWorkspace< double > workspace;
+	return estimatePoseImpl( p, p2D, p3D, nIterations, error, workspace );
+}
+
+bool estimatePose( Math::Pose& p, const std::vector< Math::Vector< float, 3 > >& p2D,
+	const std::vector< Math::Vector< float, 3 > >& p3D, const Math::Matrix< float, 3, 3 >&,
+	unsigned &nIterations, float &error, HagerWorkspace< float >& workspace )
+{
+	return estimatePoseImpl( p, p2D, p3D, nIterations, error, workspace );
+}
+
+bool estimatePose( Math::Pose& p, const std::vector< Math::Vector< double, 3 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D, const Math::Matrix< double, 3, 3 >&,
+	unsigned &nIterations, double &error, HagerWorkspace< double >& workspace )
+{
+	return estimatePoseImpl( p, p2D, p3D, nIterations, error, workspace );
 }
 
 #endif // HAVE_LAPACK
@@ -70,6 +70,62 @@ UBITRACK_EXPORT bool estimatePose( Math::Pose& p,
 	const Math::Matrix< double, 3, 3 >& cam ,
 	unsigned &nIterations ,
 	double &error );
+
+/**
+ * @ingroup tracking_algorithms
+ * Caller-owned memory for \c estimatePose.
+ *
+ * Keeping one workspace per marker (or per thread) and passing it to every call avoids all
+ * heap allocations once the workspace has grown to the largest number of points.
+ */
+template< typename T >
+struct HagerWorkspace
+{
+	/** line-of-sight projection matrices of the image points */
+	std::vector< Math::Matrix< T, 3, 3 > > lineOfSight;
+
+	/** object points, moved to their centroid */
+	std::vector< Math::Vector< T, 3 > > objectPoints;
+
+	/** current estimate of the points in camera coordinates */
+	std::vector< Math::Vector< T, 3 > > cameraPoints;
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Hager's fast and globally convergent pose estimation @cite lu2000fast.
+ *
+ * Same as above, but takes the points by reference and keeps all intermediate results in
+ * the caller-owned \c workspace. The iteration uses fixed-size 3x3 kernels, the rotation in
+ * each step is computed in closed form from the correlation matrix with Horn's quaternion
+ * method instead of a LAPACK SVD.
+ *
+ * Note: Also exists with \c double parameters.
+ *
+ * @param p the estimated pose
+ * @param p2D image points in homogeneous normalized coordinates
+ * @param p3D points in object coordinates, at least three
+ * @param cam camera intrinsics matrix
+ * @param nIterations maximum number of iterations on input, number of performed iterations on output
+ * @param error object space error at which to stop on input, final object space error on output
+ * @param workspace memory to use for intermediate results
+ * @return true if the algorithm converged to the requested error
+ */
+UBITRACK_EXPORT bool estimatePose( Math::Pose& p,
+	const std::vector< Math::Vector< float, 3 > >& p2D,
+	const std::vector< Math::Vector< float, 3 > >& p3D,
+	const Math::Matrix< float, 3, 3 >& cam,
+	unsigned &nIterations,
+	float &error,
+	HagerWorkspace< float >& workspace );
+
+UBITRACK_EXPORT bool estimatePose( Math::Pose& p,
+	const std::vector< Math::Vector< double, 3 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D,
+	const Math::Matrix< double, 3, 3 >& cam,
+	unsigned &nIterations,
+	double &error,
+	HagerWorkspace< double >& workspace );
 	
 #endif // HAVE_LAPACK
 	
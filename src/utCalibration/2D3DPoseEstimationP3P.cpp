@@ -0,0 +1,252 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implements the P3P minimal solver.
+ */
+
+#include "2D3DPoseEstimationP3P.h"
+
+#include <cmath>
+#include <utMath/PolynomialRoots.h>
+
+namespace Ubitrack { namespace Calibration {
+
+namespace {
+
+inline double dot3( const double* a, const double* b )
+{ return a[ 0 ] * b[ 0 ] + a[ 1 ] * b[ 1 ] + a[ 2 ] * b[ 2 ]; }
+
+inline void cross3( const double* a, const double* b, double* c )
+{
+	c[ 0 ] = a[ 1 ] * b[ 2 ] - a[ 2 ] * b[ 1 ];
+	c[ 1 ] = a[ 2 ] * b[ 0 ] - a[ 0 ] * b[ 2 ];
+	c[ 2 ] = a[ 0 ] * b[ 1 ] - a[ 1 ] * b[ 0 ];
+}
+
+inline bool normalize3( double* a )
+{
+	double l = std::sqrt( dot3( a, a ) );
+	if ( l == 0 )
+		return false;
+	a[ 0 ] /= l; a[ 1 ] /= l; a[ 2 ] /= l;
+	return true;
+}
+
+/** orthonormal frame (as columns of e) spanned by a triangle, first axis along p1 - p0 */
+bool triangleFrame( const double* p0, const double* p1, const double* p2, double e[ 3 ][ 3 ] )
+{
+	double x[ 3 ], y[ 3 ], z[ 3 ];
+	for ( int i = 0; i < 3; i++ )
+	{
+		x[ i ] = p1[ i ] - p0[ i ];
+		y[ i ] = p2[ i ] - p0[ i ];
+	}
+	if ( !normalize3( x ) )
+		return false;
+	cross3( x, y, z );
+	if ( !normalize3( z ) )
+		return false;
+	cross3( z, x, y );
+	for ( int i = 0; i < 3; i++ )
+	{
+		e[ i ][ 0 ] = x[ i ];
+		e[ i ][ 1 ] = y[ i ];
+		e[ i ][ 2 ] = z[ i ];
+	}
+	return true;
+}
+
+/** multiplies polynomials given as coefficients of increasing powers */
+template< std::size_t NA, std::size_t NB >
+void polyMul( const double ( &a )[ NA ], const double ( &b )[ NB ], double ( &c )[ NA + NB - 1 ] )
+{
+	for ( std::size_t i = 0; i < NA + NB - 1; i++ )
+		c[ i ] = 0;
+	for ( std::size_t i = 0; i < NA; i++ )
+		for ( std::size_t j = 0; j < NB; j++ )
+			c[ i + j ] += a[ i ] * b[ j ];
+}
+
+/**
+ * Gauss-Newton refinement of the distances along the rays using the three law of cosines equations.
+ * Improves the accuracy of roots that the quartic only determines poorly (e.g. double roots).
+ */
+void refineDistances( double* s, double c12, double c13, double c23, double a2, double b2, double c2 )
+{
+	for ( int it = 0; it < 2; it++ )
+	{
+		const double r[ 3 ] = {
+			s[ 0 ] * s[ 0 ] + s[ 1 ] * s[ 1 ] - 2 * s[ 0 ] * s[ 1 ] * c12 - a2,
+			s[ 0 ] * s[ 0 ] + s[ 2 ] * s[ 2 ] - 2 * s[ 0 ] * s[ 2 ] * c13 - b2,
+			s[ 1 ] * s[ 1 ] + s[ 2 ] * s[ 2 ] - 2 * s[ 1 ] * s[ 2 ] * c23 - c2 };
+
+		// Jacobian
+		const double J[ 3 ][ 3 ] = {
+			{ 2 * ( s[ 0 ] - s[ 1 ] * c12 ), 2 * ( s[ 1 ] - s[ 0 ] * c12 ), 0 },
+			{ 2 * ( s[ 0 ] - s[ 2 ] * c13 ), 0, 2 * ( s[ 2 ] - s[ 0 ] * c13 ) },
+			{ 0, 2 * ( s[ 1 ] - s[ 2 ] * c23 ), 2 * ( s[ 2 ] - s[ 1 ] * c23 ) } };
+
+		// solve J * delta = r with Cramer's rule
+		double cof[ 3 ];
+		cross3( J[ 1 ], J[ 2 ], cof );
+		const double det = dot3( J[ 0 ], cof );
+		if ( std::fabs( det ) < 1e-12 * ( a2 + b2 + c2 ) * ( s[ 0 ] + s[ 1 ] + s[ 2 ] ) )
+			return;
+
+		double inv[ 3 ][ 3 ];
+		cross3( J[ 1 ], J[ 2 ], inv[ 0 ] );
+		cross3( J[ 2 ], J[ 0 ], inv[ 1 ] );
+		cross3( J[ 0 ], J[ 1 ], inv[ 2 ] );
+		// inverse of J is the transposed cofactor matrix divided by the determinant
+		for ( int i = 0; i < 3; i++ )
+			s[ i ] -= ( inv[ 0 ][ i ] * r[ 0 ] + inv[ 1 ][ i ] * r[ 1 ] + inv[ 2 ][ i ] * r[ 2 ] ) / det;
+	}
+}
+
+} // anonymous namespace
+
+
+Math::Vector< double, 3 > viewingRay( const Math::Vector< double, 2 >& p2D, const Math::Matrix< double, 3, 3 >& invK )
+{
+	Math::Vector< double, 3 > r;
+	for ( std::size_t i = 0; i < 3; i++ )
+		r( i ) = invK( i, 0 ) * p2D( 0 ) + invK( i, 1 ) * p2D( 1 ) + invK( i, 2 );
+	return r;
+}
+
+
+std::size_t p3p( const Math::Vector< double, 3 >* rays, const Math::Vector< double, 3 >* p3D, Math::Pose* poses )
+{
+	double f[ 3 ][ 3 ];
+	double P[ 3 ][ 3 ];
+	for ( int i = 0; i < 3; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+		{
+			f[ i ][ j ] = rays[ i ]( j );
+			P[ i ][ j ] = p3D[ i ]( j );
+		}
+		if ( !normalize3( f[ i ] ) )
+			return 0;
+	}
+
+	// cosines of the angles between the rays
+	const double c12 = dot3( f[ 0 ], f[ 1 ] );
+	const double c13 = dot3( f[ 0 ], f[ 2 ] );
+	const double c23 = dot3( f[ 1 ], f[ 2 ] );
+
+	// squared distances between the points
+	double d[ 3 ];
+	for ( int i = 0; i < 3; i++ )
+		d[ i ] = P[ 1 ][ i ] - P[ 0 ][ i ];
+	const double a2 = dot3( d, d );
+	for ( int i = 0; i < 3; i++ )
+		d[ i ] = P[ 2 ][ i ] - P[ 0 ][ i ];
+	const double b2 = dot3( d, d );
+	for ( int i = 0; i < 3; i++ )
+		d[ i ] = P[ 2 ][ i ] - P[ 1 ][ i ];
+	const double c2 = dot3( d, d );
+	if ( a2 == 0 || b2 == 0 || c2 == 0 )
+		return 0;
+
+	// With distances s1, s2 = u s1, s3 = v s1 along the rays, the law of cosines gives
+	//   (1 + u^2 - 2 u c12) / a^2 = (1 + v^2 - 2 v c13) / b^2 = (u^2 + v^2 - 2 u v c23) / c^2.
+	// Subtracting the two equations quadratic in v yields v = N(u) / D(u), and substituting
+	// back gives a^2 N^2 - 2 a^2 c13 N D + G D^2 = 0 with G = a^2 - b^2 (1 + u^2 - 2 u c12).
+	const double N[ 3 ] = { a2 - b2 + c2, 2 * ( b2 - c2 ) * c12, -( a2 + b2 - c2 ) };
+	const double D[ 2 ] = { 2 * a2 * c13, -2 * a2 * c23 };
+	const double G[ 3 ] = { a2 - b2, 2 * b2 * c12, -b2 };
+
+	double NN[ 5 ], ND[ 4 ], DD[ 3 ], GDD[ 5 ];
+	polyMul( N, N, NN );
+	polyMul( N, D, ND );
+	polyMul( D, D, DD );
+	polyMul( G, DD, GDD );
+
+	double poly[ 5 ];
+	for ( int i = 0; i < 5; i++ )
+		poly[ i ] = a2 * NN[ i ] + GDD[ i ];
+	for ( int i = 0; i < 4; i++ )
+		poly[ i ] -= 2 * a2 * c13 * ND[ i ];
+
+	double roots[ 4 ];
+	std::size_t nRoots = Math::solveQuartic( poly[ 4 ], poly[ 3 ], poly[ 2 ], poly[ 1 ], poly[ 0 ], roots );
+
+	// object frame
+	double Ew[ 3 ][ 3 ];
+	if ( !triangleFrame( P[ 0 ], P[ 1 ], P[ 2 ], Ew ) )
+		return 0;
+
+	std::size_t nSolutions = 0;
+	for ( std::size_t r = 0; r < nRoots; r++ )
+	{
+		const double u = roots[ r ];
+		if ( u <= 0 )
+			continue;
+
+		const double den = D[ 0 ] + D[ 1 ] * u;
+		if ( std::fabs( den ) < 1e-12 * a2 )
+			continue;
+		const double v = ( N[ 0 ] + ( N[ 1 ] + N[ 2 ] * u ) * u ) / den;
+		if ( v <= 0 )
+			continue;
+
+		const double q = 1 + u * u - 2 * u * c12;
+		if ( q <= 0 )
+			continue;
+		const double s1 = std::sqrt( a2 / q );
+		double s[ 3 ] = { s1, u * s1, v * s1 };
+		refineDistances( s, c12, c13, c23, a2, b2, c2 );
+
+		// points in camera coordinates
+		double X[ 3 ][ 3 ];
+		for ( int i = 0; i < 3; i++ )
+			for ( int j = 0; j < 3; j++ )
+				X[ i ][ j ] = s[ i ] * f[ i ][ j ];
+
+		// rotation that maps the object triangle frame to the camera triangle frame
+		double Ec[ 3 ][ 3 ];
+		if ( !triangleFrame( X[ 0 ], X[ 1 ], X[ 2 ], Ec ) )
+			continue;
+
+		Math::Matrix< double, 3, 3 > R;
+		for ( int i = 0; i < 3; i++ )
+			for ( int j = 0; j < 3; j++ )
+				R( i, j ) = Ec[ i ][ 0 ] * Ew[ j ][ 0 ] + Ec[ i ][ 1 ] * Ew[ j ][ 1 ] + Ec[ i ][ 2 ] * Ew[ j ][ 2 ];
+
+		Math::Vector< double, 3 > t;
+		for ( int i = 0; i < 3; i++ )
+			t( i ) = X[ 0 ][ i ] - ( R( i, 0 ) * P[ 0 ][ 0 ] + R( i, 1 ) * P[ 0 ][ 1 ] + R( i, 2 ) * P[ 0 ][ 2 ] );
+
+		poses[ nSolutions++ ] = Math::Pose( Math::Quaternion::fromMatrix( R ), t );
+		if ( nSolutions == 4 )
+			break;
+	}
+
+	return nSolutions;
+}
+
+} } // namespace Ubitrack::Calibration
@@ -0,0 +1,74 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Minimal solver for the perspective-three-point problem.
+ */
+
+#ifndef __UBITRACK_CALIBRATION_2D3DPOSEESTIMATION_P3P_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_2D3DPOSEESTIMATION_P3P_H_INCLUDED__
+
+#include <cstddef>
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+
+namespace Ubitrack { namespace Calibration {
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the poses of a calibrated camera that observes three known 3D points (P3P).
+ *
+ * Grunert's formulation: the three distances along the viewing rays are related by the law of
+ * cosines, which reduces to a quartic in the ratio of two distances. The quartic is solved in
+ * closed form and each positive solution is aligned with the object points. No memory is
+ * allocated, which makes the function suitable as a minimal solver in RANSAC.
+ *
+ * The viewing rays may be computed as \f$ K^{-1} (x, y, 1)^T \f$. They must point towards the
+ * observed points, which is the case for both the usual and the Ubitrack (OpenGL-style)
+ * definition of the intrinsics matrix.
+ *
+ * @param rays viewing rays of the three points in camera coordinates, need not be normalized
+ * @param p3D the three points in object coordinates
+ * @param poses array of four elements which receives the solutions (object to camera)
+ * @return number of solutions, at most four
+ */
+UBITRACK_EXPORT std::size_t p3p( const Math::Vector< double, 3 >* rays, const Math::Vector< double, 3 >* p3D,
+	Math::Pose* poses );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the viewing ray \f$ K^{-1} (x, y, 1)^T \f$ of an image point.
+ *
+ * @param p2D point in image coordinates
+ * @param invK inverse of the camera intrinsics matrix
+ * @return ray in camera coordinates, not normalized
+ */
+UBITRACK_EXPORT Math::Vector< double, 3 > viewingRay( const Math::Vector< double, 2 >& p2D, const Math::Matrix< double, 3, 3 >& invK );
+
+} } // namespace Ubitrack::Calibration
+
+#endif
@@ -31,11 +31,18 @@
 
 #include "3DPointReconstruction.h"
 
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <boost/bind.hpp>
+
 #include <utUtil/Logging.h>
 #include <utUtil/Exception.h>
 #include <utMath/GaussNewton.h>
 #include <utMath/Graph/Munkres.h>
+#include <utMath/Graph/LinearAssignment.h>
 #include <utMath/LevenbergMarquardt.h>
+#include <utMath/ParallelEvaluation.h>
 #include <utCalibration/Function/SinglePointMultiProjection.h>
 
 namespace ublas = boost::numeric::ublas;
@@ -83,6 +90,360 @@ double pointToPointDist( const Math::Vector< double, 3 > & from, const Math::Vec
 	return pointToPointDistImp( from, to, fM );
 }
 
+/**
+ * \internal
+ * Finds for each point of the first image the points of the second image within \c maxDistance
+ * of its epipolar line, stored in compressed rows.
+ */
+template< typename T >
+void epipolarCandidates( const std::vector< Math::Vector< T, 2 > >& p1, const std::vector< Math::Vector< T, 2 > >& p2,
+	const Math::Matrix< T, 3, 3 >& fM, T maxDistance, std::vector< std::size_t >& rowStart, 
+	std::vector< std::size_t >& candidates, std::vector< T >& costs )
+{
+	const std::size_t n2( p2.size() );
+	rowStart.assign( 1, 0 );
+	candidates.clear();
+	costs.clear();
+	if ( n2 == 0 )
+	{
+		rowStart.resize( p1.size() + 1, 0 );
+		return;
+	}
+
+	// uniform grid over the bounding box of the second image's points, about one point per cell
+	T minX( p2[ 0 ]( 0 ) ), maxX( minX ), minY( p2[ 0 ]( 1 ) ), maxY( minY );
+	for ( std::size_t j( 1 ); j < n2; j++ )
+	{
+		minX = std::min( minX, p2[ j ]( 0 ) );
+		maxX = std::max( maxX, p2[ j ]( 0 ) );
+		minY = std::min( minY, p2[ j ]( 1 ) );
+		maxY = std::max( maxY, p2[ j ]( 1 ) );
+	}
+	T cellSize( std::max( maxDistance, std::sqrt( ( maxX - minX ) * ( maxY - minY ) / T( n2 ) ) ) );
+	if ( !( cellSize > 0 ) )
+		cellSize = 1;
+	const std::size_t nx( static_cast< std::size_t >( ( maxX - minX ) / cellSize ) + 1 );
+	const std::size_t ny( static_cast< std::size_t >( ( maxY - minY ) / cellSize ) + 1 );
+
+	// bucket the points by cell
+	std::vector< std::size_t > cellStart( nx * ny + 1, 0 );
+	std::vector< std::size_t > cellOf( n2 );
+	for ( std::size_t j( 0 ); j < n2; j++ )
+	{
+		const std::size_t cx( std::min( nx - 1, static_cast< std::size_t >( ( p2[ j ]( 0 ) - minX ) / cellSize ) ) );
+		const std::size_t cy( std::min( ny - 1, static_cast< std::size_t >( ( p2[ j ]( 1 ) - minY ) / cellSize ) ) );
+		cellOf[ j ] = cy * nx + cx;
+		cellStart[ cellOf[ j ] + 1 ]++;
+	}
+	for ( std::size_t c( 0 ); c < nx * ny; c++ )
+		cellStart[ c + 1 ] += cellStart[ c ];
+	std::vector< std::size_t > cellPoints( n2 );
+	{
+		std::vector< std::size_t > fill( cellStart.begin(), cellStart.end() - 1 );
+		for ( std::size_t j( 0 ); j < n2; j++ )
+			cellPoints[ fill[ cellOf[ j ] ]++ ] = j;
+	}
+
+	const T maxDistance2( maxDistance * maxDistance );
+	for ( std::size_t i( 0 ); i < p1.size(); i++ )
+	{
+		// normalized epipolar line a x + b y + c = 0 in the second image
+		T a( fM( 0, 0 ) * p1[ i ]( 0 ) + fM( 0, 1 ) * p1[ i ]( 1 ) + fM( 0, 2 ) );
+		T b( fM( 1, 0 ) * p1[ i ]( 0 ) + fM( 1, 1 ) * p1[ i ]( 1 ) + fM( 1, 2 ) );
+		T c( fM( 2, 0 ) * p1[ i ]( 0 ) + fM( 2, 1 ) * p1[ i ]( 1 ) + fM( 2, 2 ) );
+		const T norm( std::sqrt( a * a + b * b ) );
+		if ( norm > 0 )
+		{
+			a /= norm;
+			b /= norm;
+			c /= norm;
+
+			// walk along the major direction of the line, visiting the cells of the band around it
+			const bool bAlongX( std::fabs( b ) >= std::fabs( a ) );
+			const T u( bAlongX ? a : b );
+			const T v( bAlongX ? b : a );
+			const T minU( bAlongX ? minX : minY );
+			const T minV( bAlongX ? minY : minX );
+			const std::size_t nu( bAlongX ? nx : ny );
+			const std::size_t nv( bAlongX ? ny : nx );
+			const T halfWidth( maxDistance / std::fabs( v ) );
+
+			for ( std::size_t cu( 0 ); cu < nu; cu++ )
+			{
+				const T u0( minU + cu * cellSize );
+				const T v0( -( u * u0 + c ) / v );
+				const T v1( -( u * ( u0 + cellSize ) + c ) / v );
+				const T vLow( ( std::min( v0, v1 ) - halfWidth - minV ) / cellSize );
+				const T vHigh( ( std::max( v0, v1 ) + halfWidth - minV ) / cellSize );
+				if ( !( vHigh >= 0 && vLow < T( nv ) ) )
+					continue;
+				const std::size_t cvBegin( vLow > 0 ? static_cast< std::size_t >( vLow ) : 0 );
+				const std::size_t cvEnd( std::min( nv, static_cast< std::size_t >( vHigh ) + 1 ) );
+
+				for ( std::size_t cv( cvBegin ); cv < cvEnd; cv++ )
+				{
+					const std::size_t cell( bAlongX ? cv * nx + cu : cu * nx + cv );
+					for ( std::size_t k( cellStart[ cell ] ); k < cellStart[ cell + 1 ]; k++ )
+					{
+						const std::size_t j( cellPoints[ k ] );
+						const T d( a * p2[ j ]( 0 ) + b * p2[ j ]( 1 ) + c );
+						if ( d * d <= maxDistance2 )
+						{
+							candidates.push_back( j );
+							costs.push_back( d * d );
+						}
+					}
+				}
+			}
+		}
+		rowStart.push_back( candidates.size() );
+	}
+}
+
+
+/** \internal */
+template< typename T >
+std::vector< std::pair< std::size_t, std::size_t > > matchEpipolarImpl( const std::vector< Math::Vector< T, 2 > >& p1, 
+	const std::vector< Math::Vector< T, 2 > >& p2, const Math::Matrix< T, 3, 3 >& fM, T maxDistance )
+{
+	std::vector< std::size_t > rowStart;
+	std::vector< std::size_t > candidates;
+	std::vector< T > costs;
+	epipolarCandidates( p1, p2, fM, maxDistance, rowStart, candidates, costs );
+
+	Math::Graph::LinearAssignment< T > assignment;
+	assignment.solve( p1.size(), p2.size(), rowStart, candidates, costs );
+
+	std::vector< std::pair< std::size_t, std::size_t > > matches;
+	const std::vector< std::size_t >& matchList( assignment.getRowMatchList() );
+	for ( std::size_t i( 0 ); i < p1.size(); i++ )
+		if ( matchList[ i ] < p2.size() )
+			matches.push_back( std::make_pair( i, matchList[ i ] ) );
+
+	return matches;
+}
+
+std::vector< std::pair< std::size_t, std::size_t > > matchEpipolar( const std::vector< Math::Vector< float, 2 > >& p1, 
+	const std::vector< Math::Vector< float, 2 > >& p2, const Math::Matrix< float, 3, 3 >& fM, float maxDistance )
+{
+	return matchEpipolarImpl( p1, p2, fM, maxDistance );
+}
+
+std::vector< std::pair< std::size_t, std::size_t > > matchEpipolar( const std::vector< Math::Vector< double, 2 > >& p1, 
+	const std::vector< Math::Vector< double, 2 > >& p2, const Math::Matrix< double, 3, 3 >& fM, double maxDistance )
+{
+	return matchEpipolarImpl( p1, p2, fM, maxDistance );
+}
+
+
+/** \internal number of points that are triangulated together */
+static const std::size_t g_triangulationBlockSize = 64;
+
+/**
+ * \internal
+ * Symmetric 3x3 normal equations A x = b of a block of points, stored as the upper triangle
+ * a[ 0..5 ] = ( A00, A01, A02, A11, A12, A22 ).
+ */
+struct NormalEquationsBlock
+{
+	double a[ 6 ][ g_triangulationBlockSize ];
+	double b[ 3 ][ g_triangulationBlockSize ];
+
+	void clear()
+	{
+		std::fill( &a[ 0 ][ 0 ], &a[ 0 ][ 0 ] + 6 * g_triangulationBlockSize, 0.0 );
+		std::fill( &b[ 0 ][ 0 ], &b[ 0 ][ 0 ] + 3 * g_triangulationBlockSize, 0.0 );
+	}
+
+	/** adds the equation r^T x = rhs with weight w for point k */
+	void add( std::size_t k, double w, double r0, double r1, double r2, double rhs )
+	{
+		a[ 0 ][ k ] += w * r0 * r0;
+		a[ 1 ][ k ] += w * r0 * r1;
+		a[ 2 ][ k ] += w * r0 * r2;
+		a[ 3 ][ k ] += w * r1 * r1;
+		a[ 4 ][ k ] += w * r1 * r2;
+		a[ 5 ][ k ] += w * r2 * r2;
+		b[ 0 ][ k ] += w * r0 * rhs;
+		b[ 1 ][ k ] += w * r1 * rhs;
+		b[ 2 ][ k ] += w * r2 * rhs;
+	}
+
+	/** solves the first n systems with Cramer's rule */
+	void solve( double ( &x )[ 3 ][ g_triangulationBlockSize ], std::size_t n ) const
+	{
+		for ( std::size_t k( 0 ); k < n; k++ )
+		{
+			const double c00( a[ 3 ][ k ] * a[ 5 ][ k ] - a[ 4 ][ k ] * a[ 4 ][ k ] );
+			const double c01( a[ 2 ][ k ] * a[ 4 ][ k ] - a[ 1 ][ k ] * a[ 5 ][ k ] );
+			const double c02( a[ 1 ][ k ] * a[ 4 ][ k ] - a[ 2 ][ k ] * a[ 3 ][ k ] );
+			const double c11( a[ 0 ][ k ] * a[ 5 ][ k ] - a[ 2 ][ k ] * a[ 2 ][ k ] );
+			const double c12( a[ 1 ][ k ] * a[ 2 ][ k ] - a[ 0 ][ k ] * a[ 4 ][ k ] );
+			const double c22( a[ 0 ][ k ] * a[ 3 ][ k ] - a[ 1 ][ k ] * a[ 1 ][ k ] );
+			const double invDet( 1.0 / ( a[ 0 ][ k ] * c00 + a[ 1 ][ k ] * c01 + a[ 2 ][ k ] * c02 ) );
+			x[ 0 ][ k ] = ( c00 * b[ 0 ][ k ] + c01 * b[ 1 ][ k ] + c02 * b[ 2 ][ k ] ) * invDet;
+			x[ 1 ][ k ] = ( c01 * b[ 0 ][ k ] + c11 * b[ 1 ][ k ] + c12 * b[ 2 ][ k ] ) * invDet;
+			x[ 2 ][ k ] = ( c02 * b[ 0 ][ k ] + c12 * b[ 1 ][ k ] + c22 * b[ 2 ][ k ] ) * invDet;
+		}
+	}
+};
+
+
+/**
+ * \internal
+ * Triangulates the points [begin, end).
+ */
+template< typename T >
+void triangulatePointsRange( const std::vector< Math::Matrix< T, 3, 4 > >& P, const MultiViewObservations< T >& observations,
+	std::vector< Math::Vector< T, 3 > >& points, std::vector< T >& residuals, unsigned nRefinementSteps,
+	std::size_t begin, std::size_t end )
+{
+	const std::size_t nPoints( observations.nPoints );
+	const std::size_t nCameras( observations.nCameras );
+
+	NormalEquationsBlock equations;
+	double X[ 3 ][ g_triangulationBlockSize ];
+	double delta[ 3 ][ g_triangulationBlockSize ];
+	double error[ g_triangulationBlockSize ];
+	double count[ g_triangulationBlockSize ];
+
+	for ( std::size_t iBlock( begin ); iBlock < end; iBlock += g_triangulationBlockSize )
+	{
+		const std::size_t n( std::min( g_triangulationBlockSize, end - iBlock ) );
+
+		// linear triangulation: x P_3 X - P_1 X = 0 and y P_3 X - P_2 X = 0 with X = ( X0, X1, X2, 1 )
+		equations.clear();
+		std::fill( count, count + n, 0.0 );
+		for ( std::size_t c( 0 ); c < nCameras; c++ )
+		{
+			const Math::Matrix< T, 3, 4 >& Pc( P[ c ] );
+			const double p00( Pc( 0, 0 ) ), p01( Pc( 0, 1 ) ), p02( Pc( 0, 2 ) ), p03( Pc( 0, 3 ) );
+			const double p10( Pc( 1, 0 ) ), p11( Pc( 1, 1 ) ), p12( Pc( 1, 2 ) ), p13( Pc( 1, 3 ) );
+			const double p20( Pc( 2, 0 ) ), p21( Pc( 2, 1 ) ), p22( Pc( 2, 2 ) ), p23( Pc( 2, 3 ) );
+			const T* x = &observations.x[ c * nPoints + iBlock ];
+			const T* y = &observations.y[ c * nPoints + iBlock ];
+			const unsigned char* v = &observations.visible[ c * nPoints + iBlock ];
+
+			for ( std::size_t k( 0 ); k < n; k++ )
+			{
+				const double w( v[ k ] );
+				const double xk( x[ k ] );
+				const double yk( y[ k ] );
+				equations.add( k, w, xk * p20 - p00, xk * p21 - p01, xk * p22 - p02, p03 - xk * p23 );
+				equations.add( k, w, yk * p20 - p10, yk * p21 - p11, yk * p22 - p12, p13 - yk * p23 );
+				count[ k ] += w;
+			}
+		}
+		equations.solve( X, n );
+
+		// Gauss-Newton on the reprojection error, with analytic 2x3 Jacobians per view
+		for ( unsigned iStep( 0 ); iStep < nRefinementSteps; iStep++ )
+		{
+			equations.clear();
+			for ( std::size_t c( 0 ); c < nCameras; c++ )
+			{
+				const Math::Matrix< T, 3, 4 >& Pc( P[ c ] );
+				const double p00( Pc( 0, 0 ) ), p01( Pc( 0, 1 ) ), p02( Pc( 0, 2 ) ), p03( Pc( 0, 3 ) );
+				const double p10( Pc( 1, 0 ) ), p11( Pc( 1, 1 ) ), p12( Pc( 1, 2 ) ), p13( Pc( 1, 3 ) );
+				const double p20( Pc( 2, 0 ) ), p21( Pc( 2, 1 ) ), p22( Pc( 2, 2 ) ), p23( Pc( 2, 3 ) );
+				const T* x = &observations.x[ c * nPoints + iBlock ];
+				const T* y = &observations.y[ c * nPoints + iBlock ];
+				const unsigned char* v = &observations.visible[ c * nPoints + iBlock ];
+
+				for ( std::size_t k( 0 ); k < n; k++ )
+				{
+					const double u0( p00 * X[ 0 ][ k ] + p01 * X[ 1 ][ k ] + p02 * X[ 2 ][ k ] + p03 );
+					const double u1( p10 * X[ 0 ][ k ] + p11 * X[ 1 ][ k ] + p12 * X[ 2 ][ k ] + p13 );
+					const double u2( p20 * X[ 0 ][ k ] + p21 * X[ 1 ][ k ] + p22 * X[ 2 ][ k ] + p23 );
+					const double iz( v[ k ] ? 1.0 / u2 : 0.0 );
+					const double px( u0 * iz );
+					const double py( u1 * iz );
+
+					// J dX = -e, invisible views have zero Jacobian and residual
+					equations.add( k, 1.0, ( p00 - px * p20 ) * iz, ( p01 - px * p21 ) * iz, ( p02 - px * p22 ) * iz, 
+						v[ k ] * ( x[ k ] - px ) );
+					equations.add( k, 1.0, ( p10 - py * p20 ) * iz, ( p11 - py * p21 ) * iz, ( p12 - py * p22 ) * iz, 
+						v[ k ] * ( y[ k ] - py ) );
+				}
+			}
+			equations.solve( delta, n );
+			for ( std::size_t k( 0 ); k < n; k++ )
+			{
+				X[ 0 ][ k ] += delta[ 0 ][ k ];
+				X[ 1 ][ k ] += delta[ 1 ][ k ];
+				X[ 2 ][ k ] += delta[ 2 ][ k ];
+			}
+		}
+
+		// reprojection errors
+		std::fill( error, error + n, 0.0 );
+		for ( std::size_t c( 0 ); c < nCameras; c++ )
+		{
+			const Math::Matrix< T, 3, 4 >& Pc( P[ c ] );
+			const T* x = &observations.x[ c * nPoints + iBlock ];
+			const T* y = &observations.y[ c * nPoints + iBlock ];
+			const unsigned char* v = &observations.visible[ c * nPoints + iBlock ];
+
+			for ( std::size_t k( 0 ); k < n; k++ )
+			{
+				const double u0( Pc( 0, 0 ) * X[ 0 ][ k ] + Pc( 0, 1 ) * X[ 1 ][ k ] + Pc( 0, 2 ) * X[ 2 ][ k ] + Pc( 0, 3 ) );
+				const double u1( Pc( 1, 0 ) * X[ 0 ][ k ] + Pc( 1, 1 ) * X[ 1 ][ k ] + Pc( 1, 2 ) * X[ 2 ][ k ] + Pc( 1, 3 ) );
+				const double u2( Pc( 2, 0 ) * X[ 0 ][ k ] + Pc( 2, 1 ) * X[ 1 ][ k ] + Pc( 2, 2 ) * X[ 2 ][ k ] + Pc( 2, 3 ) );
+				const double iz( v[ k ] ? 1.0 / u2 : 0.0 );
+				const double ex( v[ k ] * ( x[ k ] - u0 * iz ) );
+				const double ey( v[ k ] * ( y[ k ] - u1 * iz ) );
+				error[ k ] += ex * ex + ey * ey;
+			}
+		}
+
+		for ( std::size_t k( 0 ); k < n; k++ )
+			if ( count[ k ] >= 2.0 )
+			{
+				points[ iBlock + k ] = Math::Vector< T, 3 >( T( X[ 0 ][ k ] ), T( X[ 1 ][ k ] ), T( X[ 2 ][ k ] ) );
+				residuals[ iBlock + k ] = T( std::sqrt( error[ k ] / count[ k ] ) );
+			}
+			else
+			{
+				points[ iBlock + k ] = Math::Vector< T, 3 >( T( 0 ), T( 0 ), T( 0 ) );
+				residuals[ iBlock + k ] = std::numeric_limits< T >::infinity();
+			}
+	}
+}
+
+
+/** \internal */
+template< typename T >
+void triangulatePointsImpl( const std::vector< Math::Matrix< T, 3, 4 > >& P, const MultiViewObservations< T >& observations,
+	std::vector< Math::Vector< T, 3 > >& points, std::vector< T >& residuals, unsigned nRefinementSteps, unsigned nThreads )
+{
+	if ( P.size() != observations.nCameras )
+		UBITRACK_THROW( "Number of projection matrices does not match the observations" );
+	if ( observations.x.size() != observations.nCameras * observations.nPoints || 
+		observations.y.size() != observations.x.size() || observations.visible.size() != observations.x.size() )
+		UBITRACK_THROW( "Inconsistent size of the observations" );
+
+	const std::size_t n( observations.nPoints );
+	points.resize( n );
+	residuals.resize( n );
+
+	// contiguous ranges of whole blocks
+	Math::parallelRanges( Math::ThreadRanges( n, nThreads, g_triangulationBlockSize ), boost::bind( &triangulatePointsRange< T >,
+		boost::cref( P ), boost::cref( observations ), boost::ref( points ), boost::ref( residuals ), nRefinementSteps, _2, _3 ) );
+}
+
+void triangulatePoints( const std::vector< Math::Matrix< float, 3, 4 > >& P, const MultiViewObservations< float >& observations,
+	std::vector< Math::Vector< float, 3 > >& points, std::vector< float >& residuals, unsigned nRefinementSteps, unsigned nThreads )
+{
+	triangulatePointsImpl( P, observations, points, residuals, nRefinementSteps, nThreads );
+}
+
+void triangulatePoints( const std::vector< Math::Matrix< double, 3, 4 > >& P, const MultiViewObservations< double >& observations,
+	std::vector< Math::Vector< double, 3 > >& points, std::vector< double >& residuals, unsigned nRefinementSteps, unsigned nThreads )
+{
+	triangulatePointsImpl( P, observations, points, residuals, nRefinementSteps, nThreads );
+}
+
+
 /** internal of get3DPostion function */
 #ifdef HAVE_LAPACK
 template< typename T >
@@ -276,6 +637,33 @@ std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector<
 	return reconstruct3DPointsImpl( p1, p2, P1, P2, fM );
 }
 
+/** internal of the gated reconstruct3DPoints function */
+template< typename T >
+std::vector< Math::Vector< T, 3 > > reconstruct3DPointsGatedImpl( const std::vector< Math::Vector< T, 2 > > & p1, const std::vector< Math::Vector< T, 2 > > & p2,
+	const Math::Matrix< T, 3, 4 > & P1, const Math::Matrix< T, 3, 4 > & P2, const Math::Matrix< T, 3, 3 > & fM, T maxDistance )
+{
+	const std::vector< std::pair< std::size_t, std::size_t > > matches( matchEpipolar( p1, p2, fM, maxDistance ) );
+
+	std::vector< Math::Vector< T, 3 > > list;
+	list.reserve( matches.size() );
+	for( std::size_t i( 0 ); i < matches.size(); ++i )
+		list.push_back( get3DPosition( P1, P2, p1[ matches[ i ].first ], p2[ matches[ i ].second ] ) );
+
+	return list;
+}
+
+std::vector< Math::Vector< float, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< float, 2 > > & p1, const std::vector< Math::Vector< float, 2 > > & p2,
+	const Math::Matrix< float, 3, 4 > & P1, const Math::Matrix< float, 3, 4 > & P2, const Math::Matrix< float, 3, 3 > & fM, float maxDistance )
+{
+	return reconstruct3DPointsGatedImpl( p1, p2, P1, P2, fM, maxDistance );
+}
+
+std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< double, 2 > > & p1, const std::vector< Math::Vector< double, 2 > > & p2,
+	const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM, double maxDistance )
+{
+	return reconstruct3DPointsGatedImpl( p1, p2, P1, P2, fM, maxDistance );
+}
+
 #endif // HAVE_LAPACK
 
 } } // namespace Ubitrack::Calibration
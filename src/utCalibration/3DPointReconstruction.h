@@ -34,12 +34,120 @@
 #define __UBITRACK_CALIBRATION_3DPOINTRECONSTRUCTION_H_INCLUDED__
 
 
+#include <vector>
+#include <utility>
 #include <utCore.h>
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
 
 namespace Ubitrack { namespace Calibration {
 
+/**
+ * @ingroup tracking_algorithms
+ * Image observations of many points by several cameras in structure-of-arrays layout.
+ *
+ * The observation of point \c i by camera \c c is stored at index \c c * nPoints + i of the arrays,
+ * so consecutive points of one camera are contiguous in memory.
+ */
+template< typename T >
+struct MultiViewObservations
+{
+	/** number of cameras */
+	std::size_t nCameras;
+
+	/** number of points */
+	std::size_t nPoints;
+
+	/** x image coordinates */
+	std::vector< T > x;
+
+	/** y image coordinates */
+	std::vector< T > y;
+
+	/** 1 if the point is seen by the camera, 0 otherwise */
+	std::vector< unsigned char > visible;
+
+	/** creates an empty set of observations */
+	MultiViewObservations()
+		: nCameras( 0 )
+		, nPoints( 0 )
+	{}
+
+	/** sets the size, all points are marked invisible */
+	void resize( std::size_t cameras, std::size_t points )
+	{
+		nCameras = cameras;
+		nPoints = points;
+		x.assign( cameras * points, T( 0 ) );
+		y.assign( cameras * points, T( 0 ) );
+		visible.assign( cameras * points, 0 );
+	}
+
+	/** sets the observation of point \c i by camera \c c and marks it visible */
+	void set( std::size_t c, std::size_t i, const Math::Vector< T, 2 >& p )
+	{
+		x[ c * nPoints + i ] = p( 0 );
+		y[ c * nPoints + i ] = p( 1 );
+		visible[ c * nPoints + i ] = 1;
+	}
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Triangulates many points seen by several cameras at once.
+ *
+ * For each point, the linear constraints x P_3 X - P_1 X = 0 and y P_3 X - P_2 X = 0 of all cameras
+ * that see it are written for the inhomogeneous point X = ( X0, X1, X2, 1 ). Their least-squares
+ * solution is found from the 3x3 normal equations with Cramer's rule. Optionally, a few
+ * Gauss-Newton steps on the reprojection error follow.
+ * The points are processed in blocks, in loops over the structure-of-arrays observations that the
+ * compiler can vectorize, and can be split into \c nThreads ranges processed in parallel.
+ * Points at infinity cannot be represented.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param P projection matrices of the cameras
+ * @param observations image points and visibility of all points in all cameras
+ * @param points receives the 3D points, zero for points seen by less than two cameras
+ * @param residuals receives the RMS reprojection error of each point, infinity for points seen by less than two cameras
+ * @param nRefinementSteps number of Gauss-Newton steps
+ * @param nThreads number of threads to use
+ */
+UBITRACK_EXPORT void triangulatePoints( const std::vector< Math::Matrix< float, 3, 4 > >& P, 
+	const MultiViewObservations< float >& observations, std::vector< Math::Vector< float, 3 > >& points, 
+	std::vector< float >& residuals, unsigned nRefinementSteps = 0, unsigned nThreads = 1 );
+
+UBITRACK_EXPORT void triangulatePoints( const std::vector< Math::Matrix< double, 3, 4 > >& P, 
+	const MultiViewObservations< double >& observations, std::vector< Math::Vector< double, 3 > >& points, 
+	std::vector< double >& residuals, unsigned nRefinementSteps = 0, unsigned nThreads = 1 );
+
+/**
+ * @ingroup tracking_algorithms
+ * Matches two sets of image points using the epipolar constraint.
+ *
+ * Only pairs where the point in the second image lies within \c maxDistance of the epipolar line
+ * of the point in the first image are considered. These candidates are found by walking the
+ * epipolar lines through a uniform grid over the points of the second image, which avoids
+ * evaluating all pairs. The candidates form a sparse assignment problem, which is solved with
+ * Graph::LinearAssignment, maximizing the number of matches first and then minimizing the sum of 
+ * squared distances ( a x2 + b y2 + c )^2 / ( a^2 + b^2 ) of the points in the second image to
+ * the epipolar lines ( a, b, c ) = F x1 of their matches. The distance is measured in the second
+ * image only, not symmetrically in both.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param p1 points in the first image
+ * @param p2 points in the second image
+ * @param fM the fundamental matrix, x2^T F x1 = 0
+ * @param maxDistance maximum distance of a point to the epipolar line of its match
+ * @return pairs of indices into \c p1 and \c p2
+ */
+UBITRACK_EXPORT std::vector< std::pair< std::size_t, std::size_t > > matchEpipolar( const std::vector< Math::Vector< float, 2 > >& p1, 
+	const std::vector< Math::Vector< float, 2 > >& p2, const Math::Matrix< float, 3, 3 >& fM, float maxDistance );
+
+UBITRACK_EXPORT std::vector< std::pair< std::size_t, std::size_t > > matchEpipolar( const std::vector< Math::Vector< double, 2 > >& p1, 
+	const std::vector< Math::Vector< double, 2 > >& p2, const Math::Matrix< double, 3, 3 >& fM, double maxDistance );
+
 /**
  * @ingroup tracking_algorithms
  * Computes the distance between a point and the epipole of the other point in the same picture
@@ -102,6 +210,31 @@ UBITRACK_EXPORT std::vector< Math::Vector< float, 3 > > reconstruct3DPoints( con
 UBITRACK_EXPORT std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< double, 2 > > & p1, const std::vector< Math::Vector< double, 2 > > & p2,
 																			const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM );
 
+/**
+ * @ingroup tracking_algorithms
+ * Reconstructs 3D points from two sets of 2D points, matching only points within \c maxDistance
+ * of each other's epipolar line.
+ *
+ * Unlike the version above, which solves a dense assignment over all pairs, the points are matched
+ * with \c matchEpipolar, which scales to hundreds of points per image. Points without a match
+ * inside the gate are dropped.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param p1 a vector of 2D points from the first camera
+ * @param p2 a vector of 2D points from the second camera
+ * @param P1 the projection matrix of the first camera
+ * @param P2 the projection matrix of the second camera
+ * @param fM the fundamental matrix
+ * @param maxDistance maximum distance of a point to the epipolar line of its match
+ * @return a vector of 3D points
+ */
+UBITRACK_EXPORT std::vector< Math::Vector< float, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< float, 2 > > & p1, const std::vector< Math::Vector< float, 2 > > & p2,
+	const Math::Matrix< float, 3, 4 > & P1, const Math::Matrix< float, 3, 4 > & P2, const Math::Matrix< float, 3, 3 > & fM, float maxDistance );
+
+UBITRACK_EXPORT std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< double, 2 > > & p1, const std::vector< Math::Vector< double, 2 > > & p2,
+	const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM, double maxDistance );
+
 
 /**
  * @ingroup tracking_algorithms
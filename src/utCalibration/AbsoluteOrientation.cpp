@@ -30,13 +30,158 @@
  */
 
 #include "AbsoluteOrientation.h"
+#include <utMath/SymmetricEigen.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace Ubitrack { namespace Calibration {
+
+namespace ublas = boost::numeric::ublas;
+
+Math::Quaternion calculateRotationFromCorrelation( const Math::Matrix< double, 3, 3 >& M )
+{
+	// upper right suffices, since N is symmetric
+	double N[ 4 ][ 4 ];
+	N[ 0 ][ 0 ] =  M( 0, 0 ) + M( 1, 1 ) + M( 2, 2 );
+	N[ 1 ][ 1 ] =  M( 0, 0 ) - M( 1, 1 ) - M( 2, 2 );
+	N[ 2 ][ 2 ] = -M( 0, 0 ) + M( 1, 1 ) - M( 2, 2 );
+	N[ 3 ][ 3 ] = -M( 0, 0 ) - M( 1, 1 ) + M( 2, 2 );
+
+	N[ 0 ][ 1 ] = M( 1, 2 ) - M( 2, 1 );
+	N[ 0 ][ 2 ] = M( 2, 0 ) - M( 0, 2 );
+	N[ 0 ][ 3 ] = M( 0, 1 ) - M( 1, 0 );
+	N[ 1 ][ 2 ] = M( 0, 1 ) + M( 1, 0 );
+	N[ 1 ][ 3 ] = M( 2, 0 ) + M( 0, 2 );
+	N[ 2 ][ 3 ] = M( 1, 2 ) + M( 2, 1 );
+
+	// eigenvector of the largest eigenvalue
+	double W[ 4 ];
+	double V[ 4 ][ 4 ];
+	Math::symmetricEigen( N, W, V );
+
+	return Math::Quaternion( V[ 1 ][ 3 ], V[ 2 ][ 3 ], V[ 3 ][ 3 ], V[ 0 ][ 3 ] );
+}
+
+AbsoluteOrientationAccumulator::AbsoluteOrientationAccumulator()
+{
+	reset();
+}
+
+void AbsoluteOrientationAccumulator::reset()
+{
+	m_n = 0;
+	m_leftCentroid = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_rightCentroid = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_correlation = Math::Matrix< double, 3, 3 >::zeros();
+	m_leftSquares = 0;
+	m_rightSquares = 0;
+}
+
+void AbsoluteOrientationAccumulator::addPair( const Math::Vector< double, 3 >& left, const Math::Vector< double, 3 >& right )
+{
+	m_n++;
+
+	// C_n = C_n-1 + ( l - lc_n-1 ) ( r - rc_n )^T
+	const Math::Vector< double, 3 > dl( left - m_leftCentroid );
+	m_leftCentroid += dl / double( m_n );
+	const Math::Vector< double, 3 > dr( right - m_rightCentroid );
+	m_rightCentroid += dr / double( m_n );
+	const Math::Vector< double, 3 > dr2( right - m_rightCentroid );
+
+	for ( std::size_t i( 0 ); i < 3; i++ )
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			m_correlation( i, j ) += dl( i ) * dr2( j );
+
+	m_leftSquares += ublas::inner_prod( dl, left - m_leftCentroid );
+	m_rightSquares += ublas::inner_prod( dr, dr2 );
+}
+
+void AbsoluteOrientationAccumulator::removePair( const Math::Vector< double, 3 >& left, const Math::Vector< double, 3 >& right )
+{
+	if ( m_n <= 1 )
+	{
+		reset();
+		return;
+	}
+
+	// inverse of addPair
+	m_n--;
+	const Math::Vector< double, 3 > dl( left - m_leftCentroid );
+	m_leftCentroid -= dl / double( m_n );
+	const Math::Vector< double, 3 > dr( right - m_rightCentroid );
+	m_rightCentroid -= dr / double( m_n );
+	const Math::Vector< double, 3 > dl2( left - m_leftCentroid );
+
+	for ( std::size_t i( 0 ); i < 3; i++ )
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			m_correlation( i, j ) -= dl2( i ) * dr( j );
+
+	m_leftSquares -= ublas::inner_prod( dl, dl2 );
+	m_rightSquares -= ublas::inner_prod( dr, right - m_rightCentroid );
+}
+
+void AbsoluteOrientationAccumulator::addPairs( const std::vector< Math::Vector< double, 3 > >& left, const std::vector< Math::Vector< double, 3 > >& right )
+{
+	if ( left.size() != right.size() )
+		UBITRACK_THROW( "Different number of left and right points" );
+
+	for ( std::size_t i( 0 ); i < left.size(); i++ )
+		addPair( left[ i ], right[ i ] );
+}
+
+void AbsoluteOrientationAccumulator::removePairs( const std::vector< Math::Vector< double, 3 > >& left, const std::vector< Math::Vector< double, 3 > >& right )
+{
+	if ( left.size() != right.size() )
+		UBITRACK_THROW( "Different number of left and right points" );
+
+	for ( std::size_t i( 0 ); i < left.size(); i++ )
+		removePair( left[ i ], right[ i ] );
+}
+
+Math::Pose AbsoluteOrientationAccumulator::computePose() const
+{
+	if ( m_n < 3 )
+		UBITRACK_THROW( "Absolute orientation requires at least three point pairs" );
+
+	const Math::Quaternion q( calculateRotationFromCorrelation( m_correlation ) );
+	return Math::Pose( q, m_rightCentroid - q * m_leftCentroid );
+}
+
+double AbsoluteOrientationAccumulator::computeScale() const
+{
+	if ( m_n < 2 )
+		UBITRACK_THROW( "Absolute orientation scale requires at least two point pairs" );
+
+	return std::sqrt( m_rightSquares / m_leftSquares );
+}
+
+double AbsoluteOrientationAccumulator::computeRms( const Math::Pose& pose ) const
+{
+	if ( m_n == 0 )
+		return 0;
+
+	// sum |r - R l - t|^2 = sum |r~|^2 + sum |l~|^2 - 2 trace( R M ) + n |rc - R lc - t|^2
+	Math::Matrix< double, 3, 3 > R;
+	pose.rotation().toMatrix( R );
+	double traceRM = 0;
+	for ( std::size_t i( 0 ); i < 3; i++ )
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			traceRM += R( i, j ) * m_correlation( j, i );
+
+	const Math::Vector< double, 3 > dt( m_rightCentroid - pose * m_leftCentroid );
+	const double sum = m_leftSquares + m_rightSquares - 2 * traceRM + m_n * ublas::inner_prod( dt, dt );
+	return std::sqrt( std::max( 0.0, sum ) / m_n );
+}
+
+} } // namespace Ubitrack::Calibration
+
 #ifdef HAVE_LAPACK
 
 #include <utMath/Matrix.h>
 #include <utUtil/Exception.h>
 
 // namespace shortcuts
-namespace ublas = boost::numeric::ublas;
 #include <boost/numeric/bindings/lapack/syev.hpp>
 namespace lapack = boost::numeric::bindings::lapack;
 
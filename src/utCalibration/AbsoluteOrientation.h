@@ -34,11 +34,10 @@
 
 
 
-#ifdef HAVE_LAPACK
-
 #include <utCore.h>
 #include <utMath/Pose.h>
 #include <utMath/Vector.h>
+#include <utMath/Matrix.h>
 #include <utMath/Scalar.h>
 #include <vector>
 
@@ -46,6 +45,112 @@
 
 namespace Ubitrack { namespace Calibration {
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes the rotation part of the absolute orientation problem from the correlation matrix
+ * \f$ M = \sum_i ( l_i - \bar{l} ) ( r_i - \bar{r} )^T \f$ of the centered left and right points.
+ * The result maximizes \f$ trace( R M ) \f$ over all rotations, i.e. it is the rotation that
+ * best maps the left onto the right points. The quaternion is the eigenvector of the
+ * largest eigenvalue of Horn's 4x4 matrix N, which is computed by a fixed-size eigensolver
+ * without LAPACK and without allocating memory.
+ *
+ * @param M 3x3 correlation matrix
+ * @return rotation from the left into the right coordinate frame
+ */
+UBITRACK_EXPORT Math::Quaternion calculateRotationFromCorrelation( const Math::Matrix< double, 3, 3 >& M );
+
+/**
+ * @ingroup tracking_algorithms
+ * Incremental solution of the absolute orientation problem for streams of point pairs.
+ *
+ * The accumulator keeps the number of pairs, the running centroids of the left and right points 
+ * and the correlation matrix of the centered points, which are updated in O(1) per pair with 
+ * Welford's method and therefore stay accurate for points far from the origin. The pose is 
+ * computed on demand from Horn's 4x4 matrix by calculateRotationFromCorrelation, so the cost 
+ * of a query does not depend on the number of pairs either.
+ *
+ * Pairs can also be removed again, e.g. to maintain a sliding window. Removing a pair that was 
+ * never added corrupts the state.
+ */
+class UBITRACK_EXPORT AbsoluteOrientationAccumulator
+{
+public:
+	/** constructor, creates an empty accumulator */
+	AbsoluteOrientationAccumulator();
+
+	/** removes all point pairs */
+	void reset();
+
+	/** adds a pair of corresponding points in the left and right coordinate frame */
+	void addPair( const Math::Vector< double, 3 >& left, const Math::Vector< double, 3 >& right );
+
+	/**
+	 * adds a batch of corresponding points
+	 * @throws Util::Exception if the number of left and right points differs
+	 */
+	void addPairs( const std::vector< Math::Vector< double, 3 > >& left, const std::vector< Math::Vector< double, 3 > >& right );
+
+	/** removes a pair that was previously added */
+	void removePair( const Math::Vector< double, 3 >& left, const Math::Vector< double, 3 >& right );
+
+	/**
+	 * removes a batch of pairs that were previously added
+	 * @throws Util::Exception if the number of left and right points differs
+	 */
+	void removePairs( const std::vector< Math::Vector< double, 3 > >& left, const std::vector< Math::Vector< double, 3 > >& right );
+
+	/** number of point pairs currently accumulated */
+	std::size_t size() const
+	{ return m_n; }
+
+	/** centroid of the left points */
+	const Math::Vector< double, 3 >& getLeftCentroid() const
+	{ return m_leftCentroid; }
+
+	/** centroid of the right points */
+	const Math::Vector< double, 3 >& getRightCentroid() const
+	{ return m_rightCentroid; }
+
+	/** correlation matrix \f$ \sum_i ( l_i - \bar{l} ) ( r_i - \bar{r} )^T \f$ */
+	const Math::Matrix< double, 3, 3 >& getCorrelation() const
+	{ return m_correlation; }
+
+	/**
+	 * computes the pose that transforms the left into the right coordinate frame
+	 * @throws Util::Exception if less than three pairs are accumulated
+	 */
+	Math::Pose computePose() const;
+
+	/**
+	 * computes the scale between the left and right points as in calculateAbsoluteOrientationScale
+	 * @throws Util::Exception if less than two pairs are accumulated
+	 */
+	double computeScale() const;
+
+	/**
+	 * computes the root mean square distance between the right points and the transformed left 
+	 * points for the given pose, which should be the result of computePose.
+	 */
+	double computeRms( const Math::Pose& pose ) const;
+
+protected:
+	/** number of pairs */
+	std::size_t m_n;
+
+	/** centroids of the left and right points */
+	Math::Vector< double, 3 > m_leftCentroid;
+	Math::Vector< double, 3 > m_rightCentroid;
+
+	/** correlation matrix of the centered points */
+	Math::Matrix< double, 3, 3 > m_correlation;
+
+	/** sums of the squared distances of the left and right points to their centroids */
+	double m_leftSquares;
+	double m_rightSquares;
+};
+
+#ifdef HAVE_LAPACK
+
 UBITRACK_EXPORT Math::Scalar< double > calculateAbsoluteOrientationScale ( const std::vector< Math::Vector< double, 3 > >& m_left,
 														         const std::vector< Math::Vector< double, 3 > >& m_right);
 
@@ -168,8 +273,8 @@ T computeRms( const Math::Pose& pose, const std::vector< Math::Vector< T, 3 > >&
     return rms;
 }
 
-} } // namespace Ubitrack::Calibration
-
 #endif // HAVE_LAPACK
 
+} } // namespace Ubitrack::Calibration
+
 #endif
@@ -37,12 +37,13 @@
 
 #include <utCalibration/2D3DPoseEstimation.h> //compute Pose
 #include <utMath/LevenbergMarquardt.h>
+#include <utMath/ParallelEvaluation.h>
 #include <utUtil/Exception.h>
 
 
 
 // get a logger
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Calibration.BundleAdjustment" ) );
 //static log4cpp::Category& optLogger( log4cpp::Category::getInstance( "Ubitrack.Calibration.2D6DPoseEstimation.LM" ) );
 
@@ -63,7 +64,8 @@ std::pair < Math::ErrorPose , double >
 	bool hasInitialPoseProvided,
 	Math::Pose initialPose,
 	int startIndex,
-	int endIndex)
+	int endIndex,
+	unsigned nThreads)
 {
 	if (endIndex == -1)
 		endIndex = static_cast<int>( points3d.size() ) - 1 ;
@@ -127,7 +129,7 @@ std::pair < Math::ErrorPose , double >
 		// Compute initial pose
 		if (!hasInitialPoseProvided) {
 			OPT_LOG_DEBUG(  "Compute initial pose with "<<p2dLocal.at(maxObsIndex).size() << " observations for camera " << maxObsIndex );
-			initialPose = camPoses.at( maxObsIndex ) * Calibration::computePose( p2dLocal.at( maxObsIndex) , p3dLocalFiltered.at( maxObsIndex) ,
+			initialPose = ~camPoses.at( maxObsIndex ) * Calibration::computePose( p2dLocal.at( maxObsIndex) , p3dLocalFiltered.at( maxObsIndex) ,
 				camMatrices.at( maxObsIndex ), PLANAR_HOMOGRAPHY ); // there are no scoped enums in C++98 (only in C++0x onwards)
 			OPT_LOG_DEBUG(  "Initial pose "<<initialPose );
 		}
@@ -158,12 +160,14 @@ std::pair < Math::ErrorPose , double >
 		// starting optimization
 		OPT_LOG_DEBUG( "Optimizing pose over " << numberCameras << " cameras using " << observationCountTotal << " observations" );
 
+		// observations are evaluated on nThreads threads if there are enough of them
 		ObjectiveFunction< double > f( p3dLocal, camRotations, camTranslations, camMatrices, observations );
+		Math::ParallelEvaluation< ObjectiveFunction< double > > pf( f, nThreads );
 		Math::Vector< double, 6 > param;
 		ublas::subrange( param, 0, 3 ) = initialPose.translation();
 		ublas::subrange( param, 3, 6 ) = initialPose.rotation().toLogarithm();
 
-		double res = Math::levenbergMarquardt( f, param, measurements, Math::OptTerminate( 10, 1e-6 ), Math::OptNoNormalize() );
+		double res = Math::levenbergMarquardt( pf, param, measurements, Math::OptTerminate( 10, 1e-6 ), Math::OptNoNormalize() );
 
         // Create an error pose with covariance matrix that has the residual on its diagonal entries
 		Math::ErrorPose finalPose( Math::Quaternion::fromLogarithm( ublas::subrange( param, 3, 6 ) ), ublas::subrange( param, 0, 3 ), Math::Matrix< double, 6, 6 >::identity( ) * res );
@@ -173,7 +177,7 @@ std::pair < Math::ErrorPose , double >
 		return std::make_pair(finalPose, res);
 	} else { // not enough observations
 
-		LOG4CPP_DEBUG( logger, "Not enough observations. Only "<<minObs<<" observations available for some camera ");
+		UBITRACK_LOG_DEBUG( logger, "Not enough observations. Only "<<minObs<<" observations available for some camera ");
 		return std::make_pair(Math::ErrorPose(), -1.0);
 	}
 }
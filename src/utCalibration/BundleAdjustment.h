@@ -22,87 +22,17 @@
  */
 
 
-#include <utMath/NewFunction/Function.h>
-#include <utMath/NewFunction/Addition.h>
-#include <utMath/NewFunction/Dehomogenization.h>
-#include <utMath/NewFunction/LieRotation.h>
-#include <utMath/NewFunction/LinearTransformation.h>
+#ifndef __UBITRACK_CALIBRATION_BUNDLEADJUSTMENT_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_BUNDLEADJUSTMENT_H_INCLUDED__
+
+// the objective function is shared with multipleCameraEstimatePose
+#include <utCalibration/MultipleCameraPoseOptimization.h>
 #include <utMeasurement/Measurement.h>
 
 namespace Ubitrack { namespace Calibration {
 
 #ifdef HAVE_LAPACK
 
-/**
- * Function to minimize. Input is a 6-vector containing translation and exponential map rotation.
- */ 
-template< class VType = double >
-class ObjectiveFunction
-{
-public:
-	ObjectiveFunction( const std::vector< Math::Vector< VType, 3 > >& p3D, 
-		const std::vector< Math::Matrix< double, 3, 3 > >& cameraRotations, 
-		const std::vector< Math::Vector< double, 3 > >& cameraTranslations, 
-		const std::vector< Math::Matrix< VType, 3, 3 > >& cameraIntrinsics, 
-		const std::vector< std::pair< std::size_t, std::size_t > > visibilities )
-		: m_p3D( p3D )
-		, m_camR( cameraRotations )
-		, m_camT( cameraTranslations )
-		, m_camI( cameraIntrinsics )
-		, m_vis( visibilities )
-	{}
-
-	/**
-	 * return the size of the result vector
-	 */
-	std::size_t size() const
-	{ return 2 * m_vis.size(); }
-
-
-	/**
-	 * @param result vector to store the result in
-	 * @param input containing the parameters (target pose as 7-vector)
-	 * @param J matrix to store the jacobian (evaluated for input) in
-	 */
-	template< class VT1, class VT2, class MT > 
-	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
-	{
-		namespace NF = Math::Function;
-		namespace ublas = boost::numeric::ublas;
-		const std::size_t n_vis( m_vis.size() );
-		for ( std::size_t i( 0 ); i < n_vis; ++i )
-		{
-				ublas::vector_range< VT1 > subResult( result, ublas::range( i * 2, ( i + 1 ) * 2 ) );
-				ublas::matrix_range< MT > subJ( J, ublas::range( i * 2, ( i + 1 ) * 2 ), ublas::range( 0, 6 ) );
-		
-				( NF::Dehomogenization< 3 >() <<
-				( NF::LinearTransformation< 3, 3 >( m_camI[ m_vis[ i ].second ] ) <<
-					( NF::Addition< 3 >() <<
-						( NF::fixedParameterRef< 3 >( m_camT[ m_vis[ i ].second ] ) ) <<
-						( NF::LinearTransformation< 3, 3 >( m_camR[ m_vis[ i ].second ] ) <<
-							( NF::Addition< 3 >() <<
-								( NF::parameter< 3 >( 0 ) ) <<
-								( NF::LieRotation() <<
-									( NF::parameter< 3 >( 3  ) ) <<
-									( NF::fixedParameterRef< 3 >( m_p3D[ m_vis[ i ].first ] ) )
-								)
-							)
-						)
-					)
-				)
-			).evaluateWithJacobian( input, subResult, subJ );
-		}
-	}
-	
-protected:
-	const std::vector< Math::Vector< VType, 3 > >& m_p3D;
-	const std::vector< Math::Matrix< double, 3, 3 > >& m_camR;
-	const std::vector< Math::Vector< double, 3 > >& m_camT;
-	const std::vector< Math::Matrix< VType, 3, 3 > >& m_camI;
-	const std::vector< std::pair< std::size_t, std::size_t > > m_vis;
-};
-
-
 void checkConsistency2 (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
 	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
@@ -111,7 +41,8 @@ void checkConsistency2 (
 	const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices
 	);
 
-std::pair < Math::ErrorPose , double > 
+/** same as multipleCameraEstimatePose, including the meaning of \c nThreads */
+UBITRACK_EXPORT std::pair < Math::ErrorPose , double > 
 	multipleCameraBundleAdjustment (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
 	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
@@ -122,7 +53,8 @@ std::pair < Math::ErrorPose , double >
 	bool hasInitialPoseProvided,
 	Math::Pose initialPose = Math::Pose(),
 	int startIndex = 0,
-	int endIndex = -1);
+	int endIndex = -1,
+	unsigned nThreads = 1);
 
 // UBITRACK_EXPORT void multipleCameraPoseEstimationWithLocalBundles (
 	// const std::vector < Math::Vector < 3 > >&  points3d,
@@ -152,3 +84,5 @@ UBITRACK_EXPORT void bundleAdjustment (
 #endif // HAVE_LAPACK
 
 } } // namespace Ubitrack::Components
+
+#endif
@@ -62,9 +62,8 @@ public:
 	template< class VT1, class VT2 > 
 	void evaluate( VT1& result, const VT2& input ) const
 	{
-		namespace ublas = boost::numeric::ublas;
-		ublas::matrix< T, ublas::column_major > J( result.size(), input.size() );
-		evaluateWithJacobian( result, input, J );
+		Scratch scratch;
+		evaluateBlocks( result, input, 0, blockCount(), scratch );
 	}
 
 	template< class VT2, class MT > 
@@ -85,76 +84,57 @@ public:
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
 	{
-		namespace ublas = boost::numeric::ublas;
-		// precompute image rotation matrices
-		std::vector< Math::Matrix< T, 3, 3 > > camRotations( m_net.images.size() );
-		std::size_t iV = m_imageOffset;
-		for ( std::size_t i = 0; i != m_net.images.size(); i++, iV += 6 )
-			Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ).toMatrix( camRotations[ i ] );
+		Scratch scratch;
+		evaluateBlocksWithJacobian( result, input, J, 0, blockCount(), scratch );
+	}
 
-		// precompute body rotation matrices
-		std::vector< Math::Matrix< T, 3, 3 > > bodyRotations( m_net.bodyPoses.size() );
-		iV = m_bodyPoseOffset;
-		for ( std::size_t i = 1; i < m_net.bodyPoses.size(); i++, iV += 6 )
-			Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ).toMatrix( bodyRotations[ i ] );
 
-		// clear jacobian
-		noalias( J ) = ublas::zero_matrix< T >( J.size1(), J.size2() );
+	// block-separable function for Math::ParallelEvaluation, one block per measurement
 
-		std::size_t iM = 0; // offset into measurement vector
+	/** rotation matrices of the input and jacobian rows of a single measurement */
+	struct Scratch
+	{
+		std::vector< Math::Matrix< T, 3, 3 > > camRotations;
+		std::vector< Math::Matrix< T, 3, 3 > > bodyRotations;
+		Math::Matrix< T, 0, 0 > J;
+	};
 
-		// free point measurements
-		for ( typename std::vector< typename BundleAdjustmentNetwork< T >::FreePointMeasurement >::const_iterator it = m_net.freePointMeasurements.begin();
-			it != m_net.freePointMeasurements.end(); it++, iM += 2 )
-		{
-			std::size_t iP = m_pointOffset + 3 * it->iPoint; // offset into parameter vector
+	/** number of measurements, free point measurements first */
+	std::size_t blockCount() const
+	{ return m_net.freePointMeasurements.size() + m_net.bodyPointMeasurements.size(); }
 
-			ublas::vector_range< VT1 > resultRange( result, ublas::range( iM, iM + 2 ) );
-			ublas::matrix_range< MT > jRange1( J, ublas::range( iM, iM + 2 ), ublas::range( 0, J.size2() ) );
-			ublas::matrix_range< MT > jRange2( J, ublas::range( iM, iM + 2 ), ublas::range( iP, iP + 3 ) );
-			Math::Vector< T, 3 > p3d( ublas::subrange( input, iP, iP + 3 ) );
-			evaluateSingleWorldPointWithJacobian( resultRange, input, jRange1, jRange2, 
-				camRotations, bodyRotations, it->iCamera, it->iImage, p3d );
-		}
+	std::size_t blockRow( std::size_t block ) const
+	{ return 2 * block; }
 
-		// body point measurements
-		for ( typename std::vector< typename BundleAdjustmentNetwork< T >::BodyPointMeasurement >::const_iterator it = m_net.bodyPointMeasurements.begin();
-			it != m_net.bodyPointMeasurements.end(); it++, iM += 2 )
+	template< class VT1, class VT2 > 
+	void evaluateBlocks( VT1& result, const VT2& input, std::size_t begin, std::size_t end, Scratch& scratch ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+		computeRotations( input, scratch );
+
+		// the jacobian rows are computed into scratch space and discarded
+		scratch.J.resize( 2, input.size(), false );
+		for ( std::size_t b( begin ); b < end; b++ )
 		{
-			std::size_t iP = m_bodyPoseOffset + 6 * ( it->iBodyPose - 1 ); // offset into parameter vector
+			ublas::vector_range< VT1 > resultRange( result, ublas::range( 2 * b, 2 * b + 2 ) );
+			evaluateBlockWithJacobian( resultRange, input, scratch.J, b, scratch );
+		}
+	}
 
-			// transform point from body to world
-			Math::Vector< T, 3 > worldPoint;
-			if ( it->iBodyPose == 0 )
-			{
-				// world-defining has identity-pose
-				noalias( worldPoint ) = m_net.bodies[ it->iBody ][ it->iPoint ];
-			}
-			else
-			{
-				// take pose from parameter
-				noalias( worldPoint ) = ublas::prod( bodyRotations[ it->iBodyPose ], m_net.bodies[ it->iBody ][ it->iPoint ] );
-				noalias( worldPoint ) += ublas::subrange( input, iP, iP + 3 );
-			}
+	template< class VT1, class VT2, class MT > 
+	void evaluateBlocksWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t begin, std::size_t end, Scratch& scratch ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+		computeRotations( input, scratch );
 
-			// transform from world to image and compute jacobian
-			Math::Matrix< T, 2, 3 > jW2I;
-			ublas::vector_range< VT1 > resultRange( result, ublas::range( iM, iM + 2 ) );
-			ublas::matrix_range< MT > jRange1( J, ublas::range( iM, iM + 2 ), ublas::range( 0, J.size2() ) );
-			evaluateSingleWorldPointWithJacobian( resultRange, input, jRange1, jW2I, 
-				camRotations, bodyRotations, it->iCamera, it->iImage, worldPoint );
+		// clear jacobian
+		noalias( ublas::subrange( J, 2 * begin, 2 * end, 0, J.size2() ) ) = ublas::zero_matrix< T >( 2 * ( end - begin ), J.size2() );
 
-			if ( it->iBodyPose != 0 )
-			{
-				// jacobian of body translation
-				ublas::subrange( J, iM, iM + 2, iP, iP + 3 ) = jW2I;
-
-				// jacobian of body rotation
-				Math::Matrix< T, 3, 3 > jBodyRot;
-				Function::LieRotation< T >( m_net.bodies[ it->iBody ][ it->iPoint ] ).jacobian( 
-					ublas::subrange( input, iP + 3, iP + 6 ), jBodyRot );
-				noalias( ublas::subrange( J, iM, iM + 2, iP + 3, iP + 6 ) ) = ublas::prod( jW2I, jBodyRot );
-			}
+		for ( std::size_t b( begin ); b < end; b++ )
+		{
+			ublas::vector_range< VT1 > resultRange( result, ublas::range( 2 * b, 2 * b + 2 ) );
+			ublas::matrix_range< MT > jRange( J, ublas::range( 2 * b, 2 * b + 2 ), ublas::range( 0, J.size2() ) );
+			evaluateBlockWithJacobian( resultRange, input, jRange, b, scratch );
 		}
 	}
 
@@ -298,6 +278,84 @@ public:
 	}
 
 protected:
+	/** precomputes the image and body rotation matrices from the input quaternions */
+	template< class VT2 >
+	void computeRotations( const VT2& input, Scratch& scratch ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+		scratch.camRotations.resize( m_net.images.size() );
+		std::size_t iV = m_imageOffset;
+		for ( std::size_t i = 0; i != m_net.images.size(); i++, iV += 6 )
+			Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ).toMatrix( scratch.camRotations[ i ] );
+
+		scratch.bodyRotations.resize( m_net.bodyPoses.size() );
+		iV = m_bodyPoseOffset;
+		for ( std::size_t i = 1; i < m_net.bodyPoses.size(); i++, iV += 6 )
+			Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ).toMatrix( scratch.bodyRotations[ i ] );
+	}
+
+	/**
+	 * computes a single measurement and its row of the jacobian. Only the non-zero entries of J are set.
+	 * @param result where to put the predicted 2d-measurement
+	 * @param input the whole BA parameter vector
+	 * @param J 2x<inputsize> jacobian of 2d-measurement wrt. all BA parameters
+	 * @param block index of the measurement, free point measurements first
+	 * @param scratch rotation matrices computed by computeRotations
+	 */
+	template< class VT1, class VT2, class MT > 
+	void evaluateBlockWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t block, const Scratch& scratch ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+		if ( block < m_net.freePointMeasurements.size() )
+		{
+			// free point measurement
+			const typename BundleAdjustmentNetwork< T >::FreePointMeasurement& m( m_net.freePointMeasurements[ block ] );
+			std::size_t iP = m_pointOffset + 3 * m.iPoint; // offset into parameter vector
+
+			ublas::matrix_range< MT > jPoint( J, ublas::range( 0, 2 ), ublas::range( iP, iP + 3 ) );
+			Math::Vector< T, 3 > p3d( ublas::subrange( input, iP, iP + 3 ) );
+			evaluateSingleWorldPointWithJacobian( result, input, J, jPoint, 
+				scratch.camRotations, scratch.bodyRotations, m.iCamera, m.iImage, p3d );
+			return;
+		}
+
+		// body point measurement
+		const typename BundleAdjustmentNetwork< T >::BodyPointMeasurement& m( 
+			m_net.bodyPointMeasurements[ block - m_net.freePointMeasurements.size() ] );
+		std::size_t iP = m_bodyPoseOffset + 6 * ( m.iBodyPose - 1 ); // offset into parameter vector
+
+		// transform point from body to world
+		Math::Vector< T, 3 > worldPoint;
+		if ( m.iBodyPose == 0 )
+		{
+			// world-defining has identity-pose
+			noalias( worldPoint ) = m_net.bodies[ m.iBody ][ m.iPoint ];
+		}
+		else
+		{
+			// take pose from parameter
+			noalias( worldPoint ) = ublas::prod( scratch.bodyRotations[ m.iBodyPose ], m_net.bodies[ m.iBody ][ m.iPoint ] );
+			noalias( worldPoint ) += ublas::subrange( input, iP, iP + 3 );
+		}
+
+		// transform from world to image and compute jacobian
+		Math::Matrix< T, 2, 3 > jW2I;
+		evaluateSingleWorldPointWithJacobian( result, input, J, jW2I, 
+			scratch.camRotations, scratch.bodyRotations, m.iCamera, m.iImage, worldPoint );
+
+		if ( m.iBodyPose != 0 )
+		{
+			// jacobian of body translation
+			ublas::subrange( J, 0, 2, iP, iP + 3 ) = jW2I;
+
+			// jacobian of body rotation
+			Math::Matrix< T, 3, 3 > jBodyRot;
+			Function::LieRotation< T >( m_net.bodies[ m.iBody ][ m.iPoint ] ).jacobian( 
+				ublas::subrange( input, iP + 3, iP + 6 ), jBodyRot );
+			noalias( ublas::subrange( J, 0, 2, iP + 3, iP + 6 ) ) = ublas::prod( jW2I, jBodyRot );
+		}
+	}
+
 	/**
 	 * same as evaluateWithJacobian, but for a single 3D point in world coordinates
 	 * @param result where to put the predicted 2d-measurement
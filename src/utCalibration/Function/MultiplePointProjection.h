@@ -35,6 +35,8 @@
 #include "QuaternionRotation.h"
 #include "Dehomogenization.h"
 
+#include <utMath/ParallelEvaluation.h>
+
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
 
@@ -53,7 +55,8 @@ dehomogenize( C * ( r * p * r' + t ) )
  *
  * p and C must be already known, the 7-vector (t, r) is the input to the function.
  *
- * This function is used in Pose Estimation and error propagation.
+ * This function is used in Pose Estimation and error propagation. The points are independent
+ * blocks for Math::ParallelEvaluation.
  */
 template< class VType >
 class MultiplePointProjection
@@ -81,6 +84,44 @@ public:
 	 */
 	template< class VT1, class VT2 > 
 	void evaluate( VT1& result, const VT2& input ) const
+	{
+		Scratch scratch;
+		evaluateBlocks( result, input, 0, m_p3D.size(), scratch );
+	}
+	
+	/**
+	 * @param result vector to store the result in
+	 * @param input containing the parameters (to be optimized)
+	 * @param J matrix to store the jacobian (evaluated for input) in
+	 */
+	template< class VT1, class VT2, class MT > 
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		Scratch scratch;
+		evaluateBlocksWithJacobian( result, input, J, 0, m_p3D.size(), scratch );
+	}
+
+	/**
+	 * @param input containing the parameters (to be optimized)
+	 * @param J matrix to store the jacobian (evaluated for input) in
+	 */
+	template< class VT2, class MT > 
+	void jacobian( const VT2& input, MT& J ) const
+	{ jacobianBlocks( input, J, 0, m_p3D.size() ); }
+
+
+	// block-separable function for Math::ParallelEvaluation, one block per point
+
+	typedef Math::NoBlockScratch Scratch;
+
+	std::size_t blockCount() const
+	{ return m_p3D.size(); }
+
+	std::size_t blockRow( std::size_t block ) const
+	{ return 2 * block; }
+
+	template< class VT1, class VT2 > 
+	void evaluateBlocks( VT1& result, const VT2& input, std::size_t begin, std::size_t end, Scratch& ) const
 	{
 		using namespace Ubitrack::Math;
 		namespace ublas = boost::numeric::ublas;
@@ -89,7 +130,7 @@ public:
 		Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
 		Matrix< VType, 3, 3 > rot( rotQ );
 		
-		for ( std::size_t i ( 0 ); i < m_p3D.size(); ++i )
+		for ( std::size_t i ( begin ); i < end; ++i )
 		{
 			// rotate & project points
 			Vector< VType, 3 > rotated( ublas::prod( rot, m_p3D[ i ] ) + ublas::subrange( input, 0, 3 ) );
@@ -97,26 +138,19 @@ public:
 			ublas::noalias( ublas::subrange( result, i * 2, (i+1) * 2 ) ) = ublas::subrange( projected, 0, 2 ) / projected( 2 );
 		}
 	}
-	
-	/**
-	 * @param result vector to store the result in
-	 * @param input containing the parameters (to be optimized)
-	 * @param J matrix to store the jacobian (evaluated for input) in
-	 */
+
 	template< class VT1, class VT2, class MT > 
-	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	void evaluateBlocksWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t begin, std::size_t end, Scratch& scratch ) const
 	{
 		// TODO: implement as one function (more efficient)
-		evaluate( result, input );
-		jacobian( input, J );
+		evaluateBlocks( result, input, begin, end, scratch );
+		jacobianBlocks( input, J, begin, end );
 	}
 
-	/**
-	 * @param input containing the parameters (to be optimized)
-	 * @param J matrix to store the jacobian (evaluated for input) in
-	 */
+protected:
+	/** computes the jacobian rows of the points [ begin, end ) */
 	template< class VT2, class MT > 
-	void jacobian( const VT2& input, MT& J ) const
+	void jacobianBlocks( const VT2& input, MT& J, std::size_t begin, std::size_t end ) const
 	{
 		using namespace Ubitrack::Math;
 		namespace ublas = boost::numeric::ublas;
@@ -131,7 +165,7 @@ public:
 		Vector< VType, 3 > rotated;
 		Vector< VType, 3 > projected;
 		
-		for ( unsigned i = 0; i < m_p3D.size(); i++ )
+		for ( std::size_t i = begin; i < end; i++ )
 		{
 			// rotate & project points
 			noalias( rotated ) = ublas::prod( rot, m_p3D[ i ] ) + ublas::subrange( input, 0, 3 );
@@ -31,40 +31,47 @@
 
 #include "FundamentalMatrix.h"
 #include <utMath/MatrixOperations.h>
+#include <utMath/SymmetricEigen.h>
+#include <utMath/PolynomialRoots.h>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 #include <utUtil/Exception.h>
 #include <utUtil/Logging.h>
 #include <boost/numeric/ublas/io.hpp>
 
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
 #ifdef HAVE_LAPACK
 #include "3DPointReconstruction.h"
 #include <boost/numeric/bindings/lapack/gesvd.hpp>
+#endif
 
 // shortcuts to namespaces
 namespace ublas = boost::numeric::ublas;
-namespace lapack = boost::numeric::bindings::lapack;
 
 namespace Ubitrack { namespace Calibration {
 
 template< typename T >
 void normalize(Math::Vector< T, 2 >& shift, T& scale,
-	Math::Matrix< T, 3, 3 >& modMatrix, const std::vector< Math::Vector< T, 2 > >& pts)
+	Math::Matrix< T, 3, 3 >& modMatrix, const Math::Vector< T, 2 >* pts, std::size_t n )
 {    
 	shift = Math::Vector< T, 2 >( 0.0, 0.0 );
 	T meandist = 0.0;
 		
-	for( std::size_t i=0; i < pts.size(); i++ )
-		shift += pts.at( i );
-	shift = shift / pts.size();
+	for( std::size_t i=0; i < n; i++ )
+		shift += pts[ i ];
+	shift = shift / n;
 	
-	for( std::size_t i=0; i < pts.size(); i++ )
+	for( std::size_t i=0; i < n; i++ )
 	{
-		Math::Vector< T, 2 > v = pts.at(i) - shift;
+		Math::Vector< T, 2 > v = pts[ i ] - shift;
 		meandist += sqrt( v(0) * v(0) + v(1) * v(1) );
 	}    
-    meandist /= pts.size();
+    meandist /= n;
     
     scale = sqrt( static_cast< T >( 2.0 ) )/meandist;
 
@@ -79,6 +86,456 @@ void normalize(Math::Vector< T, 2 >& shift, T& scale,
 	modMatrix( 2, 2 ) = 1.0;
 }
 
+template< typename T >
+void normalize(Math::Vector< T, 2 >& shift, T& scale,
+	Math::Matrix< T, 3, 3 >& modMatrix, const std::vector< Math::Vector< T, 2 > >& pts)
+{    
+	normalize( shift, scale, modMatrix, &pts[ 0 ], pts.size() );
+}
+
+/** \internal row of the linear system x'^T F x = 0 for the entries of F in row-major order */
+inline void epipolarConstraint( double a[ 9 ], double x, double y, double x_, double y_ )
+{
+	a[ 0 ] = x_ * x;
+	a[ 1 ] = x_ * y;
+	a[ 2 ] = x_;
+	a[ 3 ] = y_ * x;
+	a[ 4 ] = y_ * y;
+	a[ 5 ] = y_;
+	a[ 6 ] = x;
+	a[ 7 ] = y;
+	a[ 8 ] = 1.0;
+}
+
+/** \internal determinant of a 3x3 matrix in row-major order */
+inline double determinant3x3( const double m[ 9 ] )
+{
+	return m[ 0 ] * ( m[ 4 ] * m[ 8 ] - m[ 5 ] * m[ 7 ] )
+		- m[ 1 ] * ( m[ 3 ] * m[ 8 ] - m[ 5 ] * m[ 6 ] )
+		+ m[ 2 ] * ( m[ 3 ] * m[ 7 ] - m[ 4 ] * m[ 6 ] );
+}
+
+/** 
+ * \internal 
+ * Undoes the point normalization F = T'^T Fn T and scales the result to unit norm. 
+ * Both normalizations are isotropic, i.e. T = [ s 0 -s*cx; 0 s -s*cy; 0 0 1 ].
+ */
+template< typename T >
+void denormalizeFundamentalMatrix( Math::Matrix< T, 3, 3 >& F, const double Fn[ 9 ], 
+	const Math::Matrix< T, 3, 3 >& fromMod, const Math::Matrix< T, 3, 3 >& toMod )
+{
+	// Fn * T
+	double M[ 9 ];
+	for ( std::size_t r( 0 ); r < 3; r++ )
+	{
+		M[ 3 * r ] = Fn[ 3 * r ] * fromMod( 0, 0 );
+		M[ 3 * r + 1 ] = Fn[ 3 * r + 1 ] * fromMod( 1, 1 );
+		M[ 3 * r + 2 ] = Fn[ 3 * r ] * fromMod( 0, 2 ) + Fn[ 3 * r + 1 ] * fromMod( 1, 2 ) + Fn[ 3 * r + 2 ];
+	}
+
+	// T'^T * M
+	double R[ 9 ];
+	double norm = 0;
+	for ( std::size_t c( 0 ); c < 3; c++ )
+	{
+		R[ c ] = toMod( 0, 0 ) * M[ c ];
+		R[ 3 + c ] = toMod( 1, 1 ) * M[ 3 + c ];
+		R[ 6 + c ] = toMod( 0, 2 ) * M[ c ] + toMod( 1, 2 ) * M[ 3 + c ] + M[ 6 + c ];
+		norm += R[ c ] * R[ c ] + R[ 3 + c ] * R[ 3 + c ] + R[ 6 + c ] * R[ 6 + c ];
+	}
+	norm = 1.0 / std::sqrt( norm );
+
+	for ( std::size_t r( 0 ); r < 3; r++ )
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			F( r, c ) = static_cast< T >( R[ 3 * r + c ] * norm );
+}
+
+
+/** \internal */
+template< typename T >
+std::size_t getFundamentalMatrix7PointImpl( const Math::Vector< T, 2 >* fromPoints,
+	const Math::Vector< T, 2 >* toPoints, Math::Matrix< T, 3, 3 >* solutions )
+{
+	Math::Vector< T, 2 > fromShift;
+	Math::Vector< T, 2 > toShift;
+	T fromScale;
+	T toScale;
+	Math::Matrix< T, 3, 3 > fromModMatrix;
+	Math::Matrix< T, 3, 3 > toModMatrix;
+	normalize( fromShift, fromScale, fromModMatrix, fromPoints, 7 );
+	normalize( toShift, toScale, toModMatrix, toPoints, 7 );
+
+	double A[ 7 ][ 9 ];
+	for ( std::size_t i( 0 ); i < 7; i++ )
+		epipolarConstraint( A[ i ], 
+			( fromPoints[ i ]( 0 ) - fromShift( 0 ) ) * fromScale, ( fromPoints[ i ]( 1 ) - fromShift( 1 ) ) * fromScale,
+			( toPoints[ i ]( 0 ) - toShift( 0 ) ) * toScale, ( toPoints[ i ]( 1 ) - toShift( 1 ) ) * toScale );
+
+	// Gauss-Jordan elimination with complete pivoting, the last two columns span the null space
+	std::size_t cols[ 9 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	for ( std::size_t r( 0 ); r < 7; r++ )
+	{
+		std::size_t pr( r );
+		std::size_t pc( r );
+		for ( std::size_t i( r ); i < 7; i++ )
+			for ( std::size_t j( r ); j < 9; j++ )
+				if ( std::fabs( A[ i ][ j ] ) > std::fabs( A[ pr ][ pc ] ) )
+				{
+					pr = i;
+					pc = j;
+				}
+
+		// the normalized coefficients are in the order of one
+		if ( std::fabs( A[ pr ][ pc ] ) < 1e-10 )
+			return 0;
+
+		for ( std::size_t j( 0 ); j < 9; j++ )
+			std::swap( A[ r ][ j ], A[ pr ][ j ] );
+		for ( std::size_t i( 0 ); i < 7; i++ )
+			std::swap( A[ i ][ r ], A[ i ][ pc ] );
+		std::swap( cols[ r ], cols[ pc ] );
+
+		for ( std::size_t i( 0 ); i < 7; i++ )
+			if ( i != r )
+			{
+				const double f = A[ i ][ r ] / A[ r ][ r ];
+				for ( std::size_t j( r ); j < 9; j++ )
+					A[ i ][ j ] -= f * A[ r ][ j ];
+			}
+	}
+
+	double F1[ 9 ];
+	double F2[ 9 ];
+	F1[ cols[ 7 ] ] = 1;
+	F1[ cols[ 8 ] ] = 0;
+	F2[ cols[ 7 ] ] = 0;
+	F2[ cols[ 8 ] ] = 1;
+	for ( std::size_t r( 0 ); r < 7; r++ )
+	{
+		F1[ cols[ r ] ] = -A[ r ][ 7 ] / A[ r ][ r ];
+		F2[ cols[ r ] ] = -A[ r ][ 8 ] / A[ r ][ r ];
+	}
+
+	// det( a F1 + ( 1 - a ) F2 ) = c3 a^3 + c2 a^2 + c1 a + c0, interpolated at a = 0, 1, -1, 2
+	double d[ 4 ];
+	const double a[ 4 ] = { 0, 1, -1, 2 };
+	for ( std::size_t k( 0 ); k < 4; k++ )
+	{
+		double M[ 9 ];
+		for ( std::size_t i( 0 ); i < 9; i++ )
+			M[ i ] = a[ k ] * F1[ i ] + ( 1 - a[ k ] ) * F2[ i ];
+		d[ k ] = determinant3x3( M );
+	}
+	const double c0 = d[ 0 ];
+	const double c2 = ( d[ 1 ] + d[ 2 ] ) / 2 - c0;
+	const double c13 = ( d[ 1 ] - d[ 2 ] ) / 2;
+	const double c3 = ( d[ 3 ] - 4 * c2 - c0 - 2 * c13 ) / 6;
+	const double c1 = c13 - c3;
+
+	double roots[ 3 ];
+	const std::size_t nRoots( Math::solveCubic( c3, c2, c1, c0, roots ) );
+	for ( std::size_t k( 0 ); k < nRoots; k++ )
+	{
+		double Fn[ 9 ];
+		for ( std::size_t i( 0 ); i < 9; i++ )
+			Fn[ i ] = roots[ k ] * F1[ i ] + ( 1 - roots[ k ] ) * F2[ i ];
+		denormalizeFundamentalMatrix( solutions[ k ], Fn, fromModMatrix, toModMatrix );
+	}
+	return nRoots;
+}
+
+
+/** \internal */
+template< typename T >
+Math::Matrix< T, 3, 3 > getFundamentalMatrixFastImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< T, 2 > >& toPoints )
+{
+	if( fromPoints.size() != toPoints.size() )
+		UBITRACK_THROW ( "Input sizes do not match" );	
+	if( fromPoints.size() < 8 )
+		UBITRACK_THROW ( "Input sizes to small. Use at least 8 values" );	
+
+	Math::Vector< T, 2 > fromShift;
+	Math::Vector< T, 2 > toShift;
+	T fromScale;
+	T toScale;
+	Math::Matrix< T, 3, 3 > fromModMatrix;
+	Math::Matrix< T, 3, 3 > toModMatrix;
+	normalize( fromShift, fromScale, fromModMatrix, fromPoints );
+	normalize( toShift, toScale, toModMatrix, toPoints );
+
+	// accumulate the upper triangle of A^T A
+	double AtA[ 9 ][ 9 ];
+	std::fill( &AtA[ 0 ][ 0 ], &AtA[ 0 ][ 0 ] + 81, 0.0 );
+	for ( std::size_t i( 0 ); i < fromPoints.size(); i++ )
+	{
+		double a[ 9 ];
+		epipolarConstraint( a, 
+			( fromPoints[ i ]( 0 ) - fromShift( 0 ) ) * fromScale, ( fromPoints[ i ]( 1 ) - fromShift( 1 ) ) * fromScale,
+			( toPoints[ i ]( 0 ) - toShift( 0 ) ) * toScale, ( toPoints[ i ]( 1 ) - toShift( 1 ) ) * toScale );
+		for ( std::size_t r( 0 ); r < 9; r++ )
+			for ( std::size_t c( r ); c < 9; c++ )
+				AtA[ r ][ c ] += a[ r ] * a[ c ];
+	}
+
+	double ev[ 9 ];
+	double V[ 9 ][ 9 ];
+	Math::symmetricEigen( AtA, ev, V );
+	double Fn[ 9 ];
+	for ( std::size_t i( 0 ); i < 9; i++ )
+		Fn[ i ] = V[ i ][ 0 ];
+
+	// constraint enforcement: F v v^T removes the smallest singular value, v is the 
+	// eigenvector of F^T F to the smallest eigenvalue
+	double FtF[ 3 ][ 3 ];
+	for ( std::size_t r( 0 ); r < 3; r++ )
+		for ( std::size_t c( r ); c < 3; c++ )
+			FtF[ r ][ c ] = Fn[ r ] * Fn[ c ] + Fn[ 3 + r ] * Fn[ 3 + c ] + Fn[ 6 + r ] * Fn[ 6 + c ];
+	double ev3[ 3 ];
+	double V3[ 3 ][ 3 ];
+	Math::symmetricEigen( FtF, ev3, V3 );
+	for ( std::size_t r( 0 ); r < 3; r++ )
+	{
+		const double Fv = Fn[ 3 * r ] * V3[ 0 ][ 0 ] + Fn[ 3 * r + 1 ] * V3[ 1 ][ 0 ] + Fn[ 3 * r + 2 ] * V3[ 2 ][ 0 ];
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			Fn[ 3 * r + c ] -= Fv * V3[ c ][ 0 ];
+	}
+
+	Math::Matrix< T, 3, 3 > F;
+	denormalizeFundamentalMatrix( F, Fn, fromModMatrix, toModMatrix );
+	return F;
+}
+
+
+/** \internal */
+template< typename T >
+void sampsonDistancesImpl( const Math::Matrix< T, 3, 3 >& F, 
+	const std::vector< T >& fromX, const std::vector< T >& fromY,
+	const std::vector< T >& toX, const std::vector< T >& toY, std::vector< T >& distances )
+{
+	const std::size_t n( fromX.size() );
+	assert( fromY.size() == n && toX.size() == n && toY.size() == n && distances.size() == n );
+	if ( n == 0 )
+		return;
+
+	const T f00 = F( 0, 0 ), f01 = F( 0, 1 ), f02 = F( 0, 2 );
+	const T f10 = F( 1, 0 ), f11 = F( 1, 1 ), f12 = F( 1, 2 );
+	const T f20 = F( 2, 0 ), f21 = F( 2, 1 ), f22 = F( 2, 2 );
+	const T* x = &fromX[ 0 ];
+	const T* y = &fromY[ 0 ];
+	const T* x_ = &toX[ 0 ];
+	const T* y_ = &toY[ 0 ];
+	T* d = &distances[ 0 ];
+
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		const T l0 = f00 * x[ i ] + f01 * y[ i ] + f02;
+		const T l1 = f10 * x[ i ] + f11 * y[ i ] + f12;
+		const T l2 = f20 * x[ i ] + f21 * y[ i ] + f22;
+		const T m0 = f00 * x_[ i ] + f10 * y_[ i ] + f20;
+		const T m1 = f01 * x_[ i ] + f11 * y_[ i ] + f21;
+		const T e = x_[ i ] * l0 + y_[ i ] * l1 + l2;
+		d[ i ] = e * e / ( l0 * l0 + l1 * l1 + m0 * m0 + m1 * m1 );
+	}
+}
+
+
+/** \internal */
+template< typename T >
+Math::Matrix< T, 3, 3 > getFundamentalMatrixRansacImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< T, 2 > >& toPoints, std::vector< bool >& inliers,
+	T fThreshold, unsigned nMaxRuns, double fConfidence )
+{
+	static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Calibration.FundamentalMatrix" ) );
+
+	const std::size_t n( fromPoints.size() );
+	if ( n < 8 || toPoints.size() != n )
+		UBITRACK_THROW( "RANSAC fundamental matrix estimation requires at least 8 point correspondences" );
+
+	// coordinates as separate arrays for scoring
+	std::vector< T > fromX( n ), fromY( n ), toX( n ), toY( n ), distances( n );
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		fromX[ i ] = fromPoints[ i ]( 0 );
+		fromY[ i ] = fromPoints[ i ]( 1 );
+		toX[ i ] = toPoints[ i ]( 0 );
+		toY[ i ] = toPoints[ i ]( 1 );
+	}
+
+	const T fThreshold2 = fThreshold * fThreshold;
+	Math::Matrix< T, 3, 3 > bestF;
+	double fBestScore = std::numeric_limits< double >::infinity();
+	std::size_t nBestInliers = 0;
+	unsigned nRuns = nMaxRuns;
+	unsigned iRun;
+	for ( iRun = 0; iRun < nRuns; iRun++ )
+	{
+		// draw seven distinct correspondences
+		Math::Vector< T, 2 > sampleFrom[ 7 ];
+		Math::Vector< T, 2 > sampleTo[ 7 ];
+		std::size_t sample[ 7 ];
+		for ( std::size_t i( 0 ); i < 7; i++ )
+		{
+			bool bUnique;
+			do
+			{
+				sample[ i ] = rand() % n;
+				bUnique = true;
+				for ( std::size_t j( 0 ); j < i; j++ )
+					bUnique = bUnique && sample[ j ] != sample[ i ];
+			}
+			while ( !bUnique );
+			sampleFrom[ i ] = fromPoints[ sample[ i ] ];
+			sampleTo[ i ] = toPoints[ sample[ i ] ];
+		}
+
+		Math::Matrix< T, 3, 3 > candidates[ 3 ];
+		const std::size_t nSolutions( getFundamentalMatrix7PointImpl( sampleFrom, sampleTo, candidates ) );
+		for ( std::size_t s( 0 ); s < nSolutions; s++ )
+		{
+			// truncated quadratic score
+			sampsonDistancesImpl( candidates[ s ], fromX, fromY, toX, toY, distances );
+			double fScore = 0;
+			std::size_t nInliers = 0;
+			for ( std::size_t i( 0 ); i < n; i++ )
+				if ( distances[ i ] < fThreshold2 )
+				{
+					fScore += distances[ i ];
+					nInliers++;
+				}
+				else
+					fScore += fThreshold2;
+
+			if ( fScore < fBestScore )
+			{
+				fBestScore = fScore;
+				nBestInliers = nInliers;
+				bestF = candidates[ s ];
+				UBITRACK_LOG_TRACE( logger, "RANSAC iteration " << iRun + 1 << ": " << nInliers << " inliers, score " << fScore );
+
+				// number of samples needed to draw seven inliers with the given confidence
+				const double w = double( nInliers ) / n;
+				const double fLogOutlierSample = std::log( 1.0 - std::pow( w, 7 ) );
+				if ( fLogOutlierSample < 0 )
+				{
+					const double fNeeded = std::ceil( std::log( 1.0 - fConfidence ) / fLogOutlierSample );
+					if ( fNeeded < nRuns )
+						nRuns = std::max( static_cast< unsigned >( fNeeded ), iRun + 1 );
+				}
+			}
+		}
+	}
+
+	UBITRACK_LOG_DEBUG( logger, "RANSAC: " << iRun << " iterations, " << nBestInliers << " inliers" );
+	if ( nBestInliers < 8 )
+		UBITRACK_THROW( "RANSAC fundamental matrix estimation found no consensus set of at least 8 correspondences" );
+
+	// refine on the consensus set until it no longer changes, as marginal outliers of the 
+	// minimal solution may still distort the first refinement
+	std::vector< Math::Vector< T, 2 > > inFrom;
+	std::vector< Math::Vector< T, 2 > > inTo;
+	inFrom.reserve( n );
+	inTo.reserve( n );
+	Math::Matrix< T, 3, 3 > F( bestF );
+	inliers.resize( n );
+	sampsonDistancesImpl( F, fromX, fromY, toX, toY, distances );
+	for ( std::size_t i( 0 ); i < n; i++ )
+		inliers[ i ] = distances[ i ] < fThreshold2;
+
+	std::vector< bool > refitInliers( n );
+	for ( unsigned iRefine( 0 ); iRefine < 5; iRefine++ )
+	{
+		inFrom.clear();
+		inTo.clear();
+		for ( std::size_t i( 0 ); i < n; i++ )
+			if ( inliers[ i ] )
+			{
+				inFrom.push_back( fromPoints[ i ] );
+				inTo.push_back( toPoints[ i ] );
+			}
+		const Math::Matrix< T, 3, 3 > refitF( getFundamentalMatrixFastImpl( inFrom, inTo ) );
+
+		sampsonDistancesImpl( refitF, fromX, fromY, toX, toY, distances );
+		bool bChanged = false;
+		std::size_t nInliers = 0;
+		for ( std::size_t i( 0 ); i < n; i++ )
+		{
+			refitInliers[ i ] = distances[ i ] < fThreshold2;
+			bChanged = bChanged || refitInliers[ i ] != inliers[ i ];
+			nInliers += refitInliers[ i ];
+		}
+
+		// keep the previous matrix if the refit lost its support
+		if ( nInliers < 8 )
+			break;
+
+		// the returned flags always belong to the returned matrix
+		F = refitF;
+		inliers.swap( refitInliers );
+		if ( !bChanged )
+			break;
+	}
+	return F;
+}
+
+
+std::size_t getFundamentalMatrix7Point( const Math::Vector< float, 2 >* fromPoints,
+	const Math::Vector< float, 2 >* toPoints, Math::Matrix< float, 3, 3 >* solutions )
+{
+	return getFundamentalMatrix7PointImpl( fromPoints, toPoints, solutions );
+}
+
+std::size_t getFundamentalMatrix7Point( const Math::Vector< double, 2 >* fromPoints,
+	const Math::Vector< double, 2 >* toPoints, Math::Matrix< double, 3, 3 >* solutions )
+{
+	return getFundamentalMatrix7PointImpl( fromPoints, toPoints, solutions );
+}
+
+Math::Matrix< float, 3, 3 > getFundamentalMatrixFast( const std::vector< Math::Vector< float, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< float, 2 > >& toPoints )
+{
+	return getFundamentalMatrixFastImpl( fromPoints, toPoints );
+}
+
+Math::Matrix< double, 3, 3 > getFundamentalMatrixFast( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< double, 2 > >& toPoints )
+{
+	return getFundamentalMatrixFastImpl( fromPoints, toPoints );
+}
+
+void sampsonDistances( const Math::Matrix< float, 3, 3 >& F, 
+	const std::vector< float >& fromX, const std::vector< float >& fromY,
+	const std::vector< float >& toX, const std::vector< float >& toY, std::vector< float >& distances )
+{
+	sampsonDistancesImpl( F, fromX, fromY, toX, toY, distances );
+}
+
+void sampsonDistances( const Math::Matrix< double, 3, 3 >& F, 
+	const std::vector< double >& fromX, const std::vector< double >& fromY,
+	const std::vector< double >& toX, const std::vector< double >& toY, std::vector< double >& distances )
+{
+	sampsonDistancesImpl( F, fromX, fromY, toX, toY, distances );
+}
+
+Math::Matrix< float, 3, 3 > getFundamentalMatrixRansac( const std::vector< Math::Vector< float, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< bool >& inliers,
+	float fThreshold, unsigned nMaxRuns, double fConfidence )
+{
+	return getFundamentalMatrixRansacImpl( fromPoints, toPoints, inliers, fThreshold, nMaxRuns, fConfidence );
+}
+
+Math::Matrix< double, 3, 3 > getFundamentalMatrixRansac( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< bool >& inliers,
+	double fThreshold, unsigned nMaxRuns, double fConfidence )
+{
+	return getFundamentalMatrixRansacImpl( fromPoints, toPoints, inliers, fThreshold, nMaxRuns, fConfidence );
+}
+
+
+#ifdef HAVE_LAPACK
+
+namespace lapack = boost::numeric::bindings::lapack;
+
 template< typename T >
 Math::Matrix< T, 3, 3 > getFundamentalMatrixImpl( const std::vector< Math::Vector< T, 2 > > & fromPoints, 
 	const std::vector< Math::Vector< T, 2 > > & toPoints, std::size_t stepSize )
@@ -87,20 +544,20 @@ Math::Matrix< T, 3, 3 > getFundamentalMatrixImpl( const std::vector< Math::Vecto
 	
 	if( stepSize < 1 )
 	{
-		LOG4CPP_ERROR ( logger, "invalid step size, using 1 instead");
+		UBITRACK_LOG_ERROR ( logger, "invalid step size, using 1 instead");
 		UBITRACK_THROW ( "invalid step size, using 1 instead" );	
 		stepSize = 1;
 	}
 
 	if( fromPoints.size() != toPoints.size() )
 	{
-		LOG4CPP_ERROR ( logger, "Input sizes of the vectors do not match ");
+		UBITRACK_LOG_ERROR ( logger, "Input sizes of the vectors do not match ");
 		UBITRACK_THROW ( "Input sizes do not match" );	
 	}
 	
 	if( fromPoints.size() < 8 )
 	{
-		LOG4CPP_ERROR ( logger, "Input sizes of the vectors to small ");
+		UBITRACK_LOG_ERROR ( logger, "Input sizes of the vectors to small ");
 		UBITRACK_THROW ( "Input sizes to small. Use at least 8 values" );	
 	}
 
@@ -145,7 +602,7 @@ Math::Matrix< T, 3, 3 > getFundamentalMatrixImpl( const std::vector< Math::Vecto
 
 	if ( info != 0 )
 	{
-		LOG4CPP_ERROR ( logger, "first SVD failed");
+		UBITRACK_LOG_ERROR ( logger, "first SVD failed");
 		UBITRACK_THROW ( "first SVD failed" );	
 	}
 
@@ -163,7 +620,7 @@ Math::Matrix< T, 3, 3 > getFundamentalMatrixImpl( const std::vector< Math::Vecto
 
 	if ( info != 0 )
 	{
-		LOG4CPP_ERROR ( logger, "second SVD failed");
+		UBITRACK_LOG_ERROR ( logger, "second SVD failed");
 		UBITRACK_THROW ( "second SVD failed" );	
 	}
 
@@ -299,6 +756,6 @@ Math::Pose poseFromFundamentalMatrix( const Math::Matrix< double, 3, 3 > & fM, c
 	return Math::Pose( Math::Quaternion( Wt ), u3 );
 }
 
-} } // namespace Ubitrack::Calibration
-
 #endif // HAVE_LAPACK
+
+} } // namespace Ubitrack::Calibration
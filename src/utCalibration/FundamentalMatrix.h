@@ -32,14 +32,133 @@
 #ifndef __UBITRACK_CALIBRATION_FUNDAMENTALMATRIX_H_INCLUDED__
 #define __UBITRACK_CALIBRATION_FUNDAMENTALMATRIX_H_INCLUDED__
 
+#include <vector>
 #include <utCore.h>
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
 
-#ifdef HAVE_LAPACK
-
 namespace Ubitrack { namespace Calibration {
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes the fundamental matrices of seven point correspondences (7-point algorithm).
+ *
+ * The constraints x'^T F x = 0 of the Hartley-normalized points leave a two-dimensional space
+ * F = a F1 + (1 - a) F2 of solutions. The condition det( F ) = 0 gives a cubic in a with one or three
+ * real roots. No memory is allocated, which makes the function suitable as minimal solver in RANSAC.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints array of seven points x as inhomogeneous 2-vectors
+ * @param toPoints array of seven points x' as inhomogeneous 2-vectors
+ * @param solutions array of three elements which receives the fundamental matrices, scaled to unit norm
+ * @return number of solutions, zero if the points are degenerate
+ */
+UBITRACK_EXPORT std::size_t getFundamentalMatrix7Point( const Math::Vector< float, 2 >* fromPoints,
+	const Math::Vector< float, 2 >* toPoints, Math::Matrix< float, 3, 3 >* solutions );
+
+UBITRACK_EXPORT std::size_t getFundamentalMatrix7Point( const Math::Vector< double, 2 >* fromPoints,
+	const Math::Vector< double, 2 >* toPoints, Math::Matrix< double, 3, 3 >* solutions );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes a fundamental matrix using the normalized 8-point algorithm without LAPACK.
+ *
+ * Same as \c getFundamentalMatrix, but only the 9x9 normal matrix A^T A is accumulated and the
+ * solution is its eigenvector to the smallest eigenvalue. The rank-2 constraint is enforced by
+ * removing the direction of the smallest singular value, which is found as eigenvector of F^T F.
+ * Takes O(n) time and does not allocate memory.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints Points x as inhomogeneous 2-vectors, at least eight
+ * @param toPoints Points x' as inhomogeneous 2-vectors
+ * @return calculated fundamental matrix, scaled to unit norm
+ * @throws Util::Exception if less than eight points or vectors of different size are given
+ */
+UBITRACK_EXPORT Math::Matrix< float, 3, 3 > getFundamentalMatrixFast( const std::vector< Math::Vector< float, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< float, 2 > >& toPoints );
+
+UBITRACK_EXPORT Math::Matrix< double, 3, 3 > getFundamentalMatrixFast( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< double, 2 > >& toPoints );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the Sampson distances of many point correspondences to a fundamental matrix.
+ *
+ * The Sampson distance (x'^T F x)^2 / ( (Fx)_1^2 + (Fx)_2^2 + (F^T x')_1^2 + (F^T x')_2^2 ) is a first-order
+ * approximation of the squared geometric distance of a correspondence. The points are given as
+ * separate coordinate arrays, so the loop can be vectorized.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param F fundamental matrix with x'^T F x = 0
+ * @param fromX x-coordinates of the points x
+ * @param fromY y-coordinates of the points x
+ * @param toX x-coordinates of the points x'
+ * @param toY y-coordinates of the points x'
+ * @param distances receives the squared distances, must have the same size as the coordinate arrays
+ */
+UBITRACK_EXPORT void sampsonDistances( const Math::Matrix< float, 3, 3 >& F, 
+	const std::vector< float >& fromX, const std::vector< float >& fromY,
+	const std::vector< float >& toX, const std::vector< float >& toY, std::vector< float >& distances );
+
+UBITRACK_EXPORT void sampsonDistances( const Math::Matrix< double, 3, 3 >& F, 
+	const std::vector< double >& fromX, const std::vector< double >& fromY,
+	const std::vector< double >& toX, const std::vector< double >& toY, std::vector< double >& distances );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes a fundamental matrix from point correspondences that may contain outliers.
+ *
+ * Hypotheses are generated by the 7-point algorithm from random minimal samples and scored by the 
+ * truncated Sampson distance of all correspondences (MSAC). The number of samples adapts to the inlier 
+ * ratio of the best hypothesis. The result is computed by \c getFundamentalMatrixFast from the inliers.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints Points x as inhomogeneous 2-vectors
+ * @param toPoints Points x' as inhomogeneous 2-vectors
+ * @param inliers receives one flag per correspondence, true for inliers of the returned matrix
+ * @param fThreshold maximum (Sampson) distance of inliers in image coordinates
+ * @param nMaxRuns maximum number of minimal samples
+ * @param fConfidence probability with which at least one outlier-free sample is drawn before stopping
+ * @return calculated fundamental matrix, scaled to unit norm
+ * @throws Util::Exception if no consensus set of at least eight correspondences was found
+ */
+UBITRACK_EXPORT Math::Matrix< float, 3, 3 > getFundamentalMatrixRansac( const std::vector< Math::Vector< float, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< bool >& inliers,
+	float fThreshold = 1.0f, unsigned nMaxRuns = 1000, double fConfidence = 0.99 );
+
+UBITRACK_EXPORT Math::Matrix< double, 3, 3 > getFundamentalMatrixRansac( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< bool >& inliers,
+	double fThreshold = 1.0, unsigned nMaxRuns = 1000, double fConfidence = 0.99 );
+
+/**
+ * function object to evalute a fundamental matrix by the Sampson distance for RANSAC etc.
+ */
+template< class T >
+class EvaluateFundamentalMatrixSampson
+{
+public:
+	/**
+	 * computes the Sampson distance, i.e. the approximate squared geometric distance of the correspondence
+	 */
+	T operator()( const Math::Matrix< T, 3, 3 >& fM, const Math::Vector< T, 2 >& from, const Math::Vector< T, 2 >& to ) const
+	{
+		Math::Vector< T, 3 > from_;
+		for ( unsigned i = 0; i < 3; i++ )
+			from_( i ) = fM( i, 0 ) * from( 0 ) + fM( i, 1 ) * from( 1 ) + fM( i, 2 );
+
+		const T to0 = fM( 0, 0 ) * to( 0 ) + fM( 1, 0 ) * to( 1 ) + fM( 2, 0 );
+		const T to1 = fM( 0, 1 ) * to( 0 ) + fM( 1, 1 ) * to( 1 ) + fM( 2, 1 );
+		const T term = from_( 0 ) * to( 0 ) + from_( 1 ) * to( 1 ) + from_( 2 );
+		return ( term * term ) / ( from_( 0 ) * from_( 0 ) + from_( 1 ) * from_( 1 ) + to0 * to0 + to1 * to1 );
+	}
+};
+
+#ifdef HAVE_LAPACK
+
 /**
  * @ingroup tracking_algorithms
  * Computes a fundamental matrix using the normalized 8-point algorithm.
@@ -123,8 +242,8 @@ public:
 	}
 };
 	
-} } // namespace Ubitrack::Calibration
-
 #endif // HAVE_LAPACK
 
+} } // namespace Ubitrack::Calibration
+
 #endif
@@ -38,11 +38,13 @@
 #include <boost/numeric/ublas/vector_proxy.hpp>
 #include <boost/numeric/bindings/lapack/gels.hpp>
 
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 #include <utUtil/Exception.h>
 #include <utUtil/Logging.h>
 #include <utMath/MatrixOperations.h>
 
+#include <cmath>
+
 //shortcuts to namespaces
 namespace ublas = boost::numeric::ublas;
 namespace lapack = boost::numeric::bindings::lapack;
@@ -423,7 +425,7 @@ Math::Pose performHandEyeCalibrationImp ( const std::vector<Math::Matrix< T, 4,
 	const std::size_t n_eyes( eye.size() );
 	if( n_eyes != hand.size())
 	{
-		LOG4CPP_ERROR ( logger, "Input sizes of the vectors do not match ");
+		UBITRACK_LOG_ERROR ( logger, "Input sizes of the vectors do not match ");
 		UBITRACK_THROW ( "Input sizes do not match" );		
 	}
 
@@ -493,7 +495,7 @@ Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  c
 	const std::size_t n_eyes( eye.size() );
 	if( n_eyes != hand.size())
 	{
-		LOG4CPP_ERROR ( logger, "Input sizes of the vectors do not match ");
+		UBITRACK_LOG_ERROR ( logger, "Input sizes of the vectors do not match ");
 		UBITRACK_THROW ( "Input sizes do not match" );		
 	}
 
@@ -515,6 +517,112 @@ Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  c
 	return Math::Pose(Math::Quaternion( rcg ), tcg);
 }
 
+
+/** \internal solves the symmetric 3x3 system A x = b by Cramer's rule */
+static Math::Vector< double, 3 > solveSymmetric3x3( const Math::Matrix< double, 3, 3 >& A, const Math::Vector< double, 3 >& b )
+{
+	const double c00 = A( 1, 1 ) * A( 2, 2 ) - A( 1, 2 ) * A( 1, 2 );
+	const double c01 = A( 0, 2 ) * A( 1, 2 ) - A( 0, 1 ) * A( 2, 2 );
+	const double c02 = A( 0, 1 ) * A( 1, 2 ) - A( 0, 2 ) * A( 1, 1 );
+	const double c11 = A( 0, 0 ) * A( 2, 2 ) - A( 0, 2 ) * A( 0, 2 );
+	const double c12 = A( 0, 1 ) * A( 0, 2 ) - A( 0, 0 ) * A( 1, 2 );
+	const double c22 = A( 0, 0 ) * A( 1, 1 ) - A( 0, 1 ) * A( 0, 1 );
+	const double det = A( 0, 0 ) * c00 + A( 0, 1 ) * c01 + A( 0, 2 ) * c02;
+
+	return Math::Vector< double, 3 >( 
+		( c00 * b( 0 ) + c01 * b( 1 ) + c02 * b( 2 ) ) / det,
+		( c01 * b( 0 ) + c11 * b( 1 ) + c12 * b( 2 ) ) / det,
+		( c02 * b( 0 ) + c12 * b( 1 ) + c22 * b( 2 ) ) / det );
+}
+
+
+OnlineHandEyeCalibration::OnlineHandEyeCalibration( std::size_t nWindowSize, double fMinAngle )
+	: m_nWindowSize( nWindowSize )
+	, m_fMinAngle( fMinAngle )
+{
+	if ( nWindowSize == 0 )
+		UBITRACK_THROW( "Window size of the online hand-eye calibration must be positive" );
+	reset();
+}
+
+
+void OnlineHandEyeCalibration::reset()
+{
+	m_window.clear();
+	m_nPairs = 0;
+	m_rotAtA = Math::Matrix< double, 3, 3 >::zeros();
+	m_rotAtb = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_transAtA = Math::Matrix< double, 3, 3 >::zeros();
+	m_transAtg = Math::Vector< double, 3 >( 0, 0, 0 );
+	for ( std::size_t i( 0 ); i < 3; i++ )
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			for ( std::size_t l( 0 ); l < 3; l++ )
+				m_transRtc[ i ][ j ][ l ] = 0;
+}
+
+
+void OnlineHandEyeCalibration::addMeasurement( const Math::Pose& hand, const Math::Pose& eye )
+{
+	addMeasurement( Math::Matrix< double, 4, 4 >( hand ), Math::Matrix< double, 4, 4 >( eye ) );
+}
+
+
+void OnlineHandEyeCalibration::addMeasurement( const Math::Matrix< double, 4, 4 >& hand, const Math::Matrix< double, 4, 4 >& eye )
+{
+	// relative motions to the previous poses, in the same order as fillTransformationVectors
+	for ( std::size_t i( 0 ); i < m_window.size(); i++ )
+		addPair( computeTransformation( m_window[ i ].first, hand, 0 ), computeTransformation( m_window[ i ].second, eye, 1 ) );
+
+	m_window.push_back( std::make_pair( hand, eye ) );
+	if ( m_window.size() > m_nWindowSize )
+		m_window.pop_front();
+}
+
+
+void OnlineHandEyeCalibration::addPair( const Math::Matrix< double, 4, 4 >& hgij, const Math::Matrix< double, 4, 4 >& hcij )
+{
+	// skip small rotations, cos( angle ) = ( trace( R ) - 1 ) / 2
+	if ( m_fMinAngle > 0 && ( hgij( 0, 0 ) + hgij( 1, 1 ) + hgij( 2, 2 ) - 1 ) / 2 > std::cos( m_fMinAngle ) )
+		return;
+
+	// rotation: skew( P'gij + P'cij ) P'cg = P'cij - P'gij
+	Math::Matrix< double, 3, 3 > skewP;
+	const Math::Vector< double, 3 > rightR( computeSidesRot( hgij, hcij, skewP ) );
+	m_rotAtA += ublas::prod( ublas::trans( skewP ), skewP );
+	m_rotAtb += ublas::prod( ublas::trans( skewP ), rightR );
+
+	// translation: ( Rgij - I ) Tcg = Rcg Tcij - Tgij
+	Math::Matrix< double, 3, 3 > leftT( ublas::subrange( hgij, 0, 3, 0, 3 ) );
+	leftT -= Math::Matrix< double, 3, 3 >::identity();
+	const Math::Vector< double, 3 > tgij( ublas::subrange( ublas::column( hgij, 3 ), 0, 3 ) );
+	const Math::Vector< double, 3 > tcij( ublas::subrange( ublas::column( hcij, 3 ), 0, 3 ) );
+	m_transAtA += ublas::prod( ublas::trans( leftT ), leftT );
+	m_transAtg += ublas::prod( ublas::trans( leftT ), tgij );
+	for ( std::size_t i( 0 ); i < 3; i++ )
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			for ( std::size_t l( 0 ); l < 3; l++ )
+				m_transRtc[ i ][ j ][ l ] += leftT( j, i ) * tcij( l );
+
+	m_nPairs++;
+}
+
+
+Math::Pose OnlineHandEyeCalibration::computeResult() const
+{
+	if ( m_nPairs < 2 )
+		return Math::Pose( Math::Quaternion(), Math::Vector< double, 3 >( 0, 0, 0 ) );
+
+	const Math::Matrix< double, 3, 3 > rcg( getRcg( solveSymmetric3x3( m_rotAtA, m_rotAtb ) ) );
+
+	Math::Vector< double, 3 > b( -m_transAtg );
+	for ( std::size_t i( 0 ); i < 3; i++ )
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			for ( std::size_t l( 0 ); l < 3; l++ )
+				b( i ) += rcg( j, l ) * m_transRtc[ i ][ j ][ l ];
+
+	return Math::Pose( Math::Quaternion( rcg ), solveSymmetric3x3( m_transAtA, b ) );
+}
+
 }}
 
 #endif // HAVE_LAPACK
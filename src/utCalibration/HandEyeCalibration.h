@@ -40,6 +40,8 @@
 #include <utMath/Matrix.h>
 #include <utMath/Pose.h>
 #include <vector>
+#include <deque>
+#include <utility>
 
 namespace Ubitrack { namespace Calibration {
 
@@ -61,6 +63,77 @@ UBITRACK_EXPORT Math::Pose performHandEyeCalibration ( const std::vector< Math::
 
 UBITRACK_EXPORT Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  const std::vector< Math::Pose >& eye, bool bUseAllPairs = true );
 
+/**
+ * @ingroup tracking_algorithms
+ * Incremental version of performHandEyeCalibration for long streams of hand and eye poses.
+ *
+ * Each new pair of hand and eye poses is combined with the most recent \c nWindowSize poses 
+ * into relative motions, which are folded into the 3x3 normal equations of the Tsai-Lenz 
+ * rotation and translation systems. The translation system depends on the rotation, which is 
+ * only known at the end, so its right hand side is kept as a tensor that is linear in the 
+ * rotation. Memory and time per pose are therefore bounded by the window size, independent 
+ * of the number of poses, and a result can be computed at any time.
+ *
+ * A window size of one corresponds to \c bUseAllPairs = false in the batch version, a window 
+ * that covers all poses to \c bUseAllPairs = true. Relative motions whose hand rotation is 
+ * smaller than \c fMinAngle are skipped, as they carry little information on the rotation.
+ */
+class UBITRACK_EXPORT OnlineHandEyeCalibration
+{
+public:
+	/**
+	 * constructor
+	 * @param nWindowSize number of previous poses each new pose is paired with
+	 * @param fMinAngle minimum rotation angle of the relative hand motion of a pair, in radians
+	 */
+	OnlineHandEyeCalibration( std::size_t nWindowSize = 1, double fMinAngle = 0.0 );
+
+	/** removes all measurements */
+	void reset();
+
+	/**
+	 * adds a new pair of poses
+	 * @param hand hand (marker) pose in the global (tracker) coordinate system
+	 * @param eye eye (camera) pose in the eye coordinate system
+	 */
+	void addMeasurement( const Math::Pose& hand, const Math::Pose& eye );
+
+	/** adds a new pair of poses given as 4x4 matrices */
+	void addMeasurement( const Math::Matrix< double, 4, 4 >& hand, const Math::Matrix< double, 4, 4 >& eye );
+
+	/** number of relative motions accumulated so far */
+	std::size_t getNumberOfPairs() const
+	{ return m_nPairs; }
+
+	/**
+	 * returns the current estimate of the transformation between eye and hand, or the identity 
+	 * if less than two relative motions have been accumulated.
+	 */
+	Math::Pose computeResult() const;
+
+protected:
+	/** folds one relative motion into the normal equations */
+	void addPair( const Math::Matrix< double, 4, 4 >& hgij, const Math::Matrix< double, 4, 4 >& hcij );
+
+	std::size_t m_nWindowSize;
+	double m_fMinAngle;
+
+	/** most recent hand and eye poses */
+	std::deque< std::pair< Math::Matrix< double, 4, 4 >, Math::Matrix< double, 4, 4 > > > m_window;
+
+	/** number of relative motions */
+	std::size_t m_nPairs;
+
+	/** normal equations A^T A and A^T b of the rotation system */
+	Math::Matrix< double, 3, 3 > m_rotAtA;
+	Math::Vector< double, 3 > m_rotAtb;
+
+	/** normal equations of the translation system, A^T b = sum_jl R_jl m_transRtc[ . ][ j ][ l ] - m_transAtg */
+	Math::Matrix< double, 3, 3 > m_transAtA;
+	double m_transRtc[ 3 ][ 3 ][ 3 ];
+	Math::Vector< double, 3 > m_transAtg;
+};
+
 
 }} // namespace Ubitrack::Calibration
 
@@ -31,16 +31,187 @@
 
 #include "Homography.h"
 #include <utMath/Geometry/PointNormalization.h>
+#include <utMath/SymmetricEigen.h>
+
+#include <cmath>
+#include <algorithm>
 
 #ifdef HAVE_LAPACK
 #include <boost/numeric/bindings/lapack/gesvd.hpp>
+#endif
 
 // shortcuts to namespaces
 namespace ublas = boost::numeric::ublas;
-namespace lapack = boost::numeric::bindings::lapack;
 
 namespace Ubitrack { namespace Calibration {
 
+/** 
+ * \internal 
+ * Computes the homography S that maps the unit square (0,0), (1,0), (1,1), (0,1) to the
+ * quadrilateral p[ 0 ]..p[ 3 ] (see Heckbert, "Fundamentals of Texture Mapping and Image Warping").
+ * Returns false if three of the points are (almost) colinear.
+ */
+template< typename T >
+bool unitSquareToQuad( const Math::Vector< T, 2 >* p, double S[ 3 ][ 3 ] )
+{
+	const double x0 = p[ 0 ]( 0 ), y0 = p[ 0 ]( 1 );
+	const double x1 = p[ 1 ]( 0 ), y1 = p[ 1 ]( 1 );
+	const double x2 = p[ 2 ]( 0 ), y2 = p[ 2 ]( 1 );
+	const double x3 = p[ 3 ]( 0 ), y3 = p[ 3 ]( 1 );
+
+	const double dx1 = x1 - x2, dx2 = x3 - x2, dx3 = x0 - x1 + x2 - x3;
+	const double dy1 = y1 - y2, dy2 = y3 - y2, dy3 = y0 - y1 + y2 - y3;
+
+	const double den = dx1 * dy2 - dx2 * dy1;
+	if ( den == 0 )
+		return false;
+
+	const double g = ( dx3 * dy2 - dx2 * dy3 ) / den;
+	const double h = ( dx1 * dy3 - dx3 * dy1 ) / den;
+
+	S[ 0 ][ 0 ] = x1 - x0 + g * x1; S[ 0 ][ 1 ] = x3 - x0 + h * x3; S[ 0 ][ 2 ] = x0;
+	S[ 1 ][ 0 ] = y1 - y0 + g * y1; S[ 1 ][ 1 ] = y3 - y0 + h * y3; S[ 1 ][ 2 ] = y0;
+	S[ 2 ][ 0 ] = g;                S[ 2 ][ 1 ] = h;                S[ 2 ][ 2 ] = 1;
+
+	// S becomes (almost) singular if three points are colinear
+	const double det = 
+		S[ 0 ][ 0 ] * ( S[ 1 ][ 1 ] - S[ 1 ][ 2 ] * h ) -
+		S[ 0 ][ 1 ] * ( S[ 1 ][ 0 ] - S[ 1 ][ 2 ] * g ) +
+		S[ 0 ][ 2 ] * ( S[ 1 ][ 0 ] * h - S[ 1 ][ 1 ] * g );
+	double norm = 0;
+	for ( std::size_t r( 0 ); r < 3; r++ )
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			norm += S[ r ][ c ] * S[ r ][ c ];
+	return std::fabs( det ) > 1e-10 * norm * std::sqrt( norm );
+}
+
+
+/** 
+ * \internal 
+ * Closed-form homography between two quadrilaterals: H = S_to * adj( S_from ).
+ * Returns false if one of the quadrilaterals is degenerate.
+ */
+template< typename T >
+bool fourPointHomography( const Math::Vector< T, 2 >* fromPoints, const Math::Vector< T, 2 >* toPoints, double H[ 3 ][ 3 ] )
+{
+	double F[ 3 ][ 3 ];
+	double S[ 3 ][ 3 ];
+	if ( !unitSquareToQuad( fromPoints, F ) || !unitSquareToQuad( toPoints, S ) )
+		return false;
+
+	// adjugate of F, which is its inverse up to scale
+	double A[ 3 ][ 3 ];
+	A[ 0 ][ 0 ] = F[ 1 ][ 1 ] * F[ 2 ][ 2 ] - F[ 1 ][ 2 ] * F[ 2 ][ 1 ];
+	A[ 0 ][ 1 ] = F[ 0 ][ 2 ] * F[ 2 ][ 1 ] - F[ 0 ][ 1 ] * F[ 2 ][ 2 ];
+	A[ 0 ][ 2 ] = F[ 0 ][ 1 ] * F[ 1 ][ 2 ] - F[ 0 ][ 2 ] * F[ 1 ][ 1 ];
+	A[ 1 ][ 0 ] = F[ 1 ][ 2 ] * F[ 2 ][ 0 ] - F[ 1 ][ 0 ] * F[ 2 ][ 2 ];
+	A[ 1 ][ 1 ] = F[ 0 ][ 0 ] * F[ 2 ][ 2 ] - F[ 0 ][ 2 ] * F[ 2 ][ 0 ];
+	A[ 1 ][ 2 ] = F[ 0 ][ 2 ] * F[ 1 ][ 0 ] - F[ 0 ][ 0 ] * F[ 1 ][ 2 ];
+	A[ 2 ][ 0 ] = F[ 1 ][ 0 ] * F[ 2 ][ 1 ] - F[ 1 ][ 1 ] * F[ 2 ][ 0 ];
+	A[ 2 ][ 1 ] = F[ 0 ][ 1 ] * F[ 2 ][ 0 ] - F[ 0 ][ 0 ] * F[ 2 ][ 1 ];
+	A[ 2 ][ 2 ] = F[ 0 ][ 0 ] * F[ 1 ][ 1 ] - F[ 0 ][ 1 ] * F[ 1 ][ 0 ];
+
+	for ( std::size_t r( 0 ); r < 3; r++ )
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			H[ r ][ c ] = S[ r ][ 0 ] * A[ 0 ][ c ] + S[ r ][ 1 ] * A[ 1 ][ c ] + S[ r ][ 2 ] * A[ 2 ][ c ];
+	return true;
+}
+
+
+/** \internal */
+template< typename T >
+Math::Matrix< T, 3, 3 > homographyDLTFastImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< T, 2 > >& toPoints )
+{
+	const std::size_t n_points ( fromPoints.size() );
+	assert( n_points == toPoints.size() );
+	assert( n_points >= 4 );
+
+	double H[ 3 ][ 3 ];
+	if ( n_points != 4 || !fourPointHomography( &fromPoints[ 0 ], &toPoints[ 0 ], H ) )
+	{
+		// normalize input points
+		Math::Vector< T, 2 > fromShift;
+		Math::Vector< T, 2 > fromScale;
+		Math::Geometry::estimateNormalizationParameters( fromPoints.begin(), fromPoints.end(), fromShift, fromScale );
+
+		Math::Vector< T, 2 > toShift;
+		Math::Vector< T, 2 > toScale;
+		Math::Geometry::estimateNormalizationParameters( toPoints.begin(), toPoints.end(), toShift, toScale );
+
+		// accumulate the upper triangle of A^T A, using the same rows of A as homographyDLT
+		double AtA[ 9 ][ 9 ];
+		std::fill( &AtA[ 0 ][ 0 ], &AtA[ 0 ][ 0 ] + 81, 0.0 );
+		for ( std::size_t i ( 0 ); i < n_points; ++i )
+		{
+			const double fx = ( fromPoints[ i ]( 0 ) - fromShift( 0 ) ) / fromScale( 0 );
+			const double fy = ( fromPoints[ i ]( 1 ) - fromShift( 1 ) ) / fromScale( 1 );
+			const double tx = ( toPoints[ i ]( 0 ) - toShift( 0 ) ) / toScale( 0 );
+			const double ty = ( toPoints[ i ]( 1 ) - toShift( 1 ) ) / toScale( 1 );
+
+			const double a0[ 9 ] = { 0, 0, 0, -fx, -fy, -1, ty * fx, ty * fy, ty };
+			const double a1[ 9 ] = { fx, fy, 1, 0, 0, 0, -tx * fx, -tx * fy, -tx };
+			for ( std::size_t r( 0 ); r < 9; r++ )
+				for ( std::size_t c( r ); c < 9; c++ )
+					AtA[ r ][ c ] += a0[ r ] * a0[ c ] + a1[ r ] * a1[ c ];
+		}
+
+		// the solution is the eigenvector to the smallest eigenvalue
+		double ev[ 9 ];
+		double V[ 9 ][ 9 ];
+		Math::symmetricEigen( AtA, ev, V );
+
+		// reverse normalization: H = toCorrect * Hn * fromCorrect
+		const double fsx = 1.0 / fromScale( 0 );
+		const double fsy = 1.0 / fromScale( 1 );
+		for ( std::size_t r( 0 ); r < 3; r++ )
+		{
+			const double h0 = V[ 3 * r ][ 0 ];
+			const double h1 = V[ 3 * r + 1 ][ 0 ];
+			const double h2 = V[ 3 * r + 2 ][ 0 ];
+			H[ r ][ 0 ] = h0 * fsx;
+			H[ r ][ 1 ] = h1 * fsy;
+			H[ r ][ 2 ] = h2 - h0 * fsx * fromShift( 0 ) - h1 * fsy * fromShift( 1 );
+		}
+		for ( std::size_t c( 0 ); c < 3; c++ )
+		{
+			H[ 0 ][ c ] = toScale( 0 ) * H[ 0 ][ c ] + toShift( 0 ) * H[ 2 ][ c ];
+			H[ 1 ][ c ] = toScale( 1 ) * H[ 1 ][ c ] + toShift( 1 ) * H[ 2 ][ c ];
+		}
+	}
+
+	// scale to unit norm
+	double norm = 0;
+	for ( std::size_t r( 0 ); r < 3; r++ )
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			norm += H[ r ][ c ] * H[ r ][ c ];
+	norm = 1.0 / std::sqrt( norm );
+
+	Math::Matrix< T, 3, 3 > result;
+	for ( std::size_t r( 0 ); r < 3; r++ )
+		for ( std::size_t c( 0 ); c < 3; c++ )
+			result( r, c ) = static_cast< T >( H[ r ][ c ] * norm );
+	return result;
+}
+
+
+Math::Matrix< float, 3, 3 > homographyDLTFast( const std::vector< Math::Vector< float, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< float, 2 > >& toPoints )
+{
+	return homographyDLTFastImpl( fromPoints, toPoints );
+}
+
+Math::Matrix< double, 3, 3 > homographyDLTFast( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< double, 2 > >& toPoints )
+{
+	return homographyDLTFastImpl( fromPoints, toPoints );
+}
+
+
+#ifdef HAVE_LAPACK
+
+namespace lapack = boost::numeric::bindings::lapack;
+
 /** \internal */
 template< typename T >
 Math::Matrix< T, 3, 3 > homographyDLTImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, 
@@ -208,6 +379,6 @@ Math::Matrix< double, 3, 3 > squareHomography( const std::vector< Math::Vector<
 	return squareHomographyImpl( corners );
 }
 
-} } // namespace Ubitrack::Calibration
-
 #endif // HAVE_LAPACK
+
+} } // namespace Ubitrack::Calibration
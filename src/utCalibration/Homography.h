@@ -34,8 +34,6 @@
 
 
 
-#ifdef HAVE_LAPACK
-
 #include <utCore.h>
 #include <utMath/Matrix.h>
 #include <utMath/Vector.h>
@@ -43,6 +41,32 @@
 
 namespace Ubitrack { namespace Calibration {
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes a general homography using a normalized linear DLT method without LAPACK.
+ *
+ * Gives the same result as \c homographyDLT, but the points are normalized as described in
+ * Hartley&Zisserman and only the 9x9 normal matrix A^T A is accumulated, whose eigenvector 
+ * to the smallest eigenvalue is the solution. For exactly four points, the homography is computed
+ * in closed form via the unit square. The computation takes O(n) time and does not allocate memory,
+ * which makes it suitable for estimating homographies of many markers per frame.
+ *
+ * The result is scaled to unit Frobenius norm.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints Points x as inhomogeneous 2-vectors, at least four
+ * @param toPoints Points x' as inhomogeneous 2-vectors
+ * @return calculated homography
+ */
+UBITRACK_EXPORT Math::Matrix< float, 3, 3 > homographyDLTFast( const std::vector< Math::Vector< float, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< float, 2 > >& toPoints );
+
+UBITRACK_EXPORT Math::Matrix< double, 3, 3 > homographyDLTFast( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
+	const std::vector< Math::Vector< double, 2 > >& toPoints );
+
+#ifdef HAVE_LAPACK
+
 
 /**
  * @ingroup tracking_algorithms
@@ -81,8 +105,8 @@ UBITRACK_EXPORT Math::Matrix< float, 3, 3 > squareHomography( const std::vector<
 
 UBITRACK_EXPORT Math::Matrix< double, 3, 3 > squareHomography( const std::vector< Math::Vector< double, 2 > >& corners );
 
-} } // namespace Ubitrack::Calibration
-
 #endif // HAVE_LAPACK
 
+} } // namespace Ubitrack::Calibration
+
 #endif
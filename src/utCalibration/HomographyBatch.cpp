@@ -0,0 +1,172 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implements batched homography and pose estimation for many square markers.
+ */
+
+#include "HomographyBatch.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <utMath/ParallelEvaluation.h>
+
+namespace Ubitrack { namespace Calibration {
+
+/** \internal number of markers whose homographies are computed together */
+static const std::size_t g_blockSize = 64;
+
+/** 
+ * \internal 
+ * Computes homographies and poses of the markers [begin, end).
+ */
+template< typename T >
+void squareMarkerPosesRange( const SquareMarkerCorners< T >& corners, const std::vector< Math::Matrix< T, 3, 3 > >& invK,
+	std::vector< Math::Matrix< T, 3, 3 > >& homographies, std::vector< Math::Pose >& poses, 
+	std::size_t begin, std::size_t end )
+{
+	T h[ 9 ][ g_blockSize ];
+
+	for ( std::size_t iBlock( begin ); iBlock < end; iBlock += g_blockSize )
+	{
+		const std::size_t n( std::min( g_blockSize, end - iBlock ) );
+		const T* x0 = &corners.x[ 0 ][ iBlock ];
+		const T* x1 = &corners.x[ 1 ][ iBlock ];
+		const T* x2 = &corners.x[ 2 ][ iBlock ];
+		const T* x3 = &corners.x[ 3 ][ iBlock ];
+		const T* y0 = &corners.y[ 0 ][ iBlock ];
+		const T* y1 = &corners.y[ 1 ][ iBlock ];
+		const T* y2 = &corners.y[ 2 ][ iBlock ];
+		const T* y3 = &corners.y[ 3 ][ iBlock ];
+
+		// homographies of the whole block without any branches, so the loop can be vectorized.
+		// S maps the unit square to the corners (see Heckbert, "Fundamentals of Texture Mapping 
+		// and Image Warping") and is multiplied by the map from the standard square to the unit square
+		for ( std::size_t k( 0 ); k < n; k++ )
+		{
+			const T dx1 = x1[ k ] - x2[ k ];
+			const T dx2 = x3[ k ] - x2[ k ];
+			const T dx3 = x0[ k ] - x1[ k ] + x2[ k ] - x3[ k ];
+			const T dy1 = y1[ k ] - y2[ k ];
+			const T dy2 = y3[ k ] - y2[ k ];
+			const T dy3 = y0[ k ] - y1[ k ] + y2[ k ] - y3[ k ];
+
+			const T invDen = 1 / ( dx1 * dy2 - dx2 * dy1 );
+			const T g = ( dx3 * dy2 - dx2 * dy3 ) * invDen;
+			const T e = ( dx1 * dy3 - dx3 * dy1 ) * invDen;
+
+			const T s00 = x1[ k ] - x0[ k ] + g * x1[ k ];
+			const T s01 = x3[ k ] - x0[ k ] + e * x3[ k ];
+			const T s10 = y1[ k ] - y0[ k ] + g * y1[ k ];
+			const T s11 = y3[ k ] - y0[ k ] + e * y3[ k ];
+
+			h[ 0 ][ k ] = s01;
+			h[ 1 ][ k ] = -s00;
+			h[ 2 ][ k ] = ( s00 + s01 ) / 2 + x0[ k ];
+			h[ 3 ][ k ] = s11;
+			h[ 4 ][ k ] = -s10;
+			h[ 5 ][ k ] = ( s10 + s11 ) / 2 + y0[ k ];
+			h[ 6 ][ k ] = e;
+			h[ 7 ][ k ] = -g;
+			h[ 8 ][ k ] = ( g + e ) / 2 + 1;
+		}
+
+		// poses, as in poseFromHomography
+		for ( std::size_t k( 0 ); k < n; k++ )
+		{
+			Math::Matrix< T, 3, 3 >& H( homographies[ iBlock + k ] );
+			for ( std::size_t i( 0 ); i < 9; i++ )
+				H( i / 3, i % 3 ) = h[ i ][ k ];
+
+			// R = K^-1 H, with negative z-coordinate
+			const Math::Matrix< T, 3, 3 >& K( invK[ invK.size() == 1 ? 0 : iBlock + k ] );
+			T r[ 3 ][ 3 ];
+			for ( std::size_t i( 0 ); i < 3; i++ )
+				for ( std::size_t j( 0 ); j < 3; j++ )
+					r[ i ][ j ] = K( i, 0 ) * h[ j ][ k ] + K( i, 1 ) * h[ 3 + j ][ k ] + K( i, 2 ) * h[ 6 + j ][ k ];
+			const T sign = r[ 2 ][ 2 ] > 0 ? -1 : 1;
+
+			// normalize translation by the mean length of the first two columns
+			const T a = r[ 0 ][ 0 ] * r[ 0 ][ 0 ] + r[ 1 ][ 0 ] * r[ 1 ][ 0 ] + r[ 2 ][ 0 ] * r[ 2 ][ 0 ];
+			const T b = r[ 0 ][ 0 ] * r[ 0 ][ 1 ] + r[ 1 ][ 0 ] * r[ 1 ][ 1 ] + r[ 2 ][ 0 ] * r[ 2 ][ 1 ];
+			const T d = r[ 0 ][ 1 ] * r[ 0 ][ 1 ] + r[ 1 ][ 1 ] * r[ 1 ][ 1 ] + r[ 2 ][ 1 ] * r[ 2 ][ 1 ];
+			const T transScale = sign * 2 / ( std::sqrt( a ) + std::sqrt( d ) );
+			const Math::Vector< T, 3 > t( r[ 0 ][ 2 ] * transScale, r[ 1 ][ 2 ] * transScale, r[ 2 ][ 2 ] * transScale );
+
+			// closest orthonormal columns C (C^T C)^-1/2, with the closed-form inverse square root 
+			// of the 2x2 matrix C^T C = [ a b; b d ]
+			const T s = std::sqrt( a * d - b * b );
+			const T f = sign / ( s * std::sqrt( a + d + 2 * s ) );
+			const T m00 = ( d + s ) * f;
+			const T m01 = -b * f;
+			const T m11 = ( a + s ) * f;
+
+			Math::Matrix< T, 3, 3 > R;
+			for ( std::size_t i( 0 ); i < 3; i++ )
+			{
+				R( i, 0 ) = r[ i ][ 0 ] * m00 + r[ i ][ 1 ] * m01;
+				R( i, 1 ) = r[ i ][ 0 ] * m01 + r[ i ][ 1 ] * m11;
+			}
+			R( 0, 2 ) = R( 1, 0 ) * R( 2, 1 ) - R( 2, 0 ) * R( 1, 1 );
+			R( 1, 2 ) = R( 2, 0 ) * R( 0, 1 ) - R( 0, 0 ) * R( 2, 1 );
+			R( 2, 2 ) = R( 0, 0 ) * R( 1, 1 ) - R( 1, 0 ) * R( 0, 1 );
+
+			poses[ iBlock + k ] = Math::Pose( Math::Quaternion( R ), t );
+		}
+	}
+}
+
+
+/** \internal */
+template< typename T >
+void squareMarkerPosesImpl( const SquareMarkerCorners< T >& corners, const std::vector< Math::Matrix< T, 3, 3 > >& invK,
+	std::vector< Math::Matrix< T, 3, 3 > >& homographies, std::vector< Math::Pose >& poses, unsigned nThreads )
+{
+	const std::size_t n( corners.size() );
+	assert( invK.size() == 1 || invK.size() == n );
+	homographies.resize( n );
+	poses.resize( n );
+
+	// contiguous ranges of whole blocks
+	Math::parallelRanges( Math::ThreadRanges( n, nThreads, g_blockSize ), boost::bind( &squareMarkerPosesRange< T >,
+		boost::cref( corners ), boost::cref( invK ), boost::ref( homographies ), boost::ref( poses ), _2, _3 ) );
+}
+
+
+void squareMarkerPoses( const SquareMarkerCorners< float >& corners, const std::vector< Math::Matrix< float, 3, 3 > >& invK,
+	std::vector< Math::Matrix< float, 3, 3 > >& homographies, std::vector< Math::Pose >& poses, unsigned nThreads )
+{
+	squareMarkerPosesImpl( corners, invK, homographies, poses, nThreads );
+}
+
+void squareMarkerPoses( const SquareMarkerCorners< double >& corners, const std::vector< Math::Matrix< double, 3, 3 > >& invK,
+	std::vector< Math::Matrix< double, 3, 3 > >& homographies, std::vector< Math::Pose >& poses, unsigned nThreads )
+{
+	squareMarkerPosesImpl( corners, invK, homographies, poses, nThreads );
+}
+
+} } // namespace Ubitrack::Calibration
@@ -0,0 +1,119 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Batched homography and pose estimation for many square markers.
+ */
+
+#ifndef __UBITRACK_CALIBRATION_HOMOGRAPHYBATCH_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_HOMOGRAPHYBATCH_H_INCLUDED__
+
+#include <vector>
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+
+namespace Ubitrack { namespace Calibration {
+
+/**
+ * @ingroup tracking_algorithms
+ * Image corners of many square markers in structure-of-arrays layout.
+ *
+ * \c x[ i ][ k ] and \c y[ i ][ k ] are the coordinates of corner \c i of marker \c k. The corners
+ * are ordered as for \c squareHomography, i.e. they are the images of (-0.5, +0.5), (-0.5, -0.5),
+ * (+0.5, -0.5) and (+0.5, +0.5).
+ */
+template< typename T >
+struct SquareMarkerCorners
+{
+	/** x coordinates of the four corners of all markers */
+	std::vector< T > x[ 4 ];
+
+	/** y coordinates of the four corners of all markers */
+	std::vector< T > y[ 4 ];
+
+	/** sets the number of markers */
+	void resize( std::size_t n )
+	{
+		for ( std::size_t i( 0 ); i < 4; i++ )
+		{
+			x[ i ].resize( n );
+			y[ i ].resize( n );
+		}
+	}
+
+	/** @return the number of markers */
+	std::size_t size() const
+	{ return x[ 0 ].size(); }
+
+	/** sets the four corners of marker \c k */
+	void set( std::size_t k, const std::vector< Math::Vector< T, 2 > >& corners )
+	{
+		for ( std::size_t i( 0 ); i < 4; i++ )
+		{
+			x[ i ][ k ] = corners[ i ]( 0 );
+			y[ i ][ k ] = corners[ i ]( 1 );
+		}
+	}
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the homographies and poses of many square markers at once.
+ *
+ * Gives the same results as calling \c squareHomography and \c poseFromHomography for every
+ * marker, but the homographies are computed in closed form, a block of markers at a time, in a
+ * loop over the structure-of-arrays input that the compiler can vectorize. The rotation is
+ * orthogonalized in closed form instead of by a SVD, so no LAPACK is needed.
+ *
+ * The markers can be split into \c nThreads contiguous ranges that are processed in parallel.
+ * Starting the threads costs some tens of microseconds, so this pays off only for several
+ * hundred markers.
+ *
+ * Degenerate markers, i.e. with three colinear corners, give non-finite results.
+ *
+ * Note: Also exists with \c double parameters.
+ *
+ * @param corners image corners of K markers
+ * @param invK inverse camera intrinsics, either one per marker or a single one for all markers
+ * @param homographies receives K homographies that map the square to the image
+ * @param poses receives K marker poses
+ * @param nThreads number of threads to use
+ */
+UBITRACK_EXPORT void squareMarkerPoses( const SquareMarkerCorners< float >& corners,
+	const std::vector< Math::Matrix< float, 3, 3 > >& invK,
+	std::vector< Math::Matrix< float, 3, 3 > >& homographies,
+	std::vector< Math::Pose >& poses, unsigned nThreads = 1 );
+
+UBITRACK_EXPORT void squareMarkerPoses( const SquareMarkerCorners< double >& corners,
+	const std::vector< Math::Matrix< double, 3, 3 > >& invK,
+	std::vector< Math::Matrix< double, 3, 3 > >& homographies,
+	std::vector< Math::Pose >& poses, unsigned nThreads = 1 );
+
+} } // namespace Ubitrack::Calibration
+
+#endif
@@ -30,7 +30,7 @@
  *
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 
 // get a logger
 static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Calibration.2D6DPoseEstimation" ) );
@@ -38,10 +38,16 @@ static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Cali
 
 //#define OPTIMIZATION_LOGGING
 #include <utMath/LevenbergMarquardt.h>
+#include <utMath/ParallelEvaluation.h>
 #include <utCalibration/2D3DPoseEstimation.h>
 #include <utUtil/Exception.h>
 #include "MultipleCameraPoseOptimization.h"
 
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <boost/bind.hpp>
+
 
 namespace Ubitrack { namespace Calibration {
 
@@ -59,7 +65,8 @@ std::pair < Math::ErrorPose , double >
 	bool hasInitialPoseProvided,
 	Math::Pose initialPose,
 	int startIndex,
-	int endIndex)
+	int endIndex,
+	unsigned nThreads)
 {
 	if (endIndex == -1)
 		endIndex = static_cast<int>( points3d.size() ) - 1 ;
@@ -123,7 +130,7 @@ std::pair < Math::ErrorPose , double >
 		// Compute initial pose
 		if (!hasInitialPoseProvided) {
 			OPT_LOG_DEBUG(  "Compute initial pose with "<<p2dLocal.at(maxObsIndex).size() << " observations for camera " << maxObsIndex );
-			initialPose = camPoses.at( maxObsIndex ) * Calibration::computePose( p2dLocal.at( maxObsIndex) , p3dLocalFiltered.at( maxObsIndex) ,
+			initialPose = ~camPoses.at( maxObsIndex ) * Calibration::computePose( p2dLocal.at( maxObsIndex) , p3dLocalFiltered.at( maxObsIndex) ,
 				camMatrices.at( maxObsIndex ), PLANAR_HOMOGRAPHY ); // there are no scoped enums in C++98 (only in C++0x onwards)
 			OPT_LOG_DEBUG(  "Initial pose "<<initialPose );
 		}
@@ -154,12 +161,14 @@ std::pair < Math::ErrorPose , double >
 		// starting optimization
 		OPT_LOG_DEBUG( "Optimizing pose over " << numberCameras << " cameras using " << observationCountTotal << " observations" );
 
+		// observations are evaluated on nThreads threads if there are enough of them
 		ObjectiveFunction< double > f( p3dLocal, camRotations, camTranslations, camMatrices, observations );
+		Math::ParallelEvaluation< ObjectiveFunction< double > > pf( f, nThreads );
 		Math::Vector< double, 6 > param;
 		ublas::subrange( param, 0, 3 ) = initialPose.translation();
 		ublas::subrange( param, 3, 6 ) = initialPose.rotation().toLogarithm();
 
-		double res = Math::levenbergMarquardt( f, param, measurements, Math::OptTerminate( 10, 1e-6 ), Math::OptNoNormalize() );
+		double res = Math::levenbergMarquardt( pf, param, measurements, Math::OptTerminate( 10, 1e-6 ), Math::OptNoNormalize() );
 
         // Create an error pose with covariance matrix that has the residual on its diagonal entries
 		Math::ErrorPose finalPose( Math::Quaternion::fromLogarithm( ublas::subrange( param, 3, 6 ) ), ublas::subrange( param, 0, 3 ), Math::Matrix< double, 6, 6 >::identity( ) * res );
@@ -169,7 +178,7 @@ std::pair < Math::ErrorPose , double >
 		return std::make_pair(finalPose, res);
 	} else { // not enough observations
 
-		LOG4CPP_DEBUG( logger, "Not enough observations. Only "<<minObs<<" observations available for some camera ");
+		UBITRACK_LOG_DEBUG( logger, "Not enough observations. Only "<<minObs<<" observations available for some camera ");
 		return std::make_pair(Math::ErrorPose(), -1.0);
 	}
 }
@@ -223,14 +232,14 @@ void multipleCameraPoseEstimationWithLocalBundles (
 	// Offset for the current local bundle	
 	int localBundleOffset = 0;
 
-	LOG4CPP_DEBUG( logger, "Processing " << localBundleSizes.size() << " local bundles..." );
+	UBITRACK_LOG_DEBUG( logger, "Processing " << localBundleSizes.size() << " local bundles..." );
 
 	for (int localBundleIndex = 0; localBundleIndex < localBundleSizes.size(); ++localBundleIndex) {
 
 		// Get the number of marker corners for the current cube
 		int localBundleSize = localBundleSizes.at( localBundleIndex );
 
-		LOG4CPP_DEBUG( logger, "Local bundle " << localBundleIndex <<" has "<<localBundleSize<< " 2d points. Offset in global bundle list: "<<localBundleOffset);
+		UBITRACK_LOG_DEBUG( logger, "Local bundle " << localBundleIndex <<" has "<<localBundleSize<< " 2d points. Offset in global bundle list: "<<localBundleOffset);
 
 		std::pair < Math::ErrorPose , double > estimate = 
 			multipleCameraEstimatePose (points3d, points2d, points2dWeights, camPoses, camMatrices, minCorrespondences, false,
@@ -266,6 +275,279 @@ void multipleCameraPoseEstimation (
 	poseWeight = estimate.second;
 }
 
+
+/** \internal inputs and outputs of one call of LocalBundlePoseEstimator::estimate */
+struct LocalBundlePoseEstimator::Frame
+{
+	Frame( const std::vector < Math::Vector< double, 3 > >&  _points3d,
+		const std::vector < std::vector < Math::Vector< double, 2 > > >& _points2d,
+		const std::vector < std::vector < Math::Scalar< double > > >& _points2dWeights,
+		const std::vector < Math::Pose >& _camPoses,
+		const std::vector < Math::Matrix< double, 3, 3 > >& _camMatrices,
+		const int _minCorrespondences,
+		std::vector < Math::ErrorPose >& _poses,
+		std::vector < Math::Scalar < double > >& _poseWeights )
+		: points3d( _points3d )
+		, points2d( _points2d )
+		, points2dWeights( _points2dWeights )
+		, camPoses( _camPoses )
+		, camMatrices( _camMatrices )
+		, minCorrespondences( _minCorrespondences )
+		, poses( _poses )
+		, poseWeights( _poseWeights )
+	{}
+
+	const std::vector < Math::Vector< double, 3 > >&  points3d;
+	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d;
+	const std::vector < std::vector < Math::Scalar< double > > >& points2dWeights;
+	const std::vector < Math::Pose >& camPoses;
+	const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices;
+	const int minCorrespondences;
+	std::vector < Math::ErrorPose >& poses;
+	std::vector < Math::Scalar < double > >& poseWeights;
+
+	/** first point of each bundle, followed by the end of the last one */
+	std::vector< std::size_t > offsets;
+};
+
+
+/** \internal solves A x = b in place for the symmetric positive definite A, given by its lower triangle */
+static bool choleskySolve6( double A[ 6 ][ 6 ], double b[ 6 ] )
+{
+	for ( std::size_t j( 0 ); j < 6; j++ )
+	{
+		double d( A[ j ][ j ] );
+		for ( std::size_t k( 0 ); k < j; k++ )
+			d -= A[ j ][ k ] * A[ j ][ k ];
+		if ( !( d > 0 ) )
+			return false;
+		A[ j ][ j ] = std::sqrt( d );
+		for ( std::size_t i( j + 1 ); i < 6; i++ )
+		{
+			double v( A[ i ][ j ] );
+			for ( std::size_t k( 0 ); k < j; k++ )
+				v -= A[ i ][ k ] * A[ j ][ k ];
+			A[ i ][ j ] = v / A[ j ][ j ];
+		}
+	}
+
+	for ( std::size_t i( 0 ); i < 6; i++ )
+	{
+		for ( std::size_t k( 0 ); k < i; k++ )
+			b[ i ] -= A[ i ][ k ] * b[ k ];
+		b[ i ] /= A[ i ][ i ];
+	}
+	for ( std::size_t i( 6 ); i-- > 0; )
+	{
+		for ( std::size_t k( i + 1 ); k < 6; k++ )
+			b[ i ] -= A[ k ][ i ] * b[ k ];
+		b[ i ] /= A[ i ][ i ];
+	}
+	return true;
+}
+
+
+LocalBundlePoseEstimator::LocalBundlePoseEstimator( unsigned nThreads, bool bWarmStart )
+	: m_nThreads( std::max( nThreads, 1u ) )
+	, m_bWarmStart( bWarmStart )
+{}
+
+
+void LocalBundlePoseEstimator::estimate( const std::vector < Math::Vector< double, 3 > >&  points3d,
+	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
+	const std::vector < std::vector < Math::Scalar< double > > >& points2dWeights,
+	const std::vector < Math::Pose >& camPoses,
+	const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices,
+	const int minCorrespondences,
+	const std::vector < Math::Scalar < int > >& localBundleSizes,
+	std::vector < Math::ErrorPose >& poses,
+	std::vector < Math::Scalar < double > >& poseWeights )
+{
+	namespace ublas = boost::numeric::ublas;
+	checkConsistency ( points3d, points2d, points2dWeights, camPoses, camMatrices );
+
+	const std::size_t nBundles( localBundleSizes.size() );
+	Frame frame( points3d, points2d, points2dWeights, camPoses, camMatrices, minCorrespondences, poses, poseWeights );
+	frame.offsets.resize( nBundles + 1, 0 );
+	for ( std::size_t b( 0 ); b < nBundles; b++ )
+	{
+		if ( localBundleSizes[ b ] < 0 )
+			UBITRACK_THROW( "Local bundle sizes must not be negative" );
+		frame.offsets[ b + 1 ] = frame.offsets[ b ] + localBundleSizes[ b ];
+	}
+	if ( frame.offsets[ nBundles ] > points3d.size() )
+		UBITRACK_THROW( "Local bundles contain more points than given" );
+
+	m_camKR.resize( camPoses.size() );
+	m_camKT.resize( camPoses.size() );
+	for ( std::size_t c( 0 ); c < camPoses.size(); c++ )
+	{
+		m_camKR[ c ] = ublas::prod( camMatrices[ c ], Math::Matrix< double, 3, 3 >( camPoses[ c ].rotation() ) );
+		m_camKT[ c ] = ublas::prod( camMatrices[ c ], camPoses[ c ].translation() );
+	}
+
+	if ( m_workspaces.size() < nBundles )
+		m_workspaces.resize( nBundles );
+	poses.resize( nBundles );
+	poseWeights.resize( nBundles );
+
+	// contiguous ranges of bundles
+	Math::parallelRanges( Math::ThreadRanges( nBundles, m_nThreads ),
+		boost::bind( &LocalBundlePoseEstimator::estimateRange, this, boost::cref( frame ), _2, _3 ) );
+}
+
+
+void LocalBundlePoseEstimator::estimateRange( const Frame& frame, std::size_t begin, std::size_t end )
+{
+	for ( std::size_t b( begin ); b < end; b++ )
+	{
+		Math::ErrorPose pose;
+		frame.poseWeights[ b ] = estimateBundle( frame, b, pose );
+		frame.poses[ b ] = pose;
+	}
+}
+
+
+double LocalBundlePoseEstimator::estimateBundle( const Frame& frame, std::size_t bundle, Math::ErrorPose& pose )
+{
+	namespace ublas = boost::numeric::ublas;
+	Workspace& ws( m_workspaces[ bundle ] );
+	const std::size_t start( frame.offsets[ bundle ] );
+	const std::size_t end( frame.offsets[ bundle + 1 ] );
+	const std::size_t numberCameras( frame.points2dWeights.size() );
+
+	// observations, ordered by camera as in multipleCameraEstimatePose
+	ws.observations.clear();
+	ws.measurements.clear();
+	ws.p3d.assign( frame.points3d.begin() + start, frame.points3d.begin() + end );
+	ws.observationCount.assign( numberCameras, 0 );
+	for ( std::size_t cameraIndex( 0 ); cameraIndex < numberCameras; cameraIndex++ )
+		for ( std::size_t pointIndex( start ); pointIndex < end; pointIndex++ )
+			if ( frame.points2dWeights[ cameraIndex ][ pointIndex ] != 0.0 )
+			{
+				ws.observations.push_back( std::make_pair( pointIndex - start, cameraIndex ) );
+				ws.measurements.push_back( frame.points2d[ cameraIndex ][ pointIndex ] );
+				ws.observationCount[ cameraIndex ]++;
+			}
+
+	if ( numberCameras == 0 )
+	{
+		ws.bHasPrevious = false;
+		return -1.0;
+	}
+	const std::size_t minObs( *std::min_element( ws.observationCount.begin(), ws.observationCount.end() ) );
+	const std::size_t maxObsIndex( std::max_element( ws.observationCount.begin(), ws.observationCount.end() ) - ws.observationCount.begin() );
+	const bool bWarmStart( m_bWarmStart && ws.bHasPrevious );
+	if ( !( minObs >= static_cast< std::size_t >( std::max( frame.minCorrespondences, 0 ) ) && ( bWarmStart || ws.observationCount[ maxObsIndex ] >= 4 ) ) )
+	{
+		UBITRACK_LOG_DEBUG( logger, "Not enough observations for local bundle " << bundle << ". Only " << minObs << " observations available for some camera" );
+		ws.bHasPrevious = false;
+		return -1.0;
+	}
+
+	Math::Vector< double, 6 > param;
+	if ( bWarmStart )
+		param = ws.previous;
+	else
+	{
+		// initial pose from the camera with most observations, the camera poses map world to camera coordinates
+		ws.initial2d.clear();
+		ws.initial3d.clear();
+		for ( std::size_t i( 0 ); i < ws.observations.size(); i++ )
+			if ( ws.observations[ i ].second == maxObsIndex )
+			{
+				ws.initial2d.push_back( ws.measurements[ i ] );
+				ws.initial3d.push_back( ws.p3d[ ws.observations[ i ].first ] );
+			}
+		const Math::Pose initialPose( ~frame.camPoses[ maxObsIndex ] * Calibration::computePose( ws.initial2d, ws.initial3d,
+			frame.camMatrices[ maxObsIndex ], PLANAR_HOMOGRAPHY ) );
+		ublas::subrange( param, 0, 3 ) = initialPose.translation();
+		ublas::subrange( param, 3, 6 ) = initialPose.rotation().toLogarithm();
+	}
+
+	// Levenberg-Marquardt on the 6x6 normal equations, as levenbergMarquardt with OptTerminate( 10, 1e-6 )
+	const Math::OptTerminate terminate( 10, 1e-6 );
+	double JtJ[ 6 ][ 6 ], Jtr[ 6 ];
+	double newJtJ[ 6 ][ 6 ], newJtr[ 6 ];
+	double res( normalEquations( ws, param, JtJ, Jtr ) );
+	double fLambda( 1.0 );
+	for ( std::size_t iteration( 1 ); ; iteration++ )
+	{
+		double A[ 6 ][ 6 ];
+		double step[ 6 ];
+		for ( std::size_t i( 0 ); i < 6; i++ )
+		{
+			for ( std::size_t j( 0 ); j <= i; j++ )
+				A[ i ][ j ] = JtJ[ i ][ j ];
+			A[ i ][ i ] += fLambda;
+			step[ i ] = Jtr[ i ];
+		}
+
+		double newRes( std::numeric_limits< double >::infinity() );
+		Math::Vector< double, 6 > newParam;
+		if ( choleskySolve6( A, step ) )
+		{
+			for ( std::size_t i( 0 ); i < 6; i++ )
+				newParam( i ) = param( i ) + step[ i ];
+			newRes = normalEquations( ws, newParam, newJtJ, newJtr );
+		}
+
+		const bool bTerminate( terminate( iteration, newRes, res ) );
+		if ( !( newRes < res ) )
+			fLambda *= 10;
+		else
+		{
+			fLambda /= 10;
+			param = newParam;
+			std::copy( &newJtJ[ 0 ][ 0 ], &newJtJ[ 0 ][ 0 ] + 36, &JtJ[ 0 ][ 0 ] );
+			std::copy( newJtr, newJtr + 6, Jtr );
+			res = newRes;
+		}
+		if ( bTerminate )
+			break;
+	}
+
+	ws.bHasPrevious = true;
+	ws.previous = param;
+	pose = Math::ErrorPose( Math::Quaternion::fromLogarithm( ublas::subrange( param, 3, 6 ) ), ublas::subrange( param, 0, 3 ),
+		Math::Matrix< double, 6, 6 >::identity() * res );
+	return res;
+}
+
+
+double LocalBundlePoseEstimator::normalEquations( Workspace& ws, const Math::Vector< double, 6 >& param, double JtJ[ 6 ][ 6 ], double Jtr[ 6 ] ) const
+{
+	ObjectiveFunction< double >::transformPoints( param, ws.p3d, ws.points, ws.lieJacobians );
+
+	for ( std::size_t i( 0 ); i < 6; i++ )
+	{
+		Jtr[ i ] = 0;
+		for ( std::size_t j( 0 ); j <= i; j++ )
+			JtJ[ i ][ j ] = 0;
+	}
+
+	double res( 0 );
+	for ( std::size_t o( 0 ); o < ws.observations.size(); o++ )
+	{
+		const std::size_t p( ws.observations[ o ].first );
+		const std::size_t c( ws.observations[ o ].second );
+		double estimate[ 2 ];
+		double J[ 2 ][ 6 ];
+		ObjectiveFunction< double >::projectWithJacobian( m_camKR[ c ], m_camKT[ c ], ws.points[ p ], ws.lieJacobians[ p ], estimate, J );
+
+		const double r0( ws.measurements[ o ]( 0 ) - estimate[ 0 ] );
+		const double r1( ws.measurements[ o ]( 1 ) - estimate[ 1 ] );
+		res += r0 * r0 + r1 * r1;
+		for ( std::size_t i( 0 ); i < 6; i++ )
+		{
+			Jtr[ i ] += J[ 0 ][ i ] * r0 + J[ 1 ][ i ] * r1;
+			for ( std::size_t j( 0 ); j <= i; j++ )
+				JtJ[ i ][ j ] += J[ 0 ][ i ] * J[ 0 ][ j ] + J[ 1 ][ i ] * J[ 1 ][ j ];
+		}
+	}
+	return res;
+}
+
 #endif // HAVE_LAPACK
 
 } } // namespace Ubitrack::Calibration
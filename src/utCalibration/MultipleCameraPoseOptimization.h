@@ -21,6 +21,8 @@
  * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
  */
 
+#ifndef __UBITRACK_CALIBRATION_MULTIPLECAMERAPOSEOPTIMIZATION_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_MULTIPLECAMERAPOSEOPTIMIZATION_H_INCLUDED__
 
 #include <utMath/NewFunction/Function.h>
 #include <utMath/NewFunction/Addition.h>
@@ -35,6 +37,15 @@ namespace Ubitrack { namespace Calibration {
 
 /**
  * Function to minimize. Input is a 6-vector containing translation and exponential map rotation.
+ *
+ * The jacobian is computed analytically in fixed-size 2x6 blocks per observation. The transformed 
+ * points and the 3x3 jacobians of the rotation are computed once per point and shared by all 
+ * cameras observing it. The observations are independent blocks, so large problems can be 
+ * evaluated on multiple threads with Math::ParallelEvaluation.
+ *
+ * The object holds no mutable state and may be evaluated concurrently. \c evaluate and
+ * \c evaluateWithJacobian allocate their scratch space in every call, repeated evaluations
+ * should go through Math::ParallelEvaluation, which keeps one scratch space per thread.
  */ 
 template< class VType = double >
 class ObjectiveFunction
@@ -50,7 +61,16 @@ public:
 		, m_camT( cameraTranslations )
 		, m_camI( cameraIntrinsics )
 		, m_vis( visibilities )
-	{}
+		, m_camKR( cameraRotations.size() )
+		, m_camKT( cameraRotations.size() )
+	{
+		namespace ublas = boost::numeric::ublas;
+		for ( std::size_t c( 0 ); c < m_camKR.size(); c++ )
+		{
+			m_camKR[ c ] = ublas::prod( m_camI[ c ], m_camR[ c ] );
+			m_camKT[ c ] = ublas::prod( m_camI[ c ], m_camT[ c ] );
+		}
+	}
 
 	/**
 	 * return the size of the result vector
@@ -59,6 +79,17 @@ public:
 	{ return 2 * m_vis.size(); }
 
 
+	/**
+	 * @param result vector to store the result in
+	 * @param input containing the parameters (target pose as 7-vector)
+	 */
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		Scratch scratch;
+		evaluateBlocks( result, input, 0, m_vis.size(), scratch );
+	}
+
 	/**
 	 * @param result vector to store the result in
 	 * @param input containing the parameters (target pose as 7-vector)
@@ -67,30 +98,119 @@ public:
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
 	{
-		namespace NF = Math::Function;
+		Scratch scratch;
+		evaluateBlocksWithJacobian( result, input, J, 0, m_vis.size(), scratch );
+	}
+
+
+	// block-separable function for Math::ParallelEvaluation, one block per observation
+
+	/** transformed points and their rotation jacobians */
+	struct Scratch
+	{
+		std::vector< Math::Vector< VType, 3 > > points;
+		std::vector< Math::Matrix< VType, 3, 3 > > lieJacobians;
+	};
+
+	std::size_t blockCount() const
+	{ return m_vis.size(); }
+
+	std::size_t blockRow( std::size_t block ) const
+	{ return 2 * block; }
+
+	template< class VT1, class VT2 >
+	void evaluateBlocks( VT1& result, const VT2& input, std::size_t begin, std::size_t end, Scratch& scratch ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+		const Math::Vector< VType, 3 > t( input( 0 ), input( 1 ), input( 2 ) );
+		const Math::Vector< VType, 3 > r( input( 3 ), input( 4 ), input( 5 ) );
+		Math::Matrix< VType, 3, 3 > R;
+		Math::Quaternion::fromLogarithm( r ).toMatrix( R );
+		scratch.points.resize( m_p3D.size() );
+		for ( std::size_t p( 0 ); p < m_p3D.size(); p++ )
+			ublas::noalias( scratch.points[ p ] ) = ublas::prod( R, m_p3D[ p ] ) + t;
+
+		for ( std::size_t i( begin ); i < end; ++i )
+		{
+			const Math::Vector< VType, 3 >& X( scratch.points[ m_vis[ i ].first ] );
+			const Math::Matrix< VType, 3, 3 >& KR( m_camKR[ m_vis[ i ].second ] );
+			const Math::Vector< VType, 3 >& Kt( m_camKT[ m_vis[ i ].second ] );
+			VType y[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; k++ )
+				y[ k ] = KR( k, 0 ) * X( 0 ) + KR( k, 1 ) * X( 1 ) + KR( k, 2 ) * X( 2 ) + Kt( k );
+			const VType iz( 1 / y[ 2 ] );
+			result( 2 * i ) = y[ 0 ] * iz;
+			result( 2 * i + 1 ) = y[ 1 ] * iz;
+		}
+	}
+
+	template< class VT1, class VT2, class MT > 
+	void evaluateBlocksWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t begin, std::size_t end, Scratch& scratch ) const
+	{
+		transformPoints( input, m_p3D, scratch.points, scratch.lieJacobians );
+
+		for ( std::size_t i( begin ); i < end; ++i )
+		{
+			VType block[ 2 ];
+			VType blockJ[ 2 ][ 6 ];
+			const std::size_t p( m_vis[ i ].first );
+			const std::size_t c( m_vis[ i ].second );
+			projectWithJacobian( m_camKR[ c ], m_camKT[ c ], scratch.points[ p ], scratch.lieJacobians[ p ], block, blockJ );
+			for ( std::size_t r( 0 ); r < 2; r++ )
+			{
+				result( 2 * i + r ) = block[ r ];
+				for ( std::size_t k( 0 ); k < 6; k++ )
+					J( 2 * i + r, k ) = blockJ[ r ][ k ];
+			}
+		}
+	}
+
+	/**
+	 * transforms the points by the pose ( t, exp( r ) ) given as 6-vector and computes the 
+	 * jacobians of the rotated points wrt. r.
+	 */
+	template< class VT >
+	static void transformPoints( const VT& input, const std::vector< Math::Vector< VType, 3 > >& p3D, 
+		std::vector< Math::Vector< VType, 3 > >& points, std::vector< Math::Matrix< VType, 3, 3 > >& lieJacobians )
+	{
 		namespace ublas = boost::numeric::ublas;
-		const std::size_t n_vis( m_vis.size() );
-		for ( std::size_t i( 0 ); i < n_vis; ++i )
+		const Math::Vector< VType, 3 > t( input( 0 ), input( 1 ), input( 2 ) );
+		const Math::Vector< VType, 3 > r( input( 3 ), input( 4 ), input( 5 ) );
+		Math::Matrix< VType, 3, 3 > R;
+		Math::Quaternion::fromLogarithm( r ).toMatrix( R );
+		const Math::Matrix< VType, 3, 3 > identity( Math::Matrix< VType, 3, 3 >::identity() );
+
+		points.resize( p3D.size() );
+		lieJacobians.resize( p3D.size() );
+		for ( std::size_t p( 0 ); p < p3D.size(); p++ )
+		{
+			ublas::noalias( points[ p ] ) = ublas::prod( R, p3D[ p ] ) + t;
+			Math::Function::LieRotation().multiplyJacobian1( identity, lieJacobians[ p ], r, p3D[ p ] );
+		}
+	}
+
+	/**
+	 * projects the transformed point X with the camera K [ R | t ], given as KR and Kt, and 
+	 * computes the 2x6 jacobian wrt. the translation and rotation of the target, where JL is 
+	 * the jacobian of X wrt. the rotation.
+	 */
+	static void projectWithJacobian( const Math::Matrix< VType, 3, 3 >& KR, const Math::Vector< VType, 3 >& Kt,
+		const Math::Vector< VType, 3 >& X, const Math::Matrix< VType, 3, 3 >& JL, VType result[ 2 ], VType J[ 2 ][ 6 ] )
+	{
+		VType y[ 3 ];
+		for ( std::size_t k( 0 ); k < 3; k++ )
+			y[ k ] = KR( k, 0 ) * X( 0 ) + KR( k, 1 ) * X( 1 ) + KR( k, 2 ) * X( 2 ) + Kt( k );
+		const VType iz( 1 / y[ 2 ] );
+		result[ 0 ] = y[ 0 ] * iz;
+		result[ 1 ] = y[ 1 ] * iz;
+
+		// jacobian of the dehomogenization times KR, then chain rule for the rotation
+		for ( std::size_t r( 0 ); r < 2; r++ )
 		{
-				ublas::vector_range< VT1 > subResult( result, ublas::range( i * 2, ( i + 1 ) * 2 ) );
-				ublas::matrix_range< MT > subJ( J, ublas::range( i * 2, ( i + 1 ) * 2 ), ublas::range( 0, 6 ) );
-		
-				( NF::Dehomogenization< 3 >() <<
-				( NF::LinearTransformation< 3, 3 >( m_camI[ m_vis[ i ].second ] ) <<
-					( NF::Addition< 3 >() <<
-						( NF::fixedParameterRef< 3 >( m_camT[ m_vis[ i ].second ] ) ) <<
-						( NF::LinearTransformation< 3, 3 >( m_camR[ m_vis[ i ].second ] ) <<
-							( NF::Addition< 3 >() <<
-								( NF::parameter< 3 >( 0 ) ) <<
-								( NF::LieRotation() <<
-									( NF::parameter< 3 >( 3  ) ) <<
-									( NF::fixedParameterRef< 3 >( m_p3D[ m_vis[ i ].first ] ) )
-								)
-							)
-						)
-					)
-				)
-			).evaluateWithJacobian( input, subResult, subJ );
+			for ( std::size_t l( 0 ); l < 3; l++ )
+				J[ r ][ l ] = ( KR( r, l ) - result[ r ] * KR( 2, l ) ) * iz;
+			for ( std::size_t l( 0 ); l < 3; l++ )
+				J[ r ][ 3 + l ] = J[ r ][ 0 ] * JL( 0, l ) + J[ r ][ 1 ] * JL( 1, l ) + J[ r ][ 2 ] * JL( 2, l );
 		}
 	}
 	
@@ -100,6 +220,10 @@ protected:
 	const std::vector< Math::Vector< double, 3 > >& m_camT;
 	const std::vector< Math::Matrix< VType, 3, 3 > >& m_camI;
 	const std::vector< std::pair< std::size_t, std::size_t > > m_vis;
+
+	/** K R and K t of the cameras */
+	std::vector< Math::Matrix< VType, 3, 3 > > m_camKR;
+	std::vector< Math::Vector< VType, 3 > > m_camKT;
 };
 
 
@@ -111,6 +235,11 @@ void checkConsistency (
 	const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices
 	);
 
+/**
+ * Estimates the pose of the points [ \c startIndex, \c endIndex ] from their observations by all
+ * cameras. The observations are evaluated on \c nThreads threads, including the calling thread,
+ * or on all cores for 0. Small problems use fewer threads.
+ */
 std::pair < Math::ErrorPose , double > 
 	multipleCameraEstimatePose (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
@@ -122,7 +251,8 @@ std::pair < Math::ErrorPose , double >
 	bool hasInitialPoseProvided,
 	Math::Pose initialPose = Math::Pose(),
 	int startIndex = 0,
-	int endIndex = -1);
+	int endIndex = -1,
+	unsigned nThreads = 1);
 
 UBITRACK_EXPORT void multipleCameraPoseEstimationWithLocalBundles (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
@@ -149,6 +279,96 @@ UBITRACK_EXPORT void multipleCameraPoseEstimation (
 	Math::Pose initialPose = Math::Pose()
 	);
 
+/**
+ * @ingroup tracking_algorithms
+ * Batched version of multipleCameraPoseEstimationWithLocalBundles for tracking many local bundles 
+ * (e.g. marker cubes) in every frame.
+ *
+ * All local bundles are optimized concurrently, distributed over \c nThreads threads. Each bundle 
+ * has a workspace that keeps its observations and buffers across frames, so after the first 
+ * frames no memory is allocated except for the initial pose estimation. The Levenberg-Marquardt 
+ * iteration is the same as in multipleCameraPoseEstimation (at most 10 iterations, same damping 
+ * schedule), but accumulates the 6x6 normal equations directly from the analytic 2x6 jacobian 
+ * blocks of ObjectiveFunction instead of building the dense jacobian.
+ */
+class UBITRACK_EXPORT LocalBundlePoseEstimator
+{
+public:
+	/**
+	 * constructor
+	 * @param nThreads number of threads, including the calling thread
+	 * @param bWarmStart start from the pose of the previous frame instead of a homography-based 
+	 *   initial pose for bundles that were successfully estimated in the previous call
+	 */
+	LocalBundlePoseEstimator( unsigned nThreads = 1, bool bWarmStart = false );
+
+	/**
+	 * estimates the poses of all local bundles, with the same inputs as 
+	 * multipleCameraPoseEstimationWithLocalBundles. \c poses and \c poseWeights are resized to 
+	 * the number of bundles and receive the pose and residual of each bundle, or a residual of 
+	 * -1 if the bundle has not enough observations.
+	 */
+	void estimate( const std::vector < Math::Vector< double, 3 > >&  points3d,
+		const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
+		const std::vector < std::vector < Math::Scalar< double > > >& points2dWeights,
+		const std::vector < Math::Pose >& camPoses,
+		const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices,
+		const int minCorrespondences,
+		const std::vector < Math::Scalar < int > >& localBundleSizes,
+		std::vector < Math::ErrorPose >& poses,
+		std::vector < Math::Scalar < double > >& poseWeights );
+
+protected:
+	/** inputs and outputs of one call of estimate */
+	struct Frame;
+
+	/** per-bundle buffers, reused across frames */
+	struct Workspace
+	{
+		/** observations as ( local point index, camera index ) and the measured image points */
+		std::vector< std::pair< std::size_t, std::size_t > > observations;
+		std::vector< Math::Vector< double, 2 > > measurements;
+
+		/** points of the bundle and their transformations of the last evaluation */
+		std::vector< Math::Vector< double, 3 > > p3d;
+		std::vector< Math::Vector< double, 3 > > points;
+		std::vector< Math::Matrix< double, 3, 3 > > lieJacobians;
+
+		/** observations of the camera used for the initial pose */
+		std::vector< Math::Vector< double, 2 > > initial2d;
+		std::vector< Math::Vector< double, 3 > > initial3d;
+
+		std::vector< std::size_t > observationCount;
+
+		/** parameters of the previous frame for warm starts */
+		bool bHasPrevious;
+		Math::Vector< double, 6 > previous;
+
+		Workspace()
+			: bHasPrevious( false )
+		{}
+	};
+
+	/** estimates the bundles [ begin, end ) */
+	void estimateRange( const Frame& frame, std::size_t begin, std::size_t end );
+
+	/** estimates one bundle, returns the residual or -1 */
+	double estimateBundle( const Frame& frame, std::size_t bundle, Math::ErrorPose& pose );
+
+	/** residual and normal equations of a bundle for the given parameters */
+	double normalEquations( Workspace& ws, const Math::Vector< double, 6 >& param, double JtJ[ 6 ][ 6 ], double Jtr[ 6 ] ) const;
+
+	unsigned m_nThreads;
+	bool m_bWarmStart;
+	std::vector< Workspace > m_workspaces;
+
+	/** K R and K t of the cameras */
+	std::vector< Math::Matrix< double, 3, 3 > > m_camKR;
+	std::vector< Math::Vector< double, 3 > > m_camKT;
+};
+
 #endif // HAVE_LAPACK
 
 } } // namespace Ubitrack::Components
+
+#endif
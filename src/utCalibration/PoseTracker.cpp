@@ -0,0 +1,355 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implements frame-to-frame 2D-3D pose tracking.
+ */
+
+#include "PoseTracker.h"
+
+#ifdef HAVE_LAPACK
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utUtil/Exception.h>
+
+//#define OPTIMIZATION_LOGGING
+#include <utMath/Optimization.h>
+
+namespace Ubitrack { namespace Calibration {
+
+namespace {
+
+/** cholesky factorization of a symmetric positive definite 6x6 matrix, L is stored in the lower triangle */
+bool choleskyFactor6( double A[ 6 ][ 6 ] )
+{
+	for ( std::size_t j = 0; j < 6; j++ )
+	{
+		double d = A[ j ][ j ];
+		for ( std::size_t k = 0; k < j; k++ )
+			d -= A[ j ][ k ] * A[ j ][ k ];
+		if ( d <= 0 )
+			return false;
+		A[ j ][ j ] = std::sqrt( d );
+		for ( std::size_t i = j + 1; i < 6; i++ )
+		{
+			double s = A[ i ][ j ];
+			for ( std::size_t k = 0; k < j; k++ )
+				s -= A[ i ][ k ] * A[ j ][ k ];
+			A[ i ][ j ] = s / A[ j ][ j ];
+		}
+	}
+	return true;
+}
+
+/** solves L L^T x = b in place */
+void choleskySolve6( const double L[ 6 ][ 6 ], double b[ 6 ] )
+{
+	for ( std::size_t i = 0; i < 6; i++ )
+	{
+		for ( std::size_t k = 0; k < i; k++ )
+			b[ i ] -= L[ i ][ k ] * b[ k ];
+		b[ i ] /= L[ i ][ i ];
+	}
+	for ( std::size_t i = 6; i-- > 0; )
+	{
+		for ( std::size_t k = i + 1; k < 6; k++ )
+			b[ i ] -= L[ k ][ i ] * b[ k ];
+		b[ i ] /= L[ i ][ i ];
+	}
+}
+
+/** solves A x = b in place for a symmetric positive definite 6x6 matrix */
+bool solveCholesky6( double A[ 6 ][ 6 ], double b[ 6 ] )
+{
+	if ( !choleskyFactor6( A ) )
+		return false;
+	choleskySolve6( A, b );
+	return true;
+}
+
+/**
+ * covariance s * ( J^T J )^-1 of the tracker parameters ( translation, small left rotation ), 
+ * converted to the ( e_t, e_r ) parameterization of \c ErrorPose, where e_r = R^T * rotation / 2.
+ * @return false if the normal equations are singular
+ */
+bool poseCovariance( const double JtJ[ 6 ][ 6 ], const Math::Pose& pose, double s, Math::Matrix< double, 6, 6 >& result )
+{
+	double L[ 6 ][ 6 ];
+	std::copy( &JtJ[ 0 ][ 0 ], &JtJ[ 0 ][ 0 ] + 36, &L[ 0 ][ 0 ] );
+	if ( !choleskyFactor6( L ) )
+		return false;
+
+	// columns of the inverse
+	double C[ 6 ][ 6 ];
+	for ( std::size_t j = 0; j < 6; j++ )
+	{
+		for ( std::size_t i = 0; i < 6; i++ )
+			C[ j ][ i ] = i == j ? s : 0;
+		choleskySolve6( L, C[ j ] );
+	}
+
+	// T = diag( I, R^T / 2 ), result = T * C * T^T
+	Math::Matrix< double, 3, 3 > R;
+	pose.rotation().toMatrix( R );
+	double T[ 6 ][ 6 ];
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 6; j++ )
+			T[ i ][ j ] = i < 3 ? ( i == j ? 1.0 : 0.0 ) : ( j < 3 ? 0.0 : 0.5 * R( j - 3, i - 3 ) );
+
+	double TC[ 6 ][ 6 ];
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 6; j++ )
+		{
+			TC[ i ][ j ] = 0;
+			for ( std::size_t k = 0; k < 6; k++ )
+				TC[ i ][ j ] += T[ i ][ k ] * C[ k ][ j ];
+		}
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 6; j++ )
+		{
+			double v = 0;
+			for ( std::size_t k = 0; k < 6; k++ )
+				v += TC[ i ][ k ] * T[ j ][ k ];
+			result( i, j ) = v;
+		}
+	return true;
+}
+
+} // anonymous namespace
+
+
+PoseTracker::PoseTracker( const Math::Matrix< double, 3, 3 >& cam, InitializationMethod initMethod,
+	unsigned nMaxIterations, double fJumpFactor, double fMinJumpResidual )
+	: m_cam( cam )
+	, m_initMethod( initMethod )
+	, m_nMaxIterations( nMaxIterations )
+	, m_fJumpFactor( fJumpFactor )
+	, m_fMinJumpResidual( fMinJumpResidual )
+	, m_bTracking( false )
+	, m_fResidual( 0 )
+	, m_nIterations( 0 )
+	, m_bReinitialized( false )
+{}
+
+
+void PoseTracker::reset()
+{
+	m_bTracking = false;
+	m_motion = Math::Pose();
+}
+
+
+void PoseTracker::setCameraMatrix( const Math::Matrix< double, 3, 3 >& cam )
+{
+	m_cam = cam;
+}
+
+
+Math::ErrorPose PoseTracker::track( const std::vector< Math::Vector< double, 2 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D, double& residual )
+{
+	const std::size_t n = p2D.size();
+	if ( n < 4 || p3D.size() != n ) {
+		UBITRACK_THROW( "2D3D pose tracking requires at least 4 2D-3D correspondences" );
+	}
+
+	m_nIterations = 0;
+	m_bReinitialized = false;
+
+	if ( m_bTracking )
+	{
+		// warm start from the constant-velocity prediction
+		Math::Pose pose( m_motion * m_pose );
+		double JtJ[ 6 ][ 6 ];
+		const double fError = refine( p2D, p3D, pose, JtJ );
+		const double fRms = std::sqrt( fError / ( 2 * n ) );
+		OPT_LOG_DEBUG( "Tracked pose after " << m_nIterations << " iterations: " << pose << ", residual " << fRms );
+
+		if ( fRms <= std::max( m_fJumpFactor * m_fResidual, m_fMinJumpResidual ) )
+		{
+			m_motion = pose * ~m_pose;
+			m_pose = pose;
+			m_fResidual = fRms;
+			residual = fRms;
+
+			// same scale as computePose, but from the normal equations of the last step
+			Math::Matrix< double, 6, 6 > covariance;
+			if ( !poseCovariance( JtJ, pose, fError, covariance ) )
+				covariance = singleCameraPoseError( pose, p3D, m_cam, fError );
+			return Math::ErrorPose( pose, covariance );
+		}
+
+		OPT_LOG_DEBUG( "Residual jumped from " << m_fResidual << " to " << fRms << ", re-initializing" );
+	}
+
+	// full initialization
+	m_bTracking = false;
+	m_bReinitialized = true;
+	Math::ErrorPose result( computePose( p2D, p3D, m_cam, residual, true, m_initMethod ) );
+
+	m_bTracking = true;
+	m_pose = result;
+	m_motion = Math::Pose();
+	m_fResidual = residual;
+	return result;
+}
+
+
+double PoseTracker::refine( const std::vector< Math::Vector< double, 2 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D, Math::Pose& pose, double JtJ[ 6 ][ 6 ] )
+{
+	double Jtr[ 6 ];
+	double fError = normalEquations( p2D, p3D, pose, JtJ, Jtr );
+	if ( fError == std::numeric_limits< double >::infinity() )
+		return fError;
+
+	double fLambda = 0;
+	while ( m_nIterations < m_nMaxIterations )
+	{
+		m_nIterations++;
+
+		// solve the (damped) normal equations
+		double A[ 6 ][ 6 ];
+		double delta[ 6 ];
+		for ( std::size_t i = 0; i < 6; i++ )
+		{
+			for ( std::size_t j = 0; j < 6; j++ )
+				A[ i ][ j ] = JtJ[ i ][ j ];
+			A[ i ][ i ] *= 1 + fLambda;
+			delta[ i ] = Jtr[ i ];
+		}
+		if ( !solveCholesky6( A, delta ) )
+		{
+			fLambda = fLambda == 0 ? 1e-3 : fLambda * 10;
+			continue;
+		}
+
+		// update translation additively, rotation by a small left rotation
+		Math::Quaternion dq( 0.5 * delta[ 3 ], 0.5 * delta[ 4 ], 0.5 * delta[ 5 ], 1.0 );
+		dq.normalize();
+		Math::Quaternion q( dq * pose.rotation() );
+		q.normalize();
+		const Math::Pose candidate( q, pose.translation() + Math::Vector< double, 3 >( delta[ 0 ], delta[ 1 ], delta[ 2 ] ) );
+
+		double newJtJ[ 6 ][ 6 ];
+		double newJtr[ 6 ];
+		const double fNewError = normalEquations( p2D, p3D, candidate, newJtJ, newJtr );
+		OPT_LOG_TRACE( "Tracking iteration " << m_nIterations << ": error " << fNewError << ", lambda " << fLambda );
+
+		if ( fNewError < fError )
+		{
+			const bool bConverged = fError - fNewError <= 1e-10 * fError;
+			pose = candidate;
+			fError = fNewError;
+			std::copy( &newJtJ[ 0 ][ 0 ], &newJtJ[ 0 ][ 0 ] + 36, &JtJ[ 0 ][ 0 ] );
+			std::copy( newJtr, newJtr + 6, Jtr );
+			fLambda = fLambda < 1e-6 ? 0 : fLambda / 10;
+			if ( bConverged )
+				break;
+		}
+		else
+			fLambda = fLambda == 0 ? 1e-3 : fLambda * 10;
+	}
+
+	return fError;
+}
+
+
+double PoseTracker::normalEquations( const std::vector< Math::Vector< double, 2 > >& p2D,
+	const std::vector< Math::Vector< double, 3 > >& p3D, const Math::Pose& pose,
+	double JtJ[ 6 ][ 6 ], double Jtr[ 6 ] ) const
+{
+	Math::Matrix< double, 3, 3 > R;
+	pose.rotation().toMatrix( R );
+	const Math::Vector< double, 3 >& t( pose.translation() );
+
+	for ( std::size_t i = 0; i < 6; i++ )
+	{
+		Jtr[ i ] = 0;
+		for ( std::size_t j = 0; j < 6; j++ )
+			JtJ[ i ][ j ] = 0;
+	}
+
+	double fError = 0;
+	for ( std::size_t n = 0; n < p3D.size(); n++ )
+	{
+		// rotated point and point in camera coordinates
+		double a[ 3 ];
+		double x[ 3 ];
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			a[ k ] = R( k, 0 ) * p3D[ n ]( 0 ) + R( k, 1 ) * p3D[ n ]( 1 ) + R( k, 2 ) * p3D[ n ]( 2 );
+			x[ k ] = a[ k ] + t( k );
+		}
+
+		double h[ 3 ];
+		for ( std::size_t k = 0; k < 3; k++ )
+			h[ k ] = m_cam( k, 0 ) * x[ 0 ] + m_cam( k, 1 ) * x[ 1 ] + m_cam( k, 2 ) * x[ 2 ];
+		if ( h[ 2 ] <= 0 )
+			return std::numeric_limits< double >::infinity();
+
+		const double r[ 2 ] = { p2D[ n ]( 0 ) - h[ 0 ] / h[ 2 ], p2D[ n ]( 1 ) - h[ 1 ] / h[ 2 ] };
+		fError += r[ 0 ] * r[ 0 ] + r[ 1 ] * r[ 1 ];
+
+		// derivative of the projection wrt. the point in camera coordinates
+		double D[ 2 ][ 3 ];
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			D[ 0 ][ k ] = ( m_cam( 0, k ) - h[ 0 ] / h[ 2 ] * m_cam( 2, k ) ) / h[ 2 ];
+			D[ 1 ][ k ] = ( m_cam( 1, k ) - h[ 1 ] / h[ 2 ] * m_cam( 2, k ) ) / h[ 2 ];
+		}
+
+		// jacobian wrt. ( translation, small left rotation ): D * [ I | -[a]x ]
+		double J[ 2 ][ 6 ];
+		for ( std::size_t m = 0; m < 2; m++ )
+		{
+			J[ m ][ 0 ] = D[ m ][ 0 ];
+			J[ m ][ 1 ] = D[ m ][ 1 ];
+			J[ m ][ 2 ] = D[ m ][ 2 ];
+			J[ m ][ 3 ] = D[ m ][ 2 ] * a[ 1 ] - D[ m ][ 1 ] * a[ 2 ];
+			J[ m ][ 4 ] = D[ m ][ 0 ] * a[ 2 ] - D[ m ][ 2 ] * a[ 0 ];
+			J[ m ][ 5 ] = D[ m ][ 1 ] * a[ 0 ] - D[ m ][ 0 ] * a[ 1 ];
+		}
+
+		for ( std::size_t i = 0; i < 6; i++ )
+		{
+			Jtr[ i ] += J[ 0 ][ i ] * r[ 0 ] + J[ 1 ][ i ] * r[ 1 ];
+			for ( std::size_t j = i; j < 6; j++ )
+				JtJ[ i ][ j ] += J[ 0 ][ i ] * J[ 0 ][ j ] + J[ 1 ][ i ] * J[ 1 ][ j ];
+		}
+	}
+
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < i; j++ )
+			JtJ[ i ][ j ] = JtJ[ j ][ i ];
+
+	return fError;
+}
+
+} } // namespace Ubitrack::Calibration
+
+#endif // HAVE_LAPACK
@@ -0,0 +1,148 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Frame-to-frame 2D-3D pose tracking.
+ */
+
+#ifndef __UBITRACK_CALIBRATION_POSETRACKER_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_POSETRACKER_H_INCLUDED__
+
+#include <vector>
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+#include <utMath/ErrorPose.h>
+#include "2D3DPoseEstimation.h"
+
+#ifdef HAVE_LAPACK
+
+namespace Ubitrack { namespace Calibration {
+
+/**
+ * @ingroup tracking_algorithms
+ * Stateful 2D-3D pose estimation for camera tracking.
+ *
+ * Instead of solving every frame from scratch like \c computePose, the tracker keeps the pose
+ * of the previous frame and the motion between the last two frames. Each new frame is
+ * predicted with a constant-velocity model and refined by a few damped Gauss-Newton steps.
+ * The 6x6 normal equations are accumulated directly from analytic Jacobians, so a frame
+ * needs neither a 2N x 7 Jacobian nor LAPACK. The covariance is the inverse of the normal
+ * equations of the last step. At high frame rates the prediction is usually so close that
+ * one or two steps suffice.
+ *
+ * If the tracker has no previous pose or the RMS reprojection error jumps above
+ * \c max( fJumpFactor * previous residual, fMinJumpResidual ), the frame is solved again with
+ * \c computePose and the motion model is reset.
+ */
+class UBITRACK_EXPORT PoseTracker
+{
+public:
+	/**
+	 * constructor.
+	 * @param cam camera intrinsics matrix
+	 * @param initMethod initialization used by \c computePose when the tracker (re-)initializes
+	 * @param nMaxIterations maximum number of Gauss-Newton steps per frame
+	 * @param fJumpFactor relative increase of the residual that triggers re-initialization
+	 * @param fMinJumpResidual residual in image coordinates below which no re-initialization happens
+	 */
+	PoseTracker( const Math::Matrix< double, 3, 3 >& cam, 
+		InitializationMethod initMethod = PLANAR_HOMOGRAPHY,
+		unsigned nMaxIterations = 3, double fJumpFactor = 3.0, double fMinJumpResidual = 1.0 );
+
+	/**
+	 * Computes the pose of the next frame.
+	 * @param p2D points in image coordinates
+	 * @param p3D points in object coordinates, at least four
+	 * @param residual reprojection error in image coordinates
+	 * @return the pose and its covariance, as in \c computePose
+	 */
+	Math::ErrorPose track( const std::vector< Math::Vector< double, 2 > >& p2D,
+		const std::vector< Math::Vector< double, 3 > >& p3D, double& residual );
+
+	/** forgets the previous pose, the next frame is fully initialized */
+	void reset();
+
+	/** changes the camera intrinsics matrix */
+	void setCameraMatrix( const Math::Matrix< double, 3, 3 >& cam );
+
+	/** true if a previous pose is available */
+	bool isTracking() const
+	{ return m_bTracking; }
+
+	/** pose of the last frame */
+	const Math::Pose& pose() const
+	{ return m_pose; }
+
+	/** number of Gauss-Newton steps tried in the last frame */
+	unsigned iterations() const
+	{ return m_nIterations; }
+
+	/** true if the last frame was solved by full initialization */
+	bool reinitialized() const
+	{ return m_bReinitialized; }
+
+protected:
+	/** 
+	 * damped Gauss-Newton refinement starting from \c pose 
+	 * @param JtJ receives the normal equations at the returned pose
+	 * @return sum of squared reprojection errors
+	 */
+	double refine( const std::vector< Math::Vector< double, 2 > >& p2D,
+		const std::vector< Math::Vector< double, 3 > >& p3D, Math::Pose& pose, double JtJ[ 6 ][ 6 ] );
+
+	/** 
+	 * computes the normal equations of the reprojection error around \c pose 
+	 * @return sum of squared reprojection errors, infinite if a point is behind the camera
+	 */
+	double normalEquations( const std::vector< Math::Vector< double, 2 > >& p2D,
+		const std::vector< Math::Vector< double, 3 > >& p3D, const Math::Pose& pose,
+		double JtJ[ 6 ][ 6 ], double Jtr[ 6 ] ) const;
+
+	Math::Matrix< double, 3, 3 > m_cam;
+	InitializationMethod m_initMethod;
+	unsigned m_nMaxIterations;
+	double m_fJumpFactor;
+	double m_fMinJumpResidual;
+
+	bool m_bTracking;
+	Math::Pose m_pose;
+	
+	/** motion between the last two frames */
+	Math::Pose m_motion;
+	
+	/** RMS reprojection error of the last frame */
+	double m_fResidual;
+	
+	unsigned m_nIterations;
+	bool m_bReinitialized;
+};
+
+} } // namespace Ubitrack::Calibration
+
+#endif // HAVE_LAPACK
+
+#endif
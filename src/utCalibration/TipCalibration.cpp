@@ -33,6 +33,147 @@
 
 #include <utMath/Matrix.h>
 
+#include <cmath>
+#include <algorithm>
+
+namespace Ubitrack { namespace Calibration {
+
+OnlineTipCalibration::OnlineTipCalibration( double fOutlierFactor, double fMinOutlierDistance, std::size_t nMinPoses )
+	: m_fOutlierFactor( fOutlierFactor )
+	, m_fMinOutlierDistance( fMinOutlierDistance )
+	, m_nMinPoses( nMinPoses )
+{
+	reset();
+}
+
+void OnlineTipCalibration::reset()
+{
+	m_nPoses = 0;
+	m_nRejected = 0;
+	m_sumR = Math::Matrix< double, 3, 3 >::zeros();
+	m_sumRtt = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_sumT = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_sumTt = 0;
+	m_bValid = false;
+	m_pm = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_pw = Math::Vector< double, 3 >( 0, 0, 0 );
+	m_fRms = 0;
+}
+
+bool OnlineTipCalibration::addPose( const Math::Pose& pose )
+{
+	if ( m_bValid && m_fOutlierFactor > 0 && m_nPoses >= m_nMinPoses &&
+		computeResidual( pose ) > std::max( m_fMinOutlierDistance, m_fOutlierFactor * m_fRms ) )
+	{
+		m_nRejected++;
+		return false;
+	}
+
+	accumulate( pose, 1 );
+	m_nPoses++;
+	solve();
+	return true;
+}
+
+void OnlineTipCalibration::removePose( const Math::Pose& pose )
+{
+	if ( m_nPoses <= 1 )
+	{
+		const std::size_t nRejected( m_nRejected );
+		reset();
+		m_nRejected = nRejected;
+		return;
+	}
+
+	accumulate( pose, -1 );
+	m_nPoses--;
+	solve();
+}
+
+double OnlineTipCalibration::computeResidual( const Math::Pose& pose ) const
+{
+	const Math::Vector< double, 3 > r( pose * m_pm - m_pw );
+	return std::sqrt( r( 0 ) * r( 0 ) + r( 1 ) * r( 1 ) + r( 2 ) * r( 2 ) );
+}
+
+void OnlineTipCalibration::accumulate( const Math::Pose& pose, double w )
+{
+	Math::Matrix< double, 3, 3 > R;
+	pose.rotation().toMatrix( R );
+	const Math::Vector< double, 3 >& t( pose.translation() );
+
+	for ( std::size_t i( 0 ); i < 3; i++ )
+	{
+		for ( std::size_t j( 0 ); j < 3; j++ )
+		{
+			m_sumR( i, j ) += w * R( i, j );
+			m_sumRtt( i ) += w * R( j, i ) * t( j );
+		}
+		m_sumT( i ) += w * t( i );
+		m_sumTt += w * t( i ) * t( i );
+	}
+}
+
+void OnlineTipCalibration::solve()
+{
+	// normal equations [ n I, -S^T; -S, n I ] ( pm pw ) = ( -sum R^T t, sum t ) with S = sum R,
+	// eliminating pw = ( sum t + S pm ) / n leaves M pm = b with M = n I - S^T S / n
+	const double n( static_cast< double >( m_nPoses ) );
+	m_bValid = false;
+	if ( m_nPoses < 3 )
+		return;
+
+	double M[ 3 ][ 3 ];
+	double b[ 3 ];
+	for ( std::size_t i( 0 ); i < 3; i++ )
+	{
+		b[ i ] = -m_sumRtt( i );
+		for ( std::size_t j( 0 ); j < 3; j++ )
+		{
+			double sts( 0 );
+			for ( std::size_t k( 0 ); k < 3; k++ )
+				sts += m_sumR( k, i ) * m_sumR( k, j );
+			M[ i ][ j ] = ( i == j ? n : 0.0 ) - sts / n;
+			b[ i ] += m_sumR( j, i ) * m_sumT( j ) / n;
+		}
+	}
+
+	// Cramer's rule, rejecting (nearly) singular systems from too little rotation
+	const double c00 = M[ 1 ][ 1 ] * M[ 2 ][ 2 ] - M[ 1 ][ 2 ] * M[ 2 ][ 1 ];
+	const double c01 = M[ 0 ][ 2 ] * M[ 2 ][ 1 ] - M[ 0 ][ 1 ] * M[ 2 ][ 2 ];
+	const double c02 = M[ 0 ][ 1 ] * M[ 1 ][ 2 ] - M[ 0 ][ 2 ] * M[ 1 ][ 1 ];
+	const double c11 = M[ 0 ][ 0 ] * M[ 2 ][ 2 ] - M[ 0 ][ 2 ] * M[ 2 ][ 0 ];
+	const double c12 = M[ 0 ][ 2 ] * M[ 1 ][ 0 ] - M[ 0 ][ 0 ] * M[ 1 ][ 2 ];
+	const double c22 = M[ 0 ][ 0 ] * M[ 1 ][ 1 ] - M[ 0 ][ 1 ] * M[ 1 ][ 0 ];
+	const double det = M[ 0 ][ 0 ] * c00 + M[ 0 ][ 1 ] * c01 + M[ 0 ][ 2 ] * c02;
+	if ( !( det > 1e-12 * n * n * n ) )
+		return;
+
+	m_pm( 0 ) = ( c00 * b[ 0 ] + c01 * b[ 1 ] + c02 * b[ 2 ] ) / det;
+	m_pm( 1 ) = ( c01 * b[ 0 ] + c11 * b[ 1 ] + c12 * b[ 2 ] ) / det;
+	m_pm( 2 ) = ( c02 * b[ 0 ] + c12 * b[ 1 ] + c22 * b[ 2 ] ) / det;
+	for ( std::size_t i( 0 ); i < 3; i++ )
+	{
+		m_pw( i ) = m_sumT( i );
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			m_pw( i ) += m_sumR( i, j ) * m_pm( j );
+		m_pw( i ) /= n;
+	}
+
+	// sum | R pm - pw + t |^2 = n |pm|^2 + n |pw|^2 + sum |t|^2 - 2 pw^T S pm + 2 pm^T sum R^T t - 2 pw^T sum t
+	double rss( m_sumTt );
+	for ( std::size_t i( 0 ); i < 3; i++ )
+	{
+		rss += n * ( m_pm( i ) * m_pm( i ) + m_pw( i ) * m_pw( i ) ) + 2 * m_pm( i ) * m_sumRtt( i ) - 2 * m_pw( i ) * m_sumT( i );
+		for ( std::size_t j( 0 ); j < 3; j++ )
+			rss -= 2 * m_pw( i ) * m_sumR( i, j ) * m_pm( j );
+	}
+	m_fRms = std::sqrt( std::max( 0.0, rss ) / n );
+	m_bValid = true;
+}
+
+} } // namespace Ubitrack::Calibration
+
 #ifdef HAVE_LAPACK
 #include <boost/numeric/bindings/traits/ublas_matrix.hpp>
 #include <boost/numeric/bindings/traits/ublas_vector2.hpp>
@@ -34,14 +34,107 @@
 
 
 
-#ifdef HAVE_LAPACK
-
 #include <utCore.h>
 #include <utMath/Pose.h>
+#include <utMath/Matrix.h>
 #include <vector>
 
 namespace Ubitrack { namespace Calibration {
 
+/**
+ * @ingroup tracking_algorithms
+ * Online tip/hotspot calibration by recursive least squares.
+ *
+ * Each pose (R_i, t_i) adds the equations (R_i -I) (p_m p_w) = -t_i to the 6x6 information 
+ * matrix, which is kept in its block form \f$ \sum_i [ I, -R_i^T; -R_i, I ] \f$ together with 
+ * the right hand side and the squared norm of the translations. The current estimate is 
+ * updated after every pose by eliminating p_w and solving the remaining 3x3 system, so tip, 
+ * pivot and RMS residual are available at tracker rate without keeping the poses.
+ *
+ * Once the estimate is reliable, poses whose residual \f$ | R_i p_m + t_i - p_w | \f$ exceeds 
+ * \c fOutlierFactor times the current RMS residual (but at least \c fMinOutlierDistance) 
+ * are rejected instead of being added. Poses can also be removed again, e.g. for a sliding 
+ * window.
+ */
+class UBITRACK_EXPORT OnlineTipCalibration
+{
+public:
+	/**
+	 * constructor
+	 * @param fOutlierFactor poses with a residual above this multiple of the RMS are rejected, 0 disables the rejection
+	 * @param fMinOutlierDistance residuals below this distance are never rejected
+	 * @param nMinPoses number of poses before outliers are rejected
+	 */
+	OnlineTipCalibration( double fOutlierFactor = 3.0, double fMinOutlierDistance = 0.0, std::size_t nMinPoses = 10 );
+
+	/** removes all poses */
+	void reset();
+
+	/**
+	 * adds a pose of the tracked body
+	 * @return false if the pose was rejected as an outlier
+	 */
+	bool addPose( const Math::Pose& pose );
+
+	/** removes a pose that was previously accepted */
+	void removePose( const Math::Pose& pose );
+
+	/** number of accepted poses */
+	std::size_t size() const
+	{ return m_nPoses; }
+
+	/** number of rejected poses */
+	std::size_t getNumberOfRejected() const
+	{ return m_nRejected; }
+
+	/** true if the poses contain enough rotation to determine tip and pivot */
+	bool isValid() const
+	{ return m_bValid; }
+
+	/** constant point in body coordinates (the tip), valid if isValid() */
+	const Math::Vector< double, 3 >& getTip() const
+	{ return m_pm; }
+
+	/** constant point in world coordinates (the pivot), valid if isValid() */
+	const Math::Vector< double, 3 >& getPivot() const
+	{ return m_pw; }
+
+	/** RMS of the residual distances of the accepted poses, valid if isValid() */
+	double getRms() const
+	{ return m_fRms; }
+
+	/** residual distance of a pose for the current estimate */
+	double computeResidual( const Math::Pose& pose ) const;
+
+protected:
+	/** updates the pose sums with weight +1 or -1 */
+	void accumulate( const Math::Pose& pose, double w );
+
+	/** solves the normal equations for the current estimate */
+	void solve();
+
+	double m_fOutlierFactor;
+	double m_fMinOutlierDistance;
+	std::size_t m_nMinPoses;
+
+	std::size_t m_nPoses;
+	std::size_t m_nRejected;
+
+	/** sums of R_i, R_i^T t_i, t_i and t_i^T t_i */
+	Math::Matrix< double, 3, 3 > m_sumR;
+	Math::Vector< double, 3 > m_sumRtt;
+	Math::Vector< double, 3 > m_sumT;
+	double m_sumTt;
+
+	/** current estimate */
+	bool m_bValid;
+	Math::Vector< double, 3 > m_pm;
+	Math::Vector< double, 3 > m_pw;
+	double m_fRms;
+};
+
+#ifdef HAVE_LAPACK
+
 /**
  * @ingroup tracking_algorithms
  * Computes the tip/hotspot calibration.
@@ -71,8 +164,8 @@ namespace Ubitrack { namespace Calibration {
 UBITRACK_EXPORT void tipCalibration( const std::vector< Math::Pose >& poses, 
 	Math::Vector< double, 3 >& pm, Math::Vector< double, 3 >& pw );
 
-} } // namespace Ubitrack::Calibration
-
 #endif // HAVE_LAPACK
 
+} } // namespace Ubitrack::Calibration
+
 #endif
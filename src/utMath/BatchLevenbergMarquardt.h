@@ -0,0 +1,331 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Levenberg-Marquardt optimizer for many small independent problems of the same size
+ */
+
+#ifndef __UBITRACK_MATH_BATCHLEVENBERGMARQUARDT_INCLUDED__
+#define __UBITRACK_MATH_BATCHLEVENBERGMARQUARDT_INCLUDED__
+
+#include <utMath/Optimization.h>
+#include <utMath/Vector.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+#include <limits>
+#include <cmath>
+
+#include <boost/scoped_ptr.hpp>
+
+namespace Ubitrack { namespace Math {
+
+namespace Detail {
+
+/**
+ * \internal
+ * State of a group of problems that are optimized in lockstep. All arrays have the lane (problem)
+ * as innermost index, so the loops over the lanes of the linear algebra can be vectorized.
+ */
+template< class T, std::size_t N, std::size_t M >
+struct BatchLmLanes
+{
+	/** number of problems optimized in lockstep */
+	static const std::size_t W = 8;
+
+	/** parameters, residual ( measurement - prediction ) and jacobian of the current estimate */
+	T params[ N ][ W ];
+	T residual[ M ][ W ];
+	T jacobian[ M ][ N ][ W ];
+	T error[ W ];
+
+	/** the same for the trial step */
+	T newParams[ N ][ W ];
+	T newResidual[ M ][ W ];
+	T newJacobian[ M ][ N ][ W ];
+	T newError[ W ];
+
+	/** normal equations J^T J + lambda I (lower triangle, cholesky factor after solving), J^T r and the step */
+	T normal[ N ][ N ][ W ];
+	T gradient[ N ][ W ];
+	T step[ N ][ W ];
+	T lambda[ W ];
+	bool factorized[ W ];
+
+	bool active[ W ];
+	std::vector< LmDamping< T > > damping;
+
+	/** evaluates the problem of a lane into the current or trial state */
+	template< class P >
+	void evaluate( const P& problem, std::size_t k, std::size_t w, const T ( &measurement )[ M ], bool bTrial )
+	{
+		T input[ N ];
+		T result[ M ];
+		T J[ M ][ N ];
+		for ( std::size_t i( 0 ); i < N; i++ )
+			input[ i ] = bTrial ? newParams[ i ][ w ] : params[ i ][ w ];
+		problem.evaluateWithJacobian( k, input, result, J );
+
+		T ( &r )[ M ][ W ]( bTrial ? newResidual : residual );
+		T ( &jac )[ M ][ N ][ W ]( bTrial ? newJacobian : jacobian );
+		T e( 0 );
+		for ( std::size_t m( 0 ); m < M; m++ )
+		{
+			r[ m ][ w ] = measurement[ m ] - result[ m ];
+			e += r[ m ][ w ] * r[ m ][ w ];
+			for ( std::size_t i( 0 ); i < N; i++ )
+				jac[ m ][ i ][ w ] = J[ m ][ i ];
+		}
+		( bTrial ? newError : error )[ w ] = e;
+	}
+
+	/** computes the damped step of all lanes by solving the normal equations with cholesky */
+	void solve()
+	{
+		// J^T J + lambda I and J^T r
+		for ( std::size_t i( 0 ); i < N; i++ )
+		{
+			for ( std::size_t j( 0 ); j <= i; j++ )
+			{
+				T* a( normal[ i ][ j ] );
+				for ( std::size_t w( 0 ); w < W; w++ )
+					a[ w ] = 0;
+				for ( std::size_t m( 0 ); m < M; m++ )
+					for ( std::size_t w( 0 ); w < W; w++ )
+						a[ w ] += jacobian[ m ][ i ][ w ] * jacobian[ m ][ j ][ w ];
+			}
+			for ( std::size_t w( 0 ); w < W; w++ )
+				normal[ i ][ i ][ w ] += lambda[ w ];
+
+			for ( std::size_t w( 0 ); w < W; w++ )
+				gradient[ i ][ w ] = 0;
+			for ( std::size_t m( 0 ); m < M; m++ )
+				for ( std::size_t w( 0 ); w < W; w++ )
+					gradient[ i ][ w ] += jacobian[ m ][ i ][ w ] * residual[ m ][ w ];
+		}
+
+		// cholesky decomposition, lanes that are not positive definite get a dummy factor
+		for ( std::size_t w( 0 ); w < W; w++ )
+			factorized[ w ] = true;
+		for ( std::size_t j( 0 ); j < N; j++ )
+		{
+			for ( std::size_t k( 0 ); k < j; k++ )
+				for ( std::size_t w( 0 ); w < W; w++ )
+					normal[ j ][ j ][ w ] -= normal[ j ][ k ][ w ] * normal[ j ][ k ][ w ];
+			for ( std::size_t w( 0 ); w < W; w++ )
+			{
+				const bool bPositive( normal[ j ][ j ][ w ] > 0 );
+				factorized[ w ] = factorized[ w ] && bPositive;
+				normal[ j ][ j ][ w ] = bPositive ? std::sqrt( normal[ j ][ j ][ w ] ) : T( 1 );
+			}
+			for ( std::size_t i( j + 1 ); i < N; i++ )
+			{
+				for ( std::size_t k( 0 ); k < j; k++ )
+					for ( std::size_t w( 0 ); w < W; w++ )
+						normal[ i ][ j ][ w ] -= normal[ i ][ k ][ w ] * normal[ j ][ k ][ w ];
+				for ( std::size_t w( 0 ); w < W; w++ )
+					normal[ i ][ j ][ w ] /= normal[ j ][ j ][ w ];
+			}
+		}
+
+		// forward and back substitution
+		for ( std::size_t i( 0 ); i < N; i++ )
+		{
+			for ( std::size_t w( 0 ); w < W; w++ )
+				step[ i ][ w ] = gradient[ i ][ w ];
+			for ( std::size_t k( 0 ); k < i; k++ )
+				for ( std::size_t w( 0 ); w < W; w++ )
+					step[ i ][ w ] -= normal[ i ][ k ][ w ] * step[ k ][ w ];
+			for ( std::size_t w( 0 ); w < W; w++ )
+				step[ i ][ w ] /= normal[ i ][ i ][ w ];
+		}
+		for ( std::size_t i( N ); i-- > 0; )
+		{
+			for ( std::size_t k( i + 1 ); k < N; k++ )
+				for ( std::size_t w( 0 ); w < W; w++ )
+					step[ i ][ w ] -= normal[ k ][ i ][ w ] * step[ k ][ w ];
+			for ( std::size_t w( 0 ); w < W; w++ )
+				step[ i ][ w ] /= normal[ i ][ i ][ w ];
+		}
+
+		for ( std::size_t i( 0 ); i < N; i++ )
+			for ( std::size_t w( 0 ); w < W; w++ )
+				newParams[ i ][ w ] = params[ i ][ w ] + step[ i ][ w ];
+	}
+
+	/** predicted error reduction of the step of a lane */
+	T predictedReduction( std::size_t w ) const
+	{
+		T d( 0 );
+		for ( std::size_t i( 0 ); i < N; i++ )
+			d += step[ i ][ w ] * ( lambda[ w ] * step[ i ][ w ] + gradient[ i ][ w ] );
+		return d;
+	}
+
+	/** makes the trial step of a lane the current estimate */
+	void accept( std::size_t w )
+	{
+		for ( std::size_t i( 0 ); i < N; i++ )
+			params[ i ][ w ] = newParams[ i ][ w ];
+		for ( std::size_t m( 0 ); m < M; m++ )
+		{
+			residual[ m ][ w ] = newResidual[ m ][ w ];
+			for ( std::size_t i( 0 ); i < N; i++ )
+				jacobian[ m ][ i ][ w ] = newJacobian[ m ][ i ][ w ];
+		}
+		error[ w ] = newError[ w ];
+	}
+};
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math
+ * Optimizes many small independent problems of the same size with the levenberg marquardt
+ * optimizer, e.g. one pose per marker or one 3D point per blob in every frame.
+ *
+ * The problems are optimized in groups of eight in lockstep. The normal equations, their
+ * cholesky decomposition and the updates are computed for all problems of a group at once
+ * in fixed-size arrays, which the compiler can vectorize, and without any memory allocation
+ * per problem. Every problem has its own damping parameter and terminates on its own, the
+ * others of the group continue.
+ *
+ * The iteration is the same as in levenbergMarquardt with lmUseCholesky, except that a step
+ * whose normal equations are not positive definite is rejected instead of solved by SVD.
+ *
+ * @par The problem class
+ * The problem class P evaluates the problem with index k for a given parameter vector:
+ * \code
+ * void evaluateWithJacobian( std::size_t k, const T ( &input )[ N ], T ( &result )[ M ], T ( &J )[ M ][ N ] ) const;
+ * \endcode
+ *
+ * @param problem the problems to optimize -- provides measurement estimates and jacobians
+ * @param params initial parameters of all problems on entry, optimized parameters on exit
+ * @param measurements the measurement vectors of all problems
+ * @param terminationCriteria functor that returns true if the optimization of a problem should terminate.
+ *   Is called for every problem with bool operator()( unsigned iteration, double currentError, double previousError )
+ * @param residuals returns the residuals of the optimized problems
+ * @param damping update of the damping parameter
+ */
+template< class P, class T, std::size_t N, std::size_t M, class TC >
+void batchLevenbergMarquardt( const P& problem, std::vector< Math::Vector< T, N > >& params,
+	const std::vector< Math::Vector< T, M > >& measurements, const TC& terminationCriteria,
+	std::vector< T >& residuals, LmDampingUpdate damping = lmDampingFactor10 )
+{
+	typedef Detail::BatchLmLanes< T, N, M > Lanes;
+	const std::size_t W( Lanes::W );
+
+	if ( params.size() != measurements.size() )
+		UBITRACK_THROW( "Number of parameter and measurement vectors differ" );
+	const std::size_t nProblems( params.size() );
+	residuals.resize( nProblems );
+
+	boost::scoped_ptr< Lanes > pLanes( new Lanes );
+	Lanes& lanes( *pLanes );
+	lanes.damping.assign( W, Detail::LmDamping< T >( damping ) );
+	T measurement[ W ][ M ];
+
+	for ( std::size_t begin( 0 ); begin < nProblems; begin += W )
+	{
+		// initial estimates, unused lanes solve a zero problem and are never evaluated
+		const std::size_t nLanes( std::min( W, nProblems - begin ) );
+		for ( std::size_t w( 0 ); w < W; w++ )
+		{
+			lanes.active[ w ] = w < nLanes;
+			lanes.damping[ w ] = Detail::LmDamping< T >( damping );
+			lanes.lambda[ w ] = lanes.damping[ w ].lambda();
+			if ( w < nLanes )
+			{
+				for ( std::size_t i( 0 ); i < N; i++ )
+					lanes.params[ i ][ w ] = params[ begin + w ]( i );
+				for ( std::size_t m( 0 ); m < M; m++ )
+					measurement[ w ][ m ] = measurements[ begin + w ]( m );
+				lanes.evaluate( problem, begin + w, w, measurement[ w ], false );
+			}
+			else
+			{
+				for ( std::size_t i( 0 ); i < N; i++ )
+					lanes.params[ i ][ w ] = 0;
+				for ( std::size_t m( 0 ); m < M; m++ )
+				{
+					lanes.residual[ m ][ w ] = 0;
+					for ( std::size_t i( 0 ); i < N; i++ )
+						lanes.jacobian[ m ][ i ][ w ] = 0;
+				}
+				lanes.error[ w ] = 0;
+			}
+		}
+
+		OPT_LOG_DEBUG( "Batch Levenberg-Marquardt problems " << begin << " to " << begin + nLanes );
+
+		std::size_t nActive( nLanes );
+		for ( unsigned iteration( 1 ); nActive > 0; iteration++ )
+		{
+			lanes.solve();
+
+			for ( std::size_t w( 0 ); w < nLanes; w++ )
+			{
+				if ( !lanes.active[ w ] )
+					continue;
+
+				if ( lanes.factorized[ w ] )
+					lanes.evaluate( problem, begin + w, w, measurement[ w ], true );
+				else
+					lanes.newError[ w ] = std::numeric_limits< T >::infinity();
+
+				// check if we should terminate
+				const bool bTerminate( terminationCriteria( iteration, lanes.newError[ w ], lanes.error[ w ] ) );
+
+				// update parameters
+				if ( !lanes.factorized[ w ] || lanes.newError[ w ] >= lanes.error[ w ] )
+					lanes.damping[ w ].reject();
+				else
+				{
+					lanes.damping[ w ].accept( ( lanes.error[ w ] - lanes.newError[ w ] ) / lanes.predictedReduction( w ) );
+					lanes.accept( w );
+				}
+				lanes.lambda[ w ] = lanes.damping[ w ].lambda();
+
+				if ( bTerminate )
+				{
+					lanes.active[ w ] = false;
+					nActive--;
+				}
+			}
+		}
+
+		for ( std::size_t w( 0 ); w < nLanes; w++ )
+		{
+			for ( std::size_t i( 0 ); i < N; i++ )
+				params[ begin + w ]( i ) = lanes.params[ i ][ w ];
+			residuals[ begin + w ] = lanes.error[ w ];
+		}
+	}
+}
+
+} } // namespace Ubitrack::Math
+
+#endif
@@ -34,6 +34,8 @@
 
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 
+#include "Matrix.h"
+#include "Vector.h"
 #include "Optimization.h"
 
 namespace Ubitrack { namespace Math {
@@ -49,17 +51,18 @@ namespace Ubitrack { namespace Math {
  * @param measurement goal of the function
  * @param terminationCriteria when to terminate
  * @param normalize normalization function
+ * @param observer notified about every iteration, see OptNoObserver
  */
-template< class P, class VT1, class VT2, class TC, class NT > 
+template< class P, class VT1, class VT2, class TC, class NT, class OT > 
 typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const VT2& measurement, 
-	const TC& terminationCriteria, const NT& normalize = OptNoNormalize() )
+	const TC& terminationCriteria, const NT& normalize, const OT& observer )
 {
 	namespace ublas = boost::numeric::ublas;
 	typedef typename VT1::value_type T;
 
 	// initialize the starting points of the simplex
 	unsigned ndim = params.size();
-	Math::Matrix< VType, 0, 0 > p( ndim + 1, ndim );
+	Math::Matrix< T, 0, 0 > p( ndim + 1, ndim );
 	ublas::row( p, 0 ) = params;
 	for ( unsigned i = 1; i <= ndim; i++ )
 	{
@@ -80,12 +83,15 @@ typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const V
 
 	// number of iterations
 	unsigned nfunk = 0;
+	unsigned iteration = 0;
+	T yBest = 0;
 
 	// the sum of all simplex points
 	Math::Vector< T > psum( ublas::row( p, 0 ) );
 	for ( unsigned i = 1; i <= ndim; i++ )
 		noalias( psum ) += ublas::row( p, i );
 
+	observer.begin( "downhillSimplex" );
 	while ( true )
 	{
 		// find lowest, highest and next-highest points
@@ -108,10 +114,18 @@ typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const V
 				inhi = i;
 		}
 
+		// the first pass only ranks the initial simplex
+		if ( iteration > 0 )
+			observer.iteration( OptIteration( iteration, y( ilo ), yBest, 0, 
+				ublas::norm_2( ublas::row( p, ihi ) - ublas::row( p, ilo ) ), y( ilo ) < yBest ) );
+		iteration++;
+		yBest = y( ilo );
+
 		// check for termination
 		if ( terminationCriteria( nfunk, y( ilo ), y( ihi ) ) )
 		{
 			noalias( params ) = ublas::row( p, ilo );
+			observer.end( y( ilo ) );
 			return y( ilo );
 		}
 
@@ -154,6 +168,14 @@ typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const V
 	}
 }
 
+/**
+ * Downhill simplex minimizer, see above.
+ */
+template< class P, class VT1, class VT2, class TC, class NT > 
+typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const VT2& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize() )
+{ return downhillSimplex( problem, params, measurement, terminationCriteria, normalize, OptNoObserver() ); }
+
 
 /**
  * function internally used by the simplex optimizer
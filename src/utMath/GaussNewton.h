@@ -63,26 +63,30 @@ namespace Ubitrack { namespace Math {
  * @param measurement the measurement vector
  * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
  * @param nIterations number of iterations
- * @return the residual of the optimization process
+ * @param observer notified about every iteration, see OptNoObserver. As the residual is only
+ *   computed before each step, the residual of the last iteration is reported as final residual.
  */
-template< class P, class VT1, class VT2, class NT >
-void gaussNewton( P& problem, VT1& params, const VT2& measurement, unsigned nIterations, const NT& normalize = OptNoNormalize() )
+template< class P, class VT1, class VT2, class NT, class OT >
+void gaussNewton( P& problem, VT1& params, const VT2& measurement, unsigned nIterations, const NT& normalize, const OT& observer )
 {
 	namespace lapack = boost::numeric::bindings::lapack;
 	namespace blas = boost::numeric::bindings::blas;
 	namespace ublas = boost::numeric::ublas;
 	typedef typename VT1::value_type T;
-	typedef typename Math::Matrix< T, 0, 0 > MatType;
+	typedef typename Math::Matrix< T, 0, 0 >::base_type MatType;
+	typedef typename Math::Vector< T >::base_type VecType;
 
 	// create some matrices and vectors
 	MatType matJacobian( measurement.size(), params.size() );
 	MatType matJacobiSquare( params.size(), params.size() );
-	Math::Vector< T > measurementDiff( measurement.size() );
-	Math::Vector< T > paramDiff( params.size() );
-	Math::Vector< T > estimatedMeasurement( measurement.size() );
+	VecType measurementDiff( measurement.size() );
+	VecType paramDiff( params.size() );
+	VecType estimatedMeasurement( measurement.size() );
 
 	OPT_LOG_DEBUG( "Gauss-Newton entry params: " << params );
 
+	observer.begin( "gaussNewton" );
+	T fResPrev = 0;
 	for ( unsigned i = 0; i < nIterations; i++ )
 	{
 		// compute initial error
@@ -111,9 +115,21 @@ void gaussNewton( P& problem, VT1& params, const VT2& measurement, unsigned nIte
 
 		// normalize
 		normalize.evaluate( params, params );
+
+		observer.iteration( OptIteration( i + 1, fRes, i ? fResPrev : fRes, 0, ublas::norm_2( paramDiff ), true ) );
+		fResPrev = fRes;
 	}
+	observer.end( fResPrev );
 }
 
+/**
+ * @ingroup math
+ * Run a number of Gauss-Newton optimizer iterations, see above.
+ */
+template< class P, class VT1, class VT2, class NT >
+void gaussNewton( P& problem, VT1& params, const VT2& measurement, unsigned nIterations, const NT& normalize = OptNoNormalize() )
+{ gaussNewton( problem, params, measurement, nIterations, normalize, OptNoObserver() ); }
+
 } } // namespace Ubitrack::Math
 
 #endif // HAVE_LAPACK
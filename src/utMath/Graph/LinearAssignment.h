@@ -0,0 +1,483 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * LinearAssignment class
+ * This file contains a shortest augmenting path solver for the linear assignment problem,
+ * in the style of Jonker and Volgenant (LAPJV).
+ *
+ * Compared to the Munkres class, it accepts sparse cost matrices, forbidden pairs and
+ * rectangular problems directly, and it can be warm-started from the result of the
+ * previous problem, e.g. when associating targets from frame to frame.
+ */
+
+#ifndef __UBITRACK_MATH_GRAPH_LINEARASSIGNMENT_H_INCLUDED__
+#define __UBITRACK_MATH_GRAPH_LINEARASSIGNMENT_H_INCLUDED__
+
+#include <utCore.h>
+#include <utMath/Matrix.h>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+namespace Ubitrack { namespace Math { namespace Graph {
+
+/**
+ * @ingroup math
+ * Solves the linear assignment problem with shortest augmenting paths.
+ *
+ * The rows are assigned one after the other along a shortest augmenting path in the graph 
+ * of reduced costs, found with Dijkstra's algorithm. Row and column prices (dual variables) 
+ * keep the reduced costs non-negative and prove optimality. Only finite costs are edges of 
+ * the graph, so infinite costs forbid a pair. Each row can also stay unassigned, which costs 
+ * more than any assignment of rows to columns, so the result is an assignment of maximum 
+ * cardinality, and the cheapest among those. Rectangular problems need no padding.
+ *
+ * The search of a row stops at the first unassigned column, so for sparse problems it 
+ * usually only touches a small neighbourhood. The worst case is O(n^3) for dense problems.
+ *
+ * For warm starts, the column prices and all previous pairs that are still optimal with respect 
+ * to them are kept, and only the remaining rows are augmented. This requires that row and 
+ * column indices refer to the same objects as in the previous call.
+ *
+ * @param T type of the costs
+ */
+template< typename T >
+class LinearAssignment
+{
+public:
+	/** Default constructor */
+	LinearAssignment();
+
+	/** the cost of a forbidden pair */
+	static T forbidden()
+	{ return std::numeric_limits< T >::infinity(); }
+
+	/**
+	 * solves a dense assignment problem
+	 * @param costs rows x columns cost matrix, forbidden pairs have infinite cost
+	 * @param bWarmStart start from the result of the previous call
+	 * @return the total cost of the assignment
+	 */
+	T solve( const Math::Matrix< T, 0, 0 >& costs, bool bWarmStart = false );
+
+	/**
+	 * solves a sparse assignment problem given in compressed sparse row (CSR) form
+	 * @param nRows number of rows
+	 * @param nCols number of columns
+	 * @param rowStart nRows + 1 offsets of the rows into \c colIndex and \c costs 
+	 * @param colIndex column of each entry
+	 * @param costs cost of each entry, entries that are not given or infinite are forbidden
+	 * @param bWarmStart start from the result of the previous call
+	 * @return the total cost of the assignment
+	 */
+	T solve( std::size_t nRows, std::size_t nCols, const std::vector< std::size_t >& rowStart, 
+		const std::vector< std::size_t >& colIndex, const std::vector< T >& costs, bool bWarmStart = false );
+
+	/**
+	 * returns the column assigned to each row
+	 * @return match list of rows to columns, unassigned rows get the number of columns
+	 */
+	const std::vector< std::size_t >& getRowMatchList() const
+	{ return m_rowMatch; }
+
+	/**
+	 * returns the row assigned to each column
+	 * @return match list of columns to rows, unassigned columns get the number of rows
+	 */
+	const std::vector< std::size_t >& getColMatchList() const
+	{ return m_colMatch; }
+
+	/** @return the number of assigned pairs */
+	std::size_t size() const
+	{ return m_nAssigned; }
+
+private:
+	/** 
+	 * a cost or price, ordered first by the number of unassigned rows and then by the value, 
+	 * which avoids an arbitrary large constant for leaving a row unassigned
+	 */
+	struct Cost
+	{
+		Cost( T u = T( 0 ), T v = T( 0 ) )
+			: unassigned( u )
+			, value( v )
+		{}
+
+		Cost operator+( const Cost& c ) const
+		{ return Cost( unassigned + c.unassigned, value + c.value ); }
+
+		Cost operator-( const Cost& c ) const
+		{ return Cost( unassigned - c.unassigned, value - c.value ); }
+
+		bool operator<( const Cost& c ) const
+		{ return unassigned < c.unassigned || ( unassigned == c.unassigned && value < c.value ); }
+
+		bool operator==( const Cost& c ) const
+		{ return unassigned == c.unassigned && value == c.value; }
+
+		T unassigned;
+		T value;
+	};
+
+	typedef std::pair< Cost, std::size_t > HeapEntry;
+
+	/** heap order, smallest distance first */
+	static bool heapLess( const HeapEntry& a, const HeapEntry& b )
+	{ return b.first < a.first; }
+
+	/** solves the problem stored in m_rowStart, m_colIndex and m_costs */
+	T solveInternal( bool bWarmStart );
+
+	/** initializes the prices and keeps the previous pairs that are still optimal */
+	void initialize( bool bWarmStart );
+
+	/** assigns the unassigned row along a shortest augmenting path, possibly leaving another row unassigned */
+	void augment( std::size_t row );
+
+	/** entry index of ( row, col ) or m_costs.size() */
+	std::size_t findEntry( std::size_t row, std::size_t col ) const;
+
+	static const std::size_t npos = static_cast< std::size_t >( -1 );
+
+	/** marks a row that stays unassigned */
+	static const std::size_t unassigned = static_cast< std::size_t >( -2 );
+
+	/** column states during a shortest path search */
+	enum { UNTOUCHED = 0, REACHED, SCANNED };
+
+	// problem
+	std::size_t m_nRows;
+	std::size_t m_nCols;
+	std::vector< std::size_t > m_rowStart;
+	std::vector< std::size_t > m_colIndex;
+	std::vector< T > m_costs;
+
+	// prices, reduced costs are c_ij - u_i - v_j, leaving a row unassigned has reduced cost ( 1, 0 ) - u_i
+	std::vector< Cost > m_u;
+	std::vector< Cost > m_v;
+
+	// assignment
+	std::vector< std::size_t > m_col4row;
+	std::vector< std::size_t > m_row4col;
+
+	// shortest path search
+	std::vector< Cost > m_dist;
+	std::vector< std::size_t > m_path;
+	std::vector< unsigned char > m_state;
+	std::vector< HeapEntry > m_heap;
+	std::vector< std::size_t > m_touchedCols;
+	std::vector< std::size_t > m_scannedRows;
+	std::vector< std::size_t > m_scannedCols;
+
+	// result
+	std::vector< std::size_t > m_rowMatch;
+	std::vector< std::size_t > m_colMatch;
+	std::size_t m_nAssigned;
+};
+
+
+template< typename T >
+const std::size_t LinearAssignment< T >::npos;
+
+template< typename T >
+const std::size_t LinearAssignment< T >::unassigned;
+
+
+template< typename T >
+LinearAssignment< T >::LinearAssignment()
+	: m_nRows( 0 )
+	, m_nCols( 0 )
+	, m_nAssigned( 0 )
+{
+}
+
+
+template< typename T >
+T LinearAssignment< T >::solve( const Math::Matrix< T, 0, 0 >& costs, bool bWarmStart )
+{
+	m_nRows = costs.size1();
+	m_nCols = costs.size2();
+	m_rowStart.assign( 1, 0 );
+	m_colIndex.clear();
+	m_costs.clear();
+	for ( std::size_t i( 0 ); i < m_nRows; i++ )
+	{
+		for ( std::size_t j( 0 ); j < m_nCols; j++ )
+			if ( costs( i, j ) < forbidden() )
+			{
+				m_colIndex.push_back( j );
+				m_costs.push_back( costs( i, j ) );
+			}
+		m_rowStart.push_back( m_colIndex.size() );
+	}
+
+	return solveInternal( bWarmStart );
+}
+
+
+template< typename T >
+T LinearAssignment< T >::solve( std::size_t nRows, std::size_t nCols, const std::vector< std::size_t >& rowStart, 
+	const std::vector< std::size_t >& colIndex, const std::vector< T >& costs, bool bWarmStart )
+{
+	m_nRows = nRows;
+	m_nCols = nCols;
+	m_rowStart.assign( 1, 0 );
+	m_colIndex.clear();
+	m_costs.clear();
+	for ( std::size_t i( 0 ); i < nRows; i++ )
+	{
+		for ( std::size_t k( rowStart[ i ] ); k < rowStart[ i + 1 ]; k++ )
+			if ( costs[ k ] < forbidden() )
+			{
+				m_colIndex.push_back( colIndex[ k ] );
+				m_costs.push_back( costs[ k ] );
+			}
+		m_rowStart.push_back( m_colIndex.size() );
+	}
+
+	return solveInternal( bWarmStart );
+}
+
+
+template< typename T >
+T LinearAssignment< T >::solveInternal( bool bWarmStart )
+{
+	initialize( bWarmStart );
+
+	m_dist.resize( m_nCols );
+	m_path.resize( m_nCols );
+	m_state.assign( m_nCols, UNTOUCHED );
+	for ( std::size_t i( 0 ); i < m_nRows; i++ )
+		if ( m_col4row[ i ] == npos )
+			augment( i );
+
+	m_rowMatch.assign( m_nRows, m_nCols );
+	m_colMatch.assign( m_nCols, m_nRows );
+	m_nAssigned = 0;
+	T totalCost( 0 );
+	for ( std::size_t i( 0 ); i < m_nRows; i++ )
+	{
+		const std::size_t j( m_col4row[ i ] );
+		if ( j == unassigned )
+			continue;
+
+		totalCost += m_costs[ findEntry( i, j ) ];
+		m_nAssigned++;
+		m_rowMatch[ i ] = j;
+		m_colMatch[ j ] = i;
+	}
+
+	return totalCost;
+}
+
+
+template< typename T >
+void LinearAssignment< T >::initialize( bool bWarmStart )
+{
+	// keep the previous pairs, columns of all others get a zero price
+	if ( !bWarmStart )
+		m_col4row.clear();
+	m_col4row.resize( m_nRows, npos );
+	m_v.resize( m_nCols );
+	m_u.resize( m_nRows );
+	m_row4col.assign( m_nCols, npos );
+	for ( std::size_t i( 0 ); i < m_nRows; i++ )
+	{
+		const std::size_t j( m_col4row[ i ] );
+		if ( j < m_nCols && m_row4col[ j ] == npos && findEntry( i, j ) < m_costs.size() )
+			m_row4col[ j ] = i;
+		else
+			m_col4row[ i ] = npos;
+		m_u[ i ] = Cost();
+	}
+	for ( std::size_t j( 0 ); j < m_nCols; j++ )
+		if ( m_row4col[ j ] == npos )
+			m_v[ j ] = Cost();
+
+	// row prices of the kept pairs must make all their reduced costs non-negative and the pair tight,
+	// drop pairs and reset their column prices until this holds
+	bool bChanged( true );
+	while ( bChanged )
+	{
+		bChanged = false;
+		for ( std::size_t i( 0 ); i < m_nRows; i++ )
+		{
+			const std::size_t j( m_col4row[ i ] );
+			if ( j == npos )
+				continue;
+
+			m_u[ i ] = Cost( 1, 0 );
+			for ( std::size_t k( m_rowStart[ i ] ); k < m_rowStart[ i + 1 ]; k++ )
+			{
+				const Cost reduced( Cost( 0, m_costs[ k ] ) - m_v[ m_colIndex[ k ] ] );
+				if ( reduced < m_u[ i ] )
+					m_u[ i ] = reduced;
+			}
+
+			if ( !( Cost( 0, m_costs[ findEntry( i, j ) ] ) - m_v[ j ] == m_u[ i ] ) )
+			{
+				m_col4row[ i ] = npos;
+				m_row4col[ j ] = npos;
+				m_v[ j ] = Cost();
+				bChanged = true;
+			}
+		}
+	}
+
+	// row reduction: assign the remaining rows to their cheapest column if it is still free
+	for ( std::size_t i( 0 ); i < m_nRows; i++ )
+	{
+		if ( m_col4row[ i ] != npos )
+			continue;
+
+		std::size_t best( npos );
+		for ( std::size_t k( m_rowStart[ i ] ); k < m_rowStart[ i + 1 ]; k++ )
+		{
+			const Cost reduced( Cost( 0, m_costs[ k ] ) - m_v[ m_colIndex[ k ] ] );
+			if ( best == npos || reduced < m_u[ i ] )
+			{
+				m_u[ i ] = reduced;
+				best = m_colIndex[ k ];
+			}
+		}
+		if ( best != npos && m_row4col[ best ] == npos && m_u[ i ] < Cost( 1, 0 ) )
+		{
+			m_col4row[ i ] = best;
+			m_row4col[ best ] = i;
+		}
+	}
+}
+
+
+template< typename T >
+void LinearAssignment< T >::augment( std::size_t row )
+{
+	// Dijkstra from the row, until an unassigned column is reached or leaving a row unassigned is cheaper
+	Cost minVal;
+	std::size_t i( row );
+	std::size_t sink( npos );
+	std::size_t unassignedRow( npos );
+	Cost unassignedDist;
+	m_heap.clear();
+	m_touchedCols.clear();
+	m_scannedRows.clear();
+	m_scannedCols.clear();
+	while ( true )
+	{
+		m_scannedRows.push_back( i );
+		for ( std::size_t k( m_rowStart[ i ] ); k < m_rowStart[ i + 1 ]; k++ )
+		{
+			const std::size_t j( m_colIndex[ k ] );
+			if ( m_state[ j ] == SCANNED )
+				continue;
+
+			const Cost dist( minVal + Cost( 0, m_costs[ k ] ) - m_u[ i ] - m_v[ j ] );
+			if ( m_state[ j ] == UNTOUCHED || dist < m_dist[ j ] )
+			{
+				if ( m_state[ j ] == UNTOUCHED )
+					m_touchedCols.push_back( j );
+				m_state[ j ] = REACHED;
+				m_dist[ j ] = dist;
+				m_path[ j ] = i;
+				m_heap.push_back( HeapEntry( dist, j ) );
+				std::push_heap( m_heap.begin(), m_heap.end(), heapLess );
+			}
+		}
+
+		const Cost dist( minVal + Cost( 1, 0 ) - m_u[ i ] );
+		if ( unassignedRow == npos || dist < unassignedDist )
+		{
+			unassignedRow = i;
+			unassignedDist = dist;
+		}
+
+		// closest column, skipping outdated heap entries
+		while ( !m_heap.empty() && !( m_heap.front().first == m_dist[ m_heap.front().second ] && m_state[ m_heap.front().second ] == REACHED ) )
+		{
+			std::pop_heap( m_heap.begin(), m_heap.end(), heapLess );
+			m_heap.pop_back();
+		}
+		if ( m_heap.empty() || unassignedDist < m_heap.front().first )
+		{
+			minVal = unassignedDist;
+			break;
+		}
+
+		const std::size_t j( m_heap.front().second );
+		std::pop_heap( m_heap.begin(), m_heap.end(), heapLess );
+		m_heap.pop_back();
+		m_state[ j ] = SCANNED;
+		m_scannedCols.push_back( j );
+		minVal = m_dist[ j ];
+
+		if ( m_row4col[ j ] == npos )
+		{
+			sink = j;
+			break;
+		}
+		i = m_row4col[ j ];
+	}
+
+	// update the prices, keeping the reduced costs non-negative and the assigned pairs tight
+	m_u[ row ] = m_u[ row ] + minVal;
+	for ( std::size_t s( 1 ); s < m_scannedRows.size(); s++ )
+		m_u[ m_scannedRows[ s ] ] = m_u[ m_scannedRows[ s ] ] + minVal - m_dist[ m_col4row[ m_scannedRows[ s ] ] ];
+	for ( std::size_t s( 0 ); s < m_scannedCols.size(); s++ )
+		m_v[ m_scannedCols[ s ] ] = m_v[ m_scannedCols[ s ] ] - ( minVal - m_dist[ m_scannedCols[ s ] ] );
+
+	// flip the assignment along the path, which ends either in an unassigned column or in a row left unassigned
+	std::size_t r( sink != npos ? m_path[ sink ] : unassignedRow );
+	std::size_t j( sink != npos ? sink : unassigned );
+	while ( true )
+	{
+		const std::size_t previous( m_col4row[ r ] );
+		m_col4row[ r ] = j;
+		if ( j != unassigned )
+			m_row4col[ j ] = r;
+		if ( r == row )
+			break;
+		j = previous;
+		r = m_path[ j ];
+	}
+
+	for ( std::size_t s( 0 ); s < m_touchedCols.size(); s++ )
+		m_state[ m_touchedCols[ s ] ] = UNTOUCHED;
+}
+
+
+template< typename T >
+std::size_t LinearAssignment< T >::findEntry( std::size_t row, std::size_t col ) const
+{
+	for ( std::size_t k( m_rowStart[ row ] ); k < m_rowStart[ row + 1 ]; k++ )
+		if ( m_colIndex[ k ] == col )
+			return k;
+	return m_costs.size();
+}
+
+} } } // namespace Ubitrack::Math::Graph
+
+#endif
@@ -63,6 +63,8 @@ enum LmSolverType { lmUseCholesky, lmUseQR, lmUseSVD };
  * @par The problem class
  * The problem class P must be modeled after the UnaryFunctionPrototype and implement the function
  * \c evaluateWithJacobian which computes the predicted measurement and the jacobian wrt. the parameters to optimize.
+ * If P also implements \c evaluate, trial steps are evaluated without the jacobian, which is only
+ * computed once a step is accepted.
  *
  * @param problem the problem to optimize -- provides measurement estimates and jacobians
  * @param params initial parameters on entry, optimized parameters on exit
@@ -71,12 +73,14 @@ enum LmSolverType { lmUseCholesky, lmUseQR, lmUseSVD };
  *   bool operator()( unsigned iteration, double currentError, double previousError )
  * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
  * @param solver least-squares solver to use
+ * @param damping update of the damping parameter
+ * @param observer notified about every iteration, see OptNoObserver
  * @return the residual of the optimization process
  */
-template< class P, class X, class Y, class TC, class NT, class WFT > 
+template< class P, class X, class Y, class TC, class NT, class WFT, class OT > 
 typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
-	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
-	 const WFT& weightFunction = OptNoWeightFunction(), LmSolverType solver = lmUseCholesky )
+	const TC& terminationCriteria, const NT& normalize, const WFT& weightFunction, LmSolverType solver,
+	LmDampingUpdate damping, const OT& observer )
 {
 	namespace lapack = boost::numeric::bindings::lapack;
 	namespace blas = boost::numeric::bindings::blas;
@@ -92,6 +96,8 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 	boost::shared_ptr< VecType > pMeasurementDiff( new VecType( measurement.size() ) );
 	boost::shared_ptr< VecType > pMeasurementDiff2( new VecType( measurement.size() ) );
 	VecType paramDiff( params.size() );
+	VecType gradient( params.size() );
+	VecType weightVector( measurement.size() );
 	VecType estimatedMeasurement( measurement.size() );
 	VecType newParams( params.size() );
 
@@ -103,7 +109,6 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 	// multiply jacobian and difference with sqare root of weight matrix
 	if ( !weightFunction.noWeights() )
 	{
-		VecType weightVector( measurement.size() );
 		weightFunction.computeWeights( *pMeasurementDiff, weightVector );
 		for ( unsigned i = 0; i < measurement.size(); i++ )
 		{
@@ -118,12 +123,14 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 	OPT_LOG_DEBUG( "Levenberg-Marquardt residual 0: " << fErrPrev );
 
 	// start optimization loop
-	T fLambda = T( 1 );
+	observer.begin( "levenbergMarquardt" );
+	Detail::LmDamping< T > lambda( damping );
 	int iteration = 0;
 	bool bTerminate = false;
 	while ( !bTerminate )
 	{
 		iteration++;
+		const T fLambda = lambda.lambda();
 
 		// do one optimization step
 		if ( solver == lmUseCholesky )
@@ -132,6 +139,7 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 			blas::gemm( 'T', 'N', T( 1 ), *pJacobian, *pJacobian, T( 0 ), matJacobiSquare );
 
 		blas::gemm( 'T', 'N', T( 1 ), *pJacobian, *pMeasurementDiff, T( 0 ), paramDiff );
+		gradient = paramDiff;
 		
 		// add lambda to diagonal
 		for ( unsigned i = 0; i < params.size(); i++ )
@@ -174,21 +182,17 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 		// normalize
 		normalize.evaluate( newParams, newParams );
 
-		// compute new error
-		problem.evaluateWithJacobian( estimatedMeasurement, newParams, *pJacobian2 );
+		// compute new error, the jacobian is only needed if the step is accepted
+		bool bHasJacobian = Detail::OptEvaluateTrial< Detail::OptHasEvaluate< P, VecType >::value >::evaluate(
+			problem, estimatedMeasurement, newParams, *pJacobian2 );
 		ublas::noalias( *pMeasurementDiff2 ) = measurement - estimatedMeasurement;
 
-		// multiply jacobian and difference with sqare root of weight matrix
+		// multiply difference with sqare root of weight matrix
 		if ( !weightFunction.noWeights() )
 		{
-			VecType weightVector( measurement.size() );
 			weightFunction.computeWeights( *pMeasurementDiff2, weightVector );
 			for ( unsigned i = 0; i < measurement.size(); i++ )
-			{
-				T w = sqrt( weightVector( i ) );
-				(*pMeasurementDiff2)( i ) *= w;
-				ublas::row( *pJacobian2, i ) *= w;
-			}
+				(*pMeasurementDiff2)( i ) *= sqrt( weightVector( i ) );
 			OPT_LOG_TRACE( "weights = " << weightVector );
 		}
 
@@ -200,14 +204,25 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 		// check if we should terminate
 		bTerminate = terminationCriteria( iteration, fErr, fErrPrev );
 
+		observer.iteration( OptIteration( iteration, fErr, fErrPrev, fLambda, ublas::norm_2( paramDiff ), fErr < fErrPrev ) );
+
 		// update parameters
 		if ( fErr >= fErrPrev )
-			fLambda *= T( 10 );
+			lambda.reject();
 		else
 		{
-			fLambda /= T( 10 );
+			// gain ratio: actual reduction over the reduction predicted by the linear model
+			lambda.accept( ( fErrPrev - fErr ) / ublas::inner_prod( paramDiff, fLambda * paramDiff + gradient ) );
 			params = newParams;
 
+			if ( !bHasJacobian )
+				problem.evaluateWithJacobian( estimatedMeasurement, params, *pJacobian2 );
+
+			// multiply jacobian with sqare root of weight matrix
+			if ( !weightFunction.noWeights() )
+				for ( unsigned i = 0; i < measurement.size(); i++ )
+					ublas::row( *pJacobian2, i ) *= sqrt( weightVector( i ) );
+
 			// swap measurementDiff
 			boost::shared_ptr< VecType > pMDTemp( pMeasurementDiff );
 			pMeasurementDiff = pMeasurementDiff2;
@@ -222,9 +237,21 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 		}
 	}
 
+	observer.end( fErrPrev );
 	return fErrPrev;
 }
 
+/**
+ * @ingroup math
+ * Optimize a given problem using the levenberg marquardt optimizer, see above.
+ */
+template< class P, class X, class Y, class TC, class NT, class WFT > 
+typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
+	 const WFT& weightFunction = OptNoWeightFunction(), LmSolverType solver = lmUseCholesky,
+	LmDampingUpdate damping = lmDampingFactor10 )
+{ return weightedLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, weightFunction, solver, damping, OptNoObserver() ); }
+
 /**
  * @ingroup math
  * Optimize a given problem using the levenberg marquardt optimizer.
@@ -240,13 +267,25 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
  *   bool operator()( unsigned iteration, double currentError, double previousError )
  * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
  * @param solver least-squares solver to use
+ * @param damping update of the damping parameter
  * @return the residual of the optimization process
  */
 template< class P, class X, class Y, class TC, class NT > 
 typename X::value_type levenbergMarquardt( P& problem, X& params, const Y& measurement, 
 	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
-	LmSolverType solver = lmUseCholesky )
-{ return weightedLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver ); }
+	LmSolverType solver = lmUseCholesky, LmDampingUpdate damping = lmDampingFactor10 )
+{ return weightedLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, damping, OptNoObserver() ); }
+
+/**
+ * @ingroup math
+ * Optimize a given problem using the levenberg marquardt optimizer and notify an observer
+ * about every iteration, e.g. OptStatistics.
+ */
+template< class P, class X, class Y, class TC, class NT, class OT > 
+typename X::value_type levenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize, LmSolverType solver, LmDampingUpdate damping, 
+	const OT& observer )
+{ return weightedLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, damping, observer ); }
 
 } } // namespace Ubitrack::Math
 
@@ -33,14 +33,16 @@
 #define __UBITRACK_MATH_OPTIMIZATION_H_INCLUDED__
 
 #include <math.h> // fabs
+#include <algorithm>
 
 // to turn on logging of internal processing, create a log4cpp::Category object called "optLogger"
 // and #define OPTIMIZATION_LOGGING before including this header 
 #ifdef OPTIMIZATION_LOGGING
 	#include <boost/numeric/ublas/io.hpp>
-	#define OPT_LOG_TRACE( message ) LOG4CPP_TRACE( optLogger, message )
-	#define OPT_LOG_DEBUG( message ) LOG4CPP_DEBUG( optLogger, message )
-	#define OPT_LOG_INFO( message ) LOG4CPP_INFO( optLogger, message )
+	#include <utUtil/LogMacros.h>
+	#define OPT_LOG_TRACE( message ) UBITRACK_LOG_TRACE( optLogger, message )
+	#define OPT_LOG_DEBUG( message ) UBITRACK_LOG_DEBUG( optLogger, message )
+	#define OPT_LOG_INFO( message ) UBITRACK_LOG_INFO( optLogger, message )
 #else
 	#define OPT_LOG_TRACE( message ) 
 	#define OPT_LOG_DEBUG( message ) 
@@ -50,6 +52,113 @@
 
 namespace Ubitrack { namespace Math { 
 
+/** possible updates of the damping parameter lambda in levenberg-marquardt optimization */
+enum LmDampingUpdate
+{
+	/** multiply by 10 after rejected steps, divide by 10 after accepted steps */
+	lmDampingFactor10,
+
+	/**
+	 * update from the ratio of actual and predicted error reduction (H.B. Nielsen, "Damping
+	 * parameter in Marquardt's method", 1999), which results in fewer rejected steps
+	 */
+	lmDampingNielsen
+};
+
+namespace Detail {
+
+/** \internal damping parameter lambda of levenberg-marquardt */
+template< class T >
+class LmDamping
+{
+public:
+	LmDamping( LmDampingUpdate update )
+		: m_update( update )
+		, m_lambda( 1 )
+		, m_nu( 2 )
+	{}
+
+	T lambda() const
+	{ return m_lambda; }
+
+	/** update after a rejected step */
+	void reject()
+	{
+		if ( m_update == lmDampingNielsen )
+		{
+			m_lambda *= m_nu;
+			m_nu *= 2;
+		}
+		else
+			m_lambda *= T( 10 );
+	}
+
+	/**
+	 * update after an accepted step
+	 * @param rho ratio of the actual and the predicted error reduction
+	 */
+	void accept( T rho )
+	{
+		if ( m_update == lmDampingNielsen )
+		{
+			const T t( 2 * rho - 1 );
+			m_lambda *= std::max( T( 1 ) / T( 3 ), T( 1 ) - t * t * t );
+			m_nu = 2;
+		}
+		else
+			m_lambda /= T( 10 );
+	}
+
+protected:
+	LmDampingUpdate m_update;
+	T m_lambda;
+	T m_nu;
+};
+
+
+/**
+ * \internal true if the problem P implements the residual-only
+ * \code template< class VT1, class VT2 > void evaluate( VT1& result, const VT2& input ) const \endcode
+ * of UnaryFunctionPrototype, which optimizers use for trial steps
+ */
+template< class P, class V >
+struct OptHasEvaluate
+{
+	template< class U, void ( U::* )( V&, const V& ) const > struct Check;
+
+	template< class U > static char test( Check< U, &U::template evaluate< V, V > >* );
+	template< class U > static long test( ... );
+
+	static const bool value = sizeof( test< P >( 0 ) ) == sizeof( char );
+};
+
+
+/** \internal evaluates a trial step, without the jacobian if the problem allows it */
+template< bool bResidualOnly >
+struct OptEvaluateTrial
+{
+	/** @return true if the jacobian was computed */
+	template< class P, class VT1, class VT2, class MT >
+	static bool evaluate( P& problem, VT1& result, const VT2& input, MT& J )
+	{
+		problem.evaluateWithJacobian( result, input, J );
+		return true;
+	}
+};
+
+template<>
+struct OptEvaluateTrial< true >
+{
+	template< class P, class VT1, class VT2, class MT >
+	static bool evaluate( P& problem, VT1& result, const VT2& input, MT& )
+	{
+		problem.evaluate( result, input );
+		return false;
+	}
+};
+
+} // namespace Detail
+
 /** 
  * Termination criteria that makes the optimizer terminate after n iterations or until the 
  * residual change is smaller than some percentage, whichever comes first. 
@@ -101,6 +210,62 @@ public:
 	{}
 };
 
+
+/** information about an iteration of an optimizer, passed to observers */
+struct OptIteration
+{
+	OptIteration( unsigned iteration_, double residual_, double previousResidual_, double lambda_, 
+		double stepNorm_, bool bAccepted_ )
+		: iteration( iteration_ )
+		, residual( residual_ )
+		, previousResidual( previousResidual_ )
+		, lambda( lambda_ )
+		, stepNorm( stepNorm_ )
+		, bAccepted( bAccepted_ )
+	{}
+
+	/** number of the iteration, starting at 1 */
+	unsigned iteration;
+
+	/**
+	 * residual after the step (gaussNewton: before the step, as the result is not evaluated;
+	 * downhillSimplex: of the best point, not squared)
+	 */
+	double residual;
+
+	/** residual before the step */
+	double previousResidual;
+
+	/** damping parameter used for the step, 0 for optimizers without damping */
+	double lambda;
+
+	/** euclidean norm of the parameter step (downhillSimplex: size of the simplex) */
+	double stepNorm;
+
+	/** true if the step was taken, false if it was rejected (downhillSimplex: true if the best point improved) */
+	bool bAccepted;
+};
+
+
+/**
+ * default observer, which does nothing. Observers are notified by the optimizers when they start,
+ * after each iteration and when they finish, e.g. to collect statistics (see OptStatistics).
+ */
+struct OptNoObserver
+{
+	/** called when an optimizer starts */
+	void begin( const char* ) const
+	{}
+
+	/** called after each iteration */
+	void iteration( const OptIteration& ) const
+	{}
+
+	/** called when an optimizer returns, with the final residual */
+	void end( double ) const
+	{}
+};
+
 } } // namespace Ubitrack::Math
 
 #endif
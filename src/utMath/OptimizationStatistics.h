@@ -0,0 +1,275 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Observer that collects iteration counts, residuals and timing of optimizer calls.
+ */
+
+#ifndef __UBITRACK_MATH_OPTIMIZATIONSTATISTICS_H_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATIONSTATISTICS_H_INCLUDED__
+
+#include <vector>
+#include <algorithm>
+
+#include <utUtil/OS.h>
+#include <utUtil/LogMacros.h>
+#include <utMath/Optimization.h>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * Observer for levenbergMarquardt, sparseLevenbergMarquardt, gaussNewton and downhillSimplex
+ * that keeps a summary of the last call and aggregates all calls, e.g. to find out which
+ * problems converge slowly and how to set the iteration limits of the termination criteria.
+ *
+ * Example:
+ * \code
+ * OptStatistics stats;
+ * levenbergMarquardt( problem, params, measurement, OptTerminate( 10, 1e-6 ), OptNoNormalize(), lmUseCholesky, lmDampingFactor10, stats );
+ * if ( stats.lastCall().nIterations == 10 ) ...
+ * \endcode
+ *
+ * A summary of every call is logged with debug priority to "Ubitrack.Math.Optimization".
+ * Timing starts when the optimizer enters its iteration loop, so it does not include the
+ * initial evaluation. An object must only be used by one thread at a time; statistics of
+ * several threads can be combined with merge().
+ */
+class OptStatistics
+{
+public:
+	/** summary of an optimizer call */
+	struct Call
+	{
+		Call()
+			: sOptimizer( "" )
+			, nIterations( 0 )
+			, nAccepted( 0 )
+			, initialResidual( 0 )
+			, residual( 0 )
+			, lambda( 0 )
+			, seconds( 0 )
+			, maxIterationSeconds( 0 )
+		{}
+
+		/** name of the optimizer */
+		const char* sOptimizer;
+
+		/** number of iterations */
+		unsigned nIterations;
+
+		/** number of accepted steps */
+		unsigned nAccepted;
+
+		/** residual before the first iteration */
+		double initialResidual;
+
+		/** residual returned by the optimizer */
+		double residual;
+
+		/** damping parameter of the last iteration */
+		double lambda;
+
+		/** time spent in the iteration loop */
+		double seconds;
+
+		/** time of the slowest iteration */
+		double maxIterationSeconds;
+	};
+
+	/** an iteration of the last call */
+	struct TraceEntry
+	{
+		TraceEntry( const OptIteration& info_, double seconds_ )
+			: info( info_ )
+			, seconds( seconds_ )
+		{}
+
+		OptIteration info;
+
+		/** time spent in the iteration */
+		double seconds;
+	};
+
+	/**
+	 * constructor
+	 * @param bTrace if true, all iterations of the last call are stored, see trace()
+	 */
+	OptStatistics( bool bTrace = false )
+		: m_bTrace( bTrace )
+		, m_startTime( 0 )
+		, m_lastTime( 0 )
+	{ reset(); }
+
+	/** @name observer interface, called by the optimizers */
+	//@{
+	void begin( const char* sOptimizer ) const
+	{
+		m_lastCall = Call();
+		m_lastCall.sOptimizer = sOptimizer;
+		m_trace.clear();
+		m_startTime = m_lastTime = Util::getHighPerformanceCounter();
+	}
+
+	void iteration( const OptIteration& info ) const
+	{
+		const long long now( Util::getHighPerformanceCounter() );
+		const double seconds( ( now - m_lastTime ) / Util::getHighPerformanceFrequency() );
+		m_lastTime = now;
+
+		if ( m_lastCall.nIterations == 0 )
+			m_lastCall.initialResidual = info.previousResidual;
+		m_lastCall.nIterations++;
+		if ( info.bAccepted )
+			m_lastCall.nAccepted++;
+		m_lastCall.lambda = info.lambda;
+		m_lastCall.maxIterationSeconds = std::max( m_lastCall.maxIterationSeconds, seconds );
+
+		if ( m_bTrace )
+			m_trace.push_back( TraceEntry( info, seconds ) );
+	}
+
+	void end( double residual ) const
+	{
+		m_lastCall.seconds = ( Util::getHighPerformanceCounter() - m_startTime ) / Util::getHighPerformanceFrequency();
+		m_lastCall.residual = residual;
+		if ( m_lastCall.nIterations == 0 )
+			m_lastCall.initialResidual = residual;
+
+		m_nCalls++;
+		m_nTotalIterations += m_lastCall.nIterations;
+		m_nMaxIterations = std::max( m_nMaxIterations, m_lastCall.nIterations );
+		m_totalSeconds += m_lastCall.seconds;
+		m_maxSeconds = std::max( m_maxSeconds, m_lastCall.seconds );
+		const std::size_t bin( histogramBin( m_lastCall.nIterations ) );
+		if ( m_histogram.size() <= bin )
+			m_histogram.resize( bin + 1, 0 );
+		m_histogram[ bin ]++;
+
+		UBITRACK_LOG_DEBUG( logger(), m_lastCall.sOptimizer << ": " << m_lastCall.nIterations << " iterations ("
+			<< m_lastCall.nAccepted << " accepted), residual " << m_lastCall.initialResidual << " -> "
+			<< m_lastCall.residual << ", lambda " << m_lastCall.lambda << ", " << m_lastCall.seconds * 1000 << " ms" );
+	}
+	//@}
+
+	/** summary of the last call */
+	const Call& lastCall() const
+	{ return m_lastCall; }
+
+	/** iterations of the last call, only stored if enabled in the constructor */
+	const std::vector< TraceEntry >& trace() const
+	{ return m_trace; }
+
+	/** number of calls */
+	std::size_t calls() const
+	{ return m_nCalls; }
+
+	/** sum of the iterations of all calls */
+	std::size_t totalIterations() const
+	{ return m_nTotalIterations; }
+
+	/** maximum number of iterations of a call */
+	unsigned maxIterations() const
+	{ return m_nMaxIterations; }
+
+	/** time spent in all calls */
+	double totalSeconds() const
+	{ return m_totalSeconds; }
+
+	/** time of the slowest call */
+	double maxSeconds() const
+	{ return m_maxSeconds; }
+
+	/**
+	 * number of calls by number of iterations. Element 0 counts the calls with less than two
+	 * iterations, element k > 0 the calls with 2^k to 2^( k + 1 ) - 1 iterations.
+	 */
+	const std::vector< std::size_t >& iterationHistogram() const
+	{ return m_histogram; }
+
+	/** histogram bin of a number of iterations */
+	static std::size_t histogramBin( unsigned nIterations )
+	{
+		std::size_t bin( 0 );
+		while ( nIterations >>= 1 )
+			bin++;
+		return bin;
+	}
+
+	/** adds the aggregated statistics of another object, e.g. of another thread */
+	void merge( const OptStatistics& other )
+	{
+		m_nCalls += other.m_nCalls;
+		m_nTotalIterations += other.m_nTotalIterations;
+		m_nMaxIterations = std::max( m_nMaxIterations, other.m_nMaxIterations );
+		m_totalSeconds += other.m_totalSeconds;
+		m_maxSeconds = std::max( m_maxSeconds, other.m_maxSeconds );
+		if ( m_histogram.size() < other.m_histogram.size() )
+			m_histogram.resize( other.m_histogram.size(), 0 );
+		for ( std::size_t i( 0 ); i < other.m_histogram.size(); i++ )
+			m_histogram[ i ] += other.m_histogram[ i ];
+	}
+
+	/** clears all statistics */
+	void reset()
+	{
+		m_lastCall = Call();
+		m_trace.clear();
+		m_nCalls = 0;
+		m_nTotalIterations = 0;
+		m_nMaxIterations = 0;
+		m_totalSeconds = 0;
+		m_maxSeconds = 0;
+		m_histogram.clear();
+	}
+
+protected:
+	/** category of the call summaries */
+	static log4cpp::Category& logger()
+	{
+		static log4cpp::Category& category( log4cpp::Category::getInstance( "Ubitrack.Math.Optimization" ) );
+		return category;
+	}
+
+	bool m_bTrace;
+
+	// the optimizers only get a const reference to the observer
+	mutable long long m_startTime;
+	mutable long long m_lastTime;
+	mutable Call m_lastCall;
+	mutable std::vector< TraceEntry > m_trace;
+
+	mutable std::size_t m_nCalls;
+	mutable std::size_t m_nTotalIterations;
+	mutable unsigned m_nMaxIterations;
+	mutable double m_totalSeconds;
+	mutable double m_maxSeconds;
+	mutable std::vector< std::size_t > m_histogram;
+};
+
+} } // namespace Ubitrack::Math
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Multi-threaded evaluation of objective functions whose residuals and jacobian rows can be
+ * computed independently in blocks, e.g. one block per observation, and the division of
+ * independent items into per-thread ranges used for it.
+ */
+
+#ifndef __UBITRACK_MATH_PARALLELEVALUATION_H_INCLUDED__
+#define __UBITRACK_MATH_PARALLELEVALUATION_H_INCLUDED__
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * Division of \c n independent items into contiguous ranges, one per thread.
+ *
+ * The items are grouped into blocks of \c blockSize consecutive items (the last one may be
+ * shorter), and each range consists of at least \c minBlocksPerRange whole blocks, so fewer
+ * ranges than threads are used for small inputs. The ranges only depend on the constructor
+ * arguments, so results are deterministic if every item is processed the same way.
+ */
+class ThreadRanges
+{
+public:
+	/**
+	 * constructor
+	 * @param n number of items
+	 * @param nThreads maximum number of ranges, 0 is treated as 1
+	 * @param blockSize range boundaries are multiples of this number of items
+	 * @param minBlocksPerRange minimum number of blocks in each range
+	 */
+	ThreadRanges( std::size_t n, unsigned nThreads, std::size_t blockSize = 1, std::size_t minBlocksPerRange = 1 )
+		: m_n( n )
+		, m_blockSize( std::max< std::size_t >( blockSize, 1 ) )
+		, m_nBlocks( ( n + m_blockSize - 1 ) / m_blockSize )
+		, m_nRanges( std::max< std::size_t >( std::min< std::size_t >( nThreads, m_nBlocks / std::max< std::size_t >( minBlocksPerRange, 1 ) ), 1 ) )
+	{}
+
+	/** number of ranges */
+	std::size_t count() const
+	{ return m_nRanges; }
+
+	/** first item of a range, begin( count() ) is the number of items */
+	std::size_t begin( std::size_t i ) const
+	{ return std::min( m_n, i * m_nBlocks / m_nRanges * m_blockSize ); }
+
+protected:
+	std::size_t m_n;
+	std::size_t m_blockSize;
+	std::size_t m_nBlocks;
+	std::size_t m_nRanges;
+};
+
+
+/**
+ * @ingroup math
+ * Calls \c f( i, begin, end ) for every range \c i of \c ranges, each range on its own thread.
+ * The calling thread takes the last range, so no thread is started for a single range.
+ * Returns when all ranges are done.
+ *
+ * @param ranges the division of the items
+ * @param f function object, e.g. created by boost::bind (which ignores unused arguments)
+ */
+template< class F >
+void parallelRanges( const ThreadRanges& ranges, F f )
+{
+	boost::thread_group threads;
+	for ( std::size_t i( 0 ); i + 1 < ranges.count(); i++ )
+		threads.create_thread( boost::bind< void >( f, i, ranges.begin( i ), ranges.begin( i + 1 ) ) );
+
+	std::size_t iLast( ranges.count() - 1 );
+	std::size_t begin( ranges.begin( iLast ) );
+	std::size_t end( ranges.begin( iLast + 1 ) );
+	f( iLast, begin, end );
+	threads.join_all();
+}
+
+
+/** scratch space for block-separable functions that do not need any */
+struct NoBlockScratch
+{};
+
+
+/**
+ * @ingroup math
+ * Adapter that evaluates a block-separable function on multiple threads. It implements
+ * \c evaluate and \c evaluateWithJacobian, so it can be passed as problem to levenbergMarquardt
+ * and the other optimizers instead of the function itself.
+ *
+ * @par The block-separable function
+ * The residual vector of the function P is divided into blocks of consecutive rows, which
+ * depend on the input only and not on each other. P must implement
+ * \code
+ * // scratch space of one thread, default-constructible
+ * typedef ... Scratch;
+ *
+ * // number of blocks
+ * std::size_t blockCount() const;
+ *
+ * // first row of a block, blockRow( blockCount() ) is the size of the residual vector
+ * std::size_t blockRow( std::size_t block ) const;
+ *
+ * // computes the rows of the blocks [ begin, end )
+ * template< class VT1, class VT2 >
+ * void evaluateBlocks( VT1& result, const VT2& input, std::size_t begin, std::size_t end, Scratch& scratch ) const;
+ *
+ * // computes the rows of the blocks [ begin, end ) and all entries of these rows of J
+ * template< class VT1, class VT2, class MT >
+ * void evaluateBlocksWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t begin, std::size_t end, Scratch& scratch ) const;
+ * \endcode
+ * The block functions are called concurrently with disjoint ranges and must write only the
+ * rows of their blocks. Quantities shared by many blocks (e.g. rotation matrices computed
+ * from the input) are computed into the scratch space in every call, as its contents are
+ * undefined on entry.
+ *
+ * @par Determinism
+ * The blocks are divided into contiguous ThreadRanges, which only depend on the number of blocks,
+ * the number of threads and \c minBlocksPerThread. As every row is computed by exactly the
+ * same operations as in a single-threaded evaluation, the results do not depend on the
+ * number of threads. Values accumulated in the scratch spaces can be combined in the order
+ * of scratch(), which is the order of the blocks.
+ *
+ * The adapter keeps the scratch spaces between calls, so a single object must not be
+ * evaluated concurrently.
+ */
+template< class P >
+class ParallelEvaluation
+{
+public:
+	typedef typename P::Scratch Scratch;
+
+	/**
+	 * constructor
+	 * @param problem the block-separable function (must stay valid during lifetime of the object)
+	 * @param nThreads number of threads, including the calling thread, or 0 for the number of cores
+	 * @param minBlocksPerThread minimum number of blocks of each thread, smaller functions are
+	 *   evaluated on fewer threads, as starting a thread costs about as much as a few hundred
+	 *   simple blocks
+	 */
+	ParallelEvaluation( const P& problem, unsigned nThreads = 0, std::size_t minBlocksPerThread = 256 )
+		: m_problem( problem )
+		, m_nThreads( nThreads > 0 ? nThreads : std::max( boost::thread::hardware_concurrency(), 1u ) )
+		, m_minBlocksPerThread( std::max< std::size_t >( minBlocksPerThread, 1 ) )
+		, m_nRanges( 0 )
+	{}
+
+	/** size of the result vector */
+	std::size_t size() const
+	{ return m_problem.blockRow( m_problem.blockCount() ); }
+
+	/**
+	 * @param result vector to store the result in
+	 * @param input containing the parameters
+	 */
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		const ThreadRanges ranges( prepareRanges() );
+		parallelRanges( ranges, boost::bind( &ParallelEvaluation::evaluateRange< VT1, VT2 >, this,
+			boost::ref( result ), boost::cref( input ), _1, _2, _3 ) );
+	}
+
+	/**
+	 * @param result vector to store the result in
+	 * @param input containing the parameters
+	 * @param J matrix to store the jacobian (evaluated for input) in
+	 */
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		const ThreadRanges ranges( prepareRanges() );
+		parallelRanges( ranges, boost::bind( &ParallelEvaluation::evaluateRangeWithJacobian< VT1, VT2, MT >, this,
+			boost::ref( result ), boost::cref( input ), boost::ref( J ), _1, _2, _3 ) );
+	}
+
+	/** number of ranges (and threads) used in the last evaluation */
+	std::size_t rangeCount() const
+	{ return m_nRanges; }
+
+	/** scratch space of the ranges of the last evaluation, in the order of the blocks */
+	const std::vector< Scratch >& scratch() const
+	{ return m_scratch; }
+
+protected:
+	/** divides the blocks into ranges and provides a scratch space for each */
+	ThreadRanges prepareRanges() const
+	{
+		const ThreadRanges ranges( m_problem.blockCount(), m_nThreads, 1, m_minBlocksPerThread );
+		m_nRanges = ranges.count();
+		m_scratch.resize( m_nRanges );
+		return ranges;
+	}
+
+	template< class VT1, class VT2 >
+	void evaluateRange( VT1& result, const VT2& input, std::size_t i, std::size_t begin, std::size_t end ) const
+	{ m_problem.evaluateBlocks( result, input, begin, end, m_scratch[ i ] ); }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateRangeWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t i, std::size_t begin, std::size_t end ) const
+	{ m_problem.evaluateBlocksWithJacobian( result, input, J, begin, end, m_scratch[ i ] ); }
+
+	const P& m_problem;
+	unsigned m_nThreads;
+	std::size_t m_minBlocksPerThread;
+
+	mutable std::size_t m_nRanges;
+	mutable std::vector< Scratch > m_scratch;
+};
+
+} } // namespace Ubitrack::Math
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Closed-form real roots of polynomials up to degree four.
+ *
+ * Used by minimal solvers (e.g. P3P, seven-point fundamental matrix) that
+ * reduce to a single univariate polynomial. The closed-form roots are
+ * refined by Newton iterations on the original polynomial.
+ */
+
+#ifndef __UBITRACK_MATH_POLYNOMIALROOTS_H_INCLUDED__
+#define __UBITRACK_MATH_POLYNOMIALROOTS_H_INCLUDED__
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace Ubitrack { namespace Math {
+
+/** \internal */
+namespace Detail {
+
+/** evaluates c[0] * x^n + ... + c[n] and its derivative and performs Newton steps */
+template< typename T >
+T polishPolynomialRoot( const T* c, std::size_t n, T x, unsigned nIterations = 2 )
+{
+	for ( unsigned it = 0; it < nIterations; it++ )
+	{
+		T f = c[ 0 ];
+		T df = 0;
+		for ( std::size_t i = 1; i <= n; i++ )
+		{
+			df = df * x + f;
+			f = f * x + c[ i ];
+		}
+		if ( df == 0 )
+			break;
+		T step = f / df;
+		x -= step;
+		if ( std::fabs( step ) <= std::numeric_limits< T >::epsilon() * std::fabs( x ) )
+			break;
+	}
+	return x;
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math
+ * Computes the real roots of a x^2 + b x + c.
+ *
+ * @param roots array of at least two elements that receives the roots
+ * @return number of real roots
+ */
+template< typename T >
+std::size_t solveQuadratic( T a, T b, T c, T* roots )
+{
+	if ( a == 0 )
+	{
+		if ( b == 0 )
+			return 0;
+		roots[ 0 ] = -c / b;
+		return 1;
+	}
+
+	T d = b * b - 4 * a * c;
+	if ( d < 0 )
+		return 0;
+
+	// avoid cancellation
+	T q = b >= 0 ? -( b + std::sqrt( d ) ) / 2 : ( -b + std::sqrt( d ) ) / 2;
+	if ( q == 0 )
+	{
+		roots[ 0 ] = roots[ 1 ] = 0;
+		return 2;
+	}
+	roots[ 0 ] = q / a;
+	roots[ 1 ] = c / q;
+	return 2;
+}
+
+
+/**
+ * @ingroup math
+ * Computes the real roots of a x^3 + b x^2 + c x + d.
+ *
+ * @param roots array of at least three elements that receives the roots
+ * @return number of real roots
+ */
+template< typename T >
+std::size_t solveCubic( T a, T b, T c, T d, T* roots )
+{
+	if ( a == 0 )
+		return solveQuadratic( b, c, d, roots );
+
+	// normalize and substitute x = t - b/3 to get t^3 + p t + q
+	const T b3 = b / ( 3 * a );
+	const T p = c / a - 3 * b3 * b3;
+	const T q = 2 * b3 * b3 * b3 - b3 * c / a + d / a;
+	const T pi = static_cast< T >( 3.14159265358979323846 );
+
+	std::size_t n;
+	if ( p == 0 )
+	{
+		roots[ 0 ] = -( q < 0 ? -std::pow( -q, T( 1 ) / 3 ) : std::pow( q, T( 1 ) / 3 ) );
+		n = 1;
+	}
+	else
+	{
+		T disc = q * q / 4 + p * p * p / 27;
+		if ( disc > 0 )
+		{
+			// one real root (Cardano)
+			T s = std::sqrt( disc );
+			T u = -q / 2 + s;
+			T v = -q / 2 - s;
+			u = u < 0 ? -std::pow( -u, T( 1 ) / 3 ) : std::pow( u, T( 1 ) / 3 );
+			v = v < 0 ? -std::pow( -v, T( 1 ) / 3 ) : std::pow( v, T( 1 ) / 3 );
+			roots[ 0 ] = u + v;
+			n = 1;
+		}
+		else
+		{
+			// three real roots (trigonometric method)
+			T m = 2 * std::sqrt( -p / 3 );
+			T arg = 3 * q / ( p * m );
+			arg = arg > 1 ? 1 : ( arg < -1 ? -1 : arg );
+			T theta = std::acos( arg ) / 3;
+			roots[ 0 ] = m * std::cos( theta );
+			roots[ 1 ] = m * std::cos( theta - 2 * pi / 3 );
+			roots[ 2 ] = m * std::cos( theta - 4 * pi / 3 );
+			n = 3;
+		}
+	}
+
+	const T coeffs[ 4 ] = { a, b, c, d };
+	for ( std::size_t i = 0; i < n; i++ )
+		roots[ i ] = Detail::polishPolynomialRoot( coeffs, 3, roots[ i ] - b3 );
+	return n;
+}
+
+
+/**
+ * @ingroup math
+ * Computes the real roots of a x^4 + b x^3 + c x^2 + d x + e using Ferrari's method.
+ *
+ * @param roots array of at least four elements that receives the roots
+ * @return number of real roots
+ */
+template< typename T >
+std::size_t solveQuartic( T a, T b, T c, T d, T e, T* roots )
+{
+	if ( a == 0 )
+		return solveCubic( b, c, d, e, roots );
+
+	// normalize and substitute x = y - b/4 to get y^4 + p y^2 + q y + r
+	const T b4 = b / ( 4 * a );
+	const T c2 = c / a;
+	const T d2 = d / a;
+	const T e2 = e / a;
+	const T p = c2 - 6 * b4 * b4;
+	const T q = d2 - 2 * c2 * b4 + 8 * b4 * b4 * b4;
+	const T r = e2 - d2 * b4 + c2 * b4 * b4 - 3 * b4 * b4 * b4 * b4;
+
+	std::size_t n = 0;
+	T tmp[ 3 ];
+	if ( std::fabs( q ) <= std::numeric_limits< T >::epsilon() * ( std::fabs( p ) * std::fabs( p ) + std::fabs( r ) + 1 ) )
+	{
+		// biquadratic
+		std::size_t nz = solveQuadratic( T( 1 ), p, r, tmp );
+		for ( std::size_t i = 0; i < nz; i++ )
+			if ( tmp[ i ] >= 0 )
+			{
+				roots[ n++ ] = std::sqrt( tmp[ i ] );
+				roots[ n++ ] = -std::sqrt( tmp[ i ] );
+			}
+	}
+	else
+	{
+		// resolvent cubic 8 m^3 + 8 p m^2 + (2 p^2 - 8 r) m - q^2 = 0 has a positive root
+		std::size_t nm = solveCubic( T( 8 ), 8 * p, 2 * p * p - 8 * r, -q * q, tmp );
+		T m = tmp[ 0 ];
+		for ( std::size_t i = 1; i < nm; i++ )
+			if ( tmp[ i ] > m )
+				m = tmp[ i ];
+		if ( m <= 0 )
+			return 0;
+
+		// (y^2 + p/2 + m)^2 = 2m (y - q/(4m))^2 splits into two quadratics
+		T s = std::sqrt( 2 * m );
+		n = solveQuadratic( T( 1 ), -s, p / 2 + m + q / ( 2 * s ), roots );
+		n += solveQuadratic( T( 1 ), s, p / 2 + m - q / ( 2 * s ), roots + n );
+	}
+
+	const T coeffs[ 5 ] = { a, b, c, d, e };
+	for ( std::size_t i = 0; i < n; i++ )
+		roots[ i ] = Detail::polishPolynomialRoot( coeffs, 4, roots[ i ] - b4 );
+	return n;
+}
+
+} } // namespace Ubitrack::Math
+
+#endif
@@ -33,44 +33,8 @@ namespace Ubitrack { namespace Math {
 
 // create quaternion from (assumed) rotation matrix
 Quaternion::Quaternion( const Math::Matrix< double, 0, 0 >& mat )
+	: boost::math::quaternion< double >( fromMatrix( mat ) )
 {
-	double S, X, Y, Z, W;
-	double T = 1.0 + mat(0,0) + mat(1,1) + mat(2,2);
-
-	if (T > 0) {
-		S = sqrt(T) * 2;
-		X = ( mat(1,2) - mat(2,1) ) / S;
-		Y = ( mat(2,0) - mat(0,2) ) / S;
-		Z = ( mat(0,1) - mat(1,0) ) / S;
-		W = 0.25 * S;
-	} else if ( (mat(0,0) > mat(1,1)) && (mat(0,0) > mat(2,2)) ) { // Column 0
-		S = sqrt( 1.0 + mat(0,0) - mat(1,1) - mat(2,2) ) * 2;
-		X = 0.25 * S;
-		Y = ( mat(0,1) + mat(1,0) ) / S;
-		Z = ( mat(2,0) + mat(0,2) ) / S;
-		W = ( mat(1,2) - mat(2,1) ) / S;
-	} else if ( mat(1,1) > mat(2,2) ) { // Column 1
-		S = sqrt( 1.0 + mat(1,1) - mat(0,0) - mat(2,2) ) * 2;
-		X = ( mat(0,1) + mat(1,0) ) / S;
-		Y = 0.25 * S;
-		Z = ( mat(1,2) + mat(2,1) ) / S;
-		W = ( mat(2,0) - mat(0,2) ) / S;
-	} else { // Column 2
-		S = sqrt( 1.0 + mat(2,2) - mat(0,0) - mat(1,1) ) * 2;
-		X = ( mat(2,0) + mat(0,2) ) / S;
-		Y = ( mat(1,2) + mat(2,1) ) / S;
-		Z = 0.25 * S;
-		W = ( mat(0,1) - mat(1,0) ) / S;
-	}
-
-	// Quaternion has to be inverted, as the above code from the
-	// Matrix and Quaternion FAQ expects a column-major matrix.
-	a = -W;
-	b =  X;
-	c =  Y;
-	d =  Z;
-	
-	normalize();
 }
 
 
@@ -184,6 +184,13 @@ class UBITRACK_EXPORT Quaternion
 		template< class M >
 		void toMatrix( M& matrix ) const;
 
+		/**
+		 * creates a quaternion from a rotation matrix without converting it to a dynamic matrix
+		 * @param mat a matrix type with element access via operator(), e.g. Math::Matrix< double, 3, 3 >
+		 */
+		template< class M >
+		static Quaternion fromMatrix( const M& mat );
+
 		/**
 		 * sets the given axis-angle parameters to represent the value of this quaternion.
 		 * Note: Call normalize() in case of doubt for proper operation.
@@ -315,6 +322,46 @@ void Quaternion::toMatrix( M& matrix ) const
 }
 
 
+template< class M >
+Quaternion Quaternion::fromMatrix( const M& mat )
+{
+	double S, X, Y, Z, W;
+	double T = 1.0 + mat(0,0) + mat(1,1) + mat(2,2);
+
+	if (T > 0) {
+		S = sqrt(T) * 2;
+		X = ( mat(1,2) - mat(2,1) ) / S;
+		Y = ( mat(2,0) - mat(0,2) ) / S;
+		Z = ( mat(0,1) - mat(1,0) ) / S;
+		W = 0.25 * S;
+	} else if ( (mat(0,0) > mat(1,1)) && (mat(0,0) > mat(2,2)) ) { // Column 0
+		S = sqrt( 1.0 + mat(0,0) - mat(1,1) - mat(2,2) ) * 2;
+		X = 0.25 * S;
+		Y = ( mat(0,1) + mat(1,0) ) / S;
+		Z = ( mat(2,0) + mat(0,2) ) / S;
+		W = ( mat(1,2) - mat(2,1) ) / S;
+	} else if ( mat(1,1) > mat(2,2) ) { // Column 1
+		S = sqrt( 1.0 + mat(1,1) - mat(0,0) - mat(2,2) ) * 2;
+		X = ( mat(0,1) + mat(1,0) ) / S;
+		Y = 0.25 * S;
+		Z = ( mat(1,2) + mat(2,1) ) / S;
+		W = ( mat(2,0) - mat(0,2) ) / S;
+	} else { // Column 2
+		S = sqrt( 1.0 + mat(2,2) - mat(0,0) - mat(1,1) ) * 2;
+		X = ( mat(2,0) + mat(0,2) ) / S;
+		Y = ( mat(1,2) + mat(2,1) ) / S;
+		Z = 0.25 * S;
+		W = ( mat(0,1) - mat(1,0) ) / S;
+	}
+
+	// Quaternion has to be inverted, as the above code from the
+	// Matrix and Quaternion FAQ expects a column-major matrix.
+	Quaternion q( X, Y, Z, -W );
+	q.normalize();
+	return q;
+}
+
+
 // Code taken from http://www.euclideanspace.com/maths/geometry/rotations/conversions/quaternionToAngle/index.htm
 template< typename T >
 void Quaternion::toAxisAngle( Math::Vector< T, 3 >& axis, T& angle )
@@ -109,13 +109,8 @@ unsigned Ransac( Result& result, const std::vector< Param1 >& paramList1, const
 			if ( nBestInliers >= nMinInliers && iRun + 1 >= nMinRuns )
 				break;
 		}
-#ifdef OPTIMIZATION_LOGGING
 		catch ( const std::runtime_error& e )
 		{ OPT_LOG_DEBUG( "RANSAC: caught exception: " << e.what() ); }
-#else
-		catch ( const std::runtime_error& )
-		{}
-#endif
 	}
 
 	if ( nBestInliers >= nMinInliers )
@@ -0,0 +1,243 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Robust weight functions (Huber, Cauchy, Tukey biweight, Geman-McClure) for
+ * weightedLevenbergMarquardt, with automatic scale estimation.
+ */
+
+#ifndef __UBITRACK_MATH_ROBUSTWEIGHTFUNCTION_H_INCLUDED__
+#define __UBITRACK_MATH_ROBUSTWEIGHTFUNCTION_H_INCLUDED__
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Robust loss functions. Each provides the default tuning constant (for 95% efficiency on
+ * gaussian noise where applicable) and the IRLS weight \f$ \psi( u ) / u \f$ as a function of
+ * the squared normalized residual \f$ u^2 \f$ and the squared tuning constant.
+ */
+namespace RobustLoss {
+
+/** Huber loss: quadratic up to c, linear beyond */
+struct Huber
+{
+	static double defaultConstant()
+	{ return 1.345; }
+
+	static double weight( double u2, double c2 )
+	{ return u2 <= c2 ? 1.0 : std::sqrt( c2 / u2 ); }
+};
+
+/** Cauchy (Lorentzian) loss: \f$ \frac{c^2}{2} \log( 1 + u^2 / c^2 ) \f$ */
+struct Cauchy
+{
+	static double defaultConstant()
+	{ return 2.3849; }
+
+	static double weight( double u2, double c2 )
+	{ return 1.0 / ( 1.0 + u2 / c2 ); }
+};
+
+/** Tukey biweight (bisquare) loss, which ignores residuals larger than c */
+struct Tukey
+{
+	static double defaultConstant()
+	{ return 4.6851; }
+
+	static double weight( double u2, double c2 )
+	{
+		const double t( 1.0 - u2 / c2 );
+		return t > 0 ? t * t : 0.0;
+	}
+};
+
+/** Geman-McClure loss: \f$ \frac{u^2 / 2}{1 + u^2 / c^2} \f$ */
+struct GemanMcClure
+{
+	static double defaultConstant()
+	{ return 1.0; }
+
+	static double weight( double u2, double c2 )
+	{
+		const double t( 1.0 / ( 1.0 + u2 / c2 ) );
+		return t * t;
+	}
+};
+
+} // namespace RobustLoss
+
+
+/**
+ * @ingroup math
+ * Robust weight function for weightedLevenbergMarquardt, implementing the
+ * noWeights()/computeWeights() protocol of OptNoWeightFunction.
+ *
+ * The residual vector is grouped into blocks of \c rowsPerMeasurement rows (e.g. 2 for image
+ * points), which are weighted jointly by the norm of the block. Residuals are normalized by a
+ * scale, which is either fixed or estimated robustly from the median of the block norms (MAD)
+ * in every call of computeWeights.
+ *
+ * @param Loss one of the loss functions in the RobustLoss namespace
+ */
+template< class Loss >
+class RobustWeightFunction
+{
+public:
+	/**
+	 * constructor
+	 * @param rowsPerMeasurement number of rows of each residual block
+	 * @param fScale scale (standard deviation) of the inlier residuals of a single row, or 0 for
+	 *   automatic estimation
+	 * @param fConstant tuning constant of the loss function in units of the scale
+	 * @param fMinScale lower bound of the automatically estimated scale, to avoid division by zero
+	 *   for exact fits
+	 */
+	RobustWeightFunction( unsigned rowsPerMeasurement = 1, double fScale = 0.0,
+		double fConstant = Loss::defaultConstant(), double fMinScale = 1e-9 )
+		: m_rowsPerMeasurement( rowsPerMeasurement > 0 ? rowsPerMeasurement : 1 )
+		, m_fScale( fScale )
+		, m_fConstant( fConstant )
+		, m_fMinScale( fMinScale )
+	{}
+
+	bool noWeights() const
+	{ return false; }
+
+	template< class VT1, class VT2 >
+	void computeWeights( const VT1& errorVector, VT2& weightVector ) const
+	{
+		const std::size_t nBlocks( errorVector.size() / m_rowsPerMeasurement );
+		blockNorms( errorVector, m_norms2 );
+
+		double fScale( m_fScale );
+		if ( fScale <= 0 )
+			fScale = estimateScaleFromNorms( m_norms2 );
+
+		// weights depend on the squared norm of a block only, c^2 and 1/s^2 are folded together
+		const double c2( m_fConstant * m_fConstant );
+		const double fInvScale2( 1.0 / ( fScale * fScale ) );
+		for ( std::size_t b( 0 ); b < nBlocks; b++ )
+		{
+			const typename VT2::value_type w( Loss::weight( m_norms2[ b ] * fInvScale2, c2 ) );
+			for ( std::size_t j( b * m_rowsPerMeasurement ); j < ( b + 1 ) * m_rowsPerMeasurement; j++ )
+				weightVector( j ) = w;
+		}
+
+		// remaining rows that do not fill a block
+		for ( std::size_t j( nBlocks * m_rowsPerMeasurement ); j < errorVector.size(); j++ )
+			weightVector( j ) = 1;
+	}
+
+	/**
+	 * robust estimate of the standard deviation of a single row of the residuals, computed from
+	 * the median of the block norms
+	 */
+	template< class VT >
+	double estimateScale( const VT& errorVector ) const
+	{
+		blockNorms( errorVector, m_norms2 );
+		return estimateScaleFromNorms( m_norms2 );
+	}
+
+protected:
+	/** computes the squared norms of all residual blocks */
+	template< class VT >
+	void blockNorms( const VT& errorVector, std::vector< double >& norms2 ) const
+	{
+		const std::size_t nBlocks( errorVector.size() / m_rowsPerMeasurement );
+		norms2.resize( nBlocks );
+		for ( std::size_t b( 0 ); b < nBlocks; b++ )
+		{
+			double e( 0 );
+			for ( std::size_t j( b * m_rowsPerMeasurement ); j < ( b + 1 ) * m_rowsPerMeasurement; j++ )
+				e += double( errorVector( j ) ) * double( errorVector( j ) );
+			norms2[ b ] = e;
+		}
+	}
+
+	/**
+	 * MAD scale from the squared block norms. The norm of a block of d gaussian rows with standard
+	 * deviation s has the median s * sqrt( m_d ), where m_d is the median of the chi-square
+	 * distribution with d degrees of freedom. For d = 1 this is the usual 1.4826 * MAD.
+	 */
+	double estimateScaleFromNorms( const std::vector< double >& norms2 ) const
+	{
+		if ( norms2.empty() )
+			return m_fMinScale;
+
+		m_median.assign( norms2.begin(), norms2.end() );
+		std::vector< double >::iterator itMedian( m_median.begin() + m_median.size() / 2 );
+		std::nth_element( m_median.begin(), itMedian, m_median.end() );
+
+		const double fScale( std::sqrt( *itMedian / chiSquareMedian( m_rowsPerMeasurement ) ) );
+		return fScale > m_fMinScale ? fScale : m_fMinScale;
+	}
+
+	/** median of the chi-square distribution, Wilson-Hilferty approximation for d > 3 */
+	static double chiSquareMedian( unsigned d )
+	{
+		switch ( d )
+		{
+		case 1: return 0.454936;
+		case 2: return 1.386294;
+		case 3: return 2.365974;
+		default:
+			{
+				const double t( 1.0 - 2.0 / ( 9.0 * d ) );
+				return d * t * t * t;
+			}
+		}
+	}
+
+	unsigned m_rowsPerMeasurement;
+	double m_fScale;
+	double m_fConstant;
+	double m_fMinScale;
+
+	/** buffers, reused between calls */
+	mutable std::vector< double > m_norms2;
+	mutable std::vector< double > m_median;
+};
+
+
+/** Huber weights */
+typedef RobustWeightFunction< RobustLoss::Huber > HuberWeightFunction;
+
+/** Cauchy weights */
+typedef RobustWeightFunction< RobustLoss::Cauchy > CauchyWeightFunction;
+
+/** Tukey biweight weights, normalized by a scale (unlike TukeyWeightFunction) */
+typedef RobustWeightFunction< RobustLoss::Tukey > TukeyBiweightFunction;
+
+/** Geman-McClure weights */
+typedef RobustWeightFunction< RobustLoss::GemanMcClure > GemanMcClureWeightFunction;
+
+} } // namespace Ubitrack::Math
+
+#endif
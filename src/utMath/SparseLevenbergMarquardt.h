@@ -0,0 +1,254 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Levenberg-Marquardt optimizer for problems with sparse jacobians
+ */
+
+#ifndef __UBITRACK_MATH_SPARSELEVENBERGMARQUARDT_INCLUDED__
+#define __UBITRACK_MATH_SPARSELEVENBERGMARQUARDT_INCLUDED__
+
+#include <utMath/Optimization.h>
+#include <utMath/SparseMatrix.h>
+#include <utMath/Vector.h>
+
+#include <limits>
+
+namespace Ubitrack { namespace Math {
+
+/** possible solvers to use in sparse levenberg-marquardt optimization */
+enum SparseLmSolverType { sparseLmUseCholesky, sparseLmUseConjugateGradient };
+
+/**
+ * @ingroup math
+ * Optimize a given problem with a sparse jacobian using the levenberg marquardt optimizer.
+ *
+ * The iteration is the same as in weightedLevenbergMarquardt, but the normal equations are
+ * never formed densely. Does not require LAPACK.
+ *
+ * @par The problem class
+ * The problem class P must implement the function
+ * \code
+ * template< class VT1, class VT2 >
+ * void evaluateWithJacobian( VT1& result, const VT2& input, Math::CsrMatrix< T >& J ) const;
+ * \endcode
+ * which computes the predicted measurement and inserts the non-zero entries of the jacobian 
+ * wrt. the parameters into J, e.g. blockwise with CsrMatrix::insertBlock. J is empty and has 
+ * the correct size when called. If P also implements \c evaluate, trial steps are evaluated
+ * without the jacobian.
+ *
+ * @param problem the problem to optimize -- provides measurement estimates and jacobians
+ * @param params initial parameters on entry, optimized parameters on exit
+ * @param measurement the measurement vector
+ * @param terminationCriteria functor that returns true if the optimization should terminate. Is called with
+ *   bool operator()( unsigned iteration, double currentError, double previousError )
+ * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+ * @param weightFunction weights of the residuals, see OptNoWeightFunction
+ * @param solver sparse solver to use. Sparse cholesky works well for banded problems, conjugate
+ *   gradients for large problems with much fill-in.
+ * @param damping update of the damping parameter
+ * @param observer notified about every iteration, see OptNoObserver
+ * @return the residual of the optimization process
+ */
+template< class P, class X, class Y, class TC, class NT, class WFT, class OT > 
+typename X::value_type weightedSparseLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize, const WFT& weightFunction, 
+	SparseLmSolverType solver, LmDampingUpdate damping, const OT& observer )
+{
+	namespace ublas = boost::numeric::ublas;
+	typedef typename X::value_type T;
+	typedef typename Math::Vector< T >::base_type VecType;
+
+	// create some matrices and vectors
+	CsrMatrix< T > jacobian( measurement.size(), params.size() );
+	CsrMatrix< T > jacobian2( measurement.size(), params.size() );
+	VecType measurementDiff( measurement.size() );
+	VecType measurementDiff2( measurement.size() );
+	VecType weightVector( measurement.size() );
+	VecType paramDiff( params.size() );
+	VecType gradient( params.size() );
+	VecType estimatedMeasurement( measurement.size() );
+	VecType newParams( params.size() );
+	SparseCholesky< T > cholesky;
+	SparseConjugateGradient< T > conjugateGradient;
+
+	// compute initial error
+	problem.evaluateWithJacobian( estimatedMeasurement, params, jacobian );
+	jacobian.compress();
+	ublas::noalias( measurementDiff ) = measurement - estimatedMeasurement;
+	OPT_LOG_TRACE( "Measurement Diff = " << measurementDiff );
+
+	// multiply jacobian and difference with sqare root of weight matrix
+	if ( !weightFunction.noWeights() )
+	{
+		weightFunction.computeWeights( measurementDiff, weightVector );
+		for ( unsigned i = 0; i < measurement.size(); i++ )
+		{
+			T w = sqrt( weightVector( i ) );
+			measurementDiff( i ) *= w;
+			jacobian.scaleRow( i, w );
+		}
+		OPT_LOG_TRACE( "weights = " << weightVector );
+	}
+
+	T fErrPrev = ublas::inner_prod( measurementDiff, measurementDiff );
+	OPT_LOG_DEBUG( "Sparse Levenberg-Marquardt residual 0: " << fErrPrev << ", " << jacobian.nnz() << " jacobian entries" );
+
+	// start optimization loop
+	observer.begin( "sparseLevenbergMarquardt" );
+	Detail::LmDamping< T > lambda( damping );
+	int iteration = 0;
+	bool bTerminate = false;
+	while ( !bTerminate )
+	{
+		iteration++;
+		const T fLambda = lambda.lambda();
+
+		// solve ( J^T J + lambda I ) paramDiff = J^T measurementDiff
+		jacobian.multiplyTransposed( measurementDiff, paramDiff );
+		gradient = paramDiff;
+		if ( solver == sparseLmUseCholesky )
+		{
+			if ( !cholesky.factorize( jacobian, fLambda ) )
+			{
+				OPT_LOG_DEBUG( "Error in sparse cholesky decomposition, switching to conjugate gradients" );
+				solver = sparseLmUseConjugateGradient;
+				iteration--;
+				continue;
+			}
+			cholesky.solve( paramDiff );
+		}
+		else
+		{
+			if ( !conjugateGradient.factorize( jacobian, fLambda ) )
+			{
+				// a column without entries and no damping, or invalid entries that no damping can fix
+				OPT_LOG_DEBUG( "Error in conjugate gradient preconditioner, increasing lambda" );
+				if ( !( fLambda < std::numeric_limits< T >::max() ) )
+					break;
+				lambda.reject();
+				iteration--;
+				continue;
+			}
+			conjugateGradient.solve( paramDiff );
+			OPT_LOG_TRACE( "Conjugate gradient iterations: " << conjugateGradient.iterations() );
+		}
+
+		OPT_LOG_TRACE( "paramDiff: " << paramDiff );
+		ublas::noalias( newParams ) = params + paramDiff;
+
+		// normalize
+		normalize.evaluate( newParams, newParams );
+
+		// compute new error, the jacobian is only needed if the step is accepted
+		jacobian2.clear();
+		bool bHasJacobian = Detail::OptEvaluateTrial< Detail::OptHasEvaluate< P, VecType >::value >::evaluate(
+			problem, estimatedMeasurement, newParams, jacobian2 );
+		ublas::noalias( measurementDiff2 ) = measurement - estimatedMeasurement;
+
+		// multiply difference with sqare root of weight matrix
+		if ( !weightFunction.noWeights() )
+		{
+			weightFunction.computeWeights( measurementDiff2, weightVector );
+			for ( unsigned i = 0; i < measurement.size(); i++ )
+				measurementDiff2( i ) *= sqrt( weightVector( i ) );
+			OPT_LOG_TRACE( "weights = " << weightVector );
+		}
+
+		T fErr = ublas::inner_prod( measurementDiff2, measurementDiff2 );
+
+		OPT_LOG_TRACE( "measurementDiff: " << measurementDiff2 );
+		OPT_LOG_DEBUG( "Sparse Levenberg-Marquardt residual " << iteration << ": " << fErr );
+
+		// check if we should terminate
+		bTerminate = terminationCriteria( iteration, fErr, fErrPrev );
+		observer.iteration( OptIteration( iteration, fErr, fErrPrev, fLambda, ublas::norm_2( paramDiff ), fErr < fErrPrev ) );
+
+		// update parameters
+		if ( fErr >= fErrPrev )
+			lambda.reject();
+		else
+		{
+			// gain ratio: actual reduction over the reduction predicted by the linear model
+			lambda.accept( ( fErrPrev - fErr ) / ublas::inner_prod( paramDiff, fLambda * paramDiff + gradient ) );
+			params = newParams;
+
+			if ( !bHasJacobian )
+			{
+				jacobian2.clear();
+				problem.evaluateWithJacobian( estimatedMeasurement, params, jacobian2 );
+			}
+			jacobian2.compress();
+
+			// multiply jacobian with sqare root of weight matrix
+			if ( !weightFunction.noWeights() )
+				for ( unsigned i = 0; i < measurement.size(); i++ )
+					jacobian2.scaleRow( i, sqrt( weightVector( i ) ) );
+
+			measurementDiff.swap( measurementDiff2 );
+			jacobian.swap( jacobian2 );
+			fErrPrev = fErr;
+		}
+	}
+
+	observer.end( fErrPrev );
+	return fErrPrev;
+}
+
+/**
+ * @ingroup math
+ * Optimize a given problem with a sparse jacobian using the levenberg marquardt optimizer, see above.
+ */
+template< class P, class X, class Y, class TC, class NT, class WFT > 
+typename X::value_type weightedSparseLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize, const WFT& weightFunction, 
+	SparseLmSolverType solver = sparseLmUseCholesky, LmDampingUpdate damping = lmDampingFactor10 )
+{ return weightedSparseLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, weightFunction, solver, damping, OptNoObserver() ); }
+
+/**
+ * @ingroup math
+ * Optimize a given problem with a sparse jacobian using the levenberg marquardt optimizer.
+ * See weightedSparseLevenbergMarquardt.
+ */
+template< class P, class X, class Y, class TC, class NT > 
+typename X::value_type sparseLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
+	SparseLmSolverType solver = sparseLmUseCholesky, LmDampingUpdate damping = lmDampingFactor10 )
+{ return weightedSparseLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, damping, OptNoObserver() ); }
+
+/**
+ * @ingroup math
+ * Optimize a given problem with a sparse jacobian using the levenberg marquardt optimizer and
+ * notify an observer about every iteration, e.g. OptStatistics.
+ */
+template< class P, class X, class Y, class TC, class NT, class OT > 
+typename X::value_type sparseLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize, SparseLmSolverType solver, LmDampingUpdate damping, 
+	const OT& observer )
+{ return weightedSparseLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, damping, observer ); }
+
+} } // namespace Ubitrack::Math
+
+#endif
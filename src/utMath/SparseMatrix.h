@@ -0,0 +1,635 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Sparse matrices in compressed row format and solvers for the damped normal equations
+ * \f$ ( J^T J + \lambda I ) x = b \f$ of sparse least-squares problems.
+ */
+
+#ifndef __UBITRACK_MATH_SPARSEMATRIX_H_INCLUDED__
+#define __UBITRACK_MATH_SPARSEMATRIX_H_INCLUDED__
+
+#include <utUtil/Exception.h>
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * Sparse matrix in compressed sparse row (CSR) format.
+ *
+ * Entries are inserted as triplets in any order, e.g. blockwise per measurement, and converted
+ * to CSR by compress(). Duplicate entries are summed. Buffers are kept by clear(), so a matrix
+ * that is refilled with the same pattern does not allocate memory.
+ */
+template< class T >
+class CsrMatrix
+{
+public:
+	typedef T value_type;
+
+	/** constructs an empty rows x cols matrix */
+	CsrMatrix( std::size_t rows = 0, std::size_t cols = 0 )
+		: m_rows( rows )
+		, m_cols( cols )
+		, m_bCompressed( true )
+		, m_rowStart( rows + 1, 0 )
+	{}
+
+	/** changes the size and removes all entries */
+	void resize( std::size_t rows, std::size_t cols )
+	{
+		m_rows = rows;
+		m_cols = cols;
+		clear();
+	}
+
+	/** removes all entries */
+	void clear()
+	{
+		m_tRow.clear();
+		m_tCol.clear();
+		m_tValue.clear();
+		m_rowStart.assign( m_rows + 1, 0 );
+		m_colIndex.clear();
+		m_values.clear();
+		m_bCompressed = true;
+	}
+
+	std::size_t size1() const
+	{ return m_rows; }
+
+	std::size_t size2() const
+	{ return m_cols; }
+
+	/** number of stored entries, valid after compress() */
+	std::size_t nnz() const
+	{ return m_values.size(); }
+
+	/** adds \c value to the entry ( row, col ) */
+	void insert( std::size_t row, std::size_t col, T value )
+	{
+		m_tRow.push_back( row );
+		m_tCol.push_back( col );
+		m_tValue.push_back( value );
+		m_bCompressed = false;
+	}
+
+	/** adds a dense block with upper left corner ( row0, col0 ) */
+	template< class M >
+	void insertBlock( std::size_t row0, std::size_t col0, const M& block )
+	{
+		for ( std::size_t i( 0 ); i < block.size1(); i++ )
+			for ( std::size_t j( 0 ); j < block.size2(); j++ )
+				insert( row0 + i, col0 + j, block( i, j ) );
+	}
+
+	/** converts the inserted entries to CSR, with sorted column indices and summed duplicates */
+	void compress()
+	{
+		if ( m_bCompressed )
+			return;
+
+		// keep entries that were compressed before
+		for ( std::size_t r( 0 ); r < m_rows; r++ )
+			for ( std::size_t k( m_rowStart[ r ] ); k < m_rowStart[ r + 1 ]; k++ )
+				insert( r, m_colIndex[ k ], m_values[ k ] );
+
+		// counting sort by row
+		m_rowStart.assign( m_rows + 1, 0 );
+		for ( std::size_t t( 0 ); t < m_tRow.size(); t++ )
+		{
+			if ( m_tRow[ t ] >= m_rows || m_tCol[ t ] >= m_cols )
+				UBITRACK_THROW( "Sparse matrix index out of range" );
+			m_rowStart[ m_tRow[ t ] + 1 ]++;
+		}
+		for ( std::size_t r( 0 ); r < m_rows; r++ )
+			m_rowStart[ r + 1 ] += m_rowStart[ r ];
+
+		m_colIndex.resize( m_tRow.size() );
+		m_values.resize( m_tRow.size() );
+		m_fill.assign( m_rowStart.begin(), m_rowStart.end() - 1 );
+		for ( std::size_t t( 0 ); t < m_tRow.size(); t++ )
+		{
+			const std::size_t k( m_fill[ m_tRow[ t ] ]++ );
+			m_colIndex[ k ] = m_tCol[ t ];
+			m_values[ k ] = m_tValue[ t ];
+		}
+
+		// sort the (short) rows by insertion and merge duplicates
+		std::size_t nOut( 0 );
+		for ( std::size_t r( 0 ); r < m_rows; r++ )
+		{
+			const std::size_t begin( m_rowStart[ r ] );
+			const std::size_t end( m_rowStart[ r + 1 ] );
+			for ( std::size_t k( begin + 1 ); k < end; k++ )
+			{
+				const std::size_t col( m_colIndex[ k ] );
+				const T value( m_values[ k ] );
+				std::size_t l( k );
+				for ( ; l > begin && m_colIndex[ l - 1 ] > col; l-- )
+				{
+					m_colIndex[ l ] = m_colIndex[ l - 1 ];
+					m_values[ l ] = m_values[ l - 1 ];
+				}
+				m_colIndex[ l ] = col;
+				m_values[ l ] = value;
+			}
+
+			m_rowStart[ r ] = nOut;
+			for ( std::size_t k( begin ); k < end; k++ )
+				if ( nOut > m_rowStart[ r ] && m_colIndex[ nOut - 1 ] == m_colIndex[ k ] )
+					m_values[ nOut - 1 ] += m_values[ k ];
+				else
+				{
+					m_colIndex[ nOut ] = m_colIndex[ k ];
+					m_values[ nOut ] = m_values[ k ];
+					nOut++;
+				}
+		}
+		m_rowStart[ m_rows ] = nOut;
+		m_colIndex.resize( nOut );
+		m_values.resize( nOut );
+
+		m_tRow.clear();
+		m_tCol.clear();
+		m_tValue.clear();
+		m_bCompressed = true;
+	}
+
+	/** computes y = A x */
+	template< class VT1, class VT2 >
+	void multiply( const VT1& x, VT2& y ) const
+	{
+		checkCompressed();
+		for ( std::size_t r( 0 ); r < m_rows; r++ )
+		{
+			T s( 0 );
+			for ( std::size_t k( m_rowStart[ r ] ); k < m_rowStart[ r + 1 ]; k++ )
+				s += m_values[ k ] * x( m_colIndex[ k ] );
+			y( r ) = s;
+		}
+	}
+
+	/** computes y = A^T x */
+	template< class VT1, class VT2 >
+	void multiplyTransposed( const VT1& x, VT2& y ) const
+	{
+		checkCompressed();
+		for ( std::size_t c( 0 ); c < m_cols; c++ )
+			y( c ) = 0;
+		for ( std::size_t r( 0 ); r < m_rows; r++ )
+		{
+			const T xr( x( r ) );
+			for ( std::size_t k( m_rowStart[ r ] ); k < m_rowStart[ r + 1 ]; k++ )
+				y( m_colIndex[ k ] ) += m_values[ k ] * xr;
+		}
+	}
+
+	/** multiplies a row by a factor, e.g. the square root of a weight */
+	void scaleRow( std::size_t row, T factor )
+	{
+		checkCompressed();
+		for ( std::size_t k( m_rowStart[ row ] ); k < m_rowStart[ row + 1 ]; k++ )
+			m_values[ k ] *= factor;
+	}
+
+	/** swaps contents with another matrix without copying */
+	void swap( CsrMatrix& other )
+	{
+		std::swap( m_rows, other.m_rows );
+		std::swap( m_cols, other.m_cols );
+		std::swap( m_bCompressed, other.m_bCompressed );
+		m_tRow.swap( other.m_tRow );
+		m_tCol.swap( other.m_tCol );
+		m_tValue.swap( other.m_tValue );
+		m_rowStart.swap( other.m_rowStart );
+		m_colIndex.swap( other.m_colIndex );
+		m_values.swap( other.m_values );
+	}
+
+	/** @name CSR arrays, valid after compress() */
+	//@{
+	const std::vector< std::size_t >& rowStart() const
+	{ return m_rowStart; }
+
+	const std::vector< std::size_t >& colIndex() const
+	{ return m_colIndex; }
+
+	const std::vector< T >& values() const
+	{ return m_values; }
+	//@}
+
+protected:
+	void checkCompressed() const
+	{
+		if ( !m_bCompressed )
+			UBITRACK_THROW( "Sparse matrix must be compressed before use" );
+	}
+
+	std::size_t m_rows;
+	std::size_t m_cols;
+	bool m_bCompressed;
+
+	/** inserted entries that are not compressed yet */
+	std::vector< std::size_t > m_tRow;
+	std::vector< std::size_t > m_tCol;
+	std::vector< T > m_tValue;
+
+	std::vector< std::size_t > m_rowStart;
+	std::vector< std::size_t > m_colIndex;
+	std::vector< T > m_values;
+
+	/** buffer for compress() */
+	std::vector< std::size_t > m_fill;
+};
+
+
+/**
+ * @ingroup math
+ * Sparse Cholesky factorization of \f$ J^T J + \lambda I \f$ for a sparse jacobian J.
+ *
+ * The unknowns are reordered by reverse Cuthill-McKee to reduce the envelope (profile) of the
+ * normal equations, which is then factorized in skyline storage. The fill-in of the Cholesky
+ * factor stays within the envelope, so the cost is linear in the number of unknowns for banded
+ * problems such as chains of poses. The ordering is only recomputed if the sparsity pattern of
+ * J changes.
+ */
+template< class T >
+class SparseCholesky
+{
+public:
+	/**
+	 * factorizes \f$ J^T J + \lambda I \f$
+	 * @return false if the matrix is not positive definite
+	 */
+	bool factorize( const CsrMatrix< T >& J, T lambda )
+	{
+		if ( J.rowStart() != m_patternRowStart || J.colIndex() != m_patternColIndex )
+			analyze( J );
+
+		// assemble the lower triangle of the permuted normal equations
+		std::fill( m_L.begin(), m_L.end(), T( 0 ) );
+		const std::vector< std::size_t >& rowStart( J.rowStart() );
+		const std::vector< std::size_t >& colIndex( J.colIndex() );
+		const std::vector< T >& values( J.values() );
+		for ( std::size_t r( 0 ); r + 1 < rowStart.size(); r++ )
+			for ( std::size_t a( rowStart[ r ] ); a < rowStart[ r + 1 ]; a++ )
+			{
+				const std::size_t pa( m_perm[ colIndex[ a ] ] );
+				const T va( values[ a ] );
+				for ( std::size_t b( rowStart[ r ] ); b < rowStart[ r + 1 ]; b++ )
+				{
+					const std::size_t pb( m_perm[ colIndex[ b ] ] );
+					if ( pb <= pa )
+						m_L[ index( pa, pb ) ] += va * values[ b ];
+				}
+			}
+		for ( std::size_t i( 0 ); i < m_perm.size(); i++ )
+			m_L[ index( i, i ) ] += lambda;
+
+		// row-wise cholesky within the envelope
+		for ( std::size_t i( 0 ); i < m_perm.size(); i++ )
+		{
+			const std::size_t fi( m_first[ i ] );
+			for ( std::size_t j( fi ); j < i; j++ )
+			{
+				const std::size_t k0( std::max( fi, m_first[ j ] ) );
+				T s( m_L[ index( i, j ) ] );
+				for ( std::size_t k( k0 ); k < j; k++ )
+					s -= m_L[ index( i, k ) ] * m_L[ index( j, k ) ];
+				m_L[ index( i, j ) ] = s / m_L[ index( j, j ) ];
+			}
+
+			T d( m_L[ index( i, i ) ] );
+			for ( std::size_t k( fi ); k < i; k++ )
+				d -= m_L[ index( i, k ) ] * m_L[ index( i, k ) ];
+			if ( !( d > 0 ) )
+				return false;
+			m_L[ index( i, i ) ] = std::sqrt( d );
+		}
+		return true;
+	}
+
+	/** solves the factorized system in place */
+	template< class VT >
+	void solve( VT& b ) const
+	{
+		const std::size_t n( m_perm.size() );
+		m_y.resize( n );
+		for ( std::size_t c( 0 ); c < n; c++ )
+			m_y[ m_perm[ c ] ] = b( c );
+
+		// L y = b
+		for ( std::size_t i( 0 ); i < n; i++ )
+		{
+			T s( m_y[ i ] );
+			for ( std::size_t k( m_first[ i ] ); k < i; k++ )
+				s -= m_L[ index( i, k ) ] * m_y[ k ];
+			m_y[ i ] = s / m_L[ index( i, i ) ];
+		}
+
+		// L^T x = y, column-oriented
+		for ( std::size_t i( n ); i-- > 0; )
+		{
+			m_y[ i ] /= m_L[ index( i, i ) ];
+			for ( std::size_t k( m_first[ i ] ); k < i; k++ )
+				m_y[ k ] -= m_L[ index( i, k ) ] * m_y[ i ];
+		}
+
+		for ( std::size_t c( 0 ); c < n; c++ )
+			b( c ) = m_y[ m_perm[ c ] ];
+	}
+
+	/** number of stored entries of the factor */
+	std::size_t envelopeSize() const
+	{ return m_L.size(); }
+
+protected:
+	/** position of L( i, j ), j in [ first( i ), i ] */
+	std::size_t index( std::size_t i, std::size_t j ) const
+	{ return m_rowPtr[ i ] + j - m_first[ i ]; }
+
+	/** computes the reverse Cuthill-McKee ordering and the envelope of J^T J */
+	void analyze( const CsrMatrix< T >& J )
+	{
+		const std::size_t n( J.size2() );
+		const std::vector< std::size_t >& rowStart( J.rowStart() );
+		const std::vector< std::size_t >& colIndex( J.colIndex() );
+		m_patternRowStart = rowStart;
+		m_patternColIndex = colIndex;
+
+		// graph of the normal equations: unknowns are adjacent if they share a row of J
+		std::vector< std::vector< std::size_t > > adjacency( n );
+		for ( std::size_t r( 0 ); r + 1 < rowStart.size(); r++ )
+			for ( std::size_t a( rowStart[ r ] ); a < rowStart[ r + 1 ]; a++ )
+				for ( std::size_t b( rowStart[ r ] ); b < rowStart[ r + 1 ]; b++ )
+					if ( a != b )
+						adjacency[ colIndex[ a ] ].push_back( colIndex[ b ] );
+		for ( std::size_t c( 0 ); c < n; c++ )
+		{
+			std::sort( adjacency[ c ].begin(), adjacency[ c ].end() );
+			adjacency[ c ].erase( std::unique( adjacency[ c ].begin(), adjacency[ c ].end() ), adjacency[ c ].end() );
+		}
+
+		// cuthill-mckee: breadth-first search from a node of minimal degree in each component,
+		// visiting neighbours in order of increasing degree
+		DegreeLess degreeLess( adjacency );
+		std::vector< std::size_t > byDegree( n );
+		for ( std::size_t c( 0 ); c < n; c++ )
+			byDegree[ c ] = c;
+		std::stable_sort( byDegree.begin(), byDegree.end(), degreeLess );
+
+		std::vector< std::size_t > order;
+		order.reserve( n );
+		std::vector< bool > visited( n, false );
+		std::vector< std::size_t > neighbours;
+		for ( std::size_t s( 0 ); s < n; s++ )
+		{
+			if ( visited[ byDegree[ s ] ] )
+				continue;
+			std::size_t head( order.size() );
+			order.push_back( byDegree[ s ] );
+			visited[ byDegree[ s ] ] = true;
+			for ( ; head < order.size(); head++ )
+			{
+				neighbours.clear();
+				const std::vector< std::size_t >& adj( adjacency[ order[ head ] ] );
+				for ( std::size_t k( 0 ); k < adj.size(); k++ )
+					if ( !visited[ adj[ k ] ] )
+					{
+						visited[ adj[ k ] ] = true;
+						neighbours.push_back( adj[ k ] );
+					}
+				std::stable_sort( neighbours.begin(), neighbours.end(), degreeLess );
+				order.insert( order.end(), neighbours.begin(), neighbours.end() );
+			}
+		}
+
+		// reverse and compute the envelope
+		m_perm.resize( n );
+		for ( std::size_t i( 0 ); i < n; i++ )
+			m_perm[ order[ n - 1 - i ] ] = i;
+
+		m_first.resize( n );
+		for ( std::size_t i( 0 ); i < n; i++ )
+			m_first[ i ] = i;
+		for ( std::size_t c( 0 ); c < n; c++ )
+			for ( std::size_t k( 0 ); k < adjacency[ c ].size(); k++ )
+			{
+				const std::size_t pc( m_perm[ c ] );
+				m_first[ pc ] = std::min( m_first[ pc ], m_perm[ adjacency[ c ][ k ] ] );
+			}
+
+		m_rowPtr.resize( n );
+		std::size_t nEntries( 0 );
+		for ( std::size_t i( 0 ); i < n; i++ )
+		{
+			m_rowPtr[ i ] = nEntries;
+			nEntries += i - m_first[ i ] + 1;
+		}
+		m_L.resize( nEntries );
+	}
+
+	/** \internal compares nodes by degree */
+	struct DegreeLess
+	{
+		DegreeLess( const std::vector< std::vector< std::size_t > >& adjacency )
+			: m_adjacency( adjacency )
+		{}
+
+		bool operator()( std::size_t a, std::size_t b ) const
+		{ return m_adjacency[ a ].size() < m_adjacency[ b ].size(); }
+
+		const std::vector< std::vector< std::size_t > >& m_adjacency;
+	};
+
+	/** sparsity pattern of the analyzed jacobian */
+	std::vector< std::size_t > m_patternRowStart;
+	std::vector< std::size_t > m_patternColIndex;
+
+	/** new position of each unknown */
+	std::vector< std::size_t > m_perm;
+
+	/** first column of each row of the envelope, start of each row in m_L */
+	std::vector< std::size_t > m_first;
+	std::vector< std::size_t > m_rowPtr;
+	std::vector< T > m_L;
+
+	mutable std::vector< T > m_y;
+};
+
+
+/**
+ * @ingroup math
+ * Preconditioned conjugate gradients for \f$ ( J^T J + \lambda I ) x = b \f$.
+ *
+ * The normal equations are never formed: each iteration multiplies with J and J^T. The
+ * preconditioner is the diagonal of the normal equations (Jacobi). Has the same interface as
+ * SparseCholesky.
+ */
+template< class T >
+class SparseConjugateGradient
+{
+public:
+	/**
+	 * constructor
+	 * @param maxIterations maximum number of iterations, 0 for the number of unknowns
+	 * @param tolerance stops if the residual norm is reduced by this factor
+	 */
+	SparseConjugateGradient( std::size_t maxIterations = 0, T tolerance = T( 1e-10 ) )
+		: m_maxIterations( maxIterations )
+		, m_tolerance( tolerance )
+		, m_pJ( 0 )
+		, m_lambda( 0 )
+		, m_iterations( 0 )
+	{}
+
+	/** prepares the preconditioner, J must stay valid until solve() is called */
+	bool factorize( const CsrMatrix< T >& J, T lambda )
+	{
+		m_pJ = &J;
+		m_lambda = lambda;
+		m_invDiagonal.assign( J.size2(), lambda );
+		const std::vector< std::size_t >& colIndex( J.colIndex() );
+		const std::vector< T >& values( J.values() );
+		for ( std::size_t k( 0 ); k < values.size(); k++ )
+			m_invDiagonal[ colIndex[ k ] ] += values[ k ] * values[ k ];
+		for ( std::size_t c( 0 ); c < m_invDiagonal.size(); c++ )
+		{
+			if ( !( m_invDiagonal[ c ] > 0 ) )
+				return false;
+			m_invDiagonal[ c ] = T( 1 ) / m_invDiagonal[ c ];
+		}
+		return true;
+	}
+
+	/** solves the system in place, starting from zero */
+	template< class VT >
+	void solve( VT& b ) const
+	{
+		const std::size_t n( m_invDiagonal.size() );
+		const std::size_t maxIterations( m_maxIterations > 0 ? m_maxIterations : n );
+		m_x.assign( n, T( 0 ) );
+		m_r.resize( n );
+		m_z.resize( n );
+		m_p.resize( n );
+		m_q.resize( n );
+		m_t.resize( m_pJ->size1() );
+
+		T bNorm2( 0 );
+		T rz( 0 );
+		for ( std::size_t c( 0 ); c < n; c++ )
+		{
+			m_r[ c ] = b( c );
+			m_z[ c ] = m_invDiagonal[ c ] * m_r[ c ];
+			m_p[ c ] = m_z[ c ];
+			bNorm2 += m_r[ c ] * m_r[ c ];
+			rz += m_r[ c ] * m_z[ c ];
+		}
+
+		const T stop2( m_tolerance * m_tolerance * bNorm2 );
+		T rNorm2( bNorm2 );
+		for ( m_iterations = 0; m_iterations < maxIterations && rNorm2 > stop2; m_iterations++ )
+		{
+			// q = ( J^T J + lambda I ) p
+			VectorRef< std::vector< T > > p( m_p ), t( m_t ), q( m_q );
+			m_pJ->multiply( p, t );
+			m_pJ->multiplyTransposed( t, q );
+			T pq( 0 );
+			for ( std::size_t c( 0 ); c < n; c++ )
+			{
+				m_q[ c ] += m_lambda * m_p[ c ];
+				pq += m_p[ c ] * m_q[ c ];
+			}
+			if ( !( pq > 0 ) )
+				break;
+
+			const T alpha( rz / pq );
+			T rzNew( 0 );
+			rNorm2 = 0;
+			for ( std::size_t c( 0 ); c < n; c++ )
+			{
+				m_x[ c ] += alpha * m_p[ c ];
+				m_r[ c ] -= alpha * m_q[ c ];
+				m_z[ c ] = m_invDiagonal[ c ] * m_r[ c ];
+				rzNew += m_r[ c ] * m_z[ c ];
+				rNorm2 += m_r[ c ] * m_r[ c ];
+			}
+
+			const T beta( rzNew / rz );
+			rz = rzNew;
+			for ( std::size_t c( 0 ); c < n; c++ )
+				m_p[ c ] = m_z[ c ] + beta * m_p[ c ];
+		}
+
+		for ( std::size_t c( 0 ); c < n; c++ )
+			b( c ) = m_x[ c ];
+	}
+
+	/** number of iterations of the last solve */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+protected:
+	/** \internal adapts std::vector to the operator() access of CsrMatrix */
+	template< class V >
+	struct VectorRef
+	{
+		VectorRef( V& v )
+			: m_v( v )
+		{}
+
+		typename V::reference operator()( std::size_t i )
+		{ return m_v[ i ]; }
+
+		typename V::const_reference operator()( std::size_t i ) const
+		{ return m_v[ i ]; }
+
+		V& m_v;
+	};
+
+	std::size_t m_maxIterations;
+	T m_tolerance;
+
+	const CsrMatrix< T >* m_pJ;
+	T m_lambda;
+	std::vector< T > m_invDiagonal;
+
+	mutable std::size_t m_iterations;
+	mutable std::vector< T > m_x;
+	mutable std::vector< T > m_r;
+	mutable std::vector< T > m_z;
+	mutable std::vector< T > m_p;
+	mutable std::vector< T > m_q;
+	mutable std::vector< T > m_t;
+};
+
+} } // namespace Ubitrack::Math
+
+#endif
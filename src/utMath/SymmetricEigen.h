@@ -0,0 +1,273 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Eigen decomposition of small symmetric matrices.
+ *
+ * Householder tridiagonalization followed by the implicit QL algorithm
+ * (EISPACK tred2/tql2) on fixed-size arrays. For the small systems that appear
+ * in minimal solvers and closed-form estimators (4x4 to 12x12) this is
+ * considerably faster than calling LAPACK and does not allocate memory.
+ */
+
+#ifndef __UBITRACK_MATH_SYMMETRICEIGEN_H_INCLUDED__
+#define __UBITRACK_MATH_SYMMETRICEIGEN_H_INCLUDED__
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+
+namespace Ubitrack { namespace Math {
+/**
+ * @ingroup math
+ * Computes eigenvalues and eigenvectors of a symmetric matrix.
+ *
+ * @tparam T floating point type
+ * @tparam N size of the matrix
+ * @param A the symmetric matrix, row-major. Only the upper triangle is read.
+ * @param eigenvalues receives the eigenvalues in ascending order
+ * @param V receives the corresponding normalized eigenvectors as columns, i.e. \c V[i][k] is
+ *   component \c i of eigenvector \c k
+ * @param nMaxIterations maximum number of QL iterations per eigenvalue
+ * @return false if the iteration did not converge
+ */
+template< typename T, std::size_t N >
+bool symmetricEigen( const T ( &A )[ N ][ N ], T ( &eigenvalues )[ N ], T ( &V )[ N ][ N ], unsigned nMaxIterations = 30 )
+{
+	T* d = eigenvalues;
+	T e[ N ];
+	const int n = static_cast< int >( N );
+
+	for ( int i = 0; i < n; i++ )
+		for ( int j = 0; j < n; j++ )
+			V[ i ][ j ] = j >= i ? A[ i ][ j ] : A[ j ][ i ];
+
+	// Householder reduction to tridiagonal form
+	for ( int j = 0; j < n; j++ )
+		d[ j ] = V[ n - 1 ][ j ];
+
+	for ( int i = n - 1; i > 0; i-- )
+	{
+		T scale = 0;
+		T h = 0;
+		for ( int k = 0; k < i; k++ )
+			scale += std::fabs( d[ k ] );
+
+		if ( scale == 0 )
+		{
+			e[ i ] = d[ i - 1 ];
+			for ( int j = 0; j < i; j++ )
+			{
+				d[ j ] = V[ i - 1 ][ j ];
+				V[ i ][ j ] = 0;
+				V[ j ][ i ] = 0;
+			}
+		}
+		else
+		{
+			for ( int k = 0; k < i; k++ )
+			{
+				d[ k ] /= scale;
+				h += d[ k ] * d[ k ];
+			}
+			T f = d[ i - 1 ];
+			T g = std::sqrt( h );
+			if ( f > 0 )
+				g = -g;
+			e[ i ] = scale * g;
+			h -= f * g;
+			d[ i - 1 ] = f - g;
+			for ( int j = 0; j < i; j++ )
+				e[ j ] = 0;
+
+			// apply similarity transformation to remaining columns
+			for ( int j = 0; j < i; j++ )
+			{
+				f = d[ j ];
+				V[ j ][ i ] = f;
+				g = e[ j ] + V[ j ][ j ] * f;
+				for ( int k = j + 1; k < i; k++ )
+				{
+					g += V[ k ][ j ] * d[ k ];
+					e[ k ] += V[ k ][ j ] * f;
+				}
+				e[ j ] = g;
+			}
+			f = 0;
+			for ( int j = 0; j < i; j++ )
+			{
+				e[ j ] /= h;
+				f += e[ j ] * d[ j ];
+			}
+			const T hh = f / ( h + h );
+			for ( int j = 0; j < i; j++ )
+				e[ j ] -= hh * d[ j ];
+			for ( int j = 0; j < i; j++ )
+			{
+				f = d[ j ];
+				g = e[ j ];
+				for ( int k = j; k < i; k++ )
+					V[ k ][ j ] -= ( f * e[ k ] + g * d[ k ] );
+				d[ j ] = V[ i - 1 ][ j ];
+				V[ i ][ j ] = 0;
+			}
+		}
+		d[ i ] = h;
+	}
+
+	// accumulate transformations
+	for ( int i = 0; i < n - 1; i++ )
+	{
+		V[ n - 1 ][ i ] = V[ i ][ i ];
+		V[ i ][ i ] = 1;
+		const T h = d[ i + 1 ];
+		if ( h != 0 )
+		{
+			for ( int k = 0; k <= i; k++ )
+				d[ k ] = V[ k ][ i + 1 ] / h;
+			for ( int j = 0; j <= i; j++ )
+			{
+				T g = 0;
+				for ( int k = 0; k <= i; k++ )
+					g += V[ k ][ i + 1 ] * V[ k ][ j ];
+				for ( int k = 0; k <= i; k++ )
+					V[ k ][ j ] -= g * d[ k ];
+			}
+		}
+		for ( int k = 0; k <= i; k++ )
+			V[ k ][ i + 1 ] = 0;
+	}
+	for ( int j = 0; j < n; j++ )
+	{
+		d[ j ] = V[ n - 1 ][ j ];
+		V[ n - 1 ][ j ] = 0;
+	}
+	V[ n - 1 ][ n - 1 ] = 1;
+	e[ 0 ] = 0;
+
+	// implicit QL on the tridiagonal matrix
+	for ( int i = 1; i < n; i++ )
+		e[ i - 1 ] = e[ i ];
+	e[ n - 1 ] = 0;
+
+	bool bConverged = true;
+	T f = 0;
+	T tst1 = 0;
+	const T eps = std::numeric_limits< T >::epsilon();
+	for ( int l = 0; l < n; l++ )
+	{
+		// find small subdiagonal element
+		tst1 = std::max( tst1, std::fabs( d[ l ] ) + std::fabs( e[ l ] ) );
+		int m = l;
+		while ( m < n - 1 && std::fabs( e[ m ] ) > eps * tst1 )
+			m++;
+
+		if ( m > l )
+		{
+			unsigned iter = 0;
+			do
+			{
+				if ( ++iter > nMaxIterations )
+				{
+					bConverged = false;
+					break;
+				}
+
+				// compute implicit shift
+				T g = d[ l ];
+				T p = ( d[ l + 1 ] - g ) / ( 2 * e[ l ] );
+				T r = std::sqrt( p * p + 1 );
+				if ( p < 0 )
+					r = -r;
+				d[ l ] = e[ l ] / ( p + r );
+				d[ l + 1 ] = e[ l ] * ( p + r );
+				const T dl1 = d[ l + 1 ];
+				T h = g - d[ l ];
+				for ( int i = l + 2; i < n; i++ )
+					d[ i ] -= h;
+				f += h;
+
+				// implicit QL transformation
+				p = d[ m ];
+				T c = 1;
+				T c2 = c;
+				T c3 = c;
+				const T el1 = e[ l + 1 ];
+				T s = 0;
+				T s2 = 0;
+				for ( int i = m - 1; i >= l; i-- )
+				{
+					c3 = c2;
+					c2 = c;
+					s2 = s;
+					g = c * e[ i ];
+					h = c * p;
+					r = std::sqrt( p * p + e[ i ] * e[ i ] );
+					e[ i + 1 ] = s * r;
+					s = e[ i ] / r;
+					c = p / r;
+					p = c * d[ i ] - s * g;
+					d[ i + 1 ] = h + s * ( c * g + s * d[ i ] );
+
+					for ( int k = 0; k < n; k++ )
+					{
+						h = V[ k ][ i + 1 ];
+						V[ k ][ i + 1 ] = s * V[ k ][ i ] + c * h;
+						V[ k ][ i ] = c * V[ k ][ i ] - s * h;
+					}
+				}
+				p = -s * s2 * c3 * el1 * e[ l ] / dl1;
+				e[ l ] = s * p;
+				d[ l ] = c * p;
+			}
+			while ( std::fabs( e[ l ] ) > eps * tst1 );
+		}
+		d[ l ] += f;
+		e[ l ] = 0;
+	}
+
+	// sort ascending
+	for ( int i = 0; i < n - 1; i++ )
+	{
+		int iMin = i;
+		for ( int j = i + 1; j < n; j++ )
+			if ( d[ j ] < d[ iMin ] )
+				iMin = j;
+		if ( iMin != i )
+		{
+			std::swap( d[ i ], d[ iMin ] );
+			for ( int k = 0; k < n; k++ )
+				std::swap( V[ k ][ i ], V[ k ][ iMin ] );
+		}
+	}
+
+	return bConverged;
+}
+
+
+} } // namespace Ubitrack::Math
+
+#endif
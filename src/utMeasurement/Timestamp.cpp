@@ -31,7 +31,7 @@
 	#include <utUtil/OS.h>
 	#include "TimestampSync.h"
 
-	#include <log4cpp/Category.hh>
+	#include <utUtil/LogMacros.h>
 	static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Measurement.Timestamp" ) );
 
 #else
@@ -76,7 +76,7 @@ Timestamp now()
 			if ( hpcFreq != lastHpcFreq )
 			{
 				bUseHpc = false;
-				LOG4CPP_WARN( logger, "Your CPU frequency is not constant (power save mode?). Timestamps will be unprecise." );
+				UBITRACK_LOG_WARN( logger, "Your CPU frequency is not constant (power save mode?). Timestamps will be unprecise." );
 				return rtc;
 			}
 			else
@@ -0,0 +1,167 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file implementation of the convex hull timestamp synchronization
+ */
+
+#include "TimestampSyncHull.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace Ubitrack { namespace Measurement {
+
+TimestampSyncHull::TimestampSyncHull( double approxNativeFreq, std::size_t windowSize, double approxLocalFreq )
+	: m_windowSize( std::max( windowSize, std::size_t( 4 ) ) )
+	, m_nominalGain( approxLocalFreq / approxNativeFreq )
+	, m_events( 0 )
+{
+	m_points.reserve( m_windowSize );
+	m_hull.reserve( m_windowSize );
+	reset();
+}
+
+
+void TimestampSyncHull::reset()
+{
+	m_points.clear();
+	m_hull.clear();
+	m_sumNative = 0.0;
+	m_firstNative = 0.0;
+	m_firstLocal = 0;
+	m_lastNative = 0.0;
+	m_gain = m_nominalGain;
+	m_offset = 0.0;
+	m_avgDelay = 0.0;
+	m_avgDelaySquare = 0.0;
+}
+
+
+Timestamp TimestampSyncHull::convertNativeToLocal( double native, Timestamp local )
+{
+	if ( m_points.empty() || native < m_lastNative )
+	{
+		// first sample or native clock reset
+		reset();
+		m_firstNative = native;
+		m_firstLocal = local;
+	}
+	else if ( native == m_lastNative )
+	{
+		// no new information on the clock relation
+		m_events++;
+		return std::min( local, mapNativeToLocal( native ) );
+	}
+
+	m_events++;
+	m_lastNative = native;
+
+	Point p;
+	p.native = native - m_firstNative;
+	p.local = static_cast< double >( static_cast< long long >( local - m_firstLocal ) );
+
+	if ( m_points.size() == m_windowSize )
+		rebuild();
+
+	m_points.push_back( p );
+	m_sumNative += p.native;
+	extendHull( m_points.size() - 1 );
+
+	if ( m_points.size() > 1 )
+		updateLine();
+	else
+		m_offset = p.local - m_gain * p.native;
+
+	// delay of the new sample above the line, averaged over approximately the window length
+	double fDelay = p.local - ( m_offset + m_gain * p.native );
+	double fWeight = 1.0 / m_points.size();
+	m_avgDelay += ( fDelay - m_avgDelay ) * fWeight;
+	m_avgDelaySquare += ( fDelay * fDelay - m_avgDelaySquare ) * fWeight;
+
+	return mapNativeToLocal( native );
+}
+
+
+double TimestampSyncHull::getJitter() const
+{
+	return std::sqrt( std::max( 0.0, m_avgDelaySquare - m_avgDelay * m_avgDelay ) );
+}
+
+
+void TimestampSyncHull::extendHull( std::size_t i )
+{
+	// monotone chain: remove vertices that are not below the segment to the new point
+	const Point& p( m_points[ i ] );
+	while ( m_hull.size() >= 2 )
+	{
+		const Point& a( m_points[ m_hull[ m_hull.size() - 2 ] ] );
+		const Point& b( m_points[ m_hull.back() ] );
+		if ( ( b.native - a.native ) * ( p.local - a.local ) - ( b.local - a.local ) * ( p.native - a.native ) > 0 )
+			break;
+		m_hull.pop_back();
+	}
+	m_hull.push_back( i );
+}
+
+
+void TimestampSyncHull::rebuild()
+{
+	std::size_t nKeep = m_windowSize / 2;
+	std::copy( m_points.end() - nKeep, m_points.end(), m_points.begin() );
+	m_points.resize( nKeep );
+
+	m_hull.clear();
+	m_sumNative = 0.0;
+	for ( std::size_t i = 0; i < nKeep; i++ )
+	{
+		m_sumNative += m_points[ i ].native;
+		extendHull( i );
+	}
+}
+
+
+void TimestampSyncHull::updateLine()
+{
+	// find the hull edge above the mean native time
+	double fMean = m_sumNative / m_points.size();
+	std::size_t lo = 0;
+	std::size_t hi = m_hull.size() - 1;
+	while ( hi - lo > 1 )
+	{
+		std::size_t mid = ( lo + hi ) / 2;
+		if ( m_points[ m_hull[ mid ] ].native <= fMean )
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	const Point& a( m_points[ m_hull[ lo ] ] );
+	const Point& b( m_points[ m_hull[ hi ] ] );
+	m_gain = ( b.local - a.local ) / ( b.native - a.native );
+	m_offset = a.local - m_gain * a.native;
+}
+
+}}
@@ -0,0 +1,166 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Clock synchronization using a sliding-window lower convex hull
+ */
+
+
+#ifndef _Ubitrack_Measurement_TimestampSyncHull_INCLUDED_
+#define _Ubitrack_Measurement_TimestampSyncHull_INCLUDED_
+
+#include <cmath>
+#include <vector>
+#include <utCore.h>
+#include <utMeasurement/Timestamp.h>
+
+namespace Ubitrack { namespace Measurement {
+
+/**
+ * Class that maps a sensor's native clock to the local clock, like TimestampSync and TimestampSyncLS.
+ *
+ * The local timestamp of a sample is its native time plus a transmission delay that is never
+ * negative, but can have large positive outliers. Instead of averaging, the mapping is therefore
+ * estimated as the line below all (native, local) pairs of a sliding window that minimizes the sum
+ * of the delays. This line is the edge of the lower convex hull of the samples that lies above the
+ * mean native time of the window.
+ *
+ * The window holds between \c windowSize/2 and \c windowSize samples. New samples are added to the
+ * hull in amortized constant time, and the hull is rebuilt from the newest \c windowSize/2 samples
+ * when the window is full, so the cost per sample is O(1) amortized and no memory is allocated
+ * after construction.
+ *
+ * Converted timestamps are never later than the local timestamps they were measured with.
+ * A native clock that jumps backwards restarts the estimation.
+ */
+class UBITRACK_EXPORT TimestampSyncHull
+{
+public:
+	/**
+	 * Constructor.
+	 *
+	 * @param approxNativeFreq nominal frequency of the native clock, only used for \c getDrift().
+	 * @param windowSize maximum number of samples used for the estimation
+	 * @param approxLocalFreq frequency of the local clock
+	 */
+	TimestampSyncHull( double approxNativeFreq, std::size_t windowSize = 2000, double approxLocalFreq = 1e9 );
+
+	/**
+	 * Add a sensor timestamp and relate it to the current system clock.
+	 *
+	 * @param native native sensor clock value
+	 * @return the sensor time converted to a local time
+	 */
+	Timestamp convertNativeToLocal( double native )
+	{
+		return convertNativeToLocal( native, now() );
+	}
+
+	/**
+	 * Add a sensor timestamp and relate it to the system clock at an arbitrary time.
+	 *
+	 * @param native native sensor clock value
+	 * @param local corresponding system clock value
+	 * @return the sensor time converted to a local time
+	 */
+	Timestamp convertNativeToLocal( double native, Timestamp local );
+
+	/** Converts a native time using the current estimate without adding a sample. */
+	Timestamp mapNativeToLocal( double native ) const
+	{ return m_firstLocal + static_cast< long long >( std::floor( m_offset + m_gain * ( native - m_firstNative ) ) ); }
+
+	/** discards all samples */
+	void reset();
+
+	/** returns the number of timestamps processed */
+	unsigned getEventCount() const
+	{ return m_events; }
+
+	/** returns the number of samples in the current window */
+	std::size_t getWindowFill() const
+	{ return m_points.size(); }
+
+	/** returns the estimated local clock ticks per native clock tick */
+	double getGain() const
+	{ return m_gain; }
+
+	/** returns the relative deviation of the native clock rate from its nominal frequency (e.g. 1e-5 = 10 ppm) */
+	double getDrift() const
+	{ return m_nominalGain / m_gain - 1.0; }
+
+	/** returns the average delay of the samples above the estimated line, in local clock ticks */
+	double getLatency() const
+	{ return m_avgDelay; }
+
+	/** returns the standard deviation of the delay, in local clock ticks */
+	double getJitter() const;
+
+protected:
+	/** a sample, relative to the first one */
+	struct Point
+	{
+		double native;
+		double local;
+	};
+
+	/** adds the point with the given index to the hull */
+	void extendHull( std::size_t i );
+
+	/** rebuilds the hull from the newest half of the window */
+	void rebuild();
+
+	/** computes gain and offset from the hull */
+	void updateLine();
+
+	std::size_t m_windowSize;
+	double m_nominalGain;
+
+	unsigned m_events;
+	double m_firstNative;
+	Timestamp m_firstLocal;
+	double m_lastNative;
+
+	/** samples in the window, oldest first */
+	std::vector< Point > m_points;
+
+	/** indices of the lower hull vertices, ordered by native time */
+	std::vector< std::size_t > m_hull;
+
+	/** sum of the native times in the window */
+	double m_sumNative;
+
+	// current estimate: local = m_offset + m_gain * native
+	double m_gain;
+	double m_offset;
+
+	// delay statistics
+	double m_avgDelay;
+	double m_avgDelaySquare;
+};
+
+}}
+
+#endif // _Ubitrack_Measurement_TimestampSyncHull_INCLUDED_
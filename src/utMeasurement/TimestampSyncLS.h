@@ -32,12 +32,12 @@
 #ifndef _Ubitrack_Measurement_TimestampSyncLS_INCLUDED_
 #define _Ubitrack_Measurement_TimestampSyncLS_INCLUDED_
 
-#define DEBUG_TIMESTAMP_SYNC
+//#define DEBUG_TIMESTAMP_SYNC
 
 #ifdef DEBUG_TIMESTAMP_SYNC
 #include <iostream>
 #include <iomanip>
-// #include <cmath>
+#include <cmath>
 #endif
 
 #include <algorithm>
@@ -58,6 +58,7 @@ static const double g_fDeviationWeight = 0.01;
 /**
  * see class TimestampSync.
  * This does the same thing, but using an exponentially weighted recursive least-squares algorithm.
+ * See TimestampSyncHull for a variant with a fixed window that is robust against latency spikes.
  */
 UBITRACK_EXPORT class TimestampSyncLS
 {
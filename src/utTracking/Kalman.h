@@ -44,9 +44,10 @@
 // and #define KALMAN_LOGGING before including this header 
 #ifdef KALMAN_LOGGING
 	#include <boost/numeric/ublas/io.hpp>
-	#define KALMAN_LOG_TRACE( message ) LOG4CPP_TRACE( logger, message )
-	#define KALMAN_LOG_DEBUG( message ) LOG4CPP_DEBUG( logger, message )
-	#define KALMAN_LOG_NOTICE( message ) LOG4CPP_NOTICE( logger, message )
+	#include <utUtil/LogMacros.h>
+	#define KALMAN_LOG_TRACE( message ) UBITRACK_LOG_TRACE( logger, message )
+	#define KALMAN_LOG_DEBUG( message ) UBITRACK_LOG_DEBUG( logger, message )
+	#define KALMAN_LOG_NOTICE( message ) UBITRACK_LOG_NOTICE( logger, message )
 #else
 	#define KALMAN_LOG_TRACE( message ) 
 	#define KALMAN_LOG_DEBUG( message ) 
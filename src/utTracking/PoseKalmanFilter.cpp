@@ -41,7 +41,7 @@
 #include "Function/InvertRotationVelocity.h"
 
 // get a logger
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Tracking.PoseKalmanFilter" ) );
 
 #define KALMAN_LOGGING
@@ -113,7 +113,7 @@ void PoseKalmanFilter::addPoseMeasurement( const Measurement::ErrorPose& m )
 	// create measurement as ErrorVector
 	Math::ErrorVector< double, 7 > v;
 	m->toAdditiveErrorVector( v );
-	LOG4CPP_TRACE( logger, "Additive covariance: " << v.covariance );
+	UBITRACK_LOG_TRACE( logger, "Additive covariance: " << v.covariance );
 	
 	// negate quaternion
 	if ( ublas::inner_prod( rotSubState, ublas::subrange( v.value, 3, 7 ) ) < 0 )
@@ -216,7 +216,7 @@ void PoseKalmanFilter::timeUpdate( Measurement::Timestamp t )
 	
 	// update state
 	double dt = ( (long long int)( t - m_time ) ) * 1e-9;
-	LOG4CPP_DEBUG( logger, "Time update to t = " << t << ", dt = " << dt );
+	UBITRACK_LOG_DEBUG( logger, "Time update to t = " << t << ", dt = " << dt );
 	if ( m_bInsideOut )
 		Math::transformWithCovariance( 
 			Function::InsideOutPoseTimeUpdate( dt, m_motionModel.posOrder() ), 
@@ -248,7 +248,7 @@ void PoseKalmanFilter::normalize()
 		// check if rotation velocity is too big and reset it in this case
 		if ( ublas::norm_2( ublas::subrange( m_state, iR + 4, iR + 7 ) ) > 10.0 )
 		{
-			LOG4CPP_NOTICE( logger, "Kalman Filter orientation instability detected. Resetting orientation derivatives." );
+			UBITRACK_LOG_NOTICE( logger, "Kalman Filter orientation instability detected. Resetting orientation derivatives." );
 			ublas::subrange( m_state, iR + 4, m_state.size() ) = Math::Vector< double >::zeros( 3 * m_motionModel.oriOrder() );
 		}
 	}
@@ -257,7 +257,7 @@ void PoseKalmanFilter::normalize()
 /* 	if ( m_motionModel.posOrder() >= 0 )
 		if ( fabs( m_state( 0 ) ) > 1e3 || fabs( m_state( 1 ) ) > 1e3 || fabs( m_state( 2 ) ) > 1e3 )
 		{
-			LOG4CPP_NOTICE( logger, "Kalman Filter position instability detected. Resetting." );
+			UBITRACK_LOG_NOTICE( logger, "Kalman Filter position instability detected. Resetting." );
 			m_state = Math::Vector< double >::zeros( m_motionModel.stateSize() );
 			m_covariance = Math::Matrix< double, 0, 0 >::identity( m_motionModel.stateSize() );
 			m_time = 0;
@@ -276,7 +276,7 @@ Measurement::ErrorPose PoseKalmanFilter::predictPose( Measurement::Timestamp t )
 	const int iR = 3 * ( m_motionModel.posOrder() + 1 );
 
 	double dt = ( (long long int)( t - m_time ) ) * 1e-9;
-	LOG4CPP_DEBUG( logger, "predicting for t=" << t << ", dt=" << dt );
+	UBITRACK_LOG_DEBUG( logger, "predicting for t=" << t << ", dt=" << dt );
 
 	// update state
 	Math::Vector< double > newState( m_state.size() );
@@ -292,7 +292,7 @@ Measurement::ErrorPose PoseKalmanFilter::predictPose( Measurement::Timestamp t )
 	
 	// add process noise
 	m_motionModel.addNoise( newCovariance, dt );
-	LOG4CPP_TRACE( logger, "predicted state:" << newState );
+	UBITRACK_LOG_TRACE( logger, "predicted state:" << newState );
 	
 	// convert to 7x7 error
 	Math::ErrorVector< double, 7 > newPose;
@@ -303,7 +303,7 @@ Measurement::ErrorPose PoseKalmanFilter::predictPose( Measurement::Timestamp t )
 	ublas::subrange( newPose.covariance, 3, 7, 0, 3 ) = ublas::subrange( newCovariance, iR, iR + 4, 0, 3 );
 	ublas::subrange( newPose.covariance, 3, 7, 3, 7 ) = ublas::subrange( newCovariance, iR, iR + 4, iR, iR + 4 );
 	
-	LOG4CPP_DEBUG( logger, "predicted pose and covariance: " << newPose.value << std::endl << newPose.covariance );
+	UBITRACK_LOG_DEBUG( logger, "predicted pose and covariance: " << newPose.value << std::endl << newPose.covariance );
 	return Measurement::ErrorPose( t, Math::ErrorPose::fromAdditiveErrorVector( newPose ) );
 }
 
@@ -0,0 +1,344 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Implements the asynchronous log4cpp appender
+ */
+
+#include "AsyncLogAppender.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4290 )
+#endif
+
+#include <log4cpp/LoggingEvent.hh>
+#include <log4cpp/TimeStamp.hh>
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#include <sstream>
+#include <algorithm>
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+// longest sleep of the idle writer thread, bounds the output delay
+const long g_maxIdleSleepMicroseconds = 5000;
+
+/** counts a thread as active producer during its lifetime */
+class ActiveProducer
+{
+public:
+	ActiveProducer( boost::atomic< std::size_t >& count )
+		: m_count( count )
+	{ m_count.fetch_add( 1, boost::memory_order_seq_cst ); }
+
+	~ActiveProducer()
+	{ m_count.fetch_sub( 1, boost::memory_order_release ); }
+
+protected:
+	boost::atomic< std::size_t >& m_count;
+};
+
+} // anonymous namespace
+
+AsyncLogAppender::AsyncLogAppender( const std::string& name, log4cpp::Appender* pTarget, bool bOwnTarget,
+	std::size_t nQueueSize, OverflowPolicy policy, std::size_t nMessageSize )
+	: log4cpp::AppenderSkeleton( name )
+	, m_pTarget( pTarget )
+	, m_bOwnTarget( bOwnTarget )
+	, m_policy( policy )
+	, m_enqueuePos( 0 )
+	, m_dequeuePos( 0 )
+	, m_dropped( 0 )
+	, m_droppedReported( 0 )
+	, m_running( false )
+	, m_activeProducers( 0 )
+	, m_stop( false )
+{
+	std::size_t n = 2;
+	while ( n < nQueueSize )
+		n <<= 1;
+	m_mask = n - 1;
+
+	m_slots.reset( new Slot[ n ] );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		m_slots[ i ].sequence.store( i, boost::memory_order_relaxed );
+		m_slots[ i ].categoryName.reserve( 64 );
+		m_slots[ i ].message.reserve( nMessageSize );
+		m_slots[ i ].ndc.reserve( 32 );
+		m_slots[ i ].file.reserve( 128 );
+		m_slots[ i ].threadName.reserve( 32 );
+	}
+
+	start();
+}
+
+
+AsyncLogAppender::~AsyncLogAppender()
+{
+	stop();
+	if ( m_bOwnTarget )
+		delete m_pTarget;
+}
+
+
+void AsyncLogAppender::close()
+{
+	stop();
+	boost::recursive_mutex::scoped_lock lock( m_targetMutex );
+	m_pTarget->close();
+}
+
+
+bool AsyncLogAppender::reopen()
+{
+	bool bResult;
+	{
+		boost::recursive_mutex::scoped_lock lock( m_targetMutex );
+		bResult = m_pTarget->reopen();
+	}
+	start();
+	return bResult;
+}
+
+
+bool AsyncLogAppender::requiresLayout() const
+{
+	return false;
+}
+
+
+void AsyncLogAppender::setLayout( log4cpp::Layout* layout )
+{
+	boost::recursive_mutex::scoped_lock lock( m_targetMutex );
+	m_pTarget->setLayout( layout );
+}
+
+
+void AsyncLogAppender::flush()
+{
+	std::size_t target = m_enqueuePos.load( boost::memory_order_acquire );
+	while ( m_running.load( boost::memory_order_acquire ) &&
+		static_cast< std::ptrdiff_t >( target - m_dequeuePos.load( boost::memory_order_acquire ) ) > 0 )
+		boost::this_thread::sleep( boost::posix_time::microseconds( 100 ) );
+}
+
+
+void AsyncLogAppender::_append( const log4cpp::LoggingEvent& event )
+{
+	// events that cannot be queued are written synchronously, without being counted as producer
+	if ( !push( event ) )
+		appendToTarget( event );
+}
+
+
+bool AsyncLogAppender::push( const log4cpp::LoggingEvent& event )
+{
+	// stop() clears m_running and then waits only for the producers counted here. None of them
+	// writes to the target, so they leave quickly and later ones see m_running cleared. Their
+	// slots are published before the final drain() and m_writerId stays valid while they use it.
+	ActiveProducer producer( m_activeProducers );
+	if ( !m_running.load( boost::memory_order_seq_cst ) )
+		return false;
+
+	if ( enqueue( event ) )
+		return true;
+
+	if ( m_policy == OVERFLOW_BLOCK )
+	{
+		// the writer thread must not wait for itself
+		if ( boost::this_thread::get_id() == m_writerId )
+			return false;
+
+		do
+		{
+			boost::this_thread::yield();
+			if ( !m_running.load( boost::memory_order_seq_cst ) )
+				return false;
+		}
+		while ( !enqueue( event ) );
+		return true;
+	}
+
+	m_dropped.fetch_add( 1, boost::memory_order_relaxed );
+	return true;
+}
+
+
+bool AsyncLogAppender::enqueue( const log4cpp::LoggingEvent& event )
+{
+	// bounded MPMC queue after D. Vyukov, used with a single consumer
+	std::size_t pos = m_enqueuePos.load( boost::memory_order_relaxed );
+	Slot* pSlot;
+	while ( true )
+	{
+		pSlot = &m_slots[ pos & m_mask ];
+		std::size_t seq = pSlot->sequence.load( boost::memory_order_acquire );
+		std::ptrdiff_t diff = static_cast< std::ptrdiff_t >( seq - pos );
+		if ( diff == 0 )
+		{
+			if ( m_enqueuePos.compare_exchange_weak( pos, pos + 1, boost::memory_order_relaxed ) )
+				break;
+		}
+		else if ( diff < 0 )
+			return false;
+		else
+			pos = m_enqueuePos.load( boost::memory_order_relaxed );
+	}
+
+	// assign() reuses the preallocated capacity
+	pSlot->categoryName.assign( event.categoryName.data(), event.categoryName.size() );
+	pSlot->message.assign( event.message.data(), event.message.size() );
+	pSlot->ndc.assign( event.ndc.data(), event.ndc.size() );
+	pSlot->file.assign( event.file.data(), event.file.size() );
+	pSlot->threadName.assign( event.threadName.data(), event.threadName.size() );
+	pSlot->priority = event.priority;
+	pSlot->line = event.line;
+	pSlot->seconds = event.timeStamp.getSeconds();
+	pSlot->microSeconds = event.timeStamp.getMicroSeconds();
+
+	pSlot->sequence.store( pos + 1, boost::memory_order_release );
+	return true;
+}
+
+
+std::size_t AsyncLogAppender::drain()
+{
+	std::size_t nWritten = 0;
+	std::size_t pos = m_dequeuePos.load( boost::memory_order_relaxed );
+	while ( true )
+	{
+		Slot& slot = m_slots[ pos & m_mask ];
+		if ( slot.sequence.load( boost::memory_order_acquire ) != pos + 1 )
+			break;
+
+		try
+		{
+			log4cpp::LoggingEvent event( slot.categoryName, slot.message, slot.ndc, slot.priority,
+				slot.file.c_str(), slot.line, slot.threadName, log4cpp::TimeStamp( slot.seconds, slot.microSeconds ) );
+			appendToTarget( event );
+		}
+		catch ( ... )
+		{} // never let the writer thread die
+
+		slot.sequence.store( pos + m_mask + 1, boost::memory_order_release );
+		pos++;
+		m_dequeuePos.store( pos, boost::memory_order_release );
+		nWritten++;
+	}
+
+	if ( m_policy == OVERFLOW_COUNT )
+	{
+		unsigned long long nDropped = m_dropped.load( boost::memory_order_relaxed );
+		if ( nDropped != m_droppedReported )
+		{
+			std::ostringstream s;
+			s << ( nDropped - m_droppedReported ) << " log events dropped by " << getName() << " (queue full)";
+			m_droppedReported = nDropped;
+
+			try
+			{
+				log4cpp::LoggingEvent event( getName(), s.str(), "", log4cpp::Priority::WARN );
+				appendToTarget( event );
+			}
+			catch ( ... )
+			{}
+		}
+	}
+
+	return nWritten;
+}
+
+
+void AsyncLogAppender::appendToTarget( const log4cpp::LoggingEvent& event )
+{
+	boost::recursive_mutex::scoped_lock lock( m_targetMutex );
+	m_pTarget->doAppend( event );
+}
+
+
+void AsyncLogAppender::writerThread()
+{
+	long sleepTime = 0;
+	while ( !m_stop.load( boost::memory_order_acquire ) )
+	{
+		if ( drain() )
+			sleepTime = 0;
+		else
+		{
+			// back off while idle, so producers never need to signal
+			sleepTime = sleepTime ? std::min( 2 * sleepTime, g_maxIdleSleepMicroseconds ) : 50;
+			boost::this_thread::sleep( boost::posix_time::microseconds( sleepTime ) );
+		}
+	}
+}
+
+
+void AsyncLogAppender::start()
+{
+	if ( m_pWriterThread )
+		return;
+
+	m_stop.store( false, boost::memory_order_release );
+	m_pWriterThread.reset( new boost::thread( boost::bind( &AsyncLogAppender::writerThread, this ) ) );
+	m_writerId = m_pWriterThread->get_id();
+
+	// publishes m_writerId to the producers
+	m_running.store( true, boost::memory_order_seq_cst );
+}
+
+
+void AsyncLogAppender::stop()
+{
+	if ( !m_pWriterThread )
+		return;
+
+	// new producers write synchronously from now on
+	m_running.store( false, boost::memory_order_seq_cst );
+
+	// wait for the enqueues in flight, afterwards no slot is claimed but unpublished and no
+	// producer uses m_writerId. Synchronous writers are not counted, so they cannot hold this up.
+	while ( m_activeProducers.load( boost::memory_order_seq_cst ) != 0 )
+		boost::this_thread::yield();
+
+	m_stop.store( true, boost::memory_order_release );
+	m_pWriterThread->join();
+	m_pWriterThread.reset();
+	m_writerId = boost::thread::id();
+
+	// write events queued since the last pass of the writer thread
+	drain();
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,218 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Asynchronous log4cpp appender that moves formatting and output to a background thread
+ */
+
+#ifndef __UBITRACK_UTIL_ASYNCLOGAPPENDER_H_INCLUDED__
+#define __UBITRACK_UTIL_ASYNCLOGAPPENDER_H_INCLUDED__
+
+#include <string>
+#include <cstddef>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/utility.hpp>
+#include <utCore.h>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4290 )
+#endif
+
+#include <log4cpp/AppenderSkeleton.hh>
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * log4cpp appender that forwards events to another appender on a background thread.
+ *
+ * \c doAppend() only copies the event into a preallocated slot of a bounded lock-free
+ * multi-producer/single-consumer queue. Layout formatting and I/O are done by the target
+ * appender on the writer thread, so logging from time-critical threads does not wait for
+ * the output device. Slot strings are preallocated with \c messageSize bytes, longer
+ * messages still cause an allocation.
+ *
+ * Events that arrive when the queue is full are handled according to the overflow policy.
+ * After \c stop() or \c close(), events are passed to the target synchronously. Calls of the
+ * target are serialized, so it is never called by the writer thread and a synchronous
+ * producer at the same time.
+ *
+ * Note that \c log4cpp::Category still serializes calls to its appenders.
+ *
+ * Example:
+ * \code
+ * log4cpp::Appender* file = new log4cpp::FileAppender( "file", "ubitrack.log" );
+ * file->setLayout( new log4cpp::PatternLayout() );
+ * log4cpp::Category::getRoot().addAppender( new AsyncLogAppender( "async", file ) );
+ * \endcode
+ */
+class UBITRACK_EXPORT AsyncLogAppender
+	: public log4cpp::AppenderSkeleton
+	, private boost::noncopyable
+{
+public:
+	/** what to do if the queue is full */
+	enum OverflowPolicy
+	{
+		/** discard the event */
+		OVERFLOW_DROP,
+
+		/** wait until the writer has freed a slot */
+		OVERFLOW_BLOCK,
+
+		/** discard the event and report the number of lost events once the queue has drained */
+		OVERFLOW_COUNT
+	};
+
+	/**
+	 * Creates the appender and starts the writer thread.
+	 * @param name name of the appender
+	 * @param pTarget appender that formats and writes the events
+	 * @param bOwnTarget if true, the target is deleted together with this appender
+	 * @param nQueueSize number of slots, rounded up to a power of two
+	 * @param policy overflow policy
+	 * @param nMessageSize number of characters preallocated per message
+	 */
+	AsyncLogAppender( const std::string& name, log4cpp::Appender* pTarget, bool bOwnTarget = true,
+		std::size_t nQueueSize = 8192, OverflowPolicy policy = OVERFLOW_COUNT, std::size_t nMessageSize = 256 );
+
+	/** flushes the queue, stops the writer thread and deletes the target if owned */
+	virtual ~AsyncLogAppender();
+
+	/** writes all queued events, stops the writer thread and closes the target */
+	virtual void close();
+
+	/** reopens the target and restarts the writer thread if necessary */
+	virtual bool reopen();
+
+	/** the layout is handled by the target appender */
+	virtual bool requiresLayout() const;
+
+	/** passes the layout to the target appender */
+	virtual void setLayout( log4cpp::Layout* layout );
+
+	/** blocks until all events queued so far have been written */
+	void flush();
+
+	/**
+	 * stops the writer thread after writing all queued events. Producers that are adding
+	 * events concurrently finish first, later events are written synchronously.
+	 */
+	void stop();
+
+	/** returns the target appender */
+	log4cpp::Appender* target() const
+	{ return m_pTarget; }
+
+	/** returns the number of events discarded because the queue was full */
+	unsigned long long droppedEvents() const
+	{ return m_dropped.load( boost::memory_order_relaxed ); }
+
+	/** returns the number of slots */
+	std::size_t queueSize() const
+	{ return m_mask + 1; }
+
+protected:
+	/** copies the event into the queue */
+	virtual void _append( const log4cpp::LoggingEvent& event );
+
+	/**
+	 * queues an event or handles it according to the overflow policy
+	 * @return false if the event has to be written synchronously
+	 */
+	bool push( const log4cpp::LoggingEvent& event );
+
+	/** tries to put an event into the queue */
+	bool enqueue( const log4cpp::LoggingEvent& event );
+
+	/** writes all queued events, returns the number written */
+	std::size_t drain();
+
+	/** writer thread main loop */
+	void writerThread();
+
+	/** starts the writer thread */
+	void start();
+
+	/** passes an event to the target, serialized with all other calls of the target */
+	void appendToTarget( const log4cpp::LoggingEvent& event );
+
+	/** queue entry with preallocated strings */
+	struct Slot
+	{
+		boost::atomic< std::size_t > sequence;
+		std::string categoryName;
+		std::string message;
+		std::string ndc;
+		std::string file;
+		std::string threadName;
+		int priority;
+		unsigned line;
+		int seconds;
+		int microSeconds;
+	};
+
+	log4cpp::Appender* m_pTarget;
+	bool m_bOwnTarget;
+	OverflowPolicy m_policy;
+
+	boost::scoped_array< Slot > m_slots;
+	std::size_t m_mask;
+
+	/** next slot to be claimed by a producer */
+	boost::atomic< std::size_t > m_enqueuePos;
+
+	/** next slot to be written by the writer thread */
+	boost::atomic< std::size_t > m_dequeuePos;
+
+	boost::atomic< unsigned long long > m_dropped;
+	unsigned long long m_droppedReported;
+
+	/** true while events are queued, false while they are written synchronously */
+	boost::atomic< bool > m_running;
+
+	/** number of threads in \c push(), \c stop() waits until they have published their events */
+	boost::atomic< std::size_t > m_activeProducers;
+
+	boost::atomic< bool > m_stop;
+	boost::shared_ptr< boost::thread > m_pWriterThread;
+
+	/** id of the writer thread, only valid while \c m_running is true */
+	boost::thread::id m_writerId;
+
+	/** serializes calls of the target, recursive as the target may log itself */
+	boost::recursive_mutex m_targetMutex;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
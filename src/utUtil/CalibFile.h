@@ -41,7 +41,7 @@
 #include <boost/archive/text_oarchive.hpp>
 
 // get a logger
-#include <log4cpp/Category.hh>
+#include <utUtil/LogMacros.h>
 static log4cpp::Category& calibLogger( log4cpp::Category::getInstance( "Ubitrack.Utils.CalibFile" ) );
 
 namespace Ubitrack { namespace Util {
@@ -108,7 +108,7 @@ void readCalibFile( const std::string& sFile, Measurement::Measurement< T >& res
 template< typename T >
 void readCalibFileDropMeasurement( const std::string& sFile, T& result )
 {
-    LOG4CPP_WARN( calibLogger, "Reading calibration files with measurement overhead. Consider using files without timestamp!" );
+    UBITRACK_LOG_WARN( calibLogger, "Reading calibration files with measurement overhead. Consider using files without timestamp!" );
 	// initialize measurement
 	Measurement::Measurement< T > interResult ( 0, boost::shared_ptr< T >( new T() ) );
 
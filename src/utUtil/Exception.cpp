@@ -29,7 +29,7 @@
  */ 
  
 #include "Exception.h"
-#include <log4cpp/Category.hh>
+#include "LogMacros.h"
  
 static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Util.Exception" ) );
 
@@ -41,7 +41,7 @@ Exception::Exception( const std::string& sMessage, unsigned nLine, const char* s
 	, m_nLine( nLine )
 	, m_sFile( sFile ? sFile : "" )
 {
-	LOG4CPP_DEBUG( logger, "Exception thrown in " << sFile << ":" << nLine << ", message: " << sMessage );
+	UBITRACK_LOG_DEBUG( logger, "Exception thrown in " << sFile << ":" << nLine << ", message: " << sMessage );
 }
 
 /* bug fix/workaround for a problem with VS2005 which has problems when the exception class is
@@ -53,7 +53,7 @@ Exception::~Exception() throw()
 
 std::ostream& operator<<( std::ostream& o, const Exception& e )
 {
-	LOG4CPP_TRACE( logger, "Exception \"" << e.what() << "\" from " << e.file() << ":" << e.line() );
+	UBITRACK_LOG_TRACE( logger, "Exception \"" << e.what() << "\" from " << e.file() << ":" << e.line() );
 
 	o << "Exception \"" << e.what() << "\" from " << e.file() << ":" << e.line();
 	return o;
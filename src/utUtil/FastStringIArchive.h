@@ -0,0 +1,189 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Allocation-free conversion of very simple structures from strings.
+ * Provides an archive class for boost::serialization that reads the format
+ * written by \c SimpleStringOArchive and \c FastStringOArchive.
+ */
+ 
+#ifndef __UBITRACK_UTIL_FASTSTRINGIARCHIVE_H_INCLUDED__
+#define __UBITRACK_UTIL_FASTSTRINGIARCHIVE_H_INCLUDED__
+
+#include <string>
+#include <cstring>
+#include <boost/version.hpp>
+#include <boost/serialization/serialization.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/serialization/nvp.hpp>
+#if BOOST_VERSION >= 103500
+#include <boost/serialization/collection_size_type.hpp>
+#endif
+#if BOOST_VERSION >= 104400
+#include <boost/serialization/item_version_type.hpp>
+#endif
+#include <utUtil/Exception.h>
+#include <utUtil/NumberConversion.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Reading very simple structures from a character buffer.
+ * Provides an archive class for boost::serialization.
+ *
+ * Drop-in replacement for \c SimpleStringIArchive that parses the text in place with a
+ * locale-independent scanner instead of copying it into a \c std::istringstream.
+ * The text is not copied and must stay valid for the lifetime of the archive.
+ */
+class FastStringIArchive
+{
+public:
+	/** construct archive from a string, which is referenced, not copied */
+	FastStringIArchive( const std::string& s )
+		: m_pos( s.data() )
+		, m_end( s.data() + s.size() )
+	{}
+
+	/** construct archive from a character range */
+	FastStringIArchive( const char* data, std::size_t size )
+		: m_pos( data )
+		, m_end( data + size )
+	{}
+
+	/** construct archive from a zero-terminated string */
+	explicit FastStringIArchive( const char* data )
+		: m_pos( data )
+		, m_end( data + std::strlen( data ) )
+	{}
+
+	/** the remaining, not yet consumed text */
+	const char* position() const
+	{ return m_pos; }
+
+protected:
+	/** pre-read operations: skip whitespace and check for end of input */
+	void pre()
+	{
+		while ( m_pos != m_end && ( *m_pos == ' ' || ( *m_pos >= '\t' && *m_pos <= '\r' ) ) )
+			++m_pos;
+		if ( m_pos == m_end )
+			UBITRACK_THROW( "Stream read failure" );
+	}
+	
+	/** post-read operations */
+	void post( bool bSuccess )
+	{
+		if ( !bSuccess )
+			UBITRACK_THROW( "Stream read failure" );
+	}
+
+	/** reads a signed integer and checks its range */
+	template< class T >
+	void readSigned( T& v, long long minValue, long long maxValue )
+	{
+		long long r;
+		pre(); post( parseSigned( m_pos, m_end, r ) && r >= minValue && r <= maxValue );
+		v = static_cast< T >( r );
+	}
+
+	/** reads an unsigned integer and checks its range */
+	template< class T >
+	void readUnsigned( T& v, unsigned long long maxValue )
+	{
+		unsigned long long r;
+		pre(); post( parseUnsigned( m_pos, m_end, r ) && r <= maxValue );
+		v = static_cast< T >( r );
+	}
+
+	/** current read position */
+	const char* m_pos;
+
+	/** end of the text */
+	const char* m_end;
+
+public:
+
+	/// forward >> to &
+	template< class T >
+	FastStringIArchive& operator>>( T& v )
+	{ return *this & v; }
+
+	/// read operator for doubles
+	FastStringIArchive& operator&( double& v )
+	{ pre(); post( parseDouble( m_pos, m_end, v ) ); return *this; }
+
+	/// read operator for floats
+	FastStringIArchive& operator&( float& v )
+	{ pre(); post( parseFloat( m_pos, m_end, v ) ); return *this; }
+
+	/// read operator for ints
+	FastStringIArchive& operator&( int& v )
+	{ readSigned( v, -2147483647LL - 1, 2147483647LL ); return *this; }
+
+	/// read operator for unsigned ints
+	FastStringIArchive& operator&( unsigned int& v )
+	{ readUnsigned( v, 4294967295ULL ); return *this; }
+
+	/// read operator for chars
+	FastStringIArchive& operator&( char& v )
+	{ pre(); v = *m_pos++; return *this; }
+
+	/// read operator for unsigned long longs
+	FastStringIArchive& operator&( unsigned long long& v )
+	{ readUnsigned( v, ~0ULL ); return *this; }
+
+	#if BOOST_VERSION >= 103500
+		/// read operator for collection_size_type
+		FastStringIArchive& operator&( boost::serialization::collection_size_type& v )
+		{ std::size_t s; readUnsigned( s, std::size_t( -1 ) ); v = boost::serialization::collection_size_type( s ); return *this; }
+	#endif
+	#if BOOST_VERSION >= 104400
+		/// read operator for item_version_type
+		FastStringIArchive& operator&( boost::serialization::item_version_type& v )
+		{ unsigned int i; readUnsigned( i, 4294967295ULL ); v = boost::serialization::item_version_type( i ); return *this; }
+	#endif
+
+	/// let const-nvps through
+	template< class T >
+	FastStringIArchive& operator&( const boost::serialization::nvp< T >& v )
+	{ boost::serialization::serialize( *this, const_cast< boost::serialization::nvp< T >& >( v ), 0 ); return *this; }
+	
+	/// read operator for all other classes (calls serialize)
+	template< class T >
+	FastStringIArchive& operator&( T& v )
+	{ boost::serialization::serialize( *this, v, 0 ); return *this; }
+
+
+	// required for boost::serialization
+    typedef boost::mpl::bool_<true> is_loading;
+    typedef boost::mpl::bool_<false> is_saving;
+	unsigned int get_library_version() const 
+	{ return 0; }
+	void reset_object_address( void*, void* )
+	{}	
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Allocation-free conversion of very simple structures to strings.
+ * Provides an archive class for boost::serialization that produces the same
+ * format as \c SimpleStringOArchive.
+ */
+ 
+#ifndef __UBITRACK_UTIL_FASTSTRINGOARCHIVE_H_INCLUDED__
+#define __UBITRACK_UTIL_FASTSTRINGOARCHIVE_H_INCLUDED__
+
+#include <string>
+#include <cstddef>
+#include <boost/version.hpp>
+#include <boost/serialization/serialization.hpp>
+#include <boost/mpl/bool.hpp>
+#if BOOST_VERSION >= 103500
+#include <boost/serialization/collection_size_type.hpp>
+#endif
+#if BOOST_VERSION >= 104400
+#include <boost/serialization/item_version_type.hpp>
+#endif
+#include <utUtil/Exception.h>
+#include <utUtil/NumberConversion.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Writing very simple structures to a caller-supplied character buffer.
+ * Provides an archive class for boost::serialization.
+ *
+ * Produces the same space-separated format as \c SimpleStringOArchive and can be read by both
+ * \c SimpleStringIArchive and \c FastStringIArchive. In contrast to the stream-based archive,
+ * no memory is allocated, the output does not depend on the current locale and floating point
+ * numbers are written in the shortest form that reads back to the identical value.
+ *
+ * The buffer is always kept zero-terminated. If it is too small, an exception is thrown.
+ */
+class FastStringOArchive
+{
+public:
+	/**
+	 * construct archive that writes into the given buffer
+	 * @param buffer memory to write to, must stay valid for the lifetime of the archive
+	 * @param size size of the buffer in bytes, including the terminating zero
+	 */
+	FastStringOArchive( char* buffer, std::size_t size )
+		: m_buffer( buffer )
+		, m_size( size )
+		, m_pos( 0 )
+		, m_count( 0 )
+	{
+		if ( m_size == 0 )
+			UBITRACK_THROW( "Archive buffer too small" );
+		m_buffer[ 0 ] = 0;
+	}
+
+	/** start writing at the beginning of the buffer again */
+	void reset()
+	{ m_pos = 0; m_count = 0; m_buffer[ 0 ] = 0; }
+
+	/** pointer to the zero-terminated output */
+	const char* c_str() const
+	{ return m_buffer; }
+
+	/** number of characters written (without terminating zero) */
+	std::size_t size() const
+	{ return m_pos; }
+
+	/** get string (allocates) */
+	std::string str() const
+	{ return std::string( m_buffer, m_pos ); }
+	
+protected:
+	/** pre-write operations */
+	void pre()
+	{
+		if ( m_count++ )
+			put( ' ' );
+	}
+	
+	/** post-write operations */
+	void post( std::size_t n )
+	{
+		// n == 0 means the number did not fit into the remaining space
+		if ( n == 0 )
+			overflow();
+		m_pos += n;
+		m_buffer[ m_pos ] = 0;
+	}
+
+	/** appends a single character */
+	void put( char c )
+	{
+		if ( remaining() < 1 )
+			overflow();
+		m_buffer[ m_pos++ ] = c;
+		m_buffer[ m_pos ] = 0;
+	}
+
+	/** space left for characters, keeping one byte for the terminating zero */
+	std::size_t remaining() const
+	{ return m_size - 1 - m_pos; }
+
+	/** current write position */
+	char* cursor()
+	{ return m_buffer + m_pos; }
+
+	void overflow()
+	{ UBITRACK_THROW( "Archive buffer too small" ); }
+
+	/** the buffer to write to */
+	char* m_buffer;
+
+	/** size of the buffer */
+	std::size_t m_size;
+
+	/** current write position */
+	std::size_t m_pos;
+
+	/** number of things written */
+	unsigned m_count;
+	
+public:
+
+	/// forward << to &
+	template< class T >
+	FastStringOArchive& operator<<( const T& v )
+	{ return *this & v; }
+
+	/// write operator for doubles
+	FastStringOArchive& operator&( const double& v )
+	{ pre(); post( formatDouble( cursor(), remaining(), v ) ); return *this; }
+
+	/// write operator for floats
+	FastStringOArchive& operator&( const float& v )
+	{ pre(); post( formatFloat( cursor(), remaining(), v ) ); return *this; }
+
+	/// write operator for ints
+	FastStringOArchive& operator&( const int& v )
+	{ pre(); post( formatSigned( cursor(), remaining(), v ) ); return *this; }
+
+	/// write operator for unsigned ints
+	FastStringOArchive& operator&( const unsigned int& v )
+	{ pre(); post( formatUnsigned( cursor(), remaining(), v ) ); return *this; }
+
+	/// write operator for chars
+	FastStringOArchive& operator&( const char v )
+	{ pre(); put( v ); return *this; }
+
+	/// write operator for unsigned long longs
+	FastStringOArchive& operator&( const unsigned long long& v )
+	{ pre(); post( formatUnsigned( cursor(), remaining(), v ) ); return *this; }
+
+	#if BOOST_VERSION >= 103500
+		/// write operator for collection_size_type
+		FastStringOArchive& operator&( const boost::serialization::collection_size_type& v )
+		{ pre(); post( formatUnsigned( cursor(), remaining(), std::size_t( v ) ) ); return *this; }
+	#endif
+	#if BOOST_VERSION >= 104400
+		/// write operator for item_version_type
+		FastStringOArchive& operator&( const boost::serialization::item_version_type& v )
+		{ pre(); post( formatUnsigned( cursor(), remaining(), unsigned( v ) ) ); return *this; }
+	#endif
+
+	/// write operator for all other classes (calls serialize)
+	template< class T >
+	FastStringOArchive& operator&( const T& v )
+	{ boost::serialization::serialize( *this, const_cast< T& >( v ), 0 ); return *this; }
+
+
+	// required for boost::serialization
+    typedef boost::mpl::bool_<false> is_loading;
+    typedef boost::mpl::bool_<true> is_saving;
+	unsigned int get_library_version() const 
+	{ return 0; }	
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
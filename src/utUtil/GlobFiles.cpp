@@ -22,7 +22,7 @@
 */
 
 #include "GlobFiles.h"
-#include <log4cpp/Category.hh>
+#include "LogMacros.h"
 #include <boost/regex.hpp>
 
 #include <algorithm>
@@ -50,7 +50,7 @@ void globFiles( const std::string& directory, const std::string & patternString,
 			// check for files with suitable extension
 			if ( boost::filesystem::exists( p ) && ! boost::filesystem::is_directory( p ) && boost::regex_match( p.filename().string(), ext ) )
 			{
-				LOG4CPP_TRACE( logger, "Adding file " << p << " to list" );
+				UBITRACK_LOG_TRACE( logger, "Adding file " << p << " to list" );
 
 				files.push_back( p );
 			}
@@ -64,10 +64,10 @@ void globFiles( const std::string& directory, const std::string & patternString,
 		// sort, since directory iteration is not ordered on some file systems
 		files.sort();
 
-		LOG4CPP_DEBUG( logger, "Sorted list of files" );		
+		UBITRACK_LOG_DEBUG( logger, "Sorted list of files" );		
 		for ( std::list< boost::filesystem::path >::iterator iter = files.begin(); iter != files.end(); iter ++ )
 		{
-			LOG4CPP_DEBUG( logger, *iter );		
+			UBITRACK_LOG_DEBUG( logger, *iter );		
 		}
 	}
 	else if ( boost::filesystem::exists( testPath ) ) {
@@ -0,0 +1,161 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Logging macros with compile-time and runtime filtering and rate limiting.
+ *
+ * All macros evaluate the priority before the message is formatted:
+ *   - Messages with a priority value above \c UBITRACK_LOG_MAX_PRIORITY are removed by the
+ *     compiler. Define it to e.g. 600 (INFO) to strip debug and trace messages from a build.
+ *   - Otherwise, the cached chained priority of the category is compared, which costs a single
+ *     load. The \c std::ostringstream is only created if the message is actually logged.
+ *
+ * There is no separate atomic copy of the level. The check reads log4cpp's own cache
+ * \c Category::_chainedPriority, which \c setPriority updates for the whole subtree. That field
+ * is a volatile, aligned int, written only by \c setPriority while holding the category's
+ * children mutex. On the supported platforms the read is a single load, so a thread that races
+ * with a priority change sees either the old or the new level, like a relaxed atomic load. The
+ * level guards no other data, so no ordering is needed. A second cache inside Ubitrack would
+ * need a hook in \c setPriority, and log4cpp is an external dependency that has none.
+ *
+ * Example:
+ * \code
+ * static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Tracking.Foo" ) );
+ * UBITRACK_LOG_DEBUG( logger, "state: " << x );
+ * UBITRACK_LOG_RATE_LIMITED( logger, log4cpp::Priority::WARN, 1000, "sample dropped at " << t );
+ * \endcode
+ */
+
+#ifndef __UBITRACK_UTIL_LOGMACROS_H_INCLUDED__
+#define __UBITRACK_UTIL_LOGMACROS_H_INCLUDED__
+
+#include <sstream>
+#include <boost/atomic.hpp>
+#include <utCore.h>
+#include <utMeasurement/Timestamp.h>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4290 )
+#endif
+
+#include <log4cpp/Category.hh>
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+/**
+ * Largest log4cpp priority value that is compiled in.
+ * 300 = ERROR, 400 = WARN, 500 = NOTICE, 600 = INFO, 700 = DEBUG, 750 = TRACE.
+ */
+#ifndef UBITRACK_LOG_MAX_PRIORITY
+	#define UBITRACK_LOG_MAX_PRIORITY 750
+#endif
+
+/** true if messages of the given priority are compiled in and enabled for the category */
+#define UBITRACK_LOG_ENABLED( logger, priority ) \
+	( ( priority ) <= UBITRACK_LOG_MAX_PRIORITY && (logger).isPriorityEnabled( priority ) )
+
+/** logs a message with the given priority. Multiple parameters can be concatenated using the stream << operator. */
+#define UBITRACK_LOG( logger, priority, message ) \
+	do { \
+		if ( UBITRACK_LOG_ENABLED( logger, priority ) ) \
+		{ \
+			std::ostringstream _l_s; _l_s << message; \
+			(logger).log( priority, _l_s.str(), __FILE__, __LINE__ ); \
+		} \
+	} while ( false )
+
+#define UBITRACK_LOG_TRACE( logger, message ) UBITRACK_LOG( logger, log4cpp::Priority::TRACE, message )
+#define UBITRACK_LOG_DEBUG( logger, message ) UBITRACK_LOG( logger, log4cpp::Priority::debug, message )
+#define UBITRACK_LOG_INFO( logger, message ) UBITRACK_LOG( logger, log4cpp::Priority::INFO, message )
+#define UBITRACK_LOG_NOTICE( logger, message ) UBITRACK_LOG( logger, log4cpp::Priority::NOTICE, message )
+#define UBITRACK_LOG_WARN( logger, message ) UBITRACK_LOG( logger, log4cpp::Priority::WARN, message )
+#define UBITRACK_LOG_ERROR( logger, message ) UBITRACK_LOG( logger, log4cpp::Priority::error, message )
+
+/**
+ * Logs a message at most once per \c intervalMs milliseconds from this call site.
+ * Suppressed messages are counted and the count is appended to the next message logged.
+ * Intended for per-sample warnings in tracking loops.
+ */
+#define UBITRACK_LOG_RATE_LIMITED( logger, priority, intervalMs, message ) \
+	do { \
+		if ( UBITRACK_LOG_ENABLED( logger, priority ) ) \
+		{ \
+			static Ubitrack::Util::LogRateLimiter _l_limiter( intervalMs ); \
+			unsigned long _l_suppressed; \
+			if ( _l_limiter.pass( _l_suppressed ) ) \
+			{ \
+				std::ostringstream _l_s; _l_s << message; \
+				if ( _l_suppressed ) \
+					_l_s << " (" << _l_suppressed << " similar messages suppressed)"; \
+				(logger).log( priority, _l_s.str(), __FILE__, __LINE__ ); \
+			} \
+		} \
+	} while ( false )
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Lets one event pass per time interval. Thread-safe and lock-free, used by
+ * \c UBITRACK_LOG_RATE_LIMITED.
+ */
+class LogRateLimiter
+{
+public:
+	/** @param intervalMs minimum time between two events that pass */
+	explicit LogRateLimiter( unsigned long intervalMs )
+		: m_interval( static_cast< Measurement::Timestamp >( intervalMs ) * 1000000ULL )
+		, m_next( 0 )
+		, m_suppressed( 0 )
+	{}
+
+	/**
+	 * Returns true if the event may pass.
+	 * @param suppressed receives the number of events suppressed since the last one that passed
+	 */
+	bool pass( unsigned long& suppressed )
+	{
+		Measurement::Timestamp t = Measurement::now();
+		Measurement::Timestamp next = m_next.load( boost::memory_order_relaxed );
+		if ( t < next || !m_next.compare_exchange_strong( next, t + m_interval, boost::memory_order_relaxed ) )
+		{
+			m_suppressed.fetch_add( 1, boost::memory_order_relaxed );
+			return false;
+		}
+
+		suppressed = m_suppressed.exchange( 0, boost::memory_order_relaxed );
+		return true;
+	}
+
+protected:
+	Measurement::Timestamp m_interval;
+	boost::atomic< Measurement::Timestamp > m_next;
+	boost::atomic< unsigned long > m_suppressed;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
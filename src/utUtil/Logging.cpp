@@ -43,6 +43,7 @@
 
 #include <log4cpp/PatternLayout.hh>
 #include <log4cpp/Category.hh>
+#include <log4cpp/HierarchyMaintainer.hh>
 #include <log4cpp/PropertyConfigurator.hh>
 
 #ifdef _MSC_VER
@@ -50,12 +51,91 @@
 #endif
 
 #include <iostream>
+#include <map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
 #include "Logging.h"
+#include "AsyncLogAppender.h"
 
 
 
 namespace Ubitrack { namespace Util {
 
+namespace {
+
+/** removes an appender from all categories that use it */
+void detachAppender( log4cpp::Appender* pAppender, log4cpp::Appender* pReplacement = 0 )
+{
+	std::vector< log4cpp::Category* >* pCategories = log4cpp::Category::getCurrentCategories();
+	for ( std::vector< log4cpp::Category* >::iterator itCat = pCategories->begin(); itCat != pCategories->end(); itCat++ )
+	{
+		log4cpp::AppenderSet appenders = ( *itCat )->getAllAppenders();
+		if ( appenders.find( pAppender ) == appenders.end() )
+			continue;
+
+		// removing waits for threads currently logging to the category
+		( *itCat )->removeAppender( pAppender );
+		if ( pReplacement )
+			( *itCat )->addAppender( *pReplacement );
+	}
+	delete pCategories;
+}
+
+
+/**
+ * Appenders created by this file and attached to categories by reference.
+ * The log4cpp hierarchy is created first, so it is destroyed after the appenders
+ * have been removed from it at program exit.
+ */
+struct LoggingAppenders
+{
+	LoggingAppenders()
+	{ log4cpp::HierarchyMaintainer::getDefaultMaintainer(); }
+
+	~LoggingAppenders()
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		disableAsync();
+
+		for ( std::size_t i = 0; i < defaults.size(); i++ )
+		{
+			detachAppender( defaults[ i ] );
+			delete defaults[ i ];
+		}
+	}
+
+	/** replaces the asynchronous wrappers by their targets and deletes them */
+	void disableAsync()
+	{
+		for ( std::size_t i = 0; i < async.size(); i++ )
+		{
+			// write the queued events first, so the target is not used by two threads
+			async[ i ]->stop();
+			detachAppender( async[ i ], async[ i ]->target() );
+			delete async[ i ];
+		}
+		async.clear();
+	}
+
+	/** default appenders created by initLogging */
+	std::vector< log4cpp::Appender* > defaults;
+
+	/** wrappers created by enableAsyncLogging */
+	std::vector< AsyncLogAppender* > async;
+
+	boost::mutex mutex;
+};
+
+
+LoggingAppenders& loggingAppenders()
+{
+	static LoggingAppenders appenders;
+	return appenders;
+}
+
+} // anonymous namespace
+
+
 // Initializes the logger
 void initLogging( const char* sConfigFile )
 {
@@ -88,11 +168,69 @@ void initLogging( const char* sConfigFile )
 //	layout->setConversionPattern( "%R %p %c %x: %m%n" );
 	app->setLayout( layout );
 
+	// attached by reference, so enableAsyncLogging can wrap it, deleted at program exit
+	{
+		LoggingAppenders& registry( loggingAppenders() );
+		boost::mutex::scoped_lock lock( registry.mutex );
+		registry.defaults.push_back( app );
+	}
 	log4cpp::Category::getRoot().setAdditivity( false );
-	log4cpp::Category::getRoot().addAppender( app );
+	log4cpp::Category::getRoot().addAppender( *app );
 	log4cpp::Category::getRoot().setPriority( log4cpp::Priority::INFO ); // default: INFO
 	log4cpp::Category::getInstance( "Ubitrack.Events" ).setPriority( log4cpp::Priority::NOTICE ); // default: NOTICE
 	#endif
 }
 
+
+void enableAsyncLogging( std::size_t nQueueSize, bool bBlockWhenFull )
+{
+	LoggingAppenders& registry( loggingAppenders() );
+	boost::mutex::scoped_lock lock( registry.mutex );
+
+	// an appender may be shared by several categories
+	std::map< log4cpp::Appender*, AsyncLogAppender* > wrappers;
+	for ( std::size_t i = 0; i < registry.async.size(); i++ )
+		wrappers[ registry.async[ i ] ] = registry.async[ i ];
+
+	std::vector< log4cpp::Category* >* pCategories = log4cpp::Category::getCurrentCategories();
+	for ( std::vector< log4cpp::Category* >::iterator itCat = pCategories->begin(); itCat != pCategories->end(); itCat++ )
+	{
+		log4cpp::AppenderSet appenders = ( *itCat )->getAllAppenders();
+		for ( log4cpp::AppenderSet::iterator it = appenders.begin(); it != appenders.end(); it++ )
+		{
+			log4cpp::Appender* pAppender = *it;
+			if ( ( *itCat )->ownsAppender( pAppender ) )
+				continue;
+
+			std::map< log4cpp::Appender*, AsyncLogAppender* >::iterator itWrapper = wrappers.find( pAppender );
+			if ( itWrapper != wrappers.end() && itWrapper->second == pAppender )
+				continue; // already asynchronous
+
+			AsyncLogAppender* pWrapper;
+			if ( itWrapper != wrappers.end() )
+				pWrapper = itWrapper->second;
+			else
+			{
+				pWrapper = new AsyncLogAppender( pAppender->getName() + ".async", pAppender, false, nQueueSize,
+					bBlockWhenFull ? AsyncLogAppender::OVERFLOW_BLOCK : AsyncLogAppender::OVERFLOW_COUNT );
+				registry.async.push_back( pWrapper );
+				wrappers[ pAppender ] = pWrapper;
+				wrappers[ pWrapper ] = pWrapper;
+			}
+
+			( *itCat )->removeAppender( pAppender );
+			( *itCat )->addAppender( *pWrapper );
+		}
+	}
+	delete pCategories;
+}
+
+
+void disableAsyncLogging()
+{
+	LoggingAppenders& registry( loggingAppenders() );
+	boost::mutex::scoped_lock lock( registry.mutex );
+	registry.disableAsync();
+}
+
 } } // namespace Ubitrack::Util
@@ -31,6 +31,7 @@
 #ifndef __UBITRACK_UTIL_LOGGING_H_INCLUDED__
 #define __UBITRACK_UTIL_LOGGING_H_INCLUDED__
 
+#include <cstddef>
 #include <utCore.h>
 
 namespace Ubitrack { namespace Util {
@@ -38,6 +39,24 @@ namespace Ubitrack { namespace Util {
 /** Initializes the logger */
 void UBITRACK_EXPORT initLogging( const char* sConfigFile = "log4cpp.conf" );
 
+/**
+ * Moves the output of all currently configured appenders to background threads.
+ *
+ * Each appender attached to a category by reference (as done by \c initLogging and the
+ * property configurator) is replaced by an \c AsyncLogAppender forwarding to it. Appenders
+ * owned by their category are left unchanged. Call after \c initLogging.
+ *
+ * @param nQueueSize number of queued events per appender
+ * @param bBlockWhenFull wait for a free slot instead of dropping events if the queue is full
+ */
+void UBITRACK_EXPORT enableAsyncLogging( std::size_t nQueueSize = 8192, bool bBlockWhenFull = false );
+
+/**
+ * Undoes \c enableAsyncLogging: writes all queued events, stops the background threads and
+ * attaches the original appenders again. Called automatically at program exit.
+ */
+void UBITRACK_EXPORT disableAsyncLogging();
+
 } } // namespace Ubitrack::Util
 
 #endif
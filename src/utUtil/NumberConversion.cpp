@@ -0,0 +1,864 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Implements locale-independent conversion between numbers and text.
+ *
+ * Formatting uses the Grisu2 algorithm (F. Loitsch, "Printing Floating-Point Numbers Quickly
+ * and Accurately with Integers", PLDI 2010), which always produces text that reads back to
+ * the identical value and is the shortest such text in the vast majority of cases.
+ * Parsing uses exact double arithmetic where possible (Clinger's fast path), then a 64 bit
+ * extended precision multiplication with error bounds as in the double-conversion library,
+ * and only falls back to \c strtod if the result cannot be decided in 64 bits.
+ */
+
+#include "NumberConversion.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <clocale>
+#include <limits>
+#include <string>
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+typedef unsigned long long UInt64;
+
+/** "do-it-yourself floating point": f * 2^e with a 64 bit significand */
+struct DiyFp
+{
+	DiyFp()
+	{}
+
+	DiyFp( UInt64 _f, int _e )
+		: f( _f )
+		, e( _e )
+	{}
+
+	UInt64 f;
+	int e;
+};
+
+/** multiplies two DiyFps, keeping the rounded upper 64 bits of the product */
+DiyFp multiply( const DiyFp& x, const DiyFp& y )
+{
+	const UInt64 mask32 = 0xFFFFFFFFULL;
+	const UInt64 a = x.f >> 32;
+	const UInt64 b = x.f & mask32;
+	const UInt64 c = y.f >> 32;
+	const UInt64 d = y.f & mask32;
+	const UInt64 ac = a * c;
+	const UInt64 bc = b * c;
+	const UInt64 ad = a * d;
+	const UInt64 bd = b * d;
+	UInt64 tmp = ( bd >> 32 ) + ( ad & mask32 ) + ( bc & mask32 );
+	tmp += 1ULL << 31;
+	return DiyFp( ac + ( ad >> 32 ) + ( bc >> 32 ) + ( tmp >> 32 ), x.e + y.e + 64 );
+}
+
+/** shifts the significand until its most significant bit is set. f must not be zero */
+DiyFp normalize( DiyFp x )
+{
+	if ( !( x.f & 0xFFFFFFFF00000000ULL ) ) { x.f <<= 32; x.e -= 32; }
+	if ( !( x.f & 0xFFFF000000000000ULL ) ) { x.f <<= 16; x.e -= 16; }
+	if ( !( x.f & 0xFF00000000000000ULL ) ) { x.f <<= 8; x.e -= 8; }
+	if ( !( x.f & 0xF000000000000000ULL ) ) { x.f <<= 4; x.e -= 4; }
+	if ( !( x.f & 0xC000000000000000ULL ) ) { x.f <<= 2; x.e -= 2; }
+	if ( !( x.f & 0x8000000000000000ULL ) ) { x.f <<= 1; x.e -= 1; }
+	return x;
+}
+
+struct CachedPower
+{
+	UInt64 f;
+	int e;
+};
+
+/** normalized, rounded 10^k for k = -348, -340, ..., 340 */
+const CachedPower g_cachedPowers[] = {
+	{ 0xfa8fd5a0081c0288ULL, -1220 }, { 0xbaaee17fa23ebf76ULL, -1193 },
+	{ 0x8b16fb203055ac76ULL, -1166 }, { 0xcf42894a5dce35eaULL, -1140 },
+	{ 0x9a6bb0aa55653b2dULL, -1113 }, { 0xe61acf033d1a45dfULL, -1087 },
+	{ 0xab70fe17c79ac6caULL, -1060 }, { 0xff77b1fcbebcdc4fULL, -1034 },
+	{ 0xbe5691ef416bd60cULL, -1007 }, { 0x8dd01fad907ffc3cULL, -980 },
+	{ 0xd3515c2831559a83ULL, -954 }, { 0x9d71ac8fada6c9b5ULL, -927 },
+	{ 0xea9c227723ee8bcbULL, -901 }, { 0xaecc49914078536dULL, -874 },
+	{ 0x823c12795db6ce57ULL, -847 }, { 0xc21094364dfb5637ULL, -821 },
+	{ 0x9096ea6f3848984fULL, -794 }, { 0xd77485cb25823ac7ULL, -768 },
+	{ 0xa086cfcd97bf97f4ULL, -741 }, { 0xef340a98172aace5ULL, -715 },
+	{ 0xb23867fb2a35b28eULL, -688 }, { 0x84c8d4dfd2c63f3bULL, -661 },
+	{ 0xc5dd44271ad3cdbaULL, -635 }, { 0x936b9fcebb25c996ULL, -608 },
+	{ 0xdbac6c247d62a584ULL, -582 }, { 0xa3ab66580d5fdaf6ULL, -555 },
+	{ 0xf3e2f893dec3f126ULL, -529 }, { 0xb5b5ada8aaff80b8ULL, -502 },
+	{ 0x87625f056c7c4a8bULL, -475 }, { 0xc9bcff6034c13053ULL, -449 },
+	{ 0x964e858c91ba2655ULL, -422 }, { 0xdff9772470297ebdULL, -396 },
+	{ 0xa6dfbd9fb8e5b88fULL, -369 }, { 0xf8a95fcf88747d94ULL, -343 },
+	{ 0xb94470938fa89bcfULL, -316 }, { 0x8a08f0f8bf0f156bULL, -289 },
+	{ 0xcdb02555653131b6ULL, -263 }, { 0x993fe2c6d07b7facULL, -236 },
+	{ 0xe45c10c42a2b3b06ULL, -210 }, { 0xaa242499697392d3ULL, -183 },
+	{ 0xfd87b5f28300ca0eULL, -157 }, { 0xbce5086492111aebULL, -130 },
+	{ 0x8cbccc096f5088ccULL, -103 }, { 0xd1b71758e219652cULL, -77 },
+	{ 0x9c40000000000000ULL, -50 }, { 0xe8d4a51000000000ULL, -24 },
+	{ 0xad78ebc5ac620000ULL, 3 }, { 0x813f3978f8940984ULL, 30 },
+	{ 0xc097ce7bc90715b3ULL, 56 }, { 0x8f7e32ce7bea5c70ULL, 83 },
+	{ 0xd5d238a4abe98068ULL, 109 }, { 0x9f4f2726179a2245ULL, 136 },
+	{ 0xed63a231d4c4fb27ULL, 162 }, { 0xb0de65388cc8ada8ULL, 189 },
+	{ 0x83c7088e1aab65dbULL, 216 }, { 0xc45d1df942711d9aULL, 242 },
+	{ 0x924d692ca61be758ULL, 269 }, { 0xda01ee641a708deaULL, 295 },
+	{ 0xa26da3999aef774aULL, 322 }, { 0xf209787bb47d6b85ULL, 348 },
+	{ 0xb454e4a179dd1877ULL, 375 }, { 0x865b86925b9bc5c2ULL, 402 },
+	{ 0xc83553c5c8965d3dULL, 428 }, { 0x952ab45cfa97a0b3ULL, 455 },
+	{ 0xde469fbd99a05fe3ULL, 481 }, { 0xa59bc234db398c25ULL, 508 },
+	{ 0xf6c69a72a3989f5cULL, 534 }, { 0xb7dcbf5354e9beceULL, 561 },
+	{ 0x88fcf317f22241e2ULL, 588 }, { 0xcc20ce9bd35c78a5ULL, 614 },
+	{ 0x98165af37b2153dfULL, 641 }, { 0xe2a0b5dc971f303aULL, 667 },
+	{ 0xa8d9d1535ce3b396ULL, 694 }, { 0xfb9b7cd9a4a7443cULL, 720 },
+	{ 0xbb764c4ca7a44410ULL, 747 }, { 0x8bab8eefb6409c1aULL, 774 },
+	{ 0xd01fef10a657842cULL, 800 }, { 0x9b10a4e5e9913129ULL, 827 },
+	{ 0xe7109bfba19c0c9dULL, 853 }, { 0xac2820d9623bf429ULL, 880 },
+	{ 0x80444b5e7aa7cf85ULL, 907 }, { 0xbf21e44003acdd2dULL, 933 },
+	{ 0x8e679c2f5e44ff8fULL, 960 }, { 0xd433179d9c8cb841ULL, 986 },
+	{ 0x9e19db92b4e31ba9ULL, 1013 }, { 0xeb96bf6ebadf77d9ULL, 1039 },
+	{ 0xaf87023b9bf0ee6bULL, 1066 }
+};
+
+const int g_firstCachedPower = -348;
+const int g_cachedPowerStep = 8;
+const int g_nCachedPowers = sizeof( g_cachedPowers ) / sizeof( CachedPower );
+
+/** exact, normalized 10^1 ... 10^7, to bridge the gaps of the cached powers */
+const CachedPower g_adjustmentPowers[] = {
+	{ 0xa000000000000000ULL, -60 }, { 0xc800000000000000ULL, -57 }, { 0xfa00000000000000ULL, -54 },
+	{ 0x9c40000000000000ULL, -50 }, { 0xc350000000000000ULL, -47 }, { 0xf424000000000000ULL, -44 },
+	{ 0x9896800000000000ULL, -40 }
+};
+
+/** powers of ten that fit into 64 bits */
+const UInt64 g_pow10Int[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+	1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+	1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/** powers of ten that are exactly representable as double */
+const double g_exactPow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/** powers of ten that are exactly representable as float */
+const float g_exactPow10f[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+
+/** bit layout of the IEEE 754 binary formats */
+template< typename T > struct FloatFormat;
+
+template<> struct FloatFormat< double >
+{
+	enum { storedBits = 52, exponentBits = 11 };
+
+	static UInt64 toBits( double v )
+	{ UInt64 b; std::memcpy( &b, &v, sizeof( b ) ); return b; }
+
+	static double fromBits( UInt64 b )
+	{ double v; std::memcpy( &v, &b, sizeof( v ) ); return v; }
+};
+
+template<> struct FloatFormat< float >
+{
+	enum { storedBits = 23, exponentBits = 8 };
+
+	static UInt64 toBits( float v )
+	{ unsigned int b; std::memcpy( &b, &v, sizeof( b ) ); return b; }
+
+	static float fromBits( UInt64 b )
+	{ unsigned int b32 = static_cast< unsigned int >( b ); float v; std::memcpy( &v, &b32, sizeof( v ) ); return v; }
+};
+
+/** derived constants of a floating point format */
+template< typename T >
+struct FloatConstants
+{
+	typedef FloatFormat< T > F;
+	enum {
+		significandSize = F::storedBits + 1,
+		exponentBias = ( 1 << ( F::exponentBits - 1 ) ) - 1 + F::storedBits,
+		denormalExponent = 1 - exponentBias,
+		maxExponent = ( 1 << F::exponentBits ) - 1 - exponentBias
+	};
+
+	static UInt64 hiddenBit()
+	{ return 1ULL << F::storedBits; }
+
+	static UInt64 signBit()
+	{ return 1ULL << ( F::storedBits + F::exponentBits ); }
+};
+
+/** builds a floating point number from a DiyFp, handling denormals and overflow */
+template< typename T >
+T fromDiyFp( DiyFp x )
+{
+	typedef FloatConstants< T > C;
+	const UInt64 hiddenBit = C::hiddenBit();
+	const UInt64 significandMask = hiddenBit - 1;
+
+	while ( x.f > hiddenBit + significandMask )
+	{
+		x.f >>= 1;
+		x.e++;
+	}
+	if ( x.e >= C::maxExponent )
+		return FloatFormat< T >::fromBits( UInt64( ( 1 << FloatFormat< T >::exponentBits ) - 1 ) << FloatFormat< T >::storedBits );
+	if ( x.e < C::denormalExponent )
+		return T( 0 );
+	while ( x.e > C::denormalExponent && ( x.f & hiddenBit ) == 0 )
+	{
+		x.f <<= 1;
+		x.e--;
+	}
+
+	const UInt64 biasedExponent = ( x.e == C::denormalExponent && ( x.f & hiddenBit ) == 0 ) ? 0 : x.e + C::exponentBias;
+	return FloatFormat< T >::fromBits( ( x.f & significandMask ) | ( biasedExponent << FloatFormat< T >::storedBits ) );
+}
+
+
+/** moves the last digit towards the exact value as long as it stays inside the rounding interval */
+void grisuRound( char* buffer, int len, UInt64 delta, UInt64 rest, UInt64 tenKappa, UInt64 wpW )
+{
+	while ( rest < wpW && delta - rest >= tenKappa &&
+		( rest + tenKappa < wpW || wpW - rest > rest + tenKappa - wpW ) )
+	{
+		buffer[ len - 1 ]--;
+		rest += tenKappa;
+	}
+}
+
+int countDecimalDigits( unsigned n )
+{
+	int digits = 1;
+	while ( n >= 10 && digits < 10 )
+	{
+		n /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+/** generates the shortest digits of a number in the interval defined by Mp and delta */
+void digitGen( const DiyFp& W, const DiyFp& Mp, UInt64 delta, char* buffer, int& len, int& K )
+{
+	const DiyFp one( 1ULL << -Mp.e, Mp.e );
+	const UInt64 wpW = Mp.f - W.f;
+	unsigned p1 = static_cast< unsigned >( Mp.f >> -one.e );
+	UInt64 p2 = Mp.f & ( one.f - 1 );
+	int kappa = countDecimalDigits( p1 );
+	len = 0;
+
+	while ( kappa > 0 )
+	{
+		const unsigned divisor = static_cast< unsigned >( g_pow10Int[ kappa - 1 ] );
+		const unsigned d = p1 / divisor;
+		p1 %= divisor;
+		if ( d || len )
+			buffer[ len++ ] = static_cast< char >( '0' + d );
+		kappa--;
+
+		const UInt64 tmp = ( static_cast< UInt64 >( p1 ) << -one.e ) + p2;
+		if ( tmp <= delta )
+		{
+			K += kappa;
+			grisuRound( buffer, len, delta, tmp, g_pow10Int[ kappa ] << -one.e, wpW );
+			return;
+		}
+	}
+
+	for ( ;; )
+	{
+		p2 *= 10;
+		delta *= 10;
+		const char d = static_cast< char >( p2 >> -one.e );
+		if ( d || len )
+			buffer[ len++ ] = static_cast< char >( '0' + d );
+		p2 &= one.f - 1;
+		kappa--;
+		if ( p2 < delta )
+		{
+			K += kappa;
+			grisuRound( buffer, len, delta, p2, one.f, -kappa < 20 ? wpW * g_pow10Int[ -kappa ] : 0 );
+			return;
+		}
+	}
+}
+
+/**
+ * Grisu2: computes the decimal digits of a positive, finite value.
+ * Afterwards, value == digits * 10^K.
+ */
+template< typename T >
+void grisu2( T value, char* digits, int& len, int& K )
+{
+	typedef FloatConstants< T > C;
+	const UInt64 hiddenBit = C::hiddenBit();
+	const UInt64 bits = FloatFormat< T >::toBits( value );
+	const int biasedExponent = static_cast< int >( ( bits >> FloatFormat< T >::storedBits ) & ( ( 1 << FloatFormat< T >::exponentBits ) - 1 ) );
+	const UInt64 significand = bits & ( hiddenBit - 1 );
+
+	const DiyFp v = biasedExponent ?
+		DiyFp( significand + hiddenBit, biasedExponent - C::exponentBias ) :
+		DiyFp( significand, C::denormalExponent );
+
+	// boundaries halfway to the neighbouring values, the lower one is closer at powers of two
+	const DiyFp plus = normalize( DiyFp( ( v.f << 1 ) + 1, v.e - 1 ) );
+	DiyFp minus = ( significand == 0 && biasedExponent > 1 ) ?
+		DiyFp( ( v.f << 2 ) - 1, v.e - 2 ) : DiyFp( ( v.f << 1 ) - 1, v.e - 1 );
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+
+	// choose a cached power of ten that brings the exponent into the range [-60, -32]
+	const double dk = ( -61 - plus.e ) * 0.30102999566398114 + 347;
+	int k = static_cast< int >( dk );
+	if ( dk - k > 0.0 )
+		k++;
+	const int index = ( k >> 3 ) + 1;
+	K = -( g_firstCachedPower + index * g_cachedPowerStep );
+	const DiyFp cachedPower( g_cachedPowers[ index ].f, g_cachedPowers[ index ].e );
+
+	const DiyFp W = multiply( normalize( v ), cachedPower );
+	DiyFp Wp = multiply( plus, cachedPower );
+	DiyFp Wm = multiply( minus, cachedPower );
+	Wm.f++;
+	Wp.f--;
+	digitGen( W, Wp, Wp.f - Wm.f, digits, len, K );
+}
+
+/** writes the exponent of the scientific notation like printf: sign and at least two digits */
+char* writeExponent( char* p, int exponent )
+{
+	*p++ = 'e';
+	if ( exponent < 0 )
+	{
+		*p++ = '-';
+		exponent = -exponent;
+	}
+	else
+		*p++ = '+';
+
+	if ( exponent >= 100 )
+	{
+		*p++ = static_cast< char >( '0' + exponent / 100 );
+		exponent %= 100;
+	}
+	*p++ = static_cast< char >( '0' + exponent / 10 );
+	*p++ = static_cast< char >( '0' + exponent % 10 );
+	return p;
+}
+
+/**
+ * Formats a floating point number in the style of "%g", but with the shortest digits that
+ * read back to the same value: fixed notation for decimal exponents in [-4, 15),
+ * scientific notation otherwise.
+ */
+template< typename T >
+std::size_t formatShortest( char* buf, std::size_t size, T v )
+{
+	char tmp[ 40 ];
+	char* p = tmp;
+
+	const UInt64 bits = FloatFormat< T >::toBits( v );
+	if ( bits & FloatConstants< T >::signBit() )
+		*p++ = '-';
+
+	if ( v != v )
+	{
+		std::memcpy( p, "nan", 3 );
+		p += 3;
+	}
+	else if ( v - v != v - v )
+	{
+		std::memcpy( p, "inf", 3 );
+		p += 3;
+	}
+	else if ( v == 0 )
+		*p++ = '0';
+	else
+	{
+		char digits[ 20 ];
+		int len;
+		int K;
+		grisu2< T >( v < 0 ? -v : v, digits, len, K );
+
+		// decimal exponent of the first digit
+		const int exponent = len + K - 1;
+		if ( exponent < -4 || exponent >= 15 )
+		{
+			*p++ = digits[ 0 ];
+			if ( len > 1 )
+			{
+				*p++ = '.';
+				std::memcpy( p, digits + 1, len - 1 );
+				p += len - 1;
+			}
+			p = writeExponent( p, exponent );
+		}
+		else if ( K >= 0 )
+		{
+			// integer, append zeros
+			std::memcpy( p, digits, len );
+			p += len;
+			for ( int i = 0; i < K; i++ )
+				*p++ = '0';
+		}
+		else if ( exponent >= 0 )
+		{
+			std::memcpy( p, digits, exponent + 1 );
+			p += exponent + 1;
+			*p++ = '.';
+			std::memcpy( p, digits + exponent + 1, len - exponent - 1 );
+			p += len - exponent - 1;
+		}
+		else
+		{
+			*p++ = '0';
+			*p++ = '.';
+			for ( int i = -1; i > exponent; i-- )
+				*p++ = '0';
+			std::memcpy( p, digits, len );
+			p += len;
+		}
+	}
+
+	const std::size_t n = p - tmp;
+	if ( n > size )
+		return 0;
+	std::memcpy( buf, tmp, n );
+	return n;
+}
+
+
+bool isDigit( char c )
+{ return c >= '0' && c <= '9'; }
+
+char toLower( char c )
+{ return ( c >= 'A' && c <= 'Z' ) ? static_cast< char >( c - 'A' + 'a' ) : c; }
+
+/** case-insensitive prefix match of a lower-case keyword */
+bool matchKeyword( const char* p, const char* end, const char* keyword )
+{
+	for ( ; *keyword; ++p, ++keyword )
+		if ( p == end || toLower( *p ) != *keyword )
+			return false;
+	return true;
+}
+
+/** result of scanning a decimal floating point number */
+struct ScannedNumber
+{
+	bool bNegative;
+	bool bInfinity;
+	bool bNaN;
+	/** the first (at most 19) significant digits */
+	UInt64 mantissa;
+	/** number of significant digits (without leading zeros) */
+	int nDigits;
+	/** decimal exponent to apply to the mantissa */
+	int exponent;
+};
+
+/**
+ * Scans the syntax of a floating point number and collects its mantissa and exponent.
+ * On success, \c p points behind the number.
+ */
+bool scanNumber( const char*& p, const char* end, ScannedNumber& n )
+{
+	const char* s = p;
+	n.bNegative = false;
+	n.bInfinity = false;
+	n.bNaN = false;
+	n.mantissa = 0;
+	n.nDigits = 0;
+	n.exponent = 0;
+
+	if ( s != end && ( *s == '-' || *s == '+' ) )
+		n.bNegative = *s++ == '-';
+
+	if ( matchKeyword( s, end, "inf" ) )
+	{
+		n.bInfinity = true;
+		p = s + ( matchKeyword( s, end, "infinity" ) ? 8 : 3 );
+		return true;
+	}
+	if ( matchKeyword( s, end, "nan" ) )
+	{
+		n.bNaN = true;
+		p = s + 3;
+		return true;
+	}
+
+	bool bAnyDigit = false;
+	for ( ; s != end && isDigit( *s ); ++s )
+	{
+		bAnyDigit = true;
+		if ( n.nDigits == 0 && *s == '0' )
+			continue;
+		if ( n.nDigits < 19 )
+			n.mantissa = n.mantissa * 10 + ( *s - '0' );
+		else
+			n.exponent++;
+		n.nDigits++;
+	}
+
+	if ( s != end && *s == '.' )
+	{
+		for ( ++s; s != end && isDigit( *s ); ++s )
+		{
+			bAnyDigit = true;
+			if ( n.nDigits == 0 && *s == '0' )
+			{
+				n.exponent--;
+				continue;
+			}
+			if ( n.nDigits < 19 )
+			{
+				n.mantissa = n.mantissa * 10 + ( *s - '0' );
+				n.exponent--;
+			}
+			n.nDigits++;
+		}
+	}
+
+	if ( !bAnyDigit )
+		return false;
+
+	// the exponent is only part of the number if followed by at least one digit
+	if ( s != end && ( *s == 'e' || *s == 'E' ) )
+	{
+		const char* e = s + 1;
+		bool bExpNegative = false;
+		if ( e != end && ( *e == '-' || *e == '+' ) )
+			bExpNegative = *e++ == '-';
+
+		if ( e != end && isDigit( *e ) )
+		{
+			int nExp = 0;
+			for ( ; e != end && isDigit( *e ); ++e )
+				if ( nExp < 100000 )
+					nExp = nExp * 10 + ( *e - '0' );
+			n.exponent += bExpNegative ? -nExp : nExp;
+			s = e;
+		}
+	}
+
+	p = s;
+	return true;
+}
+
+/**
+ * Converts mantissa * 10^exponent using 64 bit extended precision and keeps track of the error.
+ * Returns false if the correctly rounded result cannot be determined this way.
+ */
+template< typename T >
+bool decimalToFloat( UInt64 mantissa, int nDigits, int exponent, T& result )
+{
+	const int denominatorLog = 3;
+	const int denominator = 1 << denominatorLog;
+
+	const int index = ( exponent - g_firstCachedPower ) / g_cachedPowerStep;
+	if ( exponent < g_firstCachedPower || index >= g_nCachedPowers )
+		return false;
+
+	DiyFp input = normalize( DiyFp( mantissa, 0 ) );
+	UInt64 error = 0;
+
+	const int adjustment = exponent - ( g_firstCachedPower + index * g_cachedPowerStep );
+	if ( adjustment )
+	{
+		const CachedPower& a = g_adjustmentPowers[ adjustment - 1 ];
+		input = multiply( input, DiyFp( a.f, a.e ) );
+		// the product is exact if it still fits into 64 bits
+		if ( 19 - nDigits < adjustment )
+			error += denominator / 2;
+	}
+
+	// error of a*b: error_a + error_b + error_a * error_b / 2^64 + 0.5
+	const UInt64 errorAB = error == 0 ? 0 : 1;
+	input = multiply( input, DiyFp( g_cachedPowers[ index ].f, g_cachedPowers[ index ].e ) );
+	error += denominator / 2 + errorAB + denominator / 2;
+
+	const int oldE = input.e;
+	input = normalize( input );
+	error <<= oldE - input.e;
+
+	// number of bits that are cut off when rounding to the target precision
+	typedef FloatConstants< T > C;
+	const int orderOfMagnitude = 64 + input.e;
+	int effectiveSignificandSize = C::significandSize;
+	if ( orderOfMagnitude < C::denormalExponent + C::significandSize )
+		effectiveSignificandSize = orderOfMagnitude <= C::denormalExponent ? 0 : orderOfMagnitude - C::denormalExponent;
+	int precisionDigits = 64 - effectiveSignificandSize;
+
+	if ( precisionDigits + denominatorLog >= 64 )
+	{
+		const int shift = precisionDigits + denominatorLog - 64 + 1;
+		input.f >>= shift;
+		input.e += shift;
+		error = ( error >> shift ) + 1 + denominator;
+		precisionDigits -= shift;
+	}
+
+	const UInt64 precisionBits = ( input.f & ( ( 1ULL << precisionDigits ) - 1 ) ) * denominator;
+	const UInt64 halfWay = ( 1ULL << ( precisionDigits - 1 ) ) * denominator;
+
+	DiyFp rounded( input.f >> precisionDigits, input.e + precisionDigits );
+	if ( precisionBits >= halfWay + error )
+		rounded.f++;
+
+	if ( halfWay - error < precisionBits && precisionBits < halfWay + error )
+		return false;
+
+	result = fromDiyFp< T >( rounded );
+	return true;
+}
+
+/** slow path: converts the text [begin, end) using the C library */
+double parseWithCLibrary( const char* begin, const char* end )
+{
+	const std::size_t len = end - begin;
+	const char* dp = std::localeconv()->decimal_point;
+	const char decimalPoint = ( dp && dp[ 0 ] ) ? dp[ 0 ] : '.';
+
+	char local[ 64 ];
+	std::string longText;
+	char* text = local;
+	if ( len >= sizeof( local ) )
+	{
+		longText.assign( begin, end );
+		text = &longText[ 0 ];
+	}
+	else
+	{
+		std::memcpy( local, begin, len );
+		local[ len ] = 0;
+	}
+
+	if ( decimalPoint != '.' )
+		for ( std::size_t i = 0; i < len; i++ )
+			if ( text[ i ] == '.' )
+				text[ i ] = decimalPoint;
+
+	return std::strtod( text, 0 );
+}
+
+/**
+ * converts a scanned number that is not handled by a type-specific fast path.
+ * Returns false if a finite number is too large for T, like \c std::istream.
+ */
+template< typename T >
+bool convertScanned( const ScannedNumber& n, const char* begin, const char* end, T& v )
+{
+	if ( n.bNaN )
+		v = static_cast< T >( std::strtod( "nan", 0 ) );
+	else if ( n.bInfinity )
+		v = static_cast< T >( std::strtod( "inf", 0 ) );
+	else if ( n.nDigits == 0 )
+		v = 0;
+	else if ( n.nDigits > 19 || !decimalToFloat< T >( n.mantissa, n.nDigits, n.exponent, v ) )
+	{
+		// everything from the largest value plus half an ulp on rounds to infinity
+		typedef std::numeric_limits< T > L;
+		const double limit = std::ldexp( 1.0, L::max_exponent ) - std::ldexp( 1.0, L::max_exponent - L::digits - 1 );
+		const double d = parseWithCLibrary( begin, end );
+		if ( std::fabs( d ) >= limit )
+			return false;
+		v = static_cast< T >( d );
+		return true;
+	}
+	else if ( v > std::numeric_limits< T >::max() )
+		return false;
+
+	if ( n.bNegative )
+		v = -v;
+	return true;
+}
+
+} // anonymous namespace
+
+
+std::size_t formatUnsigned( char* buf, std::size_t size, unsigned long long v )
+{
+	char tmp[ 24 ];
+	char* p = tmp + sizeof( tmp );
+	do
+	{
+		*--p = static_cast< char >( '0' + v % 10 );
+		v /= 10;
+	}
+	while ( v );
+
+	const std::size_t n = tmp + sizeof( tmp ) - p;
+	if ( n > size )
+		return 0;
+	std::memcpy( buf, p, n );
+	return n;
+}
+
+
+std::size_t formatSigned( char* buf, std::size_t size, long long v )
+{
+	if ( v >= 0 )
+		return formatUnsigned( buf, size, static_cast< unsigned long long >( v ) );
+
+	if ( size < 2 )
+		return 0;
+	buf[ 0 ] = '-';
+	const std::size_t n = formatUnsigned( buf + 1, size - 1, 0ULL - static_cast< unsigned long long >( v ) );
+	return n ? n + 1 : 0;
+}
+
+
+std::size_t formatDouble( char* buf, std::size_t size, double v )
+{
+	return formatShortest< double >( buf, size, v );
+}
+
+
+std::size_t formatFloat( char* buf, std::size_t size, float v )
+{
+	return formatShortest< float >( buf, size, v );
+}
+
+
+bool parseDouble( const char*& p, const char* end, double& v )
+{
+	const char* begin = p;
+	ScannedNumber n;
+	if ( !scanNumber( p, end, n ) )
+		return false;
+
+	if ( n.bNaN || n.bInfinity || n.nDigits == 0 || n.nDigits > 15 || n.exponent < -22 || n.exponent > 22 + 15 - n.nDigits )
+	{
+		if ( convertScanned< double >( n, begin, p, v ) )
+			return true;
+		p = begin;
+		return false;
+	}
+
+	// Clinger's fast path: mantissa and power of ten are exact, so there is only one rounding step
+	v = static_cast< double >( n.mantissa );
+	if ( n.exponent < 0 )
+		v /= g_exactPow10[ -n.exponent ];
+	else if ( n.exponent <= 22 )
+		v *= g_exactPow10[ n.exponent ];
+	else
+	{
+		// move the excess exponent into the mantissa, which stays below 10^15
+		v *= g_exactPow10[ n.exponent - 22 ];
+		v *= g_exactPow10[ 22 ];
+	}
+
+	if ( n.bNegative )
+		v = -v;
+	return true;
+}
+
+
+bool parseFloat( const char*& p, const char* end, float& v )
+{
+	const char* begin = p;
+	ScannedNumber n;
+	if ( !scanNumber( p, end, n ) )
+		return false;
+
+	if ( n.bNaN || n.bInfinity || n.nDigits == 0 || n.nDigits > 7 || n.exponent < -10 || n.exponent > 10 )
+	{
+		if ( convertScanned< float >( n, begin, p, v ) )
+			return true;
+		p = begin;
+		return false;
+	}
+
+	v = static_cast< float >( n.mantissa );
+	if ( n.exponent < 0 )
+		v /= g_exactPow10f[ -n.exponent ];
+	else
+		v *= g_exactPow10f[ n.exponent ];
+
+	if ( n.bNegative )
+		v = -v;
+	return true;
+}
+
+
+bool parseUnsigned( const char*& p, const char* end, unsigned long long& v )
+{
+	const char* s = p;
+	if ( s != end && *s == '+' )
+		++s;
+	if ( s == end || !isDigit( *s ) )
+		return false;
+
+	const unsigned long long maxValue = ~0ULL;
+	unsigned long long r = 0;
+	for ( ; s != end && isDigit( *s ); ++s )
+	{
+		const unsigned digit = *s - '0';
+		if ( r > ( maxValue - digit ) / 10 )
+			return false;
+		r = r * 10 + digit;
+	}
+
+	v = r;
+	p = s;
+	return true;
+}
+
+
+bool parseSigned( const char*& p, const char* end, long long& v )
+{
+	const char* s = p;
+	bool bNegative = false;
+	if ( s != end && ( *s == '-' || *s == '+' ) )
+		bNegative = *s++ == '-';
+	if ( s == end || !isDigit( *s ) )
+		return false;
+
+	unsigned long long magnitude;
+	if ( !parseUnsigned( s, end, magnitude ) )
+		return false;
+
+	const unsigned long long maxPositive = ~0ULL >> 1;
+	if ( magnitude > maxPositive + ( bNegative ? 1 : 0 ) )
+		return false;
+
+	v = bNegative ? static_cast< long long >( 0ULL - magnitude ) : static_cast< long long >( magnitude );
+	p = s;
+	return true;
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,85 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Locale-independent, allocation-free conversion between numbers and text.
+ * Used by the fast string archives, but useful wherever numbers have to be
+ * written to or read from a character buffer at high rate.
+ */
+
+#ifndef __UBITRACK_UTIL_NUMBERCONVERSION_H_INCLUDED__
+#define __UBITRACK_UTIL_NUMBERCONVERSION_H_INCLUDED__
+
+#include <cstddef>
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Writes a double in the shortest representation that reads back to exactly the same value.
+ * The output uses the same syntax as \c std::ostream (e.g. "0.1", "1e-05", "-3.25e+20"),
+ * but always with '.' as decimal separator.
+ *
+ * @param buf destination buffer (not zero-terminated)
+ * @param size size of the buffer
+ * @param v value to write
+ * @return number of characters written, or 0 if the buffer is too small
+ */
+UBITRACK_EXPORT std::size_t formatDouble( char* buf, std::size_t size, double v );
+
+/** Writes a float in the shortest round-trip representation. See \c formatDouble. */
+UBITRACK_EXPORT std::size_t formatFloat( char* buf, std::size_t size, float v );
+
+/** Writes a signed integer in decimal. Returns the number of characters written or 0 on overflow. */
+UBITRACK_EXPORT std::size_t formatSigned( char* buf, std::size_t size, long long v );
+
+/** Writes an unsigned integer in decimal. Returns the number of characters written or 0 on overflow. */
+UBITRACK_EXPORT std::size_t formatUnsigned( char* buf, std::size_t size, unsigned long long v );
+
+/**
+ * Reads a floating point number from the range [p, end).
+ * Accepts the syntax of \c std::istream with '.' as decimal separator, plus "inf" and "nan".
+ * Numbers with up to 19 significant digits are converted without calling the C library in
+ * almost all cases, the rest falls back to a locale-corrected \c strtod.
+ *
+ * @param p start of the text, advanced behind the number on success
+ * @param end end of the text
+ * @param v receives the value
+ * @return false if no number could be read or if it is too large for the type (e.g. "1e400"),
+ *   \c p is not changed then
+ */
+UBITRACK_EXPORT bool parseDouble( const char*& p, const char* end, double& v );
+
+/** Reads a float from the range [p, end). See \c parseDouble. */
+UBITRACK_EXPORT bool parseFloat( const char*& p, const char* end, float& v );
+
+/** Reads a signed decimal integer from the range [p, end). Fails on overflow. */
+UBITRACK_EXPORT bool parseSigned( const char*& p, const char* end, long long& v );
+
+/** Reads an unsigned decimal integer from the range [p, end). Fails on overflow. */
+UBITRACK_EXPORT bool parseUnsigned( const char*& p, const char* end, unsigned long long& v );
+
+} } // namespace Ubitrack::Util
+
+#endif
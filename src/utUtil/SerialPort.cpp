@@ -29,6 +29,13 @@
  */ 
 
  
+#ifdef __linux__
+	// linux/serial.h defines ASYNC_LOW_LATENCY as a macro, which collides with SerialPort::ASYNC_LOW_LATENCY
+	#include <linux/serial.h>
+	namespace { const int g_driverLowLatencyFlag = ASYNC_LOW_LATENCY; }
+	#undef ASYNC_LOW_LATENCY
+#endif
+
 #include "SerialPort.h"
 
 #ifdef _WIN32
@@ -109,6 +116,8 @@ void SerialPort::open( int vtime, int vmin )
 	*/
 void SerialPort::close()
 {
+	stopAsync();
+
 	if (m_hSerialPort != NULL)
 	{
 		CloseHandle(m_hSerialPort);
@@ -225,15 +234,33 @@ void SerialPort::sendBreak()
 }
 
 
+void SerialPort::openAsync( unsigned, std::size_t, std::size_t )
+{
+	UBITRACK_THROW( "Asynchronous serial port mode is not supported on this platform" );
+}
+
+
+void SerialPort::stopAsync()
+{
+}
+
+
 } } // namespace Ubitrack::Util
 
 #else // *nix
 
 
 #include <stdio.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifdef __linux__
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <boost/bind.hpp>
+#endif
+
 #include <iostream>
 
 #include <utUtil/Exception.h>
@@ -241,6 +268,45 @@ void SerialPort::sendBreak()
 
 namespace Ubitrack { namespace Util {
 
+#ifdef __linux__
+
+namespace {
+
+/** struct termios2 of the kernel, which glibc does not provide */
+struct KernelTermios2
+{
+	unsigned int c_iflag;
+	unsigned int c_oflag;
+	unsigned int c_cflag;
+	unsigned int c_lflag;
+	unsigned char c_line;
+	unsigned char c_cc[ 19 ];
+	unsigned int c_ispeed;
+	unsigned int c_ospeed;
+};
+
+const unsigned int g_kernelBaudMask = 0x0000100f; // CBAUD | CBAUDEX
+const unsigned int g_kernelBaudOther = 0x00001000; // BOTHER
+
+/** sets an arbitrary baud rate using the termios2 interface */
+bool setCustomBaudRate( int fd, unsigned long baudRate )
+{
+	KernelTermios2 tio;
+	if ( ioctl( fd, _IOR( 'T', 0x2A, KernelTermios2 ), &tio ) < 0 )
+		return false;
+
+	tio.c_cflag &= ~g_kernelBaudMask;
+	tio.c_cflag |= g_kernelBaudOther;
+	tio.c_ispeed = baudRate;
+	tio.c_ospeed = baudRate;
+	return ioctl( fd, _IOW( 'T', 0x2B, KernelTermios2 ), &tio ) >= 0;
+}
+
+} // anonymous namespace
+
+#endif // __linux__
+
+
 void SerialPort::open( int vtime, int vmin )
 {
 	if ( m_portOpen )
@@ -249,6 +315,7 @@ void SerialPort::open( int vtime, int vmin )
 	}
 
 	long baud;
+	bool bCustomBaudRate = false;
 	switch ( m_baudRate )
 	{
 	case 9600:
@@ -270,7 +337,14 @@ void SerialPort::open( int vtime, int vmin )
 		baud = B230400;
 		break;
 	default:
+#ifdef __linux__
+		// configured with termios2 after the other parameters are set
+		baud = B38400;
+		bCustomBaudRate = true;
+		break;
+#else
 		UBITRACK_THROW( "Unsupported baud rate" );
+#endif
 	}
 
 	int size = CS8;
@@ -314,9 +388,159 @@ void SerialPort::open( int vtime, int vmin )
 	if ( tcsetattr( m_fileDescriptor, TCSANOW, &m_termiosCurrent ) < 0 )
 		UBITRACK_THROW( "Cannot set port parameter" );
 
+#ifdef __linux__
+	if ( bCustomBaudRate && !setCustomBaudRate( m_fileDescriptor, m_baudRate ) )
+		UBITRACK_THROW( "Unsupported baud rate" );
+#endif
+
 	m_portOpen = true;
 }
 
+
+#ifdef __linux__
+
+void SerialPort::openAsync( unsigned flags, std::size_t bufferSize, std::size_t maxFrameSize )
+{
+	if ( m_portOpen )
+		UBITRACK_THROW( "Serial port " + m_portName + " is already open" );
+
+	// the reader thread drains the driver buffer with non-blocking reads
+	open( 0, 0 );
+	fcntl( m_fileDescriptor, F_SETFL, fcntl( m_fileDescriptor, F_GETFL ) | O_NONBLOCK );
+
+	if ( flags & ASYNC_LOW_LATENCY )
+	{
+		// not all drivers support this, so fail silently
+		struct serial_struct serial;
+		if ( ioctl( m_fileDescriptor, TIOCGSERIAL, &serial ) == 0 )
+		{
+			serial.flags |= g_driverLowLatencyFlag;
+			ioctl( m_fileDescriptor, TIOCSSERIAL, &serial );
+		}
+	}
+
+	m_wakeupFd = eventfd( 0, 0 );
+	m_epollFd = epoll_create( 2 );
+	if ( m_wakeupFd < 0 || m_epollFd < 0 )
+	{
+		close();
+		UBITRACK_THROW( "Cannot create event descriptors" );
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.fd = m_fileDescriptor;
+	epoll_ctl( m_epollFd, EPOLL_CTL_ADD, m_fileDescriptor, &event );
+	event.data.fd = m_wakeupFd;
+	epoll_ctl( m_epollFd, EPOLL_CTL_ADD, m_wakeupFd, &event );
+
+	m_pRingBuffer.reset( new TimestampedRingBuffer( bufferSize, maxFrameSize ) );
+	m_asyncStop = false;
+	m_pReaderThread.reset( new boost::thread( boost::bind( &SerialPort::asyncReaderThread, this ) ) );
+}
+
+
+void SerialPort::asyncReaderThread()
+{
+	unsigned char discard[ 256 ];
+	struct epoll_event events[ 2 ];
+
+	while ( !m_asyncStop )
+	{
+		const int nEvents = epoll_wait( m_epollFd, events, 2, -1 );
+		if ( nEvents < 0 && errno == EINTR )
+			continue;
+		if ( nEvents < 0 )
+			break;
+
+		// taken before reading, so the time is as close to the arrival as possible
+		const Measurement::Timestamp arrival = Measurement::now();
+
+		bool bReadable = false;
+		for ( int i = 0; i < nEvents; i++ )
+			if ( events[ i ].data.fd == m_fileDescriptor )
+				bReadable = true;
+		if ( !bReadable )
+			continue;
+
+		// drain the driver buffer
+		bool bError = false;
+		for ( ;; )
+		{
+			std::size_t space;
+			unsigned char* pSpace = m_pRingBuffer->writeSpace( space );
+
+			ssize_t nRead;
+			if ( space == 0 )
+			{
+				nRead = ::read( m_fileDescriptor, discard, sizeof( discard ) );
+				if ( nRead > 0 )
+					m_pRingBuffer->addOverflow( nRead );
+				space = sizeof( discard );
+			}
+			else
+			{
+				nRead = ::read( m_fileDescriptor, pSpace, space );
+				if ( nRead > 0 )
+					m_pRingBuffer->commit( nRead, arrival );
+			}
+
+			if ( nRead == 0 || ( nRead < 0 && errno != EAGAIN && errno != EINTR ) )
+				bError = true;
+			if ( nRead <= 0 || static_cast< std::size_t >( nRead ) < space )
+				break;
+		}
+
+		// wake up consumers blocked in waitForData
+		boost::atomic_thread_fence( boost::memory_order_seq_cst );
+		if ( m_asyncWaiting.load() )
+		{
+			boost::mutex::scoped_lock lock( m_waitMutex );
+			m_dataAvailable.notify_all();
+		}
+
+		// device is gone
+		if ( bError )
+			break;
+	}
+}
+
+
+void SerialPort::stopAsync()
+{
+	if ( m_pReaderThread )
+	{
+		m_asyncStop = true;
+		const eventfd_t one = 1;
+		eventfd_write( m_wakeupFd, one );
+		m_pReaderThread->join();
+		m_pReaderThread.reset();
+	}
+
+	if ( m_epollFd >= 0 )
+		::close( m_epollFd );
+	if ( m_wakeupFd >= 0 )
+		::close( m_wakeupFd );
+	m_epollFd = -1;
+	m_wakeupFd = -1;
+
+	m_pRingBuffer.reset();
+}
+
+#else // __linux__
+
+void SerialPort::openAsync( unsigned, std::size_t, std::size_t )
+{
+	UBITRACK_THROW( "Asynchronous serial port mode is not supported on this platform" );
+}
+
+
+void SerialPort::stopAsync()
+{
+}
+
+#endif // __linux__
+
 void SerialPort::close()
 {
 	if ( !m_portOpen )
@@ -324,12 +548,15 @@ void SerialPort::close()
 		return;
 	}
 
+	stopAsync();
+
 	if ( tcsetattr( m_fileDescriptor, TCSANOW, &m_termiosOriginal ) < 0 )
 	{
 		// fail silently
 	}
 
 	::close( m_fileDescriptor );
+	m_portOpen = false;
 }
 
 unsigned long SerialPort::read( unsigned char* buffer, unsigned long size )
@@ -339,6 +566,12 @@ unsigned long SerialPort::read( unsigned char* buffer, unsigned long size )
 	if ( !m_portOpen )
 		UBITRACK_THROW( "Port is not open" );
 
+	if ( isAsync() )
+	{
+		Measurement::Timestamp time;
+		return read( buffer, size, time );
+	}
+
 	readBytes = ::read( m_fileDescriptor, (void*) buffer, size );
 
 	if ( readBytes < 0 )
@@ -364,6 +597,9 @@ unsigned long SerialPort::bytesOnRead()
 	if ( !m_portOpen )
 		UBITRACK_THROW( "Port is not open" );
 
+	if ( isAsync() )
+		return m_pRingBuffer->available();
+
 	int onread;
 	ioctl( m_fileDescriptor, FIONREAD, (char*) &onread );
 
@@ -378,9 +614,91 @@ void SerialPort::sendBreak()
 void SerialPort::flush()
 {
 	tcflush( m_fileDescriptor, TCIOFLUSH );
+
+	if ( isAsync() )
+		m_pRingBuffer->consume( m_pRingBuffer->available() );
 }
 
 } } // namespace Ubitrack::Util
 
 #endif
 
+
+// platform-independent part of the asynchronous mode
+
+#include <cstring>
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+
+namespace Ubitrack { namespace Util {
+
+unsigned long SerialPort::read( unsigned char* buffer, unsigned long size, Measurement::Timestamp& time )
+{
+	if ( !isAsync() )
+	{
+		const unsigned long nRead = read( buffer, size );
+		time = Measurement::now();
+		return nRead;
+	}
+
+	unsigned long nCopied = 0;
+	TimestampedFrame frame;
+	while ( nCopied < size && m_pRingBuffer->peek( frame ) )
+	{
+		if ( nCopied == 0 )
+			time = frame.startTime;
+
+		const std::size_t n = std::min< std::size_t >( frame.size, size - nCopied );
+		std::memcpy( buffer + nCopied, frame.data, n );
+		m_pRingBuffer->consume( n );
+		nCopied += n;
+	}
+	return nCopied;
+}
+
+
+bool SerialPort::nextFrame( TimestampedFrame& frame, const FramingFunction& framer )
+{
+	if ( !isAsync() )
+		UBITRACK_THROW( "Port is not in asynchronous mode" );
+
+	return m_pRingBuffer->nextFrame( frame, framer );
+}
+
+
+void SerialPort::releaseFrame( const TimestampedFrame& frame )
+{
+	if ( isAsync() )
+		m_pRingBuffer->consume( frame.size );
+}
+
+
+bool SerialPort::waitForData( unsigned timeoutMs )
+{
+	if ( !isAsync() )
+		UBITRACK_THROW( "Port is not in asynchronous mode" );
+
+	if ( m_pRingBuffer->available() )
+		return true;
+
+	boost::mutex::scoped_lock lock( m_waitMutex );
+	m_asyncWaiting.store( true );
+	boost::atomic_thread_fence( boost::memory_order_seq_cst );
+
+	const boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds( timeoutMs );
+	while ( !m_pRingBuffer->available() )
+		if ( !m_dataAvailable.timed_wait( lock, deadline ) )
+			break;
+
+	m_asyncWaiting.store( false );
+	return m_pRingBuffer->available() != 0;
+}
+
+
+std::size_t SerialPort::overflowBytes() const
+{
+	return isAsync() ? m_pRingBuffer->overflowBytes() : 0;
+}
+
+} } // namespace Ubitrack::Util
+
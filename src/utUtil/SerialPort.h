@@ -35,8 +35,15 @@
 
 
 #include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <utCore.h>
 #include <utUtil/Exception.h>
+#include <utUtil/TimestampedRingBuffer.h>
+#include <utMeasurement/Timestamp.h>
 
 #ifdef _WIN32
 
@@ -60,9 +67,37 @@
 
 namespace Ubitrack { namespace Util {
 
+/**
+ * Serial port.
+ *
+ * In the default, synchronous mode, \c read() blocks according to the \c vtime and \c vmin
+ * parameters given to \c open().
+ *
+ * After \c openAsync(), a reader thread waits for incoming data and stores it in a lock-free
+ * ring buffer, tagged with the time of arrival. The data can then be accessed without blocking,
+ * either by copying (\c read()) or in place, split into frames by a user-supplied framing
+ * function (\c nextFrame()). Asynchronous mode is currently only available on Linux.
+ */
 class UBITRACK_EXPORT SerialPort
 {
 public:
+	/** flags for \c openAsync() */
+	enum AsyncFlags
+	{
+		/** no special tuning */
+		ASYNC_DEFAULT = 0,
+
+		/** ask the driver to pass on received bytes immediately instead of batching them */
+		ASYNC_LOW_LATENCY = 1
+	};
+
+	/**
+	 * @param port name of the device
+	 * @param baudRate baud rate. On Linux, non-standard rates are supported.
+	 * @param bits data bits
+	 * @param parity parity, one of N, O, E
+	 * @param stop number of stop bits
+	 */
 	SerialPort( std::string port, unsigned long baudRate, int bits = 8, int parity = 0, int stop = 1 )
 		: m_portName( port )
 		, m_baudRate( baudRate )
@@ -70,6 +105,12 @@ public:
 		, m_bits( bits )
 		, m_parity( parity )
 		, m_stop( stop )
+		, m_asyncStop( false )
+		, m_asyncWaiting( false )
+#ifndef _WIN32
+		, m_wakeupFd( -1 )
+		, m_epollFd( -1 )
+#endif
 	{}
 
 	~SerialPort( )
@@ -79,11 +120,55 @@ public:
 
 
 	void open( int vtime = 5, int vmin = 0 );
+
+	/**
+	 * Opens the port in asynchronous mode and starts the reader thread.
+	 * Throws if the port is already open.
+	 *
+	 * @param flags combination of \c AsyncFlags
+	 * @param bufferSize size of the receive ring buffer in bytes
+	 * @param maxFrameSize maximum size of a frame returned by \c nextFrame()
+	 */
+	void openAsync( unsigned flags = ASYNC_DEFAULT, std::size_t bufferSize = 65536, std::size_t maxFrameSize = 1024 );
+
 	void close();
 
+	/** true if the port has been opened with \c openAsync() */
+	bool isAsync() const
+	{ return m_pRingBuffer.get() != 0; }
+
 	unsigned long send( const unsigned char* buffer, unsigned long size );
 	unsigned long read( unsigned char* buffer, unsigned long size );
 
+	/**
+	 * Reads data and returns the time it arrived.
+	 * In asynchronous mode, this never blocks and \c time is the arrival time of the first byte.
+	 * In synchronous mode, \c time is taken after the read returns.
+	 */
+	unsigned long read( unsigned char* buffer, unsigned long size, Measurement::Timestamp& time );
+
+	/**
+	 * Asynchronous mode: returns a view of the next complete frame in the receive buffer.
+	 * The frame must be released with \c releaseFrame() before the next call.
+	 *
+	 * @param frame receives the frame
+	 * @param framer function that determines the frame boundaries
+	 * @return false if no complete frame has been received yet
+	 */
+	bool nextFrame( TimestampedFrame& frame, const FramingFunction& framer );
+
+	/** Asynchronous mode: frees the memory of a frame returned by \c nextFrame() */
+	void releaseFrame( const TimestampedFrame& frame );
+
+	/**
+	 * Asynchronous mode: waits until data is available or the timeout expires.
+	 * @return true if data is available
+	 */
+	bool waitForData( unsigned timeoutMs );
+
+	/** Asynchronous mode: number of bytes dropped because the receive buffer was full */
+	std::size_t overflowBytes() const;
+
 	unsigned long bytesOnRead();
 	void sendBreak();
 	void flush();
@@ -95,11 +180,27 @@ public:
 
 protected:
 
+	/** body of the reader thread in asynchronous mode */
+	void asyncReaderThread();
+
+	/** stops the reader thread and releases the ring buffer */
+	void stopAsync();
+
 	std::string m_portName;
 	unsigned long m_baudRate;
 	bool m_portOpen;
 	int m_bits, m_parity, m_stop;
 
+	/** receive buffer in asynchronous mode */
+	boost::shared_ptr< TimestampedRingBuffer > m_pRingBuffer;
+	boost::shared_ptr< boost::thread > m_pReaderThread;
+	boost::atomic< bool > m_asyncStop;
+
+	/** used to wake up consumers in \c waitForData() */
+	boost::atomic< bool > m_asyncWaiting;
+	boost::mutex m_waitMutex;
+	boost::condition_variable m_dataAvailable;
+
 #ifdef _WIN32
 
 	HANDLE        m_hSerialPort;
@@ -110,6 +211,10 @@ protected:
 	struct termios m_termiosCurrent;
 	struct termios m_termiosOriginal;
 
+	/** eventfd to stop the reader thread */
+	int m_wakeupFd;
+	int m_epollFd;
+
 #endif
 
 };
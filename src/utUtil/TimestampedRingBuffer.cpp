@@ -0,0 +1,195 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Implements the timestamped single-producer/single-consumer ring buffer
+ */
+
+#include "TimestampedRingBuffer.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+std::size_t roundUpToPowerOfTwo( std::size_t n )
+{
+	std::size_t p = 1;
+	while ( p < n )
+		p <<= 1;
+	return p;
+}
+
+/** compares stream positions that wrap around */
+bool positionBefore( std::size_t a, std::size_t b )
+{
+	return static_cast< std::ptrdiff_t >( a - b ) < 0;
+}
+
+} // anonymous namespace
+
+
+TimestampedRingBuffer::TimestampedRingBuffer( std::size_t capacity, std::size_t maxFrameSize )
+	: m_capacity( roundUpToPowerOfTwo( std::max( capacity, 2 * maxFrameSize ) ) )
+	, m_maxFrameSize( maxFrameSize )
+	, m_writePos( 0 )
+	, m_readPos( 0 )
+	, m_chunkWrite( 0 )
+	, m_chunkRead( 0 )
+	, m_overflowBytes( 0 )
+{
+	m_data.resize( m_capacity + m_maxFrameSize );
+	m_chunks.resize( roundUpToPowerOfTwo( std::max< std::size_t >( m_capacity / 16, 64 ) ) );
+}
+
+
+unsigned char* TimestampedRingBuffer::writeSpace( std::size_t& size )
+{
+	const std::size_t writePos = m_writePos.load( boost::memory_order_relaxed );
+	const std::size_t used = writePos - m_readPos.load( boost::memory_order_acquire );
+	const std::size_t physical = writePos & ( m_capacity - 1 );
+
+	// data can only be published with a chunk descriptor
+	if ( !chunkAvailable() )
+		size = 0;
+	else
+		size = std::min( m_capacity - used, m_capacity - physical );
+	return &m_data[ physical ];
+}
+
+
+bool TimestampedRingBuffer::chunkAvailable() const
+{
+	return m_chunkWrite.load( boost::memory_order_relaxed ) - m_chunkRead.load( boost::memory_order_acquire ) < m_chunks.size();
+}
+
+
+bool TimestampedRingBuffer::commit( std::size_t size, Measurement::Timestamp time )
+{
+	if ( size == 0 )
+		return true;
+
+	if ( !chunkAvailable() )
+	{
+		addOverflow( size );
+		return false;
+	}
+
+	const std::size_t writePos = m_writePos.load( boost::memory_order_relaxed );
+	const std::size_t physical = writePos & ( m_capacity - 1 );
+
+	// keep the mirror area behind the end of the buffer up to date
+	if ( physical < m_maxFrameSize )
+		std::memcpy( &m_data[ m_capacity + physical ], &m_data[ physical ], std::min( size, m_maxFrameSize - physical ) );
+
+	const std::size_t chunkWrite = m_chunkWrite.load( boost::memory_order_relaxed );
+	Chunk& chunk = m_chunks[ chunkWrite & ( m_chunks.size() - 1 ) ];
+	chunk.end = writePos + size;
+	chunk.time = time;
+	m_chunkWrite.store( chunkWrite + 1, boost::memory_order_release );
+	m_writePos.store( chunk.end, boost::memory_order_release );
+	return true;
+}
+
+
+std::size_t TimestampedRingBuffer::available() const
+{
+	return m_writePos.load( boost::memory_order_acquire ) - m_readPos.load( boost::memory_order_relaxed );
+}
+
+
+Measurement::Timestamp TimestampedRingBuffer::timeOf( std::size_t position ) const
+{
+	const std::size_t chunkWrite = m_chunkWrite.load( boost::memory_order_acquire );
+	for ( std::size_t i = m_chunkRead.load( boost::memory_order_relaxed ); i != chunkWrite; i++ )
+	{
+		const Chunk& chunk = m_chunks[ i & ( m_chunks.size() - 1 ) ];
+		if ( positionBefore( position, chunk.end ) )
+			return chunk.time;
+	}
+	return 0;
+}
+
+
+bool TimestampedRingBuffer::peek( TimestampedFrame& frame ) const
+{
+	const std::size_t size = std::min( available(), m_maxFrameSize );
+	if ( size == 0 )
+		return false;
+
+	const std::size_t readPos = m_readPos.load( boost::memory_order_relaxed );
+	frame.data = &m_data[ readPos & ( m_capacity - 1 ) ];
+	frame.size = size;
+	frame.startTime = timeOf( readPos );
+	frame.time = timeOf( readPos + size - 1 );
+	return true;
+}
+
+
+bool TimestampedRingBuffer::nextFrame( TimestampedFrame& frame, const FramingFunction& framer )
+{
+	while ( peek( frame ) )
+	{
+		long result = framer( frame.data, frame.size );
+
+		// a frame longer than the available data is not complete yet
+		if ( result > 0 && static_cast< std::size_t >( result ) > frame.size )
+			result = 0;
+
+		if ( result > 0 )
+		{
+			const std::size_t readPos = m_readPos.load( boost::memory_order_relaxed );
+			frame.size = result;
+			frame.time = timeOf( readPos + frame.size - 1 );
+			return true;
+		}
+		else if ( result < 0 )
+			consume( std::min( static_cast< std::size_t >( -result ), frame.size ) );
+		else if ( frame.size == m_maxFrameSize )
+			// no frame fits into the view: the stream is out of sync, drop a byte
+			consume( 1 );
+		else
+			return false;
+	}
+	return false;
+}
+
+
+void TimestampedRingBuffer::consume( std::size_t size )
+{
+	const std::size_t readPos = m_readPos.load( boost::memory_order_relaxed ) + std::min( size, available() );
+
+	// drop the descriptors of chunks that have been consumed completely
+	const std::size_t chunkWrite = m_chunkWrite.load( boost::memory_order_acquire );
+	std::size_t chunkRead = m_chunkRead.load( boost::memory_order_relaxed );
+	while ( chunkRead != chunkWrite && !positionBefore( readPos, m_chunks[ chunkRead & ( m_chunks.size() - 1 ) ].end ) )
+		chunkRead++;
+
+	m_chunkRead.store( chunkRead, boost::memory_order_release );
+	m_readPos.store( readPos, boost::memory_order_release );
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,186 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Lock-free single-producer/single-consumer byte ring buffer that remembers
+ * the arrival time of each chunk of data.
+ */
+
+#ifndef __UBITRACK_UTIL_TIMESTAMPEDRINGBUFFER_H_INCLUDED__
+#define __UBITRACK_UTIL_TIMESTAMPEDRINGBUFFER_H_INCLUDED__
+
+#include <vector>
+#include <cstddef>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+#include <utCore.h>
+#include <utMeasurement/Timestamp.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Zero-copy view of received data.
+ * The pointer stays valid until the data is released.
+ */
+struct TimestampedFrame
+{
+	/** arrival time of the first byte */
+	Measurement::Timestamp startTime;
+
+	/** arrival time of the last byte */
+	Measurement::Timestamp time;
+
+	/** pointer to the first byte */
+	const unsigned char* data;
+
+	/** number of bytes */
+	std::size_t size;
+};
+
+/**
+ * Framing callback. Gets the received, not yet consumed bytes and returns
+ *   - the length of a complete frame at the beginning of the data,
+ *   - 0 if more data is needed, or
+ *   - a negative number -n to discard n bytes, e.g. to resynchronize to a frame header.
+ */
+typedef boost::function< long ( const unsigned char* data, std::size_t size ) > FramingFunction;
+
+/**
+ * Ring buffer for a byte stream produced by one thread and consumed by another.
+ *
+ * The producer obtains contiguous write space with \c writeSpace(), fills it (e.g. by
+ * calling \c read() on a device) and publishes it together with the arrival time using
+ * \c commit(). The consumer accesses the data in place via \c peek() or \c nextFrame()
+ * and frees it with \c consume(). No locks are taken and no memory is allocated after
+ * construction.
+ *
+ * The first \c maxFrameSize bytes of the buffer are mirrored behind its end, so any
+ * sequence of up to \c maxFrameSize bytes can be accessed contiguously, even if it wraps around.
+ */
+class UBITRACK_EXPORT TimestampedRingBuffer
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * @param capacity size of the buffer in bytes, rounded up to a power of two
+	 * @param maxFrameSize maximum number of bytes that can be viewed contiguously
+	 */
+	TimestampedRingBuffer( std::size_t capacity, std::size_t maxFrameSize );
+
+	/** @name producer interface */
+	/// @{
+
+	/**
+	 * returns the contiguous free space at the write position. The size is 0 if the buffer
+	 * is full or if all chunk descriptors are in use, i.e. the consumer holds many small,
+	 * unconsumed chunks.
+	 * @param size receives the number of bytes that may be written
+	 * @return pointer to the write position
+	 */
+	unsigned char* writeSpace( std::size_t& size );
+
+	/**
+	 * publishes \c size bytes written to the space returned by \c writeSpace()
+	 * @param size number of bytes written
+	 * @param time arrival time of the data
+	 * @return false if no chunk descriptor was free, the data is dropped and counted as overflow then
+	 */
+	bool commit( std::size_t size, Measurement::Timestamp time );
+
+	/** counts bytes that had to be dropped because the buffer was full */
+	void addOverflow( std::size_t size )
+	{ m_overflowBytes.fetch_add( size, boost::memory_order_relaxed ); }
+
+	/// @}
+
+	/** @name consumer interface */
+	/// @{
+
+	/** number of bytes available to the consumer */
+	std::size_t available() const;
+
+	/**
+	 * returns a view of the available bytes, limited to \c maxFrameSize
+	 * @return false if no data is available
+	 */
+	bool peek( TimestampedFrame& frame ) const;
+
+	/**
+	 * uses the framing function to find the next complete frame.
+	 * Data the framer discards is consumed immediately, the frame itself has to be
+	 * released with \c consume( frame.size ) after use.
+	 * @return false if no complete frame is available yet
+	 */
+	bool nextFrame( TimestampedFrame& frame, const FramingFunction& framer );
+
+	/** frees \c size bytes at the read position */
+	void consume( std::size_t size );
+
+	/// @}
+
+	/** number of bytes dropped because the consumer was too slow */
+	std::size_t overflowBytes() const
+	{ return m_overflowBytes.load( boost::memory_order_relaxed ); }
+
+	/** maximum number of bytes that can be viewed contiguously */
+	std::size_t maxFrameSize() const
+	{ return m_maxFrameSize; }
+
+protected:
+	/** arrival time of all bytes up to (excluding) a stream position */
+	struct Chunk
+	{
+		std::size_t end;
+		Measurement::Timestamp time;
+	};
+
+	/** true if the producer can publish another chunk */
+	bool chunkAvailable() const;
+
+	/** returns the arrival time of the byte at the given stream position */
+	Measurement::Timestamp timeOf( std::size_t position ) const;
+
+	/** data, followed by the mirror area */
+	std::vector< unsigned char > m_data;
+	std::size_t m_capacity;
+	std::size_t m_maxFrameSize;
+
+	/** chunk descriptors, a ring of its own */
+	std::vector< Chunk > m_chunks;
+
+	/** stream positions, wrapping modulo 2^n */
+	boost::atomic< std::size_t > m_writePos;
+	boost::atomic< std::size_t > m_readPos;
+
+	/** chunk indices */
+	boost::atomic< std::size_t > m_chunkWrite;
+	boost::atomic< std::size_t > m_chunkRead;
+
+	boost::atomic< std::size_t > m_overflowBytes;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -2,6 +2,8 @@
 #include <math.h>
 #include <boost/test/floating_point_comparison.hpp>
 #include <utCalibration/2D3DPoseEstimation.h>
+#include <utCalibration/PoseTracker.h>
+#include <utCalibration/2D3DPoseEstimationHager.h>
 #include "../tools.h"
 #include <boost/numeric/ublas/vector_proxy.hpp>
 
@@ -83,8 +85,260 @@ void TestOptimizePose( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+template< typename T >
+void TestComputePoseInitialization( const std::size_t n_runs, const T epsilon, bool bPlanar,
+	Ubitrack::Calibration::InitializationMethod initMethod )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -0.5, 0.5 ); // 3d Points
+	typename Random::Vector< T, 3 >::Uniform randTranslation( -0.5, 0.5 ); //translation
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		// random intrinsics matrix
+		Matrix< T, 3, 3 > cam( Matrix< T, 3, 3 >::identity() );
+		cam( 0, 0 ) = Random::distribute_uniform< T >( 200, 800 );
+		cam( 1, 1 ) = Random::distribute_uniform< T >( 200, 800 );
+
+		// random pose
+		Quaternion rot( randQuat( ) );
+		Vector< T, 3 > trans ( randTranslation() );
+		trans( 2 ) = Random::distribute_uniform< T >( 3, 10 );
+
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 4, 30 ) );
+		std::vector< Ubitrack::Math::Vector< T, 3 > > p3D;
+		p3D.reserve( n );
+		std::generate_n ( std::back_inserter( p3D ), n,  randVector );
+		if ( initMethod == Ubitrack::Calibration::MINIMAL_P3P )
+		{
+			// P3P uses the first three points, which must not be close to colinear
+			p3D[ 0 ]( 0 ) = -0.5; p3D[ 0 ]( 1 ) = -0.5;
+			p3D[ 1 ]( 0 ) = 0.5; p3D[ 1 ]( 1 ) = -0.5;
+			p3D[ 2 ]( 0 ) = 0.0; p3D[ 2 ]( 1 ) = 0.5;
+		}
+		if ( bPlanar )
+			for ( std::size_t i = 0; i < n; i++ )
+				p3D[ i ]( 2 ) = 0;
+
+		// project to 2D points
+		Matrix< T, 3, 4 > proj( rot, trans );
+		proj = boost::numeric::ublas::prod( cam, proj );
+		std::vector< Vector< T, 2 > > p2D;
+		p2D.reserve( n );
+		std::transform( p3D.begin(), p3D.end(), std::back_inserter( p2D ), Functors::ProjectVector< T >( proj ) );
+
+		// without noise and optimization, the initialization alone must be exact
+		double residual;
+		ErrorPose pose( Ubitrack::Calibration::computePose( p2D, p3D, cam, residual, false, initMethod ) );
+
+		BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), rot ), epsilon );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - trans ), epsilon );
+		BOOST_CHECK_SMALL( residual, epsilon );
+	}
+}
+
+void TestComputePoseRansac( const std::size_t n_runs )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 ); // 3d Points
+	Random::Vector< double, 3 >::Uniform randTranslation( -0.5, 0.5 ); //translation
+	Random::Vector< double, 2 >::Normal randNoise( 0, 0.5 ); // image noise
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+		cam( 0, 0 ) = Random::distribute_uniform< double >( 400, 800 );
+		cam( 1, 1 ) = Random::distribute_uniform< double >( 400, 800 );
+
+		Quaternion rot( randQuat( ) );
+		Vector< double, 3 > trans ( randTranslation() );
+		trans( 2 ) = Random::distribute_uniform< double >( 3, 6 );
+
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 20, 60 ) );
+		std::vector< Vector< double, 3 > > p3D;
+		p3D.reserve( n );
+		std::generate_n ( std::back_inserter( p3D ), n,  randVector );
+
+		Matrix< double, 3, 4 > proj( rot, trans );
+		proj = boost::numeric::ublas::prod( cam, proj );
+		std::vector< Vector< double, 2 > > p2D;
+		p2D.reserve( n );
+		std::transform( p3D.begin(), p3D.end(), std::back_inserter( p2D ), Functors::ProjectVector< double >( proj ) );
+
+		// noise on all points, 30% gross outliers
+		std::vector< bool > outlier( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			outlier[ i ] = Random::distribute_uniform< double >( 0, 1 ) < 0.3;
+			if ( outlier[ i ] )
+				p2D[ i ] += Vector< double, 2 >( Random::distribute_uniform< double >( 20, 100 ), Random::distribute_uniform< double >( -100, 100 ) );
+			else
+				p2D[ i ] += randNoise();
+		}
+
+		std::vector< bool > inliers;
+		double residual;
+		ErrorPose pose( Ubitrack::Calibration::computePoseRansac( p2D, p3D, cam, inliers, residual ) );
+
+		BOOST_CHECK_EQUAL( inliers.size(), n );
+		for ( std::size_t i = 0; i < n; i++ )
+			BOOST_CHECK( inliers[ i ] != outlier[ i ] );
+
+		// inlier flags and residual refer to the returned pose
+		Functors::ProjectVector< double > projectResult( cam, pose );
+		double fSquaredError( 0 );
+		std::size_t nInliers( 0 );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const double e( ublas::norm_2( projectResult( p3D[ i ] ) - p2D[ i ] ) );
+			BOOST_CHECK_EQUAL( inliers[ i ], e < 4.0 );
+			if ( inliers[ i ] )
+			{
+				fSquaredError += e * e;
+				nInliers++;
+			}
+		}
+		BOOST_CHECK_CLOSE( residual, sqrt( fSquaredError / ( 2 * nInliers ) ), 1e-6 );
+		// 0.5 pixel noise on as few as 14 inliers of a small target
+		BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), rot ), 3e-2 );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - trans ), 5e-2 );
+		BOOST_CHECK_SMALL( residual, 1.0 );
+	}
+}
+
+void TestPoseTracker( const std::size_t n_runs )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 ); // 3d Points
+	Random::Vector< double, 2 >::Normal randNoise( 0, 0.3 ); // image noise
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+		cam( 0, 0 ) = cam( 1, 1 ) = Random::distribute_uniform< double >( 400, 800 );
+
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 6, 30 ) );
+		std::vector< Vector< double, 3 > > p3D;
+		p3D.reserve( n );
+		std::generate_n ( std::back_inserter( p3D ), n,  randVector );
+
+		// smooth motion: constant angular and linear velocity
+		Quaternion rot( randQuat( ) );
+		Vector< double, 3 > trans( 0, 0, Random::distribute_uniform< double >( 3, 6 ) );
+		const Quaternion angularVelocity( Vector< double, 3 >( randVector() ), 0.02 );
+		const Vector< double, 3 > velocity( randVector() * 0.02 );
+
+		Ubitrack::Calibration::PoseTracker tracker( cam, Ubitrack::Calibration::EPNP );
+		for ( std::size_t iFrame = 0; iFrame < 30; iFrame++ )
+		{
+			rot = angularVelocity * rot;
+			trans += velocity;
+
+			Matrix< double, 3, 4 > proj( rot, trans );
+			proj = boost::numeric::ublas::prod( cam, proj );
+			std::vector< Vector< double, 2 > > p2D;
+			p2D.reserve( n );
+			std::transform( p3D.begin(), p3D.end(), std::back_inserter( p2D ), Functors::ProjectVector< double >( proj ) );
+			for ( std::size_t i = 0; i < n; i++ )
+				p2D[ i ] += randNoise();
+
+			double residual;
+			ErrorPose pose( tracker.track( p2D, p3D, residual ) );
+
+			BOOST_CHECK_EQUAL( tracker.reinitialized(), iFrame == 0 );
+			BOOST_CHECK( tracker.iterations() <= 3 );
+			BOOST_CHECK_SMALL( residual, 1.0 );
+
+			// covariance from the normal equations, as computed by computePose
+			const Matrix< double, 6, 6 > covariance( Ubitrack::Calibration::singleCameraPoseError( pose, p3D, cam, 
+				residual * residual * 2 * n ) );
+			BOOST_CHECK_SMALL( ublas::norm_inf( pose.covariance() - covariance ) / ublas::norm_inf( covariance ), 1e-6 );
+
+			// the warm start must reach the same minimum as a full optimization
+			double fullResidual;
+			ErrorPose full( Ubitrack::Calibration::computePose( p2D, p3D, cam, fullResidual, true, Ubitrack::Calibration::EPNP ) );
+			BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), full.rotation() ), 1e-3 );
+			BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - full.translation() ), 1e-2 );
+			BOOST_CHECK( residual <= fullResidual * 1.01 + 1e-9 );
+		}
+
+		// flipping the object over must trigger re-initialization
+		rot = Quaternion( Vector< double, 3 >( 1, 0, 0 ), M_PI ) * rot;
+		Matrix< double, 3, 4 > proj( rot, trans );
+		proj = boost::numeric::ublas::prod( cam, proj );
+		std::vector< Vector< double, 2 > > p2D;
+		std::transform( p3D.begin(), p3D.end(), std::back_inserter( p2D ), Functors::ProjectVector< double >( proj ) );
+		double residual;
+		ErrorPose pose( tracker.track( p2D, p3D, residual ) );
+		BOOST_CHECK( tracker.reinitialized() );
+		BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), rot ), 1e-6 );
+		BOOST_CHECK_SMALL( residual, 1e-6 );
+	}
+}
+
+void TestHagerWorkspace( const std::size_t n_runs )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 );
+
+	// the workspace is reused for all runs with changing number of points
+	Ubitrack::Calibration::HagerWorkspace< double > workspace;
+	const Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+	std::size_t nFound = 0;
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		Quaternion rot( randQuat( ) );
+		Vector< double, 3 > trans( randVector() );
+		trans( 2 ) = -Random::distribute_uniform< double >( 3, 10 );
+
+		// noise-free image points in homogeneous normalized coordinates
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 4, 30 ) );
+		std::vector< Vector< double, 3 > > p3D;
+		std::vector< Vector< double, 3 > > p2D;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			p3D.push_back( randVector() );
+			Vector< double, 3 > x( rot * p3D.back() + trans );
+			p2D.push_back( x / -x( 2 ) );
+		}
+
+		Pose pose;
+		unsigned nIterations = 1000;
+		double error = 1e-10;
+		bool bConverged = Ubitrack::Calibration::estimatePose( pose, p2D, p3D, cam, nIterations, error, workspace );
+
+		// the noise-free scene is recovered, unless the iteration ends in a local minimum
+		if ( bConverged && quaternionDiff( pose.rotation(), rot ) < 1e-4 && ublas::norm_2( pose.translation() - trans ) < 1e-4 )
+			nFound++;
+
+		// leftovers of earlier runs with other point counts must not change the result
+		Ubitrack::Calibration::HagerWorkspace< double > freshWorkspace;
+		Pose freshPose;
+		unsigned nFreshIterations = 1000;
+		double freshError = 1e-10;
+		bool bFreshConverged = Ubitrack::Calibration::estimatePose( freshPose, p2D, p3D, cam, nFreshIterations, freshError, freshWorkspace );
+		BOOST_CHECK_EQUAL( bConverged, bFreshConverged );
+		BOOST_CHECK_EQUAL( nIterations, nFreshIterations );
+		BOOST_CHECK_EQUAL( error, freshError );
+		BOOST_CHECK_EQUAL( quaternionDiff( pose.rotation(), freshPose.rotation() ), 0.0 );
+		BOOST_CHECK_EQUAL( ublas::norm_2( pose.translation() - freshPose.translation() ), 0.0 );
+	}
+
+	// the iteration may end in a local minimum, but not regularly
+	BOOST_CHECK( nFound >= n_runs * 9 / 10 );
+}
+
 void Test2D3DPoseEstimation()
 {
+	TestComputePoseInitialization< double >( 1000, 1e-6, false, Ubitrack::Calibration::MINIMAL_P3P );
+	TestComputePoseInitialization< double >( 1000, 1e-6, true, Ubitrack::Calibration::MINIMAL_P3P );
+	TestComputePoseInitialization< double >( 1000, 1e-6, false, Ubitrack::Calibration::EPNP );
+	TestComputePoseInitialization< double >( 1000, 1e-6, true, Ubitrack::Calibration::EPNP );
+	TestComputePoseRansac( 200 );
+	TestPoseTracker( 100 );
+	TestHagerWorkspace( 100 );
+
 	TestOptimizePose< double >( 1000, 1e-3 );
 	// TestOptimizePose< float >( 1000, 1e-2f );
 }
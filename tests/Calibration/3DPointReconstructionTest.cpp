@@ -1,8 +1,10 @@
 #include <utCalibration/3DPointReconstruction.h>
+#include <utCalibration/FundamentalMatrix.h>
 #include <utMath/Functors/Vector3Functors.h>
 #include "../tools.h"
 
 #include <vector>
+#include <limits>
 #include <iostream>
 
 #include <boost/test/unit_test.hpp>
@@ -11,6 +13,136 @@
 using namespace Ubitrack;
 namespace ublas = boost::numeric::ublas;
 
+template< typename T >
+static void TestTriangulatePoints( const std::size_t n_points, const T epsilon )
+{
+	const std::size_t n_cameras = static_cast< std::size_t >( random( 2.0, 12.0 ) );
+
+	Math::Matrix< T, 3, 3 > K = Math::Matrix< T, 3, 3 >::identity();
+	K( 0, 0 ) = K( 1, 1 ) = 500;
+	K( 0, 2 ) = 320;
+	K( 1, 2 ) = 240;
+
+	// cameras around the origin, looking at it from a distance of 10
+	std::vector< Math::Matrix< T, 3, 4 > > matrices;
+	for( std::size_t c( 0 ); c < n_cameras; ++c )
+	{
+		Math::Pose camPose( randomQuaternion(), Math::Vector< double, 3 >( 0, 0, -10 ) );
+		const Math::Matrix< double, 3, 4 > pd( camPose );
+		Math::Matrix< T, 3, 4 > p( pd );
+		matrices.push_back( ublas::prod( K, p ) );
+	}
+
+	std::vector< Math::Vector< T, 3 > > objPoints;
+	Calibration::MultiViewObservations< T > exact;
+	Calibration::MultiViewObservations< T > noisy;
+	exact.resize( n_cameras, n_points );
+	noisy.resize( n_cameras, n_points );
+	for( std::size_t i( 0 ); i < n_points; ++i )
+	{
+		objPoints.push_back( randomVector< T, 3 >( 2 ) );
+
+		// every second point is not seen by all cameras, every tenth by only one
+		for( std::size_t c( 0 ); c < n_cameras; ++c )
+		{
+			if( ( i % 2 == 1 && c == i % n_cameras ) || ( i % 10 == 9 && c > 0 ) )
+				continue;
+
+			const Math::Vector< T, 2 > p = Math::Functors::project3x4_vector3< T >()( matrices[ c ], objPoints[ i ] );
+			exact.set( c, i, p );
+			noisy.set( c, i, p + randomVector< T, 2 >( 1 ) );
+		}
+	}
+
+	// noise-free observations are reconstructed exactly
+	std::vector< Math::Vector< T, 3 > > points;
+	std::vector< T > residuals;
+	Calibration::triangulatePoints( matrices, exact, points, residuals );
+	BOOST_REQUIRE_EQUAL( points.size(), n_points );
+	for( std::size_t i( 0 ); i < n_points; ++i )
+	{
+		const bool bValid = i % 10 != 9 && ( n_cameras > 2 || i % 2 == 0 );
+		if( bValid )
+		{
+			BOOST_CHECK_SMALL( static_cast< double >( vectorDiff( points[ i ], objPoints[ i ] ) ), static_cast< double >( epsilon ) );
+			BOOST_CHECK_SMALL( static_cast< double >( residuals[ i ] ), static_cast< double >( epsilon ) );
+		}
+		else
+			BOOST_CHECK( residuals[ i ] == std::numeric_limits< T >::infinity() );
+	}
+
+	// with noise, the refinement does not increase the reprojection error
+	std::vector< Math::Vector< T, 3 > > linearPoints;
+	std::vector< T > linearResiduals;
+	Calibration::triangulatePoints( matrices, noisy, linearPoints, linearResiduals );
+	std::vector< T > refinedResiduals;
+	Calibration::triangulatePoints( matrices, noisy, points, refinedResiduals, 3 );
+	for( std::size_t i( 0 ); i < n_points; ++i )
+		if( linearResiduals[ i ] != std::numeric_limits< T >::infinity() )
+			BOOST_CHECK_LE( refinedResiduals[ i ], linearResiduals[ i ] * T( 1.0001 ) + epsilon );
+
+	// splitting the points among threads gives the same result
+	std::vector< Math::Vector< T, 3 > > parallelPoints;
+	Calibration::triangulatePoints( matrices, noisy, parallelPoints, residuals, 3, 4 );
+	for( std::size_t i( 0 ); i < n_points; ++i )
+		for( std::size_t k( 0 ); k < 3; ++k )
+			BOOST_CHECK_EQUAL( parallelPoints[ i ]( k ), points[ i ]( k ) );
+}
+
+static void TestMatchEpipolar( const std::size_t n_points )
+{
+	Math::Matrix< double, 3, 3 > K = Math::Matrix< double, 3, 3 >::identity();
+	K( 0, 0 ) = K( 1, 1 ) = 500;
+	K( 0, 2 ) = 320;
+	K( 1, 2 ) = 240;
+
+	const Math::Pose camPose1( randomQuaternion(), Math::Vector< double, 3 >( 0, 0, -10 ) );
+	const Math::Pose camPose2( randomQuaternion(), Math::Vector< double, 3 >( 0, 0, -10 ) );
+	const Math::Matrix< double, 3, 4 > p1 = ublas::prod( K, Math::Matrix< double, 3, 4 >( camPose1 ) );
+	const Math::Matrix< double, 3, 4 > p2 = ublas::prod( K, Math::Matrix< double, 3, 4 >( camPose2 ) );
+	const Math::Matrix< double, 3, 3 > fM = Calibration::fundamentalMatrixFromPoses( camPose1, camPose2, K, K );
+
+	// the second image lists the points in reverse order, followed by points without a match
+	std::vector< Math::Vector< double, 3 > > objPoints;
+	std::vector< Math::Vector< double, 2 > > points1;
+	std::vector< Math::Vector< double, 2 > > points2( n_points );
+	for( std::size_t i( 0 ); i < n_points; ++i )
+	{
+		objPoints.push_back( randomVector< double, 3 >( 2 ) );
+		points1.push_back( Math::Functors::project3x4_vector3< double >()( p1, objPoints[ i ] ) );
+		points2[ n_points - 1 - i ] = Math::Functors::project3x4_vector3< double >()( p2, objPoints[ i ] );
+	}
+	for( std::size_t i( 0 ); i < n_points / 10; ++i )
+		points2.push_back( Math::Functors::project3x4_vector3< double >()( p2, randomVector< double, 3 >( 2 ) ) );
+
+	// matches are unique and inside the gate
+	const double maxDistance = 1.0;
+	const std::vector< std::pair< std::size_t, std::size_t > > matches = Calibration::matchEpipolar( points1, points2, fM, maxDistance );
+	std::vector< bool > used1( points1.size(), false );
+	std::vector< bool > used2( points2.size(), false );
+	std::size_t n_correct = 0;
+	for( std::size_t i( 0 ); i < matches.size(); ++i )
+	{
+		BOOST_CHECK( !used1[ matches[ i ].first ] && !used2[ matches[ i ].second ] );
+		used1[ matches[ i ].first ] = used2[ matches[ i ].second ] = true;
+		BOOST_CHECK_LE( Calibration::pointToPointDist( points1[ matches[ i ].first ], points2[ matches[ i ].second ], fM ), maxDistance * maxDistance );
+		if( matches[ i ].second == n_points - 1 - matches[ i ].first )
+			n_correct++;
+	}
+
+	// every point has a match, and almost all are the true ones, except for the unmatched
+	// points that happen to lie on the epipolar line of a true point
+	BOOST_CHECK_EQUAL( matches.size(), n_points );
+	BOOST_CHECK_GE( n_correct, n_points - n_points / 10 );
+
+	// the gated reconstruction recovers the object points of the correct matches
+	const std::vector< Math::Vector< double, 3 > > reconstructed = Calibration::reconstruct3DPoints( points1, points2, p1, p2, fM, maxDistance );
+	BOOST_REQUIRE_EQUAL( reconstructed.size(), matches.size() );
+	for( std::size_t i( 0 ); i < matches.size(); ++i )
+		if( matches[ i ].second == n_points - 1 - matches[ i ].first )
+			BOOST_CHECK_SMALL( vectorDiff( reconstructed[ i ], objPoints[ matches[ i ].first ] ), 1e-05 );
+}
+
 void Test3DPointReconstruction()
 {
 	for( int j=0; j<100; ++j )
@@ -82,4 +214,15 @@ void Test3DPointReconstruction()
 		BOOST_CHECK_SMALL( vectorDiff( p3D, v ), 1e-05 );
 	}
 	
-}
\ No newline at end of file
+
+	// check for epipolar matching
+	for( int j=0; j<20; ++j )
+		TestMatchEpipolar( 200 );
+
+	// check for batch triangulation
+	for( int j=0; j<20; ++j )
+	{
+		TestTriangulatePoints< double >( 300, 1e-6 );
+		TestTriangulatePoints< float >( 100, 1e-1f );
+	}
+}
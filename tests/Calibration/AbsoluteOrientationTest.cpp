@@ -96,6 +96,60 @@ void testAbsoluteOrientationRandom( const std::size_t n_runs, const T epsilon )
 	
 }
 
+void testAbsoluteOrientationAccumulator()
+{
+	Random::Vector< double, 3 >::Uniform randVector( -100, 100 );
+	Random::Vector< double, 3 >::Normal randNoise( 0, 0.01 );
+	Random::Quaternion< double >::Uniform randQuat;
+
+	for ( std::size_t iRun = 0; iRun < 20; iRun++ )
+	{
+		// a stream of noisy pairs far from the origin
+		const Quaternion q = randQuat();
+		const Vector< double, 3 > t = randVector();
+		const Vector< double, 3 > offset( 1000.0 * randVector() );
+		std::vector< Vector< double, 3 > > left, right;
+		for ( std::size_t i = 0; i < 200; i++ )
+		{
+			left.push_back( randVector() + offset );
+			right.push_back( q * left.back() + t + randNoise() );
+		}
+
+		// sliding window of 20 pairs against the batch solution
+		const std::size_t window = 20;
+		Ubitrack::Calibration::AbsoluteOrientationAccumulator accumulator;
+		accumulator.addPairs( std::vector< Vector< double, 3 > >( left.begin(), left.begin() + window - 1 ), 
+			std::vector< Vector< double, 3 > >( right.begin(), right.begin() + window - 1 ) );
+		for ( std::size_t i = window - 1; i < left.size(); i++ )
+		{
+			accumulator.addPair( left[ i ], right[ i ] );
+			BOOST_CHECK_EQUAL( accumulator.size(), window );
+
+			std::vector< Vector< double, 3 > > leftWindow( left.begin() + i + 1 - window, left.begin() + i + 1 );
+			std::vector< Vector< double, 3 > > rightWindow( right.begin() + i + 1 - window, right.begin() + i + 1 );
+			const Pose batch = Ubitrack::Calibration::calculateAbsoluteOrientation( leftWindow, rightWindow );
+			const Pose p = accumulator.computePose();
+			BOOST_CHECK_SMALL( vectorDiff( p.translation(), batch.translation() ), 1e-6 );
+			BOOST_CHECK_SMALL( quaternionDiff( p.rotation(), batch.rotation() ), 1e-6 );
+
+			double rms = 0;
+			for ( std::size_t j = 0; j < window; j++ )
+				rms += boost::numeric::ublas::inner_prod( p * leftWindow[ j ] - rightWindow[ j ], p * leftWindow[ j ] - rightWindow[ j ] );
+			rms = std::sqrt( rms / window );
+			BOOST_CHECK_SMALL( accumulator.computeRms( p ) - rms, 1e-6 );
+			BOOST_CHECK_CLOSE( accumulator.computeScale(), 
+				Ubitrack::Calibration::calculateAbsoluteOrientationScale( leftWindow, rightWindow ).m_value, 1e-6 );
+
+			accumulator.removePair( left[ i + 1 - window ], right[ i + 1 - window ] );
+		}
+	}
+
+	Ubitrack::Calibration::AbsoluteOrientationAccumulator accumulator;
+	BOOST_CHECK_THROW( accumulator.computePose(), Ubitrack::Util::Exception );
+	BOOST_CHECK_THROW( accumulator.addPairs( std::vector< Vector< double, 3 > >( 2 ), std::vector< Vector< double, 3 > >( 3 ) ), 
+		Ubitrack::Util::Exception );
+}
+
 void TestAbsoluteOrientation()
 {
 	// first do a deterministic test
@@ -103,6 +157,9 @@ void TestAbsoluteOrientation()
 	
 	// do some iterations of random tests
 	testAbsoluteOrientationRandom< double >( 10000, 10e-6 );
+
+	// streaming version
+	testAbsoluteOrientationAccumulator();
 }
 
 #endif // HAVE_LAPACK
@@ -11,8 +11,9 @@
 #include <utMath/Random/Scalar.h>
 #include <utMath/Random/Vector.h>
 #include <utMath/Random/Rotation.h>
-//#include <utCalibration/BundleAdjustment.h> no test yet
+#include <utCalibration/BundleAdjustment.h>
 #include <utCalibration/MultipleCameraPoseOptimization.h>
+#include <utMath/ParallelEvaluation.h>
 #include "../tools.h"
 
 #include <iostream>
@@ -180,8 +181,268 @@ void TestMarkerBundleAdjustment( const std::size_t n_runs, const T epsilon )
 	}	
 };
 
+#ifdef HAVE_LAPACK
+
+namespace {
+
+/** small random rotation */
+Quaternion randomSmallRotation( const double maxAngle )
+{
+	Vector< double, 3 > axis( Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ) );
+	axis /= boost::numeric::ublas::norm_2( axis );
+	return Quaternion( axis, Random::distribute_uniform< double >( -maxAngle, maxAngle ) );
+}
+
+/** projects the points of all bundles into all cameras and randomly drops some observations */
+void projectBundles( const std::vector< Vector< double, 3 > >& points3d, const std::vector< Scalar< int > >& localSizes, 
+	const std::vector< Pose >& bundlePoses, const std::vector< Pose >& camPoses, const std::vector< Matrix< double, 3, 3 > >& camMatrices,
+	std::vector< std::vector< Vector< double, 2 > > >& points2d, std::vector< std::vector< Scalar< double > > >& weights )
+{
+	Random::Vector< double, 2 >::Normal randPixelNoise( 0, 0.1 );
+	points2d.assign( camPoses.size(), std::vector< Vector< double, 2 > >( points3d.size() ) );
+	weights.assign( camPoses.size(), std::vector< Scalar< double > >( points3d.size(), Scalar< double >( 1.0 ) ) );
+	for ( std::size_t c( 0 ); c < camPoses.size(); c++ )
+	{
+		std::size_t p( 0 );
+		for ( std::size_t b( 0 ); b < localSizes.size(); b++ )
+		{
+			Matrix< double, 3, 4 > proj( camPoses[ c ] * bundlePoses[ b ] );
+			proj = boost::numeric::ublas::prod( camMatrices[ c ], proj );
+			const Functors::ProjectVector< double > project( proj );
+			for ( int i( 0 ); i < localSizes[ b ]; i++, p++ )
+			{
+				points2d[ c ][ p ] = project( points3d[ p ] ) + randPixelNoise();
+				if ( i >= 4 && Random::distribute_uniform< double >( 0, 1 ) < 0.1 )
+					weights[ c ][ p ] = 0.0;
+			}
+		}
+	}
+}
+
+}
+
+void TestLocalBundlePoseEstimator( const std::size_t n_runs, const double epsilon )
+{
+	for ( std::size_t run( 0 ); run < n_runs; run++ )
+	{
+		const std::size_t n_bundles = Random::distribute_uniform( 2, 8 );
+		const std::size_t n_cams = Random::distribute_uniform( 2, 5 );
+
+		// planar markers with 4 corners and some additional points
+		std::vector< Vector< double, 3 > > points3d;
+		std::vector< Scalar< int > > localSizes;
+		std::vector< Pose > bundlePoses;
+		for ( std::size_t b( 0 ); b < n_bundles; b++ )
+		{
+			const int n = Random::distribute_uniform( 4, 12 );
+			for ( int i( 0 ); i < n; i++ )
+			{
+				if ( i < 4 )
+					points3d.push_back( Vector< double, 3 >( i % 2 ? 0.5 : -0.5, i / 2 ? 0.5 : -0.5, 0.0 ) );
+				else
+					points3d.push_back( Vector< double, 3 >( Random::distribute_uniform< double >( -0.5, 0.5 ), Random::distribute_uniform< double >( -0.5, 0.5 ), 0.0 ) );
+			}
+			localSizes.push_back( n );
+			bundlePoses.push_back( Pose( randomSmallRotation( 0.5 ), Vector< double, 3 >( Random::distribute_uniform< double >( -1, 1 ),
+				Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ) ) ) );
+		}
+
+		// cameras in front of the markers, looking along -z
+		std::vector< Pose > camPoses;
+		std::vector< Matrix< double, 3, 3 > > camMatrices;
+		for ( std::size_t c( 0 ); c < n_cams; c++ )
+		{
+			Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+			cam( 0, 0 ) = cam( 1, 1 ) = Random::distribute_uniform< double >( 500, 800 );
+			cam( 0, 2 ) = -320;
+			cam( 1, 2 ) = -240;
+			cam( 2, 2 ) = -1;
+			camMatrices.push_back( cam );
+			camPoses.push_back( Pose( randomSmallRotation( 0.2 ), Vector< double, 3 >( Random::distribute_uniform< double >( -1, 1 ),
+				Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -6, -4 ) ) ) );
+		}
+
+		std::vector< std::vector< Vector< double, 2 > > > points2d;
+		std::vector< std::vector< Scalar< double > > > weights;
+		projectBundles( points3d, localSizes, bundlePoses, camPoses, camMatrices, points2d, weights );
+
+		// the last bundle is not seen by the first camera
+		if ( run % 2 )
+			for ( std::size_t p( points3d.size() - localSizes.back() ); p < points3d.size(); p++ )
+				weights[ 0 ][ p ] = 0.0;
+
+		const int minCorrespondences( 4 );
+		std::vector< ErrorPose > refPoses;
+		std::vector< Scalar< double > > refWeights;
+		Ubitrack::Calibration::multipleCameraPoseEstimationWithLocalBundles( points3d, points2d, weights, camPoses, camMatrices,
+			minCorrespondences, refPoses, refWeights, localSizes );
+
+		for ( unsigned nThreads( 1 ); nThreads <= 3; nThreads += 2 )
+		{
+			Ubitrack::Calibration::LocalBundlePoseEstimator estimator( nThreads );
+			std::vector< ErrorPose > poses;
+			std::vector< Scalar< double > > poseWeights;
+
+			// the second call reuses the workspaces
+			for ( std::size_t k( 0 ); k < 2; k++ )
+			{
+				estimator.estimate( points3d, points2d, weights, camPoses, camMatrices, minCorrespondences, localSizes, poses, poseWeights );
+				BOOST_REQUIRE_EQUAL( poses.size(), n_bundles );
+				BOOST_REQUIRE_EQUAL( poseWeights.size(), n_bundles );
+				for ( std::size_t b( 0 ); b < n_bundles; b++ )
+				{
+					BOOST_CHECK_EQUAL( poseWeights[ b ] < 0, refWeights[ b ] < 0 );
+					if ( refWeights[ b ] < 0 )
+						continue;
+					BOOST_CHECK_SMALL( poseWeights[ b ] - refWeights[ b ], epsilon * ( 1 + refWeights[ b ] ) );
+					BOOST_CHECK_SMALL( quaternionDiff( poses[ b ].rotation(), refPoses[ b ].rotation() ), epsilon );
+					BOOST_CHECK_SMALL( vectorDiff( poses[ b ].translation(), refPoses[ b ].translation() ), epsilon );
+					BOOST_CHECK_SMALL( quaternionDiff( poses[ b ].rotation(), bundlePoses[ b ].rotation() ), 0.05 );
+					BOOST_CHECK_SMALL( vectorDiff( poses[ b ].translation(), bundlePoses[ b ].translation() ), 0.05 );
+				}
+			}
+		}
+		
+		// warm start from the previous frame after a small motion of all bundles
+		Ubitrack::Calibration::LocalBundlePoseEstimator tracker( 2, true );
+		std::vector< ErrorPose > poses;
+		std::vector< Scalar< double > > poseWeights;
+		tracker.estimate( points3d, points2d, weights, camPoses, camMatrices, minCorrespondences, localSizes, poses, poseWeights );
+		for ( std::size_t b( 0 ); b < n_bundles; b++ )
+			bundlePoses[ b ] = Pose( randomSmallRotation( 0.05 ), Vector< double, 3 >( 0.01, -0.02, 0.01 ) ) * bundlePoses[ b ];
+		projectBundles( points3d, localSizes, bundlePoses, camPoses, camMatrices, points2d, weights );
+		tracker.estimate( points3d, points2d, weights, camPoses, camMatrices, minCorrespondences, localSizes, poses, poseWeights );
+		for ( std::size_t b( 0 ); b < n_bundles; b++ )
+		{
+			BOOST_CHECK( poseWeights[ b ] >= 0 );
+			BOOST_CHECK_SMALL( quaternionDiff( poses[ b ].rotation(), bundlePoses[ b ].rotation() ), 0.05 );
+			BOOST_CHECK_SMALL( vectorDiff( poses[ b ].translation(), bundlePoses[ b ].translation() ), 0.05 );
+		}
+	}
+}
+
+/** the multi-camera objective function gives the same results on multiple threads */
+void TestParallelObjectiveFunction()
+{
+	namespace ublas = boost::numeric::ublas;
+
+	// grid of points seen by three cameras, fixed data so the random numbers of the other tests do not change
+	std::vector< Vector< double, 3 > > points3d;
+	for ( int i( 0 ); i < 400; i++ )
+		points3d.push_back( Vector< double, 3 >( 0.05 * ( i % 20 ) - 0.5, 0.05 * ( i / 20 ) - 0.5, 0.01 * ( i % 7 ) ) );
+
+	std::vector< Matrix< double, 3, 3 > > camRotations;
+	std::vector< Vector< double, 3 > > camTranslations;
+	std::vector< Matrix< double, 3, 3 > > camMatrices;
+	std::vector< std::pair< std::size_t, std::size_t > > observations;
+	for ( std::size_t c( 0 ); c < 3; c++ )
+	{
+		camRotations.push_back( Matrix< double, 3, 3 >( Quaternion( Vector< double, 3 >( 0, 1, 0 ), 0.1 * c ) ) );
+		camTranslations.push_back( Vector< double, 3 >( 0.2 * c, 0.0, -5.0 ) );
+		Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+		cam( 0, 0 ) = cam( 1, 1 ) = 600;
+		cam( 0, 2 ) = -320;
+		cam( 1, 2 ) = -240;
+		cam( 2, 2 ) = -1;
+		camMatrices.push_back( cam );
+		for ( std::size_t p( c ); p < points3d.size(); p++ )
+			observations.push_back( std::make_pair( p, c ) );
+	}
+
+	typedef Ubitrack::Calibration::ObjectiveFunction< double > Objective;
+	Objective f( points3d, camRotations, camTranslations, camMatrices, observations );
+	Vector< double, 6 > input;
+	input( 0 ) = 0.1; input( 1 ) = -0.2; input( 2 ) = 0.3;
+	input( 3 ) = 0.05; input( 4 ) = 0.1; input( 5 ) = -0.02;
+
+	Vector< double > serialResult( f.size() );
+	Matrix< double, 0, 0 > serialJ( f.size(), 6 );
+	f.evaluateWithJacobian( serialResult, input, serialJ );
+
+	Ubitrack::Math::ParallelEvaluation< Objective > parallel( f, 3, 1 );
+	BOOST_CHECK_EQUAL( parallel.size(), f.size() );
+	Vector< double > result( f.size() );
+	Matrix< double, 0, 0 > J( f.size(), 6 );
+	parallel.evaluateWithJacobian( result, input, J );
+	BOOST_CHECK_EQUAL( parallel.rangeCount(), 3u );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( result - serialResult ), 0.0 );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( J - serialJ ), 0.0 );
+
+	parallel.evaluate( result, input );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( result - serialResult ), 0.0 );
+}
+
+/** pose of a planar target seen by cameras that are not at the origin, without initial pose */
+void TestMultipleCameraBundleAdjustment()
+{
+	// fixed data, so the random numbers of the other tests do not change
+	// the initial pose uses the first four points, which are the corners of a marker as in the applications
+	std::vector< Vector< double, 3 > > points3d;
+	points3d.push_back( Vector< double, 3 >( -0.4, -0.4, 0.0 ) );
+	points3d.push_back( Vector< double, 3 >( 0.4, -0.4, 0.0 ) );
+	points3d.push_back( Vector< double, 3 >( 0.4, 0.4, 0.0 ) );
+	points3d.push_back( Vector< double, 3 >( -0.4, 0.4, 0.0 ) );
+	for ( int i( 0 ); i < 64; i++ )
+		points3d.push_back( Vector< double, 3 >( 0.1 * ( i % 8 ) - 0.35, 0.1 * ( i / 8 ) - 0.35, 0.0 ) );
+	const Pose targetPose( Quaternion( Vector< double, 3 >( 1, 1, 0 ) / std::sqrt( 2.0 ), 0.3 ), Vector< double, 3 >( 0.3, -0.2, 0.5 ) );
+
+	std::vector< Pose > camPoses;
+	std::vector< Matrix< double, 3, 3 > > camMatrices;
+	std::vector< std::vector< Vector< double, 2 > > > points2d;
+	std::vector< std::vector< Scalar< double > > > weights;
+	for ( std::size_t c( 0 ); c < 3; c++ )
+	{
+		Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+		cam( 0, 0 ) = cam( 1, 1 ) = 600;
+		cam( 0, 2 ) = -320;
+		cam( 1, 2 ) = -240;
+		cam( 2, 2 ) = -1;
+		camMatrices.push_back( cam );
+
+		// the first camera has the most observations and is rotated and shifted the most
+		camPoses.push_back( Pose( Quaternion( Vector< double, 3 >( 0, 1, 0 ), 0.4 - 0.2 * c ), Vector< double, 3 >( 0.8 - 0.4 * c, 0.3, -5.0 ) ) );
+		Matrix< double, 3, 4 > proj( camPoses[ c ] * targetPose );
+		proj = boost::numeric::ublas::prod( cam, proj );
+		const Functors::ProjectVector< double > project( proj );
+
+		points2d.push_back( std::vector< Vector< double, 2 > >() );
+		weights.push_back( std::vector< Scalar< double > >() );
+		for ( std::size_t p( 0 ); p < points3d.size(); p++ )
+		{
+			points2d[ c ].push_back( project( points3d[ p ] ) );
+			weights[ c ].push_back( Scalar< double >( c > 0 && p % 5 == 0 ? 0.0 : 1.0 ) );
+		}
+	}
+
+	const std::pair< ErrorPose, double > result( Ubitrack::Calibration::multipleCameraBundleAdjustment( 
+		points3d, points2d, weights, camPoses, camMatrices, 4, false ) );
+	BOOST_CHECK( result.second >= 0 );
+	BOOST_CHECK_SMALL( result.second, 1e-6 );
+	BOOST_CHECK_SMALL( quaternionDiff( result.first.rotation(), targetPose.rotation() ), 1e-6 );
+	BOOST_CHECK_SMALL( vectorDiff( result.first.translation(), targetPose.translation() ), 1e-6 );
+
+	// the result does not depend on the number of threads
+	const std::pair< ErrorPose, double > threaded( Ubitrack::Calibration::multipleCameraBundleAdjustment( 
+		points3d, points2d, weights, camPoses, camMatrices, 4, false, Pose(), 0, -1, 4 ) );
+	BOOST_CHECK_EQUAL( threaded.second, result.second );
+	BOOST_CHECK_EQUAL( quaternionDiff( threaded.first.rotation(), result.first.rotation() ), 0.0 );
+
+	// too few observations
+	const std::pair< ErrorPose, double > rejected( Ubitrack::Calibration::multipleCameraBundleAdjustment( 
+		points3d, points2d, weights, camPoses, camMatrices, 100, false ) );
+	BOOST_CHECK_EQUAL( rejected.second, -1.0 );
+}
+
+#endif // HAVE_LAPACK
+
 void TestBundleAdjustment()
 {
+#ifdef HAVE_LAPACK
+	TestLocalBundlePoseEstimator( 10, 1e-6 );
+	TestParallelObjectiveFunction();
+	TestMultipleCameraBundleAdjustment();
+#endif
+
 	//attention: will not work with floats so far.
 	TestMarkerBundleAdjustment< double >( 10, 1e-3 );
 }
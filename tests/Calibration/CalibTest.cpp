@@ -7,8 +7,10 @@ void TestAbsoluteOrientation();
 void TestBundleAdjustment();
 void TestDecomposeProjection();
 void TestFundamentalMatrix();
+void TestHandEyeCalibration();
 void TestHomography();
 void TestProjectionDLT();
+void TestTipCalibration();
 
 CalibrationTest::CalibrationTest()
 	: boost::unit_test::test_suite( "Calibration test suite" )
@@ -19,7 +21,9 @@ CalibrationTest::CalibrationTest()
 	add( BOOST_TEST_CASE( &TestBundleAdjustment ) );
 	add( BOOST_TEST_CASE( &TestDecomposeProjection ) );
 	add( BOOST_TEST_CASE( &TestFundamentalMatrix ) );
+	add( BOOST_TEST_CASE( &TestHandEyeCalibration ) );
 	add( BOOST_TEST_CASE( &TestHomography ) );
 	add( BOOST_TEST_CASE( &TestProjectionDLT ) );
+	add( BOOST_TEST_CASE( &TestTipCalibration ) );
 }
 
@@ -14,7 +14,7 @@ using namespace Ubitrack;
 namespace ublas = boost::numeric::ublas;
 
 
-void TestFundamentalMatrix()
+void TestFundamentalMatrixLinear()
 {
 	for( int j=0; j<100; j++ )
 	{
@@ -60,4 +60,141 @@ void TestFundamentalMatrix()
 
 		BOOST_CHECK_SMALL( homMatrixDiff( F, FTest ), 0.001 );
 	}
-}
\ No newline at end of file
+}
+
+/** random stereo setup with n correspondences, returns the true fundamental matrix */
+static Math::Matrix< double, 3, 3 > randomCorrespondences( std::size_t n, 
+	std::vector< Math::Vector< double, 2 > >& fromPoints, std::vector< Math::Vector< double, 2 > >& toPoints )
+{
+	Math::Pose CamPose1( randomQuaternion() , randomVector< double, 3 >() );
+	Math::Pose CamPose2( randomQuaternion() , randomVector< double, 3 >() );
+
+	Math::Matrix< double, 3, 3 > I( Math::Matrix< double, 3, 3 >::identity() );
+	I( 0, 0 ) = 400;
+	I( 0, 2 ) = -160;
+	I( 1, 1 ) = 400;
+	I( 1, 2 ) = -120;
+	I( 2, 2 ) = -1;
+
+	Math::Matrix< double, 3, 4 > E1( CamPose1 );
+	Math::Matrix< double, 3, 4 > E2( CamPose2 );
+	E1 = ublas::prod( I, E1);
+	E2 = ublas::prod( I, E2);
+
+	fromPoints.clear();
+	toPoints.clear();
+	// keep only points that are visible in a reasonably sized image
+	while ( fromPoints.size() < n )
+	{
+		Math::Vector< double, 4 > v = randomVector< double, 4 >();
+		Math::Vector< double, 3 > v1 = ublas::prod( E1, v );
+		Math::Vector< double, 3 > v2 = ublas::prod( E2, v );
+		Math::Vector< double, 2 > from( v1( 0 )/v1( 2 ), v1( 1 )/v1( 2 ) );
+		Math::Vector< double, 2 > to( v2( 0 )/v2( 2 ), v2( 1 )/v2( 2 ) );
+		if ( ublas::norm_inf( from ) < 1000 && ublas::norm_inf( to ) < 1000 )
+		{
+			fromPoints.push_back( from );
+			toPoints.push_back( to );
+		}
+	}
+
+	return Calibration::fundamentalMatrixFromPoses( CamPose1, CamPose2, I, I );
+}
+
+
+void TestFundamentalMatrixMinimal()
+{
+	std::vector< Math::Vector< double, 2 > > fromPoints;
+	std::vector< Math::Vector< double, 2 > > toPoints;
+	std::size_t nFound = 0;
+	for( int j=0; j<100; j++ )
+	{
+		Math::Matrix< double, 3, 3 > F( randomCorrespondences( 60, fromPoints, toPoints ) );
+
+		// the normal equations must give the same result as the SVD
+		BOOST_CHECK_SMALL( homMatrixDiff( F, Calibration::getFundamentalMatrixFast( fromPoints, toPoints ) ), 0.001 );
+
+		// one of the 7-point solutions must be the true matrix
+		Math::Matrix< double, 3, 3 > solutions[ 3 ];
+		const std::size_t nSolutions( Calibration::getFundamentalMatrix7Point( &fromPoints[ 0 ], &toPoints[ 0 ], solutions ) );
+		BOOST_CHECK( nSolutions == 1 || nSolutions == 3 );
+		double fMinDiff = 1.0;
+		for ( std::size_t s = 0; s < nSolutions; s++ )
+			fMinDiff = std::min( fMinDiff, homMatrixDiff( F, solutions[ s ] ) );
+		if ( fMinDiff < 0.001 )
+			nFound++;
+
+		// SoA Sampson distances must match the function object and vanish for the true matrix
+		std::vector< double > fromX, fromY, toX, toY;
+		for ( std::size_t i = 0; i < fromPoints.size(); i++ )
+		{
+			fromX.push_back( fromPoints[ i ]( 0 ) );
+			fromY.push_back( fromPoints[ i ]( 1 ) );
+			toX.push_back( toPoints[ i ]( 0 ) + 1.0 );
+			toY.push_back( toPoints[ i ]( 1 ) );
+		}
+		std::vector< double > distances( fromX.size() );
+		Calibration::sampsonDistances( F, fromX, fromY, toX, toY, distances );
+		Calibration::EvaluateFundamentalMatrixSampson< double > sampson;
+		for ( std::size_t i = 0; i < fromPoints.size(); i++ )
+		{
+			BOOST_CHECK_SMALL( sampson( F, fromPoints[ i ], toPoints[ i ] ), 1e-6 );
+			BOOST_CHECK_CLOSE( distances[ i ], sampson( F, fromPoints[ i ], Math::Vector< double, 2 >( toX[ i ], toY[ i ] ) ), 1e-6 );
+			BOOST_CHECK( distances[ i ] <= 1.0 + 1e-9 );
+		}
+	}
+
+	// poorly conditioned samples may lose precision, but not regularly
+	BOOST_CHECK( nFound >= 90 );
+}
+
+
+void TestFundamentalMatrixRansac()
+{
+	std::vector< Math::Vector< double, 2 > > fromPoints;
+	std::vector< Math::Vector< double, 2 > > toPoints;
+	for( int j=0; j<20; j++ )
+	{
+		Math::Matrix< double, 3, 3 > F( randomCorrespondences( 100, fromPoints, toPoints ) );
+
+		// move 30% of the points far away from their epipolar lines
+		for ( std::size_t i = 0; i < fromPoints.size(); i += 3 )
+		{
+			Math::Vector< double, 3 > l = ublas::prod( F, Math::Vector< double, 3 >( fromPoints[ i ]( 0 ), fromPoints[ i ]( 1 ), 1.0 ) );
+			const double len = std::sqrt( l( 0 ) * l( 0 ) + l( 1 ) * l( 1 ) );
+			toPoints[ i ]( 0 ) += 50.0 * l( 0 ) / len;
+			toPoints[ i ]( 1 ) += 50.0 * l( 1 ) / len;
+		}
+
+		std::vector< bool > inliers;
+		Math::Matrix< double, 3, 3 > FTest = Calibration::getFundamentalMatrixRansac( fromPoints, toPoints, inliers );
+
+		BOOST_CHECK_SMALL( homMatrixDiff( F, FTest ), 0.001 );
+		BOOST_CHECK_EQUAL( inliers.size(), fromPoints.size() );
+
+		// close to the epipoles, moved points may still be consistent, so compare with the true distances
+		Calibration::EvaluateFundamentalMatrixSampson< double > sampson;
+		std::size_t nWrong = 0;
+		std::size_t nInconsistent = 0;
+		for ( std::size_t i = 0; i < inliers.size(); i++ )
+		{
+			const double d = sampson( F, fromPoints[ i ], toPoints[ i ] );
+			if ( ( d < 0.25 && !inliers[ i ] ) || ( d > 4.0 && inliers[ i ] ) )
+				nWrong++;
+
+			// the flags belong to the returned matrix
+			if ( ( sampson( FTest, fromPoints[ i ], toPoints[ i ] ) < 1.0 ) != inliers[ i ] )
+				nInconsistent++;
+		}
+		BOOST_CHECK_EQUAL( nWrong, 0u );
+		BOOST_CHECK_EQUAL( nInconsistent, 0u );
+	}
+}
+
+
+void TestFundamentalMatrix()
+{
+	TestFundamentalMatrixLinear();
+	TestFundamentalMatrixMinimal();
+	TestFundamentalMatrixRansac();
+}
@@ -0,0 +1,104 @@
+#include <utCalibration/HandEyeCalibration.h>
+#include <utUtil/Exception.h>
+#include "../tools.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+namespace ublas = boost::numeric::ublas;
+
+#ifndef HAVE_LAPACK
+void TestHandEyeCalibration()
+{
+	// Hand-eye calibration does not work without lapack
+}
+#else // HAVE_LAPACK
+
+/** noisy hand and eye poses for the transformation x, eye_i = ~x * ~hand_i * world */
+static void randomHandEyePoses( const std::size_t n, const Math::Pose& x, double noise,
+	std::vector< Math::Pose >& hand, std::vector< Math::Pose >& eye )
+{
+	// rotations of up to about 50 degrees around a base orientation, as for a robot arm
+	const Math::Pose world( randomQuaternion(), randomVector< double, 3 >( 1.0 ) );
+	const Math::Quaternion base( randomQuaternion() );
+	hand.clear();
+	eye.clear();
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Math::Quaternion q( random( -0.5, 0.5 ), random( -0.5, 0.5 ), random( -0.5, 0.5 ), 1.0 );
+		hand.push_back( Math::Pose( base * Math::Quaternion( q ).normalize(), randomVector< double, 3 >( 1.0 ) ) );
+		const Math::Pose e( ~x * ~hand.back() * world );
+		const Math::Quaternion noiseRot( Math::Quaternion( random( -noise, noise ), random( -noise, noise ), random( -noise, noise ), 1.0 ).normalize() );
+		eye.push_back( Math::Pose( noiseRot * e.rotation(), e.translation() + randomVector< double, 3 >( noise ) ) );
+	}
+}
+
+/** hand-eye transformation, Tsai-Lenz degenerates for rotations close to 180 degrees */
+static Math::Pose randomHandEye()
+{
+	const Math::Quaternion q( random( -1.0, 1.0 ), random( -1.0, 1.0 ), random( -1.0, 1.0 ), 1.0 );
+	return Math::Pose( Math::Quaternion( q ).normalize(), randomVector< double, 3 >( 0.5 ) );
+}
+
+static void checkPose( const Math::Pose& a, const Math::Pose& b, double epsilon )
+{
+	BOOST_CHECK_SMALL( quaternionDiff( a.rotation(), b.rotation() ), epsilon );
+	BOOST_CHECK_SMALL( ublas::norm_2( a.translation() - b.translation() ), epsilon );
+}
+
+void TestHandEyeCalibration()
+{
+	std::vector< Math::Pose > hand, eye;
+	for ( int iRun = 0; iRun < 20; iRun++ )
+	{
+		const Math::Pose x( randomHandEye() );
+
+		// noise-free: the online and batch versions find the true transformation
+		randomHandEyePoses( 20, x, 0.0, hand, eye );
+		Calibration::OnlineHandEyeCalibration consecutive;
+		Calibration::OnlineHandEyeCalibration all( hand.size() );
+		for ( std::size_t i = 0; i < hand.size(); i++ )
+		{
+			consecutive.addMeasurement( hand[ i ], eye[ i ] );
+			all.addMeasurement( hand[ i ], eye[ i ] );
+		}
+		BOOST_CHECK_EQUAL( consecutive.getNumberOfPairs(), hand.size() - 1 );
+		BOOST_CHECK_EQUAL( all.getNumberOfPairs(), hand.size() * ( hand.size() - 1 ) / 2 );
+		checkPose( consecutive.computeResult(), x, 1e-6 );
+		checkPose( all.computeResult(), x, 1e-6 );
+
+		// noisy: same least-squares solutions as the batch version with the same pairs
+		randomHandEyePoses( 20, x, 0.01, hand, eye );
+		consecutive.reset();
+		all.reset();
+		for ( std::size_t i = 0; i < hand.size(); i++ )
+		{
+			consecutive.addMeasurement( Math::Matrix< double, 4, 4 >( hand[ i ] ), Math::Matrix< double, 4, 4 >( eye[ i ] ) );
+			all.addMeasurement( hand[ i ], eye[ i ] );
+		}
+		checkPose( consecutive.computeResult(), Calibration::performHandEyeCalibration( hand, eye, false ), 1e-6 );
+		checkPose( all.computeResult(), Calibration::performHandEyeCalibration( hand, eye, true ), 1e-6 );
+		checkPose( all.computeResult(), x, 0.05 );
+	}
+
+	// long stream with a bounded window, skipping small rotations
+	const Math::Pose x( randomHandEye() );
+	randomHandEyePoses( 5000, x, 0.001, hand, eye );
+	Calibration::OnlineHandEyeCalibration windowed( 5, 0.3 );
+	for ( std::size_t i = 0; i < hand.size(); i++ )
+		windowed.addMeasurement( hand[ i ], eye[ i ] );
+	BOOST_CHECK( windowed.getNumberOfPairs() < 5 * hand.size() );
+	checkPose( windowed.computeResult(), x, 1e-3 );
+
+	// not enough data
+	Calibration::OnlineHandEyeCalibration empty;
+	empty.addMeasurement( hand[ 0 ], eye[ 0 ] );
+	empty.addMeasurement( hand[ 1 ], eye[ 1 ] );
+	checkPose( empty.computeResult(), Math::Pose( Math::Quaternion(), Math::Vector< double, 3 >( 0, 0, 0 ) ), 1e-12 );
+	BOOST_CHECK_THROW( Calibration::OnlineHandEyeCalibration( 0 ), Util::Exception );
+}
+
+#endif // HAVE_LAPACK
@@ -4,6 +4,7 @@
 #include <utMath/Random/Vector.h>
 #include <utMath/Random/Rotation.h>
 #include <utCalibration/Homography.h>
+#include <utCalibration/HomographyBatch.h>
 #include <utMath/Functors/MatrixFunctors.h>
 #include <utMath/Functors/VectorFunctors.h>
 #include <utCalibration/2D3DPoseEstimation.h> // for PoseFromHomography
@@ -102,6 +103,47 @@ void TestHomographyDLT( const std::size_t n_runs, const T epsilon )
 }
 
 
+template < typename T >
+void TestHomographyDLTFast( const std::size_t n_runs, const T epsilon, const bool bFourPoints )	
+{
+	typename Random::Vector< T, 2 >::Uniform randVector( -100, 100 );
+	
+	for ( std::size_t iTest = 0; iTest < n_runs; iTest++ )
+	{
+		Matrix< T, 3, 3 > Htest;
+		randomMatrix( Htest );
+				
+		// exactly four points use the closed-form solution
+		const std::size_t n( bFourPoints ? 4 : Random::distribute_uniform< std::size_t >( 10, 50 ) );
+		
+		std::vector< Vector< T, 2 > > fromPoints;
+		fromPoints.reserve( n );
+		std::generate_n ( std::back_inserter( fromPoints ), n,  randVector );
+		
+		std::vector< Vector< T, 2 > > toPoints( n );
+		for ( std::size_t i = 0; i < n; ++i )
+		{
+			Vector< T, 3 > x( fromPoints[ i ]( 0 ), fromPoints[ i ]( 1 ), 1. );
+			Vector< T, 3 > xp = ublas::prod( Htest, x );
+			toPoints[ i ] = ublas::subrange( xp, 0, 2 ) / xp( 2 );
+		}
+		
+		Matrix< T, 3, 3 > H = Ubitrack::Calibration::homographyDLTFast( fromPoints, toPoints );
+		BOOST_CHECK_SMALL( homMatrixDiff( H, Htest ), epsilon );
+	}
+
+	// standard corners must give the identity
+	std::vector< Vector< T, 2 > > stdCorners( 4 );
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		stdCorners[ i ][ 0 ] = ( i & 2 )         ? 0.5 : -0.5;
+		stdCorners[ i ][ 1 ] = ( ( i + 1 ) & 2 ) ? -0.5 : 0.5;
+	}
+	Matrix< T, 3, 3 > H( Ubitrack::Calibration::homographyDLTFast( stdCorners, stdCorners ) );
+	BOOST_CHECK_SMALL( homMatrixDiff( H, Matrix< T, 3, 3 >::identity() ), epsilon );
+}
+
+
 template< typename T >
 void TestPoseFromHomography( const std::size_t n_runs, const T epsilon )
 {
@@ -158,15 +200,87 @@ void TestPoseFromHomography( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+template< typename T >
+void TestSquareMarkerPoses( const std::size_t n_markers, const T epsilon, const unsigned nThreads )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randTranslation( -1, 1 );
+
+	// one camera for all markers
+	Matrix< T, 3, 3 > cam( Matrix< T, 3, 3 >::identity() );
+	cam( 0, 0 ) = Random::distribute_uniform< T >( 500, 800 );
+	cam( 1, 1 ) = Random::distribute_uniform< T >( 500, 800 );
+	cam( 0, 2 ) = -320;
+	cam( 1, 2 ) = -240;
+	cam( 2, 2 ) = -1;
+	std::vector< Matrix< T, 3, 3 > > invK( 1, Functors::matrix_inverse()( cam ) );
+
+	std::vector< Vector< T, 2 > > stdCorners( 4 );
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		stdCorners[ i ][ 0 ] = ( i & 2 )         ? 0.5f : -0.5f;
+		stdCorners[ i ][ 1 ] = ( ( i + 1 ) & 2 ) ? -0.5f : 0.5f;
+	}
+
+	// random markers facing the camera
+	std::vector< Pose > truePoses;
+	Ubitrack::Calibration::SquareMarkerCorners< T > corners;
+	corners.resize( n_markers );
+	for ( std::size_t k = 0; k < n_markers; k++ )
+	{
+		Quaternion rot( randQuat() );
+		while ( ( rot * Vector< double, 3 >( 0, 0, 1 ) )( 2 ) < 0.3 )
+			rot = randQuat();
+		Vector< T, 3 > trans( randTranslation() );
+		trans( 2 ) = -Random::distribute_uniform< T >( 2, 10 );
+		truePoses.push_back( Pose( rot, trans ) );
+
+		Matrix< T, 3, 4 > projection( rot, trans );
+		projection = boost::numeric::ublas::prod( cam, projection );
+		for ( std::size_t i = 0; i < 4; i++ )
+		{
+			const Vector< T, 3 > x( stdCorners[ i ]( 0 ), stdCorners[ i ]( 1 ), 0 );
+			const Vector< T, 2 > p( Functors::ProjectVector< T >( projection )( x ) );
+			corners.x[ i ][ k ] = p( 0 );
+			corners.y[ i ][ k ] = p( 1 );
+		}
+	}
+
+	std::vector< Matrix< T, 3, 3 > > homographies;
+	std::vector< Pose > poses;
+	Ubitrack::Calibration::squareMarkerPoses( corners, invK, homographies, poses, nThreads );
+	BOOST_CHECK_EQUAL( homographies.size(), n_markers );
+	BOOST_CHECK_EQUAL( poses.size(), n_markers );
+
+	for ( std::size_t k = 0; k < n_markers; k++ )
+	{
+		std::vector< Vector< T, 2 > > markerCorners( 4 );
+		for ( std::size_t i = 0; i < 4; i++ )
+			markerCorners[ i ] = Vector< T, 2 >( corners.x[ i ][ k ], corners.y[ i ][ k ] );
+		BOOST_CHECK_SMALL( homMatrixDiff( homographies[ k ], Ubitrack::Calibration::squareHomography( markerCorners ) ), epsilon );
+
+		BOOST_CHECK_SMALL( quaternionDiff( poses[ k ].rotation(), truePoses[ k ].rotation() ), static_cast< double >( epsilon ) );
+		BOOST_CHECK_SMALL( ublas::norm_2( poses[ k ].translation() - truePoses[ k ].translation() ), static_cast< double >( epsilon ) );
+	}
+}
+
+
 void TestHomography()
 {
 	TestHomographyDLTIdentity< double >( 1e-6 );
 	TestSquareHomography< double >( 1000, 1e-6 );
 	TestHomographyDLT< double >( 1000, 1e-6 );
+	TestHomographyDLTFast< double >( 1000, 1e-6, false );
+	TestHomographyDLTFast< double >( 1000, 1e-6, true );
+	TestSquareMarkerPoses< double >( 300, 1e-6, 1 );
+	TestSquareMarkerPoses< double >( 300, 1e-6, 4 );
 	// TestPoseFromHomography< double >( 1000, 1e-6 );
 	
 	TestHomographyDLTIdentity< float >( 1e-3f );
 	TestSquareHomography< float >( 1000, 1e-2f );
 	TestHomographyDLT< float >( 1000, 1e-2f );
+	// four points with float precision are too poorly conditioned for random homographies
+	TestHomographyDLTFast< float >( 1000, 1e-2f, false );
+	TestSquareMarkerPoses< float >( 300, 1e-2f, 1 );
 	// TestPoseFromHomography< float >( 1000, 1e-2f );
 }
@@ -0,0 +1,91 @@
+#include <utCalibration/TipCalibration.h>
+#include "../tools.h"
+
+#include <vector>
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+namespace ublas = boost::numeric::ublas;
+
+/** pose of a body pivoting around pw with its tip pm, rotated up to about 30 degrees around a base orientation */
+static Math::Pose randomPivotPose( const Math::Quaternion& base, const Math::Vector< double, 3 >& pm, 
+	const Math::Vector< double, 3 >& pw, double noise )
+{
+	const Math::Quaternion q( random( -0.25, 0.25 ), random( -0.25, 0.25 ), random( -0.25, 0.25 ), 1.0 );
+	const Math::Quaternion rot( base * Math::Quaternion( q ).normalize() );
+	return Math::Pose( rot, pw - rot * pm + randomVector< double, 3 >( noise ) );
+}
+
+static double rmsResidual( const std::vector< Math::Pose >& poses, const Math::Vector< double, 3 >& pm, const Math::Vector< double, 3 >& pw )
+{
+	double sum = 0;
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+	{
+		const Math::Vector< double, 3 > r( poses[ i ] * pm - pw );
+		sum += ublas::inner_prod( r, r );
+	}
+	return std::sqrt( sum / poses.size() );
+}
+
+void TestTipCalibration()
+{
+	for ( int iRun = 0; iRun < 20; iRun++ )
+	{
+		const Math::Quaternion base( randomQuaternion() );
+		const Math::Vector< double, 3 > pm( randomVector< double, 3 >( 0.2 ) );
+		const Math::Vector< double, 3 > pw( randomVector< double, 3 >( 1.0 ) );
+
+		// noisy poses with 10% outliers
+		Calibration::OnlineTipCalibration calib( 3.0, 0.001 );
+		std::vector< Math::Pose > inliers;
+		std::size_t nOutliers = 0;
+		for ( std::size_t i = 0; i < 500; i++ )
+		{
+			if ( i >= 20 && i % 10 == 0 )
+			{
+				Math::Pose outlier( randomPivotPose( base, pm, pw, 0.0001 ) );
+				outlier = Math::Pose( outlier.rotation(), outlier.translation() + Math::Vector< double, 3 >( 0.05, 0, 0 ) );
+				BOOST_CHECK( !calib.addPose( outlier ) );
+				nOutliers++;
+			}
+			else
+			{
+				inliers.push_back( randomPivotPose( base, pm, pw, 0.0001 ) );
+				BOOST_CHECK( calib.addPose( inliers.back() ) );
+			}
+		}
+		BOOST_CHECK( calib.isValid() );
+		BOOST_CHECK_EQUAL( calib.size(), inliers.size() );
+		BOOST_CHECK_EQUAL( calib.getNumberOfRejected(), nOutliers );
+		BOOST_CHECK_SMALL( ublas::norm_2( calib.getTip() - pm ), 1e-3 );
+		BOOST_CHECK_SMALL( ublas::norm_2( calib.getPivot() - pw ), 1e-3 );
+		BOOST_CHECK_SMALL( calib.getRms() - rmsResidual( inliers, calib.getTip(), calib.getPivot() ), 1e-8 );
+
+#ifdef HAVE_LAPACK
+		// same least-squares solution as the batch version
+		Math::Vector< double, 3 > batchPm, batchPw;
+		Calibration::tipCalibration( inliers, batchPm, batchPw );
+		BOOST_CHECK_SMALL( ublas::norm_2( calib.getTip() - batchPm ), 1e-8 );
+		BOOST_CHECK_SMALL( ublas::norm_2( calib.getPivot() - batchPw ), 1e-8 );
+
+		// sliding window: removing the first poses gives the solution of the remaining ones
+		for ( std::size_t i = 0; i < 100; i++ )
+			calib.removePose( inliers[ i ] );
+		std::vector< Math::Pose > window( inliers.begin() + 100, inliers.end() );
+		Calibration::tipCalibration( window, batchPm, batchPw );
+		BOOST_CHECK_EQUAL( calib.size(), window.size() );
+		BOOST_CHECK_SMALL( ublas::norm_2( calib.getTip() - batchPm ), 1e-8 );
+		BOOST_CHECK_SMALL( ublas::norm_2( calib.getPivot() - batchPw ), 1e-8 );
+#endif
+	}
+
+	// without rotation, tip and pivot are undetermined
+	Calibration::OnlineTipCalibration calib;
+	const Math::Pose pose( randomQuaternion(), randomVector< double, 3 >( 1.0 ) );
+	for ( std::size_t i = 0; i < 10; i++ )
+		calib.addPose( pose );
+	BOOST_CHECK( !calib.isValid() );
+}
@@ -0,0 +1,166 @@
+#include <utMath/BatchLevenbergMarquardt.h>
+#ifdef HAVE_LAPACK
+#include <utMath/LevenbergMarquardt.h>
+#endif
+#include <utMath/Random/Scalar.h>
+
+#include <vector>
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** triangulation of 3D points seen by two cameras at x = 0 and x = 1, looking along z */
+class StereoPoints
+{
+public:
+	void evaluateWithJacobian( std::size_t, const double ( &input )[ 3 ], double ( &result )[ 4 ], double ( &J )[ 4 ][ 3 ] ) const
+	{
+		const double f( 500 );
+		const double iz( 1 / input[ 2 ] );
+		for ( std::size_t c( 0 ); c < 2; c++ )
+		{
+			const double x( input[ 0 ] - c );
+			result[ 2 * c ] = f * x * iz;
+			result[ 2 * c + 1 ] = f * input[ 1 ] * iz;
+			J[ 2 * c ][ 0 ] = f * iz; J[ 2 * c ][ 1 ] = 0; J[ 2 * c ][ 2 ] = -f * x * iz * iz;
+			J[ 2 * c + 1 ][ 0 ] = 0; J[ 2 * c + 1 ][ 1 ] = f * iz; J[ 2 * c + 1 ][ 2 ] = -f * input[ 1 ] * iz * iz;
+		}
+	}
+
+	static Math::Vector< double, 4 > project( const Math::Vector< double, 3 >& p )
+	{
+		double input[ 3 ] = { p( 0 ), p( 1 ), p( 2 ) };
+		double result[ 4 ];
+		double J[ 4 ][ 3 ];
+		StereoPoints().evaluateWithJacobian( 0, input, result, J );
+		return Math::Vector< double, 4 >( result[ 0 ], result[ 1 ], result[ 2 ], result[ 3 ] );
+	}
+};
+
+
+#ifdef HAVE_LAPACK
+
+/** a single problem of a batch for levenbergMarquardt */
+template< class P, std::size_t N, std::size_t M >
+class SingleProblem
+{
+public:
+	SingleProblem( const P& problem, std::size_t k )
+		: m_problem( problem )
+		, m_k( k )
+	{}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		double in[ N ];
+		double res[ M ];
+		double jac[ M ][ N ];
+		for ( std::size_t i( 0 ); i < N; i++ )
+			in[ i ] = input( i );
+		m_problem.evaluateWithJacobian( m_k, in, res, jac );
+		for ( std::size_t m( 0 ); m < M; m++ )
+		{
+			result( m ) = res[ m ];
+			for ( std::size_t i( 0 ); i < N; i++ )
+				J( m, i ) = jac[ m ][ i ];
+		}
+	}
+
+protected:
+	const P& m_problem;
+	std::size_t m_k;
+};
+
+#endif
+
+}
+
+
+void TestBatchLevenbergMarquardt()
+{
+	namespace ublas = boost::numeric::ublas;
+
+	// noisy stereo points with a rough initial guess, not a multiple of the lane count
+	const std::size_t n( 37 );
+	std::vector< Math::Vector< double, 3 > > truth( n );
+	std::vector< Math::Vector< double, 3 > > start( n );
+	std::vector< Math::Vector< double, 4 > > measurements( n );
+	for ( std::size_t k( 0 ); k < n; k++ )
+	{
+		truth[ k ] = Math::Vector< double, 3 >( Math::Random::distribute_uniform< double >( -2, 2 ),
+			Math::Random::distribute_uniform< double >( -2, 2 ), Math::Random::distribute_uniform< double >( 3, 10 ) );
+		measurements[ k ] = StereoPoints::project( truth[ k ] );
+		for ( std::size_t m( 0 ); m < 4; m++ )
+			measurements[ k ]( m ) += Math::Random::distribute_normal< double >( 0.0, 0.5 );
+		start[ k ] = truth[ k ] + Math::Vector< double, 3 >( Math::Random::distribute_normal< double >( 0.0, 0.5 ),
+			Math::Random::distribute_normal< double >( 0.0, 0.5 ), Math::Random::distribute_normal< double >( 0.0, 1.0 ) );
+	}
+
+	const StereoPoints problem;
+	const Math::OptTerminate terminate( 20, 1e-12 );
+
+	std::vector< Math::Vector< double, 3 > > params( start );
+	std::vector< double > residuals;
+	Math::batchLevenbergMarquardt( problem, params, measurements, terminate, residuals );
+	BOOST_REQUIRE_EQUAL( residuals.size(), n );
+	for ( std::size_t k( 0 ); k < n; k++ )
+	{
+		BOOST_CHECK_SMALL( ublas::norm_2( params[ k ] - truth[ k ] ), 0.5 );
+		BOOST_CHECK( residuals[ k ] < 10.0 );
+	}
+
+	// problems are independent of the others in their group
+	for ( std::size_t k( 0 ); k < n; k += 5 )
+	{
+		std::vector< Math::Vector< double, 3 > > single( 1, start[ k ] );
+		std::vector< Math::Vector< double, 4 > > singleMeasurement( 1, measurements[ k ] );
+		std::vector< double > singleResidual;
+		Math::batchLevenbergMarquardt( problem, single, singleMeasurement, terminate, singleResidual );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( single[ 0 ] - params[ k ] ), 0.0 );
+		BOOST_CHECK_EQUAL( singleResidual[ 0 ], residuals[ k ] );
+	}
+
+#ifdef HAVE_LAPACK
+	// same iteration as levenbergMarquardt
+	for ( int d( 0 ); d < 2; d++ )
+	{
+		const Math::LmDampingUpdate damping( d ? Math::lmDampingNielsen : Math::lmDampingFactor10 );
+		std::vector< Math::Vector< double, 3 > > batch( start );
+		Math::batchLevenbergMarquardt( problem, batch, measurements, terminate, residuals, damping );
+
+		for ( std::size_t k( 0 ); k < n; k++ )
+		{
+			SingleProblem< StereoPoints, 3, 4 > single( problem, k );
+			Math::Vector< double > param( 3 );
+			for ( std::size_t i( 0 ); i < 3; i++ )
+				param( i ) = start[ k ]( i );
+			const double res( Math::levenbergMarquardt( single, param, measurements[ k ], terminate, Math::OptNoNormalize(),
+				Math::lmUseCholesky, damping ) );
+			BOOST_CHECK_SMALL( ublas::norm_inf( param - batch[ k ] ), 1e-8 );
+			BOOST_CHECK_CLOSE( res, residuals[ k ], 1e-6 );
+		}
+	}
+#endif
+
+	// a failing problem does not disturb the others of its group
+	{
+		std::vector< Math::Vector< double, 3 > > group( start.begin(), start.begin() + 8 );
+		group[ 3 ]( 2 ) = std::numeric_limits< double >::quiet_NaN();
+		std::vector< Math::Vector< double, 4 > > groupMeasurements( measurements.begin(), measurements.begin() + 8 );
+		std::vector< double > groupResiduals;
+		Math::batchLevenbergMarquardt( problem, group, groupMeasurements, terminate, groupResiduals );
+		for ( std::size_t k( 0 ); k < 8; k++ )
+			if ( k != 3 )
+				BOOST_CHECK_EQUAL( ublas::norm_inf( group[ k ] - params[ k ] ), 0.0 );
+	}
+
+	// sizes must match
+	std::vector< Math::Vector< double, 4 > > tooFew( n - 1 );
+	BOOST_CHECK_THROW( Math::batchLevenbergMarquardt( problem, params, tooFew, terminate, residuals ), Util::Exception );
+}
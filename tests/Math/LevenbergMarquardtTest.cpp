@@ -0,0 +1,100 @@
+#include <utMath/LevenbergMarquardt.h>
+#include <utMath/SparseLevenbergMarquardt.h>
+#include <utMath/RobustWeightFunction.h>
+#include "Rosenbrock.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#ifdef HAVE_LAPACK
+
+using namespace Ubitrack;
+
+
+void TestLevenbergMarquardt()
+{
+	namespace ublas = boost::numeric::ublas;
+	BOOST_CHECK( ( Math::Detail::OptHasEvaluate< RosenbrockWithResidual, Math::Vector< double >::base_type >::value ) );
+	BOOST_CHECK( !( Math::Detail::OptHasEvaluate< Rosenbrock, Math::Vector< double >::base_type >::value ) );
+
+	const std::size_t n( 10 );
+	const Math::Vector< double > measurement( rosenbrockMeasurement( n ) );
+	Math::Vector< double > ones( n );
+	for ( std::size_t i( 0 ); i < n; i++ )
+		ones( i ) = 1.0;
+	const Math::OptTerminate terminate( 200, 1e-14 );
+
+	// residual-only trial steps give the same iterates with fewer jacobians
+	{
+		Rosenbrock plain( n );
+		Math::Vector< double > xPlain( rosenbrockStart( n ) );
+		const double resPlain( Math::levenbergMarquardt( plain, xPlain, measurement, terminate, Math::OptNoNormalize() ) );
+
+		RosenbrockWithResidual withResidual( n );
+		Math::Vector< double > xResidual( rosenbrockStart( n ) );
+		const double resResidual( Math::levenbergMarquardt( withResidual, xResidual, measurement, terminate, Math::OptNoNormalize() ) );
+
+		BOOST_CHECK_EQUAL( resPlain, resResidual );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( xPlain - xResidual ), 0.0 );
+		BOOST_CHECK_SMALL( ublas::norm_inf( xResidual - ones ), 1e-6 );
+		BOOST_CHECK_EQUAL( withResidual.nResiduals + 1, plain.nJacobians );
+		BOOST_CHECK( withResidual.nJacobians < plain.nJacobians );
+	}
+
+	// also with weights, where the jacobian of an accepted step has to be weighted afterwards
+	{
+		Math::Vector< double > noisy( measurement );
+		noisy( 3 ) += 5.0;
+		const Math::HuberWeightFunction weights( 1, 0.1 );
+
+		Rosenbrock plain( n );
+		Math::Vector< double > xPlain( rosenbrockStart( n ) );
+		Math::weightedLevenbergMarquardt( plain, xPlain, noisy, terminate, Math::OptNoNormalize(), weights );
+
+		RosenbrockWithResidual withResidual( n );
+		Math::Vector< double > xResidual( rosenbrockStart( n ) );
+		Math::weightedLevenbergMarquardt( withResidual, xResidual, noisy, terminate, Math::OptNoNormalize(), weights );
+
+		BOOST_CHECK_EQUAL( ublas::norm_inf( xPlain - xResidual ), 0.0 );
+		BOOST_CHECK( withResidual.nJacobians < plain.nJacobians );
+	}
+
+	// nielsen damping needs fewer trial steps
+	{
+		RosenbrockWithResidual factor10( n );
+		Math::Vector< double > xFactor10( rosenbrockStart( n ) );
+		Math::levenbergMarquardt( factor10, xFactor10, measurement, TerminateBelow(), Math::OptNoNormalize() );
+
+		RosenbrockWithResidual nielsen( n );
+		Math::Vector< double > xNielsen( rosenbrockStart( n ) );
+		Math::levenbergMarquardt( nielsen, xNielsen, measurement, TerminateBelow(), Math::OptNoNormalize(),
+			Math::lmUseCholesky, Math::lmDampingNielsen );
+
+		BOOST_CHECK_SMALL( ublas::norm_inf( xNielsen - ones ), 1e-6 );
+		BOOST_CHECK( nielsen.nResiduals < factor10.nResiduals );
+		BOOST_CHECK( nielsen.nResiduals - ( nielsen.nJacobians - 1 ) < factor10.nResiduals - ( factor10.nJacobians - 1 ) );
+	}
+
+	// the sparse optimizer behaves the same
+	{
+		Rosenbrock plain( n );
+		Math::Vector< double > xPlain( rosenbrockStart( n ) );
+		Math::sparseLevenbergMarquardt( plain, xPlain, measurement, terminate, Math::OptNoNormalize() );
+
+		RosenbrockWithResidual withResidual( n );
+		Math::Vector< double > xResidual( rosenbrockStart( n ) );
+		Math::sparseLevenbergMarquardt( withResidual, xResidual, measurement, terminate, Math::OptNoNormalize(),
+			Math::sparseLmUseCholesky, Math::lmDampingNielsen );
+
+		BOOST_CHECK_SMALL( ublas::norm_inf( xPlain - ones ), 1e-6 );
+		BOOST_CHECK_SMALL( ublas::norm_inf( xResidual - ones ), 1e-6 );
+		BOOST_CHECK( withResidual.nJacobians < plain.nJacobians );
+	}
+}
+
+#else
+
+void TestLevenbergMarquardt()
+{}
+
+#endif // HAVE_LAPACK
@@ -0,0 +1,145 @@
+#include <utMath/Graph/LinearAssignment.h>
+#include <utMath/Graph/Munkres.h>
+#include "../tools.h"
+
+#include <vector>
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+/** brute force: maximum number of pairs and their minimal cost */
+static void bruteForceAssignment( const Math::Matrix< double, 0, 0 >& costs, std::size_t row, std::vector< bool >& usedCols,
+	std::size_t nPairs, double cost, std::size_t& bestPairs, double& bestCost )
+{
+	if ( row == costs.size1() )
+	{
+		if ( nPairs > bestPairs || ( nPairs == bestPairs && cost < bestCost ) )
+		{
+			bestPairs = nPairs;
+			bestCost = cost;
+		}
+		return;
+	}
+
+	bruteForceAssignment( costs, row + 1, usedCols, nPairs, cost, bestPairs, bestCost );
+	for ( std::size_t col( 0 ); col < costs.size2(); col++ )
+		if ( !usedCols[ col ] && costs( row, col ) < std::numeric_limits< double >::infinity() )
+		{
+			usedCols[ col ] = true;
+			bruteForceAssignment( costs, row + 1, usedCols, nPairs + 1, cost + costs( row, col ), bestPairs, bestCost );
+			usedCols[ col ] = false;
+		}
+}
+
+/** checks the assignment for consistency and optimality against brute force */
+static void checkAssignment( const Math::Matrix< double, 0, 0 >& costs, const Math::Graph::LinearAssignment< double >& solver, double totalCost )
+{
+	const std::vector< std::size_t >& rowMatch = solver.getRowMatchList();
+	const std::vector< std::size_t >& colMatch = solver.getColMatchList();
+	BOOST_REQUIRE_EQUAL( rowMatch.size(), costs.size1() );
+	BOOST_REQUIRE_EQUAL( colMatch.size(), costs.size2() );
+
+	std::size_t nPairs = 0;
+	double cost = 0;
+	for ( std::size_t row( 0 ); row < costs.size1(); row++ )
+		if ( rowMatch[ row ] < costs.size2() )
+		{
+			BOOST_CHECK_EQUAL( colMatch[ rowMatch[ row ] ], row );
+			BOOST_CHECK( costs( row, rowMatch[ row ] ) < std::numeric_limits< double >::infinity() );
+			cost += costs( row, rowMatch[ row ] );
+			nPairs++;
+		}
+	BOOST_CHECK_EQUAL( nPairs, solver.size() );
+	BOOST_CHECK_SMALL( cost - totalCost, 1e-9 );
+
+	// maximum cardinality and minimal cost
+	std::vector< bool > usedCols( costs.size2(), false );
+	std::size_t bestPairs = 0;
+	double bestCost = std::numeric_limits< double >::infinity();
+	bruteForceAssignment( costs, 0, usedCols, 0, 0, bestPairs, bestCost );
+	BOOST_CHECK_EQUAL( nPairs, bestPairs );
+	BOOST_CHECK_SMALL( cost - bestCost, 1e-9 );
+}
+
+static Math::Matrix< double, 0, 0 > randomCosts( std::size_t nRows, std::size_t nCols, double fForbidden )
+{
+	Math::Matrix< double, 0, 0 > costs( nRows, nCols );
+	for ( std::size_t i( 0 ); i < nRows; i++ )
+		for ( std::size_t j( 0 ); j < nCols; j++ )
+			costs( i, j ) = random( 0.0, 1.0 ) < fForbidden ? std::numeric_limits< double >::infinity() : random( -10.0, 100.0 );
+	return costs;
+}
+
+static void toSparse( const Math::Matrix< double, 0, 0 >& costs, std::vector< std::size_t >& rowStart, 
+	std::vector< std::size_t >& colIndex, std::vector< double >& values )
+{
+	rowStart.assign( 1, 0 );
+	colIndex.clear();
+	values.clear();
+	for ( std::size_t i( 0 ); i < costs.size1(); i++ )
+	{
+		for ( std::size_t j( 0 ); j < costs.size2(); j++ )
+			if ( costs( i, j ) < std::numeric_limits< double >::infinity() )
+			{
+				colIndex.push_back( j );
+				values.push_back( costs( i, j ) );
+			}
+		rowStart.push_back( colIndex.size() );
+	}
+}
+
+void TestLinearAssignment()
+{
+	// small dense, rectangular and gated problems against brute force, dense and sparse input
+	for ( int iRun = 0; iRun < 200; iRun++ )
+	{
+		const std::size_t nRows = static_cast< std::size_t >( random( 1.0, 6.99 ) );
+		const std::size_t nCols = static_cast< std::size_t >( random( 1.0, 6.99 ) );
+		const Math::Matrix< double, 0, 0 > costs( randomCosts( nRows, nCols, iRun % 2 ? 0.5 : 0.0 ) );
+
+		Math::Graph::LinearAssignment< double > solver;
+		checkAssignment( costs, solver, solver.solve( costs ) );
+
+		std::vector< std::size_t > rowStart, colIndex;
+		std::vector< double > values;
+		toSparse( costs, rowStart, colIndex, values );
+		Math::Graph::LinearAssignment< double > sparseSolver;
+		checkAssignment( costs, sparseSolver, sparseSolver.solve( nRows, nCols, rowStart, colIndex, values ) );
+
+		// warm start after a perturbation of the costs and a new column
+		Math::Matrix< double, 0, 0 > perturbed( randomCosts( nRows, nCols + 1, iRun % 2 ? 0.5 : 0.0 ) );
+		for ( std::size_t i( 0 ); i < nRows; i++ )
+			for ( std::size_t j( 0 ); j < nCols; j++ )
+				perturbed( i, j ) = costs( i, j ) + random( -1.0, 1.0 );
+		checkAssignment( perturbed, solver, solver.solve( perturbed, true ) );
+		
+		toSparse( perturbed, rowStart, colIndex, values );
+		checkAssignment( perturbed, sparseSolver, sparseSolver.solve( nRows, nCols + 1, rowStart, colIndex, values, true ) );
+	}
+
+	// larger square problems against Munkres
+	for ( int iRun = 0; iRun < 10; iRun++ )
+	{
+		const std::size_t n = 30;
+		Math::Matrix< double, 0, 0 > costs( n, n );
+		for ( std::size_t i( 0 ); i < n; i++ )
+			for ( std::size_t j( 0 ); j < n; j++ )
+				costs( i, j ) = static_cast< int >( random( 0.0, 1000.0 ) );
+
+		Math::Graph::LinearAssignment< double > solver;
+		const double totalCost = solver.solve( costs );
+		BOOST_CHECK_EQUAL( solver.size(), n );
+
+		Math::Matrix< double, 0, 0 > copy( costs );
+		Math::Graph::Munkres< double > munkres( copy );
+		munkres.solve();
+		const std::vector< std::size_t > munkresMatch = munkres.getRowMatchList();
+		double munkresCost = 0;
+		for ( std::size_t i( 0 ); i < n; i++ )
+			munkresCost += costs( i, munkresMatch[ i ] );
+		BOOST_CHECK_EQUAL( totalCost, munkresCost );
+	}
+}
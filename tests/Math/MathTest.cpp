@@ -5,6 +5,13 @@ void TestConic();
 void TestPoints();
 void TestLapack();
 void TestQuaternionConversion();
+void TestLinearAssignment();
+void TestRobustWeightFunction();
+void TestSparseLevenbergMarquardt();
+void TestLevenbergMarquardt();
+void TestParallelEvaluation();
+void TestBatchLevenbergMarquardt();
+void TestOptimizationStatistics();
 
 
 MathTest::MathTest()
@@ -14,4 +21,11 @@ MathTest::MathTest()
 	add( BOOST_TEST_CASE( &TestPoints ) );
 	add( BOOST_TEST_CASE( &TestLapack ) );
 	add( BOOST_TEST_CASE( &TestQuaternionConversion ) );
+	add( BOOST_TEST_CASE( &TestLinearAssignment ) );
+	add( BOOST_TEST_CASE( &TestRobustWeightFunction ) );
+	add( BOOST_TEST_CASE( &TestSparseLevenbergMarquardt ) );
+	add( BOOST_TEST_CASE( &TestLevenbergMarquardt ) );
+	add( BOOST_TEST_CASE( &TestParallelEvaluation ) );
+	add( BOOST_TEST_CASE( &TestBatchLevenbergMarquardt ) );
+	add( BOOST_TEST_CASE( &TestOptimizationStatistics ) );
 }
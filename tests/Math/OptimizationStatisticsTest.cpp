@@ -0,0 +1,143 @@
+#include <utMath/OptimizationStatistics.h>
+#include <utMath/DownhillSimplex.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#ifdef HAVE_LAPACK
+#include <utMath/LevenbergMarquardt.h>
+#include <utMath/GaussNewton.h>
+#endif
+
+#include "Rosenbrock.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+
+void TestOptimizationStatistics()
+{
+	namespace ublas = boost::numeric::ublas;
+	const RosenbrockWithResidual problem( 2 );
+	const Math::Vector< double, 2 > measurement( 0.0, 1.0 );
+	const Math::Vector< double, 2 > start( -1.2, 1.0 );
+
+	BOOST_CHECK_EQUAL( Math::OptStatistics::histogramBin( 0 ), 0u );
+	BOOST_CHECK_EQUAL( Math::OptStatistics::histogramBin( 1 ), 0u );
+	BOOST_CHECK_EQUAL( Math::OptStatistics::histogramBin( 2 ), 1u );
+	BOOST_CHECK_EQUAL( Math::OptStatistics::histogramBin( 3 ), 1u );
+	BOOST_CHECK_EQUAL( Math::OptStatistics::histogramBin( 4 ), 2u );
+	BOOST_CHECK_EQUAL( Math::OptStatistics::histogramBin( 100 ), 6u );
+
+	Math::OptStatistics total;
+
+	// downhill simplex
+	{
+		Math::OptStatistics stats( true );
+		Math::Vector< double, 2 > x( start );
+		const double res( Math::downhillSimplex( problem, x, measurement, Math::OptTerminate( 500, 1e-10 ), Math::OptNoNormalize(), stats ) );
+		const Math::OptStatistics::Call& call( stats.lastCall() );
+
+		BOOST_CHECK_EQUAL( std::string( call.sOptimizer ), "downhillSimplex" );
+		BOOST_CHECK( call.nIterations > 10 );
+		BOOST_CHECK_EQUAL( stats.trace().size(), call.nIterations );
+		BOOST_CHECK_EQUAL( call.residual, res );
+		BOOST_CHECK_EQUAL( call.initialResidual, stats.trace().front().info.previousResidual );
+		BOOST_CHECK( res < call.initialResidual );
+
+		// the best point never gets worse
+		for ( std::size_t i( 0 ); i < stats.trace().size(); i++ )
+		{
+			const Math::OptIteration& info( stats.trace()[ i ].info );
+			BOOST_CHECK_EQUAL( info.iteration, i + 1 );
+			BOOST_CHECK( info.residual <= info.previousResidual );
+			BOOST_CHECK_EQUAL( info.bAccepted, info.residual < info.previousResidual );
+			BOOST_CHECK( stats.trace()[ i ].seconds >= 0 );
+		}
+
+		// same result without observer
+		Math::Vector< double, 2 > x2( start );
+		BOOST_CHECK_EQUAL( Math::downhillSimplex( problem, x2, measurement, Math::OptTerminate( 500, 1e-10 ), Math::OptNoNormalize() ), res );
+		total.merge( stats );
+	}
+
+#ifdef HAVE_LAPACK
+	// levenberg-marquardt
+	{
+		Math::OptStatistics stats( true );
+		Math::Vector< double > x( start );
+		const double res( Math::levenbergMarquardt( problem, x, measurement, TerminateBelow(), Math::OptNoNormalize(),
+			Math::lmUseCholesky, Math::lmDampingFactor10, stats ) );
+		const Math::OptStatistics::Call& call( stats.lastCall() );
+		const std::vector< Math::OptStatistics::TraceEntry >& trace( stats.trace() );
+
+		BOOST_CHECK_EQUAL( std::string( call.sOptimizer ), "levenbergMarquardt" );
+		BOOST_REQUIRE_EQUAL( trace.size(), call.nIterations );
+		BOOST_CHECK_EQUAL( call.residual, res );
+		BOOST_CHECK_EQUAL( trace.front().info.lambda, 1.0 );
+		BOOST_CHECK_EQUAL( call.lambda, trace.back().info.lambda );
+		BOOST_CHECK( call.seconds >= call.maxIterationSeconds );
+
+		unsigned nAccepted( 0 );
+		bool bRejected( false );
+		for ( std::size_t i( 0 ); i < trace.size(); i++ )
+		{
+			const Math::OptIteration& info( trace[ i ].info );
+			BOOST_CHECK_EQUAL( info.iteration, i + 1 );
+			BOOST_CHECK( info.stepNorm > 0 );
+			if ( info.bAccepted )
+				nAccepted++;
+			else
+				bRejected = true;
+
+			// the residual and damping of the next iteration depend on acceptance
+			if ( i + 1 < trace.size() )
+			{
+				const Math::OptIteration& next( trace[ i + 1 ].info );
+				BOOST_CHECK_EQUAL( next.previousResidual, info.bAccepted ? info.residual : info.previousResidual );
+				BOOST_CHECK_CLOSE( next.lambda, info.bAccepted ? info.lambda / 10 : info.lambda * 10, 1e-10 );
+			}
+		}
+		BOOST_CHECK_EQUAL( call.nAccepted, nAccepted );
+		BOOST_CHECK( bRejected );
+		BOOST_CHECK( call.nIterations < 100 );
+
+		// same result without observer
+		Math::Vector< double > x2( start );
+		BOOST_CHECK_EQUAL( Math::levenbergMarquardt( problem, x2, measurement, TerminateBelow(), Math::OptNoNormalize() ), res );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( x - x2 ), 0.0 );
+		total.merge( stats );
+	}
+
+	// gauss-newton
+	{
+		Math::OptStatistics stats;
+		Math::Vector< double > x( start );
+		Math::gaussNewton( problem, x, measurement, 5, Math::OptNoNormalize(), stats );
+		BOOST_CHECK_EQUAL( std::string( stats.lastCall().sOptimizer ), "gaussNewton" );
+		BOOST_CHECK_EQUAL( stats.lastCall().nIterations, 5u );
+		BOOST_CHECK_EQUAL( stats.lastCall().nAccepted, 5u );
+		BOOST_CHECK_EQUAL( stats.lastCall().lambda, 0.0 );
+		BOOST_CHECK( stats.trace().empty() );
+		BOOST_CHECK_SMALL( stats.lastCall().residual, 1e-20 );
+		total.merge( stats );
+	}
+#endif
+
+	// aggregation
+	std::size_t nCalls( 0 );
+	for ( std::size_t i( 0 ); i < total.iterationHistogram().size(); i++ )
+		nCalls += total.iterationHistogram()[ i ];
+	BOOST_CHECK_EQUAL( nCalls, total.calls() );
+#ifdef HAVE_LAPACK
+	BOOST_CHECK_EQUAL( total.calls(), 3u );
+#else
+	BOOST_CHECK_EQUAL( total.calls(), 1u );
+#endif
+	BOOST_CHECK( total.maxIterations() > 10 );
+	BOOST_CHECK( total.totalSeconds() >= total.maxSeconds() );
+
+	total.reset();
+	BOOST_CHECK_EQUAL( total.calls(), 0u );
+	BOOST_CHECK( total.iterationHistogram().empty() );
+}
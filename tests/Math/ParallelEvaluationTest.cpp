@@ -0,0 +1,181 @@
+#include <utMath/ParallelEvaluation.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#ifdef HAVE_LAPACK
+#include <utMath/LevenbergMarquardt.h>
+#endif
+
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/**
+ * exponential curve y = a * exp( b * t ) + c, sampled at blocks of 1 to 3 values of t.
+ * Counts the evaluated blocks in the scratch space.
+ */
+class ExponentialBlocks
+{
+public:
+	ExponentialBlocks( std::size_t nBlocks )
+		: m_rows( nBlocks + 1 )
+	{
+		m_rows[ 0 ] = 0;
+		for ( std::size_t b( 0 ); b < nBlocks; b++ )
+			m_rows[ b + 1 ] = m_rows[ b ] + 1 + b % 3;
+	}
+
+	struct Scratch
+	{
+		Scratch()
+			: begin( 0 )
+			, nBlocks( 0 )
+		{}
+
+		std::size_t begin;
+		std::size_t nBlocks;
+	};
+
+	std::size_t blockCount() const
+	{ return m_rows.size() - 1; }
+
+	std::size_t blockRow( std::size_t block ) const
+	{ return m_rows[ block ]; }
+
+	template< class VT1, class VT2 >
+	void evaluateBlocks( VT1& result, const VT2& input, std::size_t begin, std::size_t end, Scratch& scratch ) const
+	{
+		scratch.begin = begin;
+		scratch.nBlocks = end - begin;
+		for ( std::size_t r( m_rows[ begin ] ); r < m_rows[ end ]; r++ )
+			result( r ) = input( 0 ) * std::exp( input( 1 ) * t( r ) ) + input( 2 );
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateBlocksWithJacobian( VT1& result, const VT2& input, MT& J, std::size_t begin, std::size_t end, Scratch& scratch ) const
+	{
+		evaluateBlocks( result, input, begin, end, scratch );
+		for ( std::size_t r( m_rows[ begin ] ); r < m_rows[ end ]; r++ )
+		{
+			const double e( std::exp( input( 1 ) * t( r ) ) );
+			J( r, 0 ) = e;
+			J( r, 1 ) = input( 0 ) * t( r ) * e;
+			J( r, 2 ) = 1;
+		}
+	}
+
+	/** single-threaded evaluation */
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		Scratch scratch;
+		evaluateBlocksWithJacobian( result, input, J, 0, blockCount(), scratch );
+	}
+
+	static double t( std::size_t row )
+	{ return 0.01 * row; }
+
+protected:
+	std::vector< std::size_t > m_rows;
+};
+
+}
+
+
+void TestParallelEvaluation()
+{
+	namespace ublas = boost::numeric::ublas;
+	const std::size_t nBlocks( 1000 );
+	ExponentialBlocks problem( nBlocks );
+	const std::size_t n( problem.blockRow( nBlocks ) );
+
+	Math::Vector< double, 3 > input( 2.0, -0.5, 1.0 );
+	Math::Vector< double > serialResult( n );
+	Math::Matrix< double, 0, 0 > serialJ( n, 3 );
+	problem.evaluateWithJacobian( serialResult, input, serialJ );
+
+	// same results with any number of threads
+	for ( unsigned nThreads( 1 ); nThreads <= 8; nThreads++ )
+	{
+		Math::ParallelEvaluation< ExponentialBlocks > parallel( problem, nThreads, 1 );
+		BOOST_CHECK_EQUAL( parallel.size(), n );
+
+		Math::Vector< double > result( n );
+		Math::Matrix< double, 0, 0 > J( n, 3 );
+		parallel.evaluateWithJacobian( result, input, J );
+		BOOST_CHECK_EQUAL( parallel.rangeCount(), nThreads );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( result - serialResult ), 0.0 );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( J - serialJ ), 0.0 );
+
+		Math::Vector< double > result2( n );
+		parallel.evaluate( result2, input );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( result2 - serialResult ), 0.0 );
+
+		// scratch spaces cover all blocks in order
+		std::size_t nEvaluated( 0 );
+		for ( std::size_t i( 0 ); i < parallel.scratch().size(); i++ )
+		{
+			BOOST_CHECK_EQUAL( parallel.scratch()[ i ].begin, nEvaluated );
+			nEvaluated += parallel.scratch()[ i ].nBlocks;
+		}
+		BOOST_CHECK_EQUAL( nEvaluated, nBlocks );
+	}
+
+	// small functions are evaluated on fewer threads
+	{
+		Math::ParallelEvaluation< ExponentialBlocks > parallel( problem, 8, 300 );
+		Math::Vector< double > result( n );
+		parallel.evaluate( result, input );
+		BOOST_CHECK_EQUAL( parallel.rangeCount(), 3u );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( result - serialResult ), 0.0 );
+
+		ExponentialBlocks tiny( 5 );
+		Math::ParallelEvaluation< ExponentialBlocks > tinyParallel( tiny, 8 );
+		Math::Vector< double > tinyResult( tinyParallel.size() );
+		tinyParallel.evaluate( tinyResult, input );
+		BOOST_CHECK_EQUAL( tinyParallel.rangeCount(), 1u );
+	}
+
+	// ranges of whole blocks, a single range runs on the calling thread
+	{
+		const Math::ThreadRanges ranges( 1000, 3, 64 );
+		BOOST_CHECK_EQUAL( ranges.count(), 3u );
+		BOOST_CHECK_EQUAL( ranges.begin( 0 ), 0u );
+		BOOST_CHECK_EQUAL( ranges.begin( 3 ), 1000u );
+		for ( std::size_t i( 1 ); i < 3; i++ )
+		{
+			BOOST_CHECK_EQUAL( ranges.begin( i ) % 64, 0u );
+			BOOST_CHECK( ranges.begin( i ) > ranges.begin( i - 1 ) );
+		}
+
+		BOOST_CHECK_EQUAL( Math::ThreadRanges( 100, 8, 64 ).count(), 2u );
+		BOOST_CHECK_EQUAL( Math::ThreadRanges( 100, 0 ).count(), 1u );
+		BOOST_CHECK_EQUAL( Math::ThreadRanges( 0, 4 ).count(), 1u );
+		BOOST_CHECK_EQUAL( Math::ThreadRanges( 0, 4 ).begin( 1 ), 0u );
+	}
+
+#ifdef HAVE_LAPACK
+	// optimization gives the same result as the single-threaded function
+	{
+		Math::Vector< double > measurement( serialResult );
+		for ( std::size_t r( 0 ); r < n; r++ )
+			measurement( r ) += 0.01 * std::sin( 7.0 * r );
+
+		Math::Vector< double > paramSerial( 3 );
+		paramSerial( 0 ) = 1.0; paramSerial( 1 ) = 0.0; paramSerial( 2 ) = 0.0;
+		Math::Vector< double > paramParallel( paramSerial );
+
+		const double resSerial( Math::levenbergMarquardt( problem, paramSerial, measurement, Math::OptTerminate( 20, 1e-10 ), Math::OptNoNormalize() ) );
+		Math::ParallelEvaluation< ExponentialBlocks > parallel( problem, 4, 1 );
+		const double resParallel( Math::levenbergMarquardt( parallel, paramParallel, measurement, Math::OptTerminate( 20, 1e-10 ), Math::OptNoNormalize() ) );
+
+		BOOST_CHECK_EQUAL( resSerial, resParallel );
+		BOOST_CHECK_EQUAL( ublas::norm_inf( paramSerial - paramParallel ), 0.0 );
+		BOOST_CHECK_SMALL( ublas::norm_inf( paramParallel - input ), 1e-2 );
+	}
+#endif
+}
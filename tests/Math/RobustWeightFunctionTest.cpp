@@ -0,0 +1,174 @@
+#include <utMath/RobustWeightFunction.h>
+#include <utMath/Vector.h>
+#ifdef HAVE_LAPACK
+#include <utMath/LevenbergMarquardt.h>
+#endif
+#include <utMath/Random/Scalar.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+/** checks the shape of the weights of a loss function */
+template< class Loss >
+static void checkLoss( bool bRedescending )
+{
+	const double c( Loss::defaultConstant() );
+	BOOST_CHECK_CLOSE( Loss::weight( 0.0, c * c ), 1.0, 1e-9 );
+
+	double fPrev( 1.0 );
+	for ( double u( 0.1 ); u < 10 * c; u += 0.1 )
+	{
+		const double w( Loss::weight( u * u, c * c ) );
+		BOOST_CHECK( w <= fPrev );
+		BOOST_CHECK( w >= 0.0 );
+		fPrev = w;
+	}
+
+	// influence u * w( u ) goes to zero for redescending losses
+	const double u( 100 * c );
+	if ( bRedescending )
+		BOOST_CHECK_SMALL( u * Loss::weight( u * u, c * c ), 0.1 );
+	else
+		BOOST_CHECK( u * Loss::weight( u * u, c * c ) > 0.5 * c );
+}
+
+
+/** gaussian residual blocks with a fraction of outlier blocks */
+static Math::Vector< double > noisyResiduals( std::size_t n, unsigned rows, double sigma, double fOutliers )
+{
+	Math::Vector< double > e( n * rows );
+	for ( std::size_t i( 0 ); i < n; i++ )
+	{
+		const bool bOutlier( Math::Random::distribute_uniform< double >( 0, 1 ) < fOutliers );
+		for ( std::size_t r( 0 ); r < rows; r++ )
+			e( i * rows + r ) = bOutlier ? Math::Random::distribute_uniform< double >( -100, 100 ) :
+				Math::Random::distribute_normal< double >( 0.0, sigma );
+	}
+	return e;
+}
+
+
+#ifdef HAVE_LAPACK
+
+/** shift of 2d points, measurement is p_i + t */
+class PointShift
+{
+public:
+	PointShift( const std::vector< Math::Vector< double, 2 > >& points )
+		: m_points( points )
+	{}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		for ( std::size_t i( 0 ); i < m_points.size(); i++ )
+			for ( std::size_t r( 0 ); r < 2; r++ )
+			{
+				result( 2 * i + r ) = m_points[ i ]( r ) + input( r );
+				J( 2 * i + r, 0 ) = r == 0 ? 1 : 0;
+				J( 2 * i + r, 1 ) = r == 1 ? 1 : 0;
+			}
+	}
+
+protected:
+	const std::vector< Math::Vector< double, 2 > >& m_points;
+};
+
+template< class WF >
+static double robustShift( const std::vector< Math::Vector< double, 2 > >& points, const Math::Vector< double >& measurements,
+	const WF& weightFunction, const Math::Vector< double, 2 >& shift )
+{
+	PointShift problem( points );
+	Math::Vector< double > param( 2 );
+	param( 0 ) = param( 1 ) = 0;
+	Math::weightedLevenbergMarquardt( problem, param, measurements, Math::OptTerminate( 20, 1e-8 ),
+		Math::OptNoNormalize(), weightFunction );
+	return norm_2( param - shift );
+}
+
+#endif // HAVE_LAPACK
+
+
+void TestRobustWeightFunction()
+{
+	checkLoss< Math::RobustLoss::Huber >( false );
+	checkLoss< Math::RobustLoss::Cauchy >( true );
+	checkLoss< Math::RobustLoss::Tukey >( true );
+	checkLoss< Math::RobustLoss::GemanMcClure >( true );
+	BOOST_CHECK_EQUAL( Math::RobustLoss::Tukey::weight( 25.0, 16.0 ), 0.0 );
+
+	// MAD scale of single rows and 2d blocks, robust to 20% outliers
+	for ( unsigned rows( 1 ); rows <= 4; rows++ )
+	{
+		const double fClean( Math::CauchyWeightFunction( rows ).estimateScale( noisyResiduals( 2000, rows, 2.0, 0.0 ) ) );
+		const double fOutliers( Math::CauchyWeightFunction( rows ).estimateScale( noisyResiduals( 2000, rows, 2.0, 0.2 ) ) );
+		BOOST_CHECK_CLOSE( fClean, 2.0, 8.0 );
+		BOOST_CHECK_CLOSE( fOutliers, 2.0, 40.0 );
+	}
+
+	// blocks are weighted jointly, fixed scale
+	{
+		Math::Vector< double > e( 5 );
+		e( 0 ) = 0.5; e( 1 ) = 0.0; e( 2 ) = 3.0; e( 3 ) = 4.0; e( 4 ) = 10.0;
+		Math::Vector< double > w( 5 );
+		Math::HuberWeightFunction( 2, 1.0, 2.0 ).computeWeights( e, w );
+		BOOST_CHECK_CLOSE( w( 0 ), 1.0, 1e-9 );
+		BOOST_CHECK_CLOSE( w( 1 ), 1.0, 1e-9 );
+		BOOST_CHECK_CLOSE( w( 2 ), 0.4, 1e-9 );
+		BOOST_CHECK_CLOSE( w( 3 ), 0.4, 1e-9 );
+		BOOST_CHECK_CLOSE( w( 4 ), 1.0, 1e-9 );
+
+		Math::TukeyBiweightFunction( 2, 1.0, 4.0 ).computeWeights( e, w );
+		BOOST_CHECK_CLOSE( w( 0 ), ( 1 - 0.25 / 16 ) * ( 1 - 0.25 / 16 ), 1e-9 );
+		BOOST_CHECK_EQUAL( w( 2 ), 0.0 );
+		BOOST_CHECK_EQUAL( w( 3 ), 0.0 );
+	}
+
+	// exact fits do not divide by zero
+	{
+		Math::Vector< double > e( 4 );
+		e( 0 ) = e( 1 ) = e( 2 ) = e( 3 ) = 0.0;
+		Math::Vector< double > w( 4 );
+		Math::GemanMcClureWeightFunction( 2 ).computeWeights( e, w );
+		for ( std::size_t i( 0 ); i < 4; i++ )
+			BOOST_CHECK_CLOSE( w( i ), 1.0, 1e-9 );
+	}
+
+#ifdef HAVE_LAPACK
+	// robust estimation of a 2d shift with 30% gross outliers
+	for ( std::size_t run( 0 ); run < 10; run++ )
+	{
+		const Math::Vector< double, 2 > shift( Math::Random::distribute_uniform< double >( -10.0, 10.0 ),
+			Math::Random::distribute_uniform< double >( -10.0, 10.0 ) );
+		const std::size_t n( 100 );
+		std::vector< Math::Vector< double, 2 > > points( n );
+		Math::Vector< double > measurements( 2 * n );
+		for ( std::size_t i( 0 ); i < n; i++ )
+		{
+			points[ i ] = Math::Vector< double, 2 >( Math::Random::distribute_uniform< double >( -100.0, 100.0 ),
+				Math::Random::distribute_uniform< double >( -100.0, 100.0 ) );
+			const bool bOutlier( i % 10 < 3 );
+			for ( std::size_t r( 0 ); r < 2; r++ )
+				measurements( 2 * i + r ) = points[ i ]( r ) + shift( r ) +
+					( bOutlier ? Math::Random::distribute_uniform< double >( 20.0, 50.0 ) :
+					Math::Random::distribute_normal< double >( 0.0, 0.5 ) );
+		}
+
+		const double fPlain( robustShift( points, measurements, Math::OptNoWeightFunction(), shift ) );
+		const double fHuber( robustShift( points, measurements, Math::HuberWeightFunction( 2 ), shift ) );
+		const double fCauchy( robustShift( points, measurements, Math::CauchyWeightFunction( 2 ), shift ) );
+		const double fTukey( robustShift( points, measurements, Math::TukeyBiweightFunction( 2 ), shift ) );
+		const double fGemanMcClure( robustShift( points, measurements, Math::GemanMcClureWeightFunction( 2 ), shift ) );
+
+		BOOST_CHECK( fPlain > 10.0 );
+		BOOST_CHECK( fHuber < fPlain );
+		BOOST_CHECK_SMALL( fCauchy, 0.5 );
+		BOOST_CHECK_SMALL( fTukey, 0.5 );
+		BOOST_CHECK_SMALL( fGemanMcClure, 0.5 );
+	}
+#endif
+}
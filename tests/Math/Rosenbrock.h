@@ -0,0 +1,118 @@
+#ifndef __TESTS_MATH_ROSENBROCK_H_INCLUDED__
+#define __TESTS_MATH_ROSENBROCK_H_INCLUDED__
+
+#include <utMath/Vector.h>
+#include <utMath/SparseMatrix.h>
+
+/**
+ * extended rosenbrock function as least-squares problem: f( 2i ) = 10 ( x( 2i + 1 ) - x( 2i )^2 )
+ * with measurement 0 and f( 2i + 1 ) = x( 2i ) with measurement 1. Counts the evaluations.
+ */
+class Rosenbrock
+{
+public:
+	explicit Rosenbrock( std::size_t n )
+		: nJacobians( 0 )
+		, m_n( n )
+	{}
+
+	std::size_t size() const
+	{ return m_n; }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		nJacobians++;
+		residual( result, input );
+		for ( std::size_t r( 0 ); r < J.size1(); r++ )
+			for ( std::size_t c( 0 ); c < J.size2(); c++ )
+				J( r, c ) = 0;
+		for ( std::size_t i( 0 ); i < input.size(); i += 2 )
+		{
+			J( i, i ) = -20 * input( i );
+			J( i, i + 1 ) = 10;
+			J( i + 1, i ) = 1;
+		}
+	}
+
+	/** sparse jacobian */
+	template< class VT1, class VT2 >
+	void evaluateWithJacobian( VT1& result, const VT2& input, Ubitrack::Math::CsrMatrix< double >& J ) const
+	{
+		nJacobians++;
+		residual( result, input );
+		for ( std::size_t i( 0 ); i < input.size(); i += 2 )
+		{
+			J.insert( i, i, -20 * input( i ) );
+			J.insert( i, i + 1, 10 );
+			J.insert( i + 1, i, 1 );
+		}
+	}
+
+	mutable std::size_t nJacobians;
+
+protected:
+	template< class VT1, class VT2 >
+	static void residual( VT1& result, const VT2& input )
+	{
+		for ( std::size_t i( 0 ); i < input.size(); i += 2 )
+		{
+			result( i ) = 10 * ( input( i + 1 ) - input( i ) * input( i ) );
+			result( i + 1 ) = input( i );
+		}
+	}
+
+	std::size_t m_n;
+};
+
+/** the same problem with residual-only evaluation */
+class RosenbrockWithResidual
+	: public Rosenbrock
+{
+public:
+	explicit RosenbrockWithResidual( std::size_t n )
+		: Rosenbrock( n )
+		, nResiduals( 0 )
+	{}
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		nResiduals++;
+		residual( result, input );
+	}
+
+	mutable std::size_t nResiduals;
+};
+
+/** stops when the residual vanishes, as the relative change does not work for zero residual problems */
+struct TerminateBelow
+{
+	bool operator()( std::size_t iterations, double resNow, double ) const
+	{ return iterations >= 200 || resNow < 1e-20; }
+};
+
+/** the usual start point ( -1.2, 1 ) for each pair of parameters */
+inline Ubitrack::Math::Vector< double > rosenbrockStart( std::size_t n )
+{
+	Ubitrack::Math::Vector< double > x( n );
+	for ( std::size_t i( 0 ); i < n; i += 2 )
+	{
+		x( i ) = -1.2;
+		x( i + 1 ) = 1.0;
+	}
+	return x;
+}
+
+inline Ubitrack::Math::Vector< double > rosenbrockMeasurement( std::size_t n )
+{
+	Ubitrack::Math::Vector< double > m( n );
+	for ( std::size_t i( 0 ); i < n; i += 2 )
+	{
+		m( i ) = 0.0;
+		m( i + 1 ) = 1.0;
+	}
+	return m;
+}
+
+#endif
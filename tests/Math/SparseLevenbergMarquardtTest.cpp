@@ -0,0 +1,247 @@
+#include <utMath/SparseLevenbergMarquardt.h>
+#include <utMath/Matrix.h>
+#ifdef HAVE_LAPACK
+#include <utMath/LevenbergMarquardt.h>
+#endif
+#include <utMath/Random/Scalar.h>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/**
+ * chain of 2d points, each measured by the distances to three beacons and by the displacement
+ * to the next point
+ */
+class PointChain
+{
+public:
+	PointChain( std::size_t n )
+		: m_n( n )
+	{
+		m_beacons.push_back( Math::Vector< double, 2 >( -50.0, 0.0 ) );
+		m_beacons.push_back( Math::Vector< double, 2 >( 50.0, 10.0 ) );
+		m_beacons.push_back( Math::Vector< double, 2 >( 0.0, 60.0 ) );
+	}
+
+	std::size_t size() const
+	{ return 5 * m_n - 2; }
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		for ( std::size_t i( 0 ); i < m_n; i++ )
+		{
+			for ( std::size_t b( 0 ); b < 3; b++ )
+			{
+				const double dx( input( 2 * i ) - m_beacons[ b ]( 0 ) );
+				const double dy( input( 2 * i + 1 ) - m_beacons[ b ]( 1 ) );
+				result( 3 * i + b ) = std::sqrt( dx * dx + dy * dy );
+			}
+			if ( i + 1 < m_n )
+				for ( std::size_t r( 0 ); r < 2; r++ )
+					result( 3 * m_n + 2 * i + r ) = input( 2 * i + 2 + r ) - input( 2 * i + r );
+		}
+	}
+
+	/** sparse jacobian */
+	template< class VT1, class VT2 >
+	void evaluateWithJacobian( VT1& result, const VT2& input, Math::CsrMatrix< double >& J ) const
+	{
+		evaluate( result, input );
+		for ( std::size_t i( 0 ); i < m_n; i++ )
+		{
+			for ( std::size_t b( 0 ); b < 3; b++ )
+			{
+				Math::Matrix< double, 1, 2 > block;
+				block( 0, 0 ) = ( input( 2 * i ) - m_beacons[ b ]( 0 ) ) / result( 3 * i + b );
+				block( 0, 1 ) = ( input( 2 * i + 1 ) - m_beacons[ b ]( 1 ) ) / result( 3 * i + b );
+				J.insertBlock( 3 * i + b, 2 * i, block );
+			}
+			if ( i + 1 < m_n )
+				for ( std::size_t r( 0 ); r < 2; r++ )
+				{
+					J.insert( 3 * m_n + 2 * i + r, 2 * i + 2 + r, 1.0 );
+					J.insert( 3 * m_n + 2 * i + r, 2 * i + r, -1.0 );
+				}
+		}
+	}
+
+	/** dense jacobian */
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		Math::CsrMatrix< double > sparse( J.size1(), J.size2() );
+		evaluateWithJacobian( result, input, sparse );
+		sparse.compress();
+		J = Math::Matrix< double, 0, 0 >::zeros( J.size1(), J.size2() );
+		for ( std::size_t r( 0 ); r < J.size1(); r++ )
+			for ( std::size_t k( sparse.rowStart()[ r ] ); k < sparse.rowStart()[ r + 1 ]; k++ )
+				J( r, sparse.colIndex()[ k ] ) = sparse.values()[ k ];
+	}
+
+protected:
+	std::size_t m_n;
+	std::vector< Math::Vector< double, 2 > > m_beacons;
+};
+
+
+/** random sparse matrix with duplicate entries and its dense equivalent */
+void randomSparse( std::size_t rows, std::size_t cols, Math::CsrMatrix< double >& A, Math::Matrix< double, 0, 0 >& dense )
+{
+	A.resize( rows, cols );
+	dense = Math::Matrix< double, 0, 0 >::zeros( rows, cols );
+	for ( std::size_t k( 0 ); k < 4 * rows; k++ )
+	{
+		const std::size_t r( Math::Random::distribute_uniform< std::size_t >( 0, rows - 1 ) );
+		const std::size_t c( Math::Random::distribute_uniform< std::size_t >( 0, cols - 1 ) );
+		const double v( Math::Random::distribute_uniform< double >( -1, 1 ) );
+		A.insert( r, c, v );
+		dense( r, c ) += v;
+	}
+	A.compress();
+}
+
+/** norm of ( A^T A + lambda I ) x - b, computed densely */
+double normalEquationError( const Math::Matrix< double, 0, 0 >& A, double lambda, const Math::Vector< double >& x, const Math::Vector< double >& b )
+{
+	namespace ublas = boost::numeric::ublas;
+	const Math::Vector< double > Ax( ublas::prod( A, x ) );
+	const Math::Vector< double > e( ublas::prod( ublas::trans( A ), Ax ) + lambda * x - b );
+	return ublas::norm_2( e ) / ublas::norm_2( b );
+}
+
+}
+
+
+void TestSparseLevenbergMarquardt()
+{
+	namespace ublas = boost::numeric::ublas;
+
+	// csr matrix operations against dense
+	for ( std::size_t run( 0 ); run < 10; run++ )
+	{
+		const std::size_t rows( Math::Random::distribute_uniform< std::size_t >( 5, 39 ) );
+		const std::size_t cols( Math::Random::distribute_uniform< std::size_t >( 3, 29 ) );
+		Math::CsrMatrix< double > A;
+		Math::Matrix< double, 0, 0 > dense;
+		randomSparse( rows, cols, A, dense );
+
+		for ( std::size_t r( 0 ); r < rows; r++ )
+			for ( std::size_t k( A.rowStart()[ r ] ); k + 1 < A.rowStart()[ r + 1 ]; k++ )
+				BOOST_CHECK( A.colIndex()[ k ] < A.colIndex()[ k + 1 ] );
+
+		Math::Vector< double > x( cols );
+		for ( std::size_t c( 0 ); c < cols; c++ )
+			x( c ) = Math::Random::distribute_uniform< double >( -1, 1 );
+		Math::Vector< double > y( rows );
+		A.multiply( x, y );
+		BOOST_CHECK_SMALL( ublas::norm_2( y - ublas::prod( dense, x ) ), 1e-12 );
+
+		Math::Vector< double > z( cols );
+		A.multiplyTransposed( y, z );
+		BOOST_CHECK_SMALL( ublas::norm_2( z - ublas::prod( ublas::trans( dense ), y ) ), 1e-12 );
+
+		// damped normal equations with both solvers
+		Math::Vector< double > b( cols );
+		for ( std::size_t c( 0 ); c < cols; c++ )
+			b( c ) = Math::Random::distribute_uniform< double >( -1, 1 );
+		const double lambda( 1e-3 );
+
+		Math::SparseCholesky< double > cholesky;
+		BOOST_CHECK( cholesky.factorize( A, lambda ) );
+		Math::Vector< double > xChol( b );
+		cholesky.solve( xChol );
+		BOOST_CHECK_SMALL( normalEquationError( dense, lambda, xChol, b ), 1e-8 );
+
+		// refactorization with the same pattern reuses the analysis
+		BOOST_CHECK( cholesky.factorize( A, 10 * lambda ) );
+		Math::Vector< double > xChol2( b );
+		cholesky.solve( xChol2 );
+		BOOST_CHECK_SMALL( normalEquationError( dense, 10 * lambda, xChol2, b ), 1e-8 );
+
+		Math::SparseConjugateGradient< double > cg( 10 * cols, 1e-12 );
+		BOOST_CHECK( cg.factorize( A, lambda ) );
+		Math::Vector< double > xCg( b );
+		cg.solve( xCg );
+		BOOST_CHECK_SMALL( normalEquationError( dense, lambda, xCg, b ), 1e-6 );
+	}
+
+	// the envelope of a banded problem stays banded in any column order
+	{
+		const std::size_t n( 200 );
+		Math::CsrMatrix< double > A( n - 1, n );
+		for ( std::size_t i( 0 ); i + 1 < n; i++ )
+		{
+			A.insert( i, ( i * 37 ) % n, 1.0 );
+			A.insert( i, ( ( i + 1 ) * 37 ) % n, -1.0 );
+		}
+		A.compress();
+		Math::SparseCholesky< double > cholesky;
+		BOOST_CHECK( cholesky.factorize( A, 1e-3 ) );
+		BOOST_CHECK( cholesky.envelopeSize() <= 2 * n );
+	}
+
+	// nonlinear chain problem
+	for ( std::size_t run( 0 ); run < 5; run++ )
+	{
+		const std::size_t n( Math::Random::distribute_uniform< std::size_t >( 5, 49 ) );
+		PointChain problem( n );
+
+		Math::Vector< double > truth( 2 * n );
+		for ( std::size_t i( 0 ); i < 2 * n; i++ )
+			truth( i ) = Math::Random::distribute_uniform< double >( -20, 20 );
+		Math::Vector< double > measurement( problem.size() );
+		problem.evaluate( measurement, truth );
+
+		Math::Vector< double > start( truth );
+		for ( std::size_t i( 0 ); i < 2 * n; i++ )
+			start( i ) += Math::Random::distribute_normal< double >( 0.0, 1.0 );
+
+		// noise-free: both solvers converge to the truth
+		Math::Vector< double > paramChol( start );
+		Math::sparseLevenbergMarquardt( problem, paramChol, measurement, Math::OptTerminate( 50, 1e-12 ), Math::OptNoNormalize() );
+		BOOST_CHECK_SMALL( ublas::norm_inf( paramChol - truth ), 1e-6 );
+
+		Math::Vector< double > paramCg( start );
+		Math::sparseLevenbergMarquardt( problem, paramCg, measurement, Math::OptTerminate( 50, 1e-12 ), Math::OptNoNormalize(),
+			Math::sparseLmUseConjugateGradient );
+		BOOST_CHECK_SMALL( ublas::norm_inf( paramCg - truth ), 1e-6 );
+
+#ifdef HAVE_LAPACK
+		// noisy: same iterates as the dense optimizer
+		Math::Vector< double > noisy( measurement );
+		for ( std::size_t i( 0 ); i < noisy.size(); i++ )
+			noisy( i ) += Math::Random::distribute_normal< double >( 0.0, 0.1 );
+
+		Math::Vector< double > paramDense( start );
+		const double resDense( Math::levenbergMarquardt( problem, paramDense, noisy, Math::OptTerminate( 10, 1e-8 ), Math::OptNoNormalize() ) );
+		Math::Vector< double > paramSparse( start );
+		const double resSparse( Math::sparseLevenbergMarquardt( problem, paramSparse, noisy, Math::OptTerminate( 10, 1e-8 ), Math::OptNoNormalize() ) );
+		BOOST_CHECK_CLOSE( resSparse, resDense, 1e-6 );
+		BOOST_CHECK_SMALL( ublas::norm_inf( paramSparse - paramDense ), 1e-8 );
+#endif
+	}
+
+	// invalid parameters: no damping makes the preconditioner usable, the optimizer gives up
+	{
+		PointChain problem( 5 );
+		Math::Vector< double > measurement( problem.size() );
+		Math::Vector< double > param( 10 );
+		for ( std::size_t i( 0 ); i < 10; i++ )
+			param( i ) = i;
+		problem.evaluate( measurement, param );
+		param( 3 ) = std::numeric_limits< double >::quiet_NaN();
+
+		Math::sparseLevenbergMarquardt( problem, param, measurement, Math::OptTerminate( 50, 1e-12 ), Math::OptNoNormalize(),
+			Math::sparseLmUseConjugateGradient );
+		BOOST_CHECK( param( 3 ) != param( 3 ) );
+	}
+}
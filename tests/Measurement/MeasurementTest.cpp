@@ -0,0 +1,11 @@
+#include "MeasurementTest.h"
+
+// declare external tests here, to save us some trivial header files
+void TestTimestampSyncHull();
+
+MeasurementTest::MeasurementTest()
+	: boost::unit_test::test_suite( "Measurement test suite" )
+{
+	add( BOOST_TEST_CASE( &TestTimestampSyncHull ) );
+}
+
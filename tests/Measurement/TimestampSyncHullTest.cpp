@@ -0,0 +1,106 @@
+#include <utMeasurement/TimestampSyncHull.h>
+#include <utMath/Random/Scalar.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** simulated sensor: 1 kHz events, native clock in microseconds running fast by the drift */
+struct SimulatedSensor
+{
+	SimulatedSensor( double drift )
+		: m_drift( drift )
+		, m_start( 1000000000000ULL )
+		, m_latency( 100000 )
+		, m_clockStep( 0 )
+	{}
+
+	/** native time of event k */
+	double native( unsigned k ) const
+	{ return k * 1000.0 * ( 1.0 + m_drift ); }
+
+	/** local time at which event k happened plus the minimum delay, i.e. what the estimate should return */
+	Measurement::Timestamp expected( unsigned k ) const
+	{ return m_start + m_clockStep + static_cast< Measurement::Timestamp >( k ) * 1000000 + m_latency; }
+
+	/** local time at which event k is received: exponential jitter of 20 us and 1% spikes of 5 ms */
+	Measurement::Timestamp received( unsigned k ) const
+	{
+		double fDelay = -20000.0 * std::log( 1.0 - Math::Random::distribute_uniform< double >( 0.0, 0.999999 ) );
+		if ( Math::Random::distribute_uniform< double >( 0.0, 1.0 ) < 0.01 )
+			fDelay += 5e6;
+		return expected( k ) + static_cast< Measurement::Timestamp >( fDelay );
+	}
+
+	double m_drift;
+	Measurement::Timestamp m_start;
+	Measurement::Timestamp m_latency;
+
+	/** jump of the local clock */
+	Measurement::Timestamp m_clockStep;
+};
+
+
+/** signed difference of two timestamps in nanoseconds */
+double difference( Measurement::Timestamp a, Measurement::Timestamp b )
+{ return static_cast< double >( static_cast< long long >( a - b ) ); }
+
+}
+
+
+void TestTimestampSyncHull()
+{
+	const std::size_t windowSize( 1000 );
+	const double drift( 50e-6 );
+	SimulatedSensor sensor( drift );
+	Measurement::TimestampSyncHull sync( 1e6, windowSize );
+
+	// linear drift: bounded offset error once the window has filled
+	unsigned k( 0 );
+	double maxError( 0.0 );
+	std::size_t nLater( 0 );
+	for ( ; k < 20000; k++ )
+	{
+		const Measurement::Timestamp received( sensor.received( k ) );
+		const Measurement::Timestamp converted( sync.convertNativeToLocal( sensor.native( k ), received ) );
+		if ( converted > received )
+			nLater++;
+		if ( k >= windowSize )
+			maxError = std::max( maxError, std::fabs( difference( converted, sensor.expected( k ) ) ) );
+	}
+	BOOST_CHECK_EQUAL( nLater, 0u );
+	BOOST_CHECK_SMALL( maxError, 5000.0 );
+	BOOST_CHECK_CLOSE( sync.getDrift(), drift, 5.0 );
+	BOOST_CHECK_EQUAL( sync.getEventCount(), k );
+	BOOST_CHECK( sync.getWindowFill() >= windowSize / 2 && sync.getWindowFill() <= windowSize );
+
+	// latency and jitter include the spikes: mean 20 us + 1% of 5 ms
+	BOOST_CHECK_CLOSE( sync.getLatency(), 70000.0, 50.0 );
+	BOOST_CHECK( sync.getJitter() > 20000.0 && sync.getJitter() < 2e6 );
+
+	// step of the local clock: the estimate recovers once the old samples have left the window
+	sensor.m_clockStep = 2000000;
+	const unsigned stepEnd( k + 2 * windowSize );
+	maxError = 0.0;
+	for ( ; k < stepEnd + 5000; k++ )
+	{
+		const Measurement::Timestamp received( sensor.received( k ) );
+		const Measurement::Timestamp converted( sync.convertNativeToLocal( sensor.native( k ), received ) );
+		if ( converted > received )
+			nLater++;
+		if ( k >= stepEnd )
+			maxError = std::max( maxError, std::fabs( difference( converted, sensor.expected( k ) ) ) );
+	}
+	BOOST_CHECK_EQUAL( nLater, 0u );
+	BOOST_CHECK_SMALL( maxError, 5000.0 );
+	BOOST_CHECK_CLOSE( sync.getDrift(), drift, 5.0 );
+
+	// a native clock that jumps backwards restarts the estimation
+	sync.convertNativeToLocal( 0.0, sensor.received( k ) );
+	BOOST_CHECK_EQUAL( sync.getWindowFill(), 1u );
+}
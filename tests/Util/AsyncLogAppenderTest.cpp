@@ -0,0 +1,305 @@
+#include <utUtil/AsyncLogAppender.h>
+#include <utUtil/Logging.h>
+
+#include <vector>
+#include <string>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <log4cpp/Category.hh>
+#include <log4cpp/LoggingEvent.hh>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** records the messages, can hold back or slow down the caller and detects concurrent calls */
+class RecordingAppender
+	: public log4cpp::AppenderSkeleton
+{
+public:
+	RecordingAppender( const std::string& name )
+		: log4cpp::AppenderSkeleton( name )
+		, m_bGateOpen( true )
+		, m_bInside( false )
+		, m_nConcurrentCalls( 0 )
+		, m_nDelay( 0 )
+	{}
+
+	virtual void close()
+	{}
+
+	virtual bool requiresLayout() const
+	{ return false; }
+
+	virtual void setLayout( log4cpp::Layout* )
+	{}
+
+	/** while the gate is closed, calls block */
+	void setGate( bool bOpen )
+	{ m_bGateOpen.store( bOpen ); }
+
+	/** each call takes at least the given number of microseconds */
+	void setDelay( long nMicroseconds )
+	{ m_nDelay.store( nMicroseconds ); }
+
+	std::vector< std::string > messages() const
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		return m_messages;
+	}
+
+	std::size_t concurrentCalls() const
+	{ return m_nConcurrentCalls.load(); }
+
+protected:
+	virtual void _append( const log4cpp::LoggingEvent& event )
+	{
+		if ( m_bInside.exchange( true ) )
+			m_nConcurrentCalls++;
+
+		while ( !m_bGateOpen.load() )
+			boost::this_thread::sleep( boost::posix_time::microseconds( 100 ) );
+		if ( m_nDelay.load() )
+			boost::this_thread::sleep( boost::posix_time::microseconds( m_nDelay.load() ) );
+
+		{
+			boost::mutex::scoped_lock lock( m_mutex );
+			m_messages.push_back( event.message );
+		}
+
+		m_bInside.store( false );
+	}
+
+	boost::atomic< bool > m_bGateOpen;
+	boost::atomic< bool > m_bInside;
+	boost::atomic< std::size_t > m_nConcurrentCalls;
+	boost::atomic< long > m_nDelay;
+	mutable boost::mutex m_mutex;
+	std::vector< std::string > m_messages;
+};
+
+
+void appendEvent( log4cpp::Appender& appender, int iThread, int iEvent )
+{
+	std::ostringstream s;
+	s << iThread << " " << iEvent;
+	appender.doAppend( log4cpp::LoggingEvent( "Ubitrack.Test", s.str(), "", log4cpp::Priority::INFO ) );
+}
+
+
+void producer( log4cpp::Appender& appender, int iThread, int nEvents, boost::atomic< bool >* pDone )
+{
+	for ( int i( 0 ); i < nEvents; i++ )
+		appendEvent( appender, iThread, i );
+	if ( pDone )
+		pDone->store( true );
+}
+
+
+/** logs until told to stop and returns the number of events in \c *pCount */
+void steadyProducer( log4cpp::Appender& appender, int iThread, boost::atomic< bool >* pDone, int* pCount )
+{
+	int i( 0 );
+	while ( !pDone->load() )
+		appendEvent( appender, iThread, i++ );
+	*pCount = i;
+}
+
+
+/**
+ * checks that every event of every producer was written exactly once.
+ * @param bOrdered also require that the events of each producer are in order
+ */
+void checkComplete( const std::vector< std::string >& messages, int nThreads, int nEvents, bool bOrdered )
+{
+	BOOST_CHECK_EQUAL( messages.size(), std::size_t( nThreads * nEvents ) );
+
+	std::vector< std::vector< int > > counts( nThreads, std::vector< int >( nEvents, 0 ) );
+	std::vector< int > next( nThreads, 0 );
+	std::size_t nErrors( 0 );
+	for ( std::size_t i( 0 ); i < messages.size(); i++ )
+	{
+		std::istringstream s( messages[ i ] );
+		int iThread( -1 );
+		int iEvent( -1 );
+		s >> iThread >> iEvent;
+		if ( iThread < 0 || iThread >= nThreads || iEvent < 0 || iEvent >= nEvents )
+		{
+			nErrors++;
+			continue;
+		}
+
+		counts[ iThread ][ iEvent ]++;
+		if ( bOrdered && iEvent != next[ iThread ]++ )
+			nErrors++;
+	}
+
+	for ( int t( 0 ); t < nThreads; t++ )
+		for ( int i( 0 ); i < nEvents; i++ )
+			if ( counts[ t ][ i ] != 1 )
+				nErrors++;
+	BOOST_CHECK_EQUAL( nErrors, 0u );
+}
+
+
+/** fills a queue of 4 slots while the target is blocked, for the overflow policies */
+std::vector< std::string > overflow( Util::AsyncLogAppender::OverflowPolicy policy, unsigned long long& nDropped )
+{
+	RecordingAppender target( "Ubitrack.Test.Overflow" );
+	target.setGate( false );
+	Util::AsyncLogAppender appender( "Ubitrack.Test.Overflow.async", &target, false, 4, policy );
+	BOOST_CHECK_EQUAL( appender.queueSize(), 4u );
+
+	// the slot written by the blocked writer thread is only freed when it returns
+	for ( int i( 0 ); i < 20; i++ )
+		appendEvent( appender, 0, i );
+	BOOST_CHECK( target.messages().empty() );
+	nDropped = appender.droppedEvents();
+
+	target.setGate( true );
+	appender.close();
+	BOOST_CHECK_EQUAL( target.concurrentCalls(), 0u );
+	return target.messages();
+}
+
+}
+
+
+void TestAsyncLogAppender()
+{
+	// multiple producers, flush and stop while the producers are running
+	const int nThreads( 4 );
+	const int nEvents( 20000 );
+	for ( int round( 0 ); round < 10; round++ )
+	{
+		const bool bStop( round % 2 == 0 );
+		RecordingAppender target( "Ubitrack.Test.Stress" );
+		Util::AsyncLogAppender* pAppender = new Util::AsyncLogAppender( "Ubitrack.Test.Stress.async", &target, false, 64,
+			Util::AsyncLogAppender::OVERFLOW_BLOCK );
+
+		boost::thread_group threads;
+		for ( int t( 0 ); t < nThreads; t++ )
+			threads.create_thread( boost::bind( &producer, boost::ref( *pAppender ), t, nEvents,
+				static_cast< boost::atomic< bool >* >( 0 ) ) );
+
+		if ( bStop )
+		{
+			// producers that are blocked or in the middle of an event must not lose it
+			boost::this_thread::sleep( boost::posix_time::milliseconds( round ) );
+			pAppender->stop();
+		}
+		threads.join_all();
+
+		if ( !bStop )
+		{
+			pAppender->flush();
+			checkComplete( target.messages(), nThreads, nEvents, true );
+		}
+
+		delete pAppender;
+		checkComplete( target.messages(), nThreads, nEvents, !bStop );
+		BOOST_CHECK_EQUAL( target.concurrentCalls(), 0u );
+	}
+
+	// OVERFLOW_DROP: events that do not fit are lost silently
+	{
+		unsigned long long nDropped;
+		std::vector< std::string > messages( overflow( Util::AsyncLogAppender::OVERFLOW_DROP, nDropped ) );
+		BOOST_CHECK_EQUAL( nDropped, 16u );
+		BOOST_REQUIRE_EQUAL( messages.size(), 4u );
+		checkComplete( messages, 1, 4, true );
+	}
+
+	// OVERFLOW_COUNT: events that do not fit are lost, but reported
+	{
+		unsigned long long nDropped;
+		std::vector< std::string > messages( overflow( Util::AsyncLogAppender::OVERFLOW_COUNT, nDropped ) );
+		BOOST_CHECK_EQUAL( nDropped, 16u );
+		BOOST_REQUIRE_EQUAL( messages.size(), 5u );
+		BOOST_CHECK_EQUAL( messages[ 3 ], "0 3" );
+		BOOST_CHECK_EQUAL( messages[ 4 ].find( "16 log events dropped" ), 0u );
+	}
+
+	// OVERFLOW_BLOCK: the producer waits for the target
+	{
+		RecordingAppender target( "Ubitrack.Test.Block" );
+		target.setGate( false );
+		Util::AsyncLogAppender appender( "Ubitrack.Test.Block.async", &target, false, 4,
+			Util::AsyncLogAppender::OVERFLOW_BLOCK );
+
+		boost::atomic< bool > bDone( false );
+		boost::thread thread( boost::bind( &producer, boost::ref( appender ), 0, 20, &bDone ) );
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 50 ) );
+		BOOST_CHECK( !bDone.load() );
+		BOOST_CHECK( target.messages().empty() );
+
+		target.setGate( true );
+		thread.join();
+		appender.flush();
+		checkComplete( target.messages(), 1, 20, true );
+		BOOST_CHECK_EQUAL( appender.droppedEvents(), 0u );
+
+		// stopped: events are written synchronously
+		appender.stop();
+		appendEvent( appender, 0, 20 );
+		BOOST_CHECK_EQUAL( target.messages().size(), 21u );
+	}
+
+	// stop() is not held up by a steady stream of synchronous writers
+	{
+		RecordingAppender target( "Ubitrack.Test.Steady" );
+		target.setDelay( 200 );
+		Util::AsyncLogAppender appender( "Ubitrack.Test.Steady.async", &target, false, 64,
+			Util::AsyncLogAppender::OVERFLOW_BLOCK );
+
+		boost::atomic< bool > bDone( false );
+		std::vector< int > counts( nThreads, 0 );
+		boost::thread_group threads;
+		for ( int t( 0 ); t < nThreads; t++ )
+			threads.create_thread( boost::bind( &steadyProducer, boost::ref( appender ), t, &bDone, &counts[ t ] ) );
+
+		// the producers keep writing synchronously between the cycles, always one of them in the target
+		for ( int i( 0 ); i < 10; i++ )
+		{
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+			appender.stop();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+			appender.reopen();
+		}
+
+		bDone.store( true );
+		threads.join_all();
+		appender.stop();
+
+		std::size_t nTotal( 0 );
+		for ( int t( 0 ); t < nThreads; t++ )
+			nTotal += counts[ t ];
+		BOOST_CHECK_EQUAL( target.messages().size(), nTotal );
+		BOOST_CHECK_EQUAL( target.concurrentCalls(), 0u );
+	}
+
+	// enableAsyncLogging and disableAsyncLogging swap the appenders of the categories
+	{
+		RecordingAppender target( "Ubitrack.Test.Category" );
+		log4cpp::Category& category( log4cpp::Category::getInstance( "Ubitrack.Test.AsyncLogging" ) );
+		category.setAdditivity( false );
+		category.setPriority( log4cpp::Priority::INFO );
+		category.addAppender( target );
+
+		Util::enableAsyncLogging( 16, true );
+		BOOST_CHECK( category.getAllAppenders().count( &target ) == 0 );
+		for ( int i( 0 ); i < 100; i++ )
+			category.info( "message" );
+
+		Util::disableAsyncLogging();
+		BOOST_CHECK( category.getAllAppenders().count( &target ) == 1 );
+		BOOST_CHECK_EQUAL( target.messages().size(), 100u );
+
+		category.removeAppender( &target );
+	}
+}
@@ -0,0 +1,345 @@
+#include <utUtil/NumberConversion.h>
+#include <utMath/Random/Scalar.h>
+
+#include <string>
+#include <sstream>
+#include <limits>
+#include <locale>
+#include <cstring>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+template< typename T >
+std::string format( T v );
+
+template<>
+std::string format< double >( double v )
+{
+	char buf[ 32 ];
+	return std::string( buf, Util::formatDouble( buf, sizeof( buf ), v ) );
+}
+
+template<>
+std::string format< float >( float v )
+{
+	char buf[ 32 ];
+	return std::string( buf, Util::formatFloat( buf, sizeof( buf ), v ) );
+}
+
+bool parse( const std::string& s, double& v, std::size_t& nConsumed )
+{
+	const char* p = s.data();
+	const bool bResult = Util::parseDouble( p, s.data() + s.size(), v );
+	nConsumed = p - s.data();
+	return bResult;
+}
+
+bool parse( const std::string& s, float& v, std::size_t& nConsumed )
+{
+	const char* p = s.data();
+	const bool bResult = Util::parseFloat( p, s.data() + s.size(), v );
+	nConsumed = p - s.data();
+	return bResult;
+}
+
+/** reads the complete string with std::istream, the reference for the parser */
+template< typename T >
+bool streamRead( const std::string& s, T& v )
+{
+	std::istringstream stream( s );
+	stream.imbue( std::locale::classic() );
+	stream >> v;
+	return !stream.fail() && stream.peek() == std::char_traits< char >::eof();
+}
+
+template< typename T >
+std::string streamWrite( T v, int precision = 6 )
+{
+	std::ostringstream stream;
+	stream.imbue( std::locale::classic() );
+	stream.precision( precision );
+	stream << v;
+	return stream.str();
+}
+
+/** number of significant digits of a formatted number */
+int significantDigits( const std::string& s )
+{
+	const std::size_t first( s.find_first_of( "123456789" ) );
+	if ( first == std::string::npos )
+		return 0;
+	const std::size_t exponent( s.find( 'e' ) );
+	const std::string mantissa( s.substr( 0, exponent ) );
+	const std::size_t last( mantissa.find_last_of( "123456789" ) );
+	int n( 0 );
+	for ( std::size_t i( first ); i <= last; i++ )
+		if ( s[ i ] != '.' )
+			n++;
+	return n;
+}
+
+/** bitwise comparison, distinguishes 0 and -0 */
+template< typename T >
+bool identical( T a, T b )
+{ return std::memcmp( &a, &b, sizeof( T ) ) == 0; }
+
+/** checks that the shortest representation is read back exactly, by us and by std::istream */
+template< typename T >
+void checkRoundTrip( T v )
+{
+	const std::string s( format( v ) );
+	BOOST_REQUIRE( !s.empty() );
+
+	T parsed( 0 );
+	std::size_t nConsumed;
+	BOOST_CHECK_MESSAGE( parse( s, parsed, nConsumed ) && identical( parsed, v ), "parse( \"" << s << "\" )" );
+	BOOST_CHECK_EQUAL( nConsumed, s.size() );
+
+	T streamed( 0 );
+	BOOST_CHECK_MESSAGE( streamRead( s, streamed ) && identical( streamed, v ), "istream( \"" << s << "\" )" );
+
+	// never more digits than std::ostream needs for a round trip
+	BOOST_CHECK_MESSAGE( significantDigits( s ) <= std::numeric_limits< T >::digits10 + 3, s );
+	const std::string full( streamWrite( v, std::numeric_limits< T >::digits10 + 3 ) );
+	BOOST_CHECK_MESSAGE( parse( full, parsed, nConsumed ) && identical( parsed, v ), "parse( \"" << full << "\" )" );
+}
+
+/** checks that the parser gives the same result as std::istream on a complete string */
+template< typename T >
+void checkSameAsStream( const std::string& s )
+{
+	T expected( 0 );
+	const bool bExpected( streamRead( s, expected ) );
+
+	T v( 0 );
+	std::size_t nConsumed;
+	const bool bResult( parse( s, v, nConsumed ) && nConsumed == s.size() );
+	BOOST_CHECK_MESSAGE( bResult == bExpected, "success for \"" << s << "\"" );
+	if ( bResult && bExpected )
+		BOOST_CHECK_MESSAGE( identical( v, expected ), "value for \"" << s << "\": " << streamWrite( v, 20 ) << " != " << streamWrite( expected, 20 ) );
+}
+
+/** checks that parsing fails without consuming anything */
+template< typename T >
+void checkFails( const std::string& s )
+{
+	T v( 0 );
+	std::size_t nConsumed;
+	BOOST_CHECK_MESSAGE( !parse( s, v, nConsumed ), "\"" << s << "\" accepted" );
+	BOOST_CHECK_EQUAL( nConsumed, 0u );
+}
+
+double randomBitsDouble()
+{
+	while ( true )
+	{
+		const unsigned long long bits( Math::Random::distribute_uniform< unsigned long long >( 0, ~0ULL ) );
+		double v;
+		std::memcpy( &v, &bits, sizeof( v ) );
+		if ( v == v && v - v == 0 ) // finite
+			return v;
+	}
+}
+
+float randomBitsFloat()
+{
+	while ( true )
+	{
+		const unsigned bits( Math::Random::distribute_uniform< unsigned >( 0, ~0U ) );
+		float v;
+		std::memcpy( &v, &bits, sizeof( v ) );
+		if ( v == v && v - v == 0 )
+			return v;
+	}
+}
+
+/** a random decimal number with up to 25 significant digits */
+std::string randomDecimal()
+{
+	std::string s;
+	if ( Math::Random::distribute_uniform< int >( 0, 1 ) )
+		s += '-';
+	const int nDigits( Math::Random::distribute_uniform< int >( 1, 25 ) );
+	for ( int i( 0 ); i < nDigits; i++ )
+	{
+		if ( i == 1 )
+			s += '.';
+		s += char( '0' + Math::Random::distribute_uniform< int >( 0, 9 ) );
+	}
+	s += 'e';
+	s += streamWrite( Math::Random::distribute_uniform< int >( -330, 310 ) );
+	return s;
+}
+
+}
+
+
+void TestNumberConversion()
+{
+	// shortest round trip of random bit patterns
+	for ( int i( 0 ); i < 20000; i++ )
+	{
+		checkRoundTrip( randomBitsDouble() );
+		checkRoundTrip( randomBitsFloat() );
+	}
+
+	// random decimal text is read like std::istream does, including the C library fallback
+	for ( int i( 0 ); i < 20000; i++ )
+	{
+		const std::string s( randomDecimal() );
+		checkSameAsStream< double >( s );
+		checkSameAsStream< float >( s );
+	}
+
+	// extremes and denormals
+	typedef std::numeric_limits< double > LD;
+	typedef std::numeric_limits< float > LF;
+	const double doubles[] = { 0.0, 1.0, 0.1, 1e-5, 123456789.0, 1e23, 9007199254740993.0, LD::max(), -LD::max(), LD::min(),
+		LD::denorm_min(), -LD::denorm_min(), LD::min() - LD::denorm_min(), 2.2250738585072009e-308, LD::epsilon() };
+	for ( std::size_t i( 0 ); i < sizeof( doubles ) / sizeof( doubles[ 0 ] ); i++ )
+		checkRoundTrip( doubles[ i ] );
+	const float floats[] = { 0.0f, 1.0f, 0.1f, 1e-5f, 16777216.0f, LF::max(), -LF::max(), LF::min(), LF::denorm_min(),
+		LF::min() - LF::denorm_min(), LF::epsilon() };
+	for ( std::size_t i( 0 ); i < sizeof( floats ) / sizeof( floats[ 0 ] ); i++ )
+		checkRoundTrip( floats[ i ] );
+	BOOST_CHECK_EQUAL( format( 1e-5 ), streamWrite( 1e-5 ) );
+	BOOST_CHECK_EQUAL( format( -3.25e20 ), streamWrite( -3.25e20 ) );
+
+	// negative zero
+	BOOST_CHECK_EQUAL( format( -0.0 ), streamWrite( -0.0 ) );
+	BOOST_CHECK_EQUAL( format( -0.0f ), streamWrite( -0.0f ) );
+	{
+		double v;
+		std::size_t nConsumed;
+		BOOST_CHECK( parse( "-0", v, nConsumed ) && identical( v, -0.0 ) );
+		BOOST_CHECK( parse( "-0.000e10", v, nConsumed ) && identical( v, -0.0 ) );
+		BOOST_CHECK( parse( "-1e-400", v, nConsumed ) && identical( v, -0.0 ) );
+	}
+
+	// rounding boundaries: exact ties round to even, anything above rounds up
+	const char* boundaries[] = {
+		"9007199254740993", "9007199254740995", "9007199254740993.0000000000000001",
+		"1.00000000000000011102230246251565404236316680908203125",
+		"1.00000000000000011102230246251565404236316680908203126",
+		"1.00000000000000011102230246251565404236316680908203124",
+		"2.4703282292062327e-324", "2.4703282292062328e-324", "4.9406564584124654e-324",
+		"2.2250738585072011e-308", "2.2250738585072012e-308", "2.2250738585072014e-308",
+		"1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308",
+		"16777217", "16777219", "3.4028235e38", "3.4028236e38", "1.4e-45", "7e-46", "7.1e-46",
+		"0.1", "0.3", "1e23", "8.589973e9", "123456789012345678901234567890" };
+	for ( std::size_t i( 0 ); i < sizeof( boundaries ) / sizeof( boundaries[ 0 ] ); i++ )
+	{
+		checkSameAsStream< double >( boundaries[ i ] );
+		checkSameAsStream< float >( boundaries[ i ] );
+	}
+	{
+		double v;
+		std::size_t nConsumed;
+		BOOST_CHECK( parse( "9007199254740993", v, nConsumed ) && v == 9007199254740992.0 );
+		BOOST_CHECK( parse( "1.00000000000000011102230246251565404236316680908203125", v, nConsumed ) && v == 1.0 );
+		BOOST_CHECK( parse( "1.00000000000000011102230246251565404236316680908203126", v, nConsumed ) && v == 1.0 + LD::epsilon() );
+		float f;
+		BOOST_CHECK( parse( "16777217", f, nConsumed ) && f == 16777216.0f );
+		BOOST_CHECK( parse( "3.4028235e38", f, nConsumed ) && f == LF::max() );
+	}
+
+	// overflow fails like std::istream, underflow gives zero
+	checkFails< double >( "1e400" );
+	checkFails< double >( "-1e400" );
+	checkFails< double >( "1.7976931348623159e308" );
+	checkFails< double >( "100000000000000000000000000000e300" );
+	checkFails< float >( "1e39" );
+	checkFails< float >( "-3.4028236e38" );
+	checkSameAsStream< double >( "1e400" );
+	checkSameAsStream< float >( "1e39" );
+	checkSameAsStream< double >( "1e-400" );
+	{
+		double v;
+		std::size_t nConsumed;
+		BOOST_CHECK( parse( "1e-400", v, nConsumed ) && identical( v, 0.0 ) );
+		BOOST_CHECK( parse( "inf", v, nConsumed ) && v > LD::max() && nConsumed == 3 );
+		BOOST_CHECK( parse( "-Infinity", v, nConsumed ) && v < -LD::max() && nConsumed == 9 );
+		BOOST_CHECK( parse( "nan", v, nConsumed ) && v != v );
+	}
+
+	// malformed input
+	const char* malformed[] = { "", "-", "+", ".", "-.", "e5", ".e5", "abc", "+-1", "--1", "in", "na" };
+	for ( std::size_t i( 0 ); i < sizeof( malformed ) / sizeof( malformed[ 0 ] ); i++ )
+	{
+		checkFails< double >( malformed[ i ] );
+		checkFails< float >( malformed[ i ] );
+		checkSameAsStream< double >( malformed[ i ] );
+	}
+
+	// unlike std::istream, leading whitespace is left to the caller
+	checkFails< double >( " 1" );
+
+	{
+		// trailing text is not part of the number
+		double v;
+		std::size_t nConsumed;
+		BOOST_CHECK( parse( "1e", v, nConsumed ) && v == 1.0 && nConsumed == 1 );
+		BOOST_CHECK( parse( "1e+x", v, nConsumed ) && v == 1.0 && nConsumed == 1 );
+		BOOST_CHECK( parse( "1.5x", v, nConsumed ) && v == 1.5 && nConsumed == 3 );
+		BOOST_CHECK( parse( "2.5,3", v, nConsumed ) && v == 2.5 && nConsumed == 3 );
+	}
+
+	// small buffers
+	{
+		char buf[ 32 ];
+		BOOST_CHECK_EQUAL( Util::formatDouble( buf, 3, 0.125 ), 0u );
+		BOOST_CHECK_EQUAL( Util::formatDouble( buf, 5, 0.125 ), 5u );
+		BOOST_CHECK_EQUAL( Util::formatSigned( buf, 2, -10 ), 0u );
+		BOOST_CHECK_EQUAL( Util::formatUnsigned( buf, 0, 0 ), 0u );
+	}
+
+	// integers
+	{
+		char buf[ 32 ];
+		const long long minSigned( -9223372036854775807LL - 1 );
+		BOOST_CHECK_EQUAL( std::string( buf, Util::formatSigned( buf, sizeof( buf ), minSigned ) ), streamWrite( minSigned ) );
+		BOOST_CHECK_EQUAL( std::string( buf, Util::formatUnsigned( buf, sizeof( buf ), ~0ULL ) ), streamWrite( ~0ULL ) );
+		for ( int i( 0 ); i < 1000; i++ )
+		{
+			const long long v( static_cast< long long >( Math::Random::distribute_uniform< unsigned long long >( 0, ~0ULL ) ) );
+			const std::string s( buf, Util::formatSigned( buf, sizeof( buf ), v ) );
+			BOOST_CHECK_EQUAL( s, streamWrite( v ) );
+			long long parsed;
+			const char* p( s.data() );
+			BOOST_CHECK( Util::parseSigned( p, s.data() + s.size(), parsed ) && parsed == v );
+		}
+
+		const std::string limits[] = { "-9223372036854775808", "9223372036854775807", "9223372036854775808", "18446744073709551615",
+			"18446744073709551616", "-1", "+1", "-", "", "x1" };
+		for ( std::size_t i( 0 ); i < sizeof( limits ) / sizeof( limits[ 0 ] ); i++ )
+		{
+			const std::string& s( limits[ i ] );
+			long long expectedSigned;
+			const bool bSigned( streamRead( s, expectedSigned ) );
+			long long vSigned;
+			const char* p( s.data() );
+			BOOST_CHECK_EQUAL( Util::parseSigned( p, s.data() + s.size(), vSigned ), bSigned );
+			if ( bSigned )
+				BOOST_CHECK_EQUAL( vSigned, expectedSigned );
+			else
+				BOOST_CHECK( p == s.data() );
+		}
+
+		unsigned long long v;
+		const char* p;
+		const std::string maxUnsigned( "18446744073709551615" );
+		p = maxUnsigned.data();
+		BOOST_CHECK( Util::parseUnsigned( p, maxUnsigned.data() + maxUnsigned.size(), v ) && v == ~0ULL );
+		const std::string tooLarge( "18446744073709551616" );
+		p = tooLarge.data();
+		BOOST_CHECK( !Util::parseUnsigned( p, tooLarge.data() + tooLarge.size(), v ) && p == tooLarge.data() );
+		const std::string negative( "-1" );
+		p = negative.data();
+		BOOST_CHECK( !Util::parseUnsigned( p, negative.data() + negative.size(), v ) && p == negative.data() );
+	}
+}
+
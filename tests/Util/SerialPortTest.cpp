@@ -0,0 +1,100 @@
+#include <boost/test/unit_test.hpp>
+
+// after boost, as it defines N, O and E
+#include <utUtil/SerialPort.h>
+#include <utUtil/Exception.h>
+
+#ifdef __linux__
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** frames of 4 bytes starting with 0xAA, other bytes are discarded */
+long headerFrames( const unsigned char* data, std::size_t size )
+{
+	if ( data[ 0 ] != 0xAA )
+		return -1;
+	return size >= 4 ? 4 : 0;
+}
+
+}
+
+
+void TestSerialPort()
+{
+	// the slave side of a pseudo terminal behaves like a serial port
+	const int master = posix_openpt( O_RDWR | O_NOCTTY );
+	if ( master < 0 || grantpt( master ) != 0 || unlockpt( master ) != 0 )
+	{
+		BOOST_TEST_MESSAGE( "no pseudo terminals available, serial port test skipped" );
+		return;
+	}
+	const std::string slaveName( ptsname( master ) );
+
+	{
+		Util::SerialPort port( slaveName, 115200 );
+		port.openAsync( Util::SerialPort::ASYNC_DEFAULT, 256, 16 );
+		BOOST_CHECK( port.isAsync() );
+		BOOST_CHECK_THROW( port.openAsync(), Util::Exception );
+		BOOST_CHECK( port.isAsync() );
+		BOOST_CHECK( !port.waitForData( 10 ) );
+
+		// copying read
+		const unsigned char hello[] = { 'h', 'e', 'l', 'l', 'o' };
+		const Measurement::Timestamp before( Measurement::now() );
+		BOOST_REQUIRE_EQUAL( ::write( master, hello, sizeof( hello ) ), ssize_t( sizeof( hello ) ) );
+		unsigned char buf[ 16 ];
+		std::size_t nRead( 0 );
+		Measurement::Timestamp time( 0 );
+		while ( nRead < sizeof( hello ) && port.waitForData( 1000 ) )
+		{
+			Measurement::Timestamp t;
+			const unsigned long n( port.read( buf + nRead, sizeof( buf ) - nRead, t ) );
+			if ( nRead == 0 )
+				time = t;
+			nRead += n;
+		}
+		BOOST_REQUIRE_EQUAL( nRead, sizeof( hello ) );
+		BOOST_CHECK( std::equal( hello, hello + sizeof( hello ), buf ) );
+		BOOST_CHECK( time >= before && time <= Measurement::now() );
+
+		// framing, with garbage in front, more data than the ring buffer holds in total
+		std::size_t nFrames( 0 );
+		for ( int round( 0 ); round < 100; round++ )
+		{
+			const unsigned char data[] = { 0x00, 0x17, 0xAA, 1, 2, static_cast< unsigned char >( round ) };
+			BOOST_REQUIRE_EQUAL( ::write( master, data, sizeof( data ) ), ssize_t( sizeof( data ) ) );
+
+			Util::TimestampedFrame frame;
+			bool bFrame( false );
+			for ( int wait( 0 ); wait < 100 && !( bFrame = port.nextFrame( frame, &headerFrames ) ); wait++ )
+				port.waitForData( 10 );
+			if ( !bFrame )
+				continue;
+			BOOST_CHECK_EQUAL( frame.size, 4u );
+			BOOST_CHECK_EQUAL( int( frame.data[ 3 ] ), round );
+			port.releaseFrame( frame );
+			nFrames++;
+		}
+		BOOST_CHECK_EQUAL( nFrames, 100u );
+		BOOST_CHECK_EQUAL( port.overflowBytes(), 0u );
+
+		port.close();
+		BOOST_CHECK( !port.isAsync() );
+	}
+
+	::close( master );
+}
+
+#else
+
+void TestSerialPort()
+{}
+
+#endif // __linux__
+
@@ -0,0 +1,191 @@
+#include <utUtil/TimestampedRingBuffer.h>
+#include <utMath/Random/Scalar.h>
+
+#include <vector>
+#include <cstring>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** value of the byte at a stream position */
+unsigned char streamByte( std::size_t position )
+{ return static_cast< unsigned char >( position * 7 + position / 251 ); }
+
+/**
+ * writes a chunk of the test stream, the time of a chunk is its end position.
+ * @return false if there was no space
+ */
+bool writeChunk( Util::TimestampedRingBuffer& buffer, std::size_t& position, std::size_t size )
+{
+	std::size_t space;
+	unsigned char* p = buffer.writeSpace( space );
+	size = std::min( size, space );
+	if ( size == 0 )
+		return false;
+
+	for ( std::size_t i( 0 ); i < size; i++ )
+		p[ i ] = streamByte( position + i );
+	position += size;
+	BOOST_CHECK( buffer.commit( size, position ) );
+	return true;
+}
+
+/** frames of 13 bytes */
+long fixedFrames( const unsigned char*, std::size_t size )
+{ return size >= 13 ? 13 : 0; }
+
+/** producer thread: writes nBytes in chunks of random size, waits if the buffer is full */
+void producer( Util::TimestampedRingBuffer& buffer, std::size_t nBytes, std::vector< std::size_t >& chunkSizes )
+{
+	std::size_t position( 0 );
+	std::size_t iChunk( 0 );
+	while ( position < nBytes )
+	{
+		if ( writeChunk( buffer, position, std::min( chunkSizes[ iChunk % chunkSizes.size() ], nBytes - position ) ) )
+			iChunk++;
+		else
+			boost::this_thread::yield();
+	}
+}
+
+}
+
+
+void TestTimestampedRingBuffer()
+{
+	// wrap-around and mirror area, single-threaded
+	{
+		Util::TimestampedRingBuffer buffer( 64, 16 );
+		BOOST_CHECK_EQUAL( buffer.maxFrameSize(), 16u );
+
+		std::size_t writePos( 0 );
+		std::size_t readPos( 0 );
+		for ( int round( 0 ); round < 50; round++ )
+		{
+			// chunks of 10 and 7 bytes, so frames start at all positions relative to the end of the buffer
+			writeChunk( buffer, writePos, 10 );
+			writeChunk( buffer, writePos, 7 );
+			BOOST_CHECK_EQUAL( buffer.available(), writePos - readPos );
+
+			Util::TimestampedFrame frame;
+			while ( buffer.peek( frame ) && frame.size >= 13 )
+			{
+				// contiguous view, even if it wraps around
+				BOOST_CHECK( frame.size <= 16u );
+				for ( std::size_t i( 0 ); i < frame.size; i++ )
+					BOOST_CHECK_EQUAL( frame.data[ i ], streamByte( readPos + i ) );
+
+				// time of the chunks containing the first and last byte
+				BOOST_CHECK( frame.startTime > readPos && frame.startTime <= readPos + 10 );
+				BOOST_CHECK( frame.time >= readPos + frame.size && frame.time < readPos + frame.size + 10 );
+
+				buffer.consume( 13 );
+				readPos += 13;
+			}
+		}
+		BOOST_CHECK( writePos > 10 * 64 );
+		BOOST_CHECK_EQUAL( buffer.overflowBytes(), 0u );
+	}
+
+	// no write space beyond the capacity
+	{
+		Util::TimestampedRingBuffer buffer( 64, 16 );
+		std::size_t position( 0 );
+		while ( writeChunk( buffer, position, 100 ) )
+			;
+		BOOST_CHECK_EQUAL( buffer.available(), 64u );
+		buffer.consume( 20 );
+		std::size_t space;
+		buffer.writeSpace( space );
+		BOOST_CHECK_EQUAL( space, 20u );
+	}
+
+	// all chunk descriptors in use: no write space, commits fail instead of holding back data
+	{
+		Util::TimestampedRingBuffer buffer( 1024, 16 );
+		std::size_t position( 0 );
+		std::size_t nChunks( 0 );
+		while ( writeChunk( buffer, position, 1 ) )
+			nChunks++;
+		BOOST_CHECK( nChunks >= 64u && nChunks < 1024u );
+		BOOST_CHECK_EQUAL( buffer.available(), nChunks );
+
+		// a producer that ignores the write space loses the data, but it is counted
+		std::size_t space;
+		buffer.writeSpace( space );
+		BOOST_CHECK_EQUAL( space, 0u );
+		BOOST_CHECK( !buffer.commit( 5, 12345 ) );
+		BOOST_CHECK_EQUAL( buffer.overflowBytes(), 5u );
+		BOOST_CHECK_EQUAL( buffer.available(), nChunks );
+
+		// freeing a descriptor allows the next chunk, which is visible immediately with its own time
+		buffer.consume( 1 );
+		BOOST_CHECK( writeChunk( buffer, position, 3 ) );
+		BOOST_CHECK_EQUAL( buffer.available(), nChunks + 2 );
+		buffer.consume( nChunks - 1 );
+		Util::TimestampedFrame frame;
+		BOOST_REQUIRE( buffer.peek( frame ) );
+		BOOST_CHECK_EQUAL( frame.size, 3u );
+		BOOST_CHECK_EQUAL( frame.startTime, position );
+		BOOST_CHECK_EQUAL( frame.data[ 0 ], streamByte( nChunks ) );
+	}
+
+	// framing: discarded bytes, incomplete frames and resynchronization
+	{
+		Util::TimestampedRingBuffer buffer( 64, 16 );
+		std::size_t position( 0 );
+		writeChunk( buffer, position, 12 );
+		Util::TimestampedFrame frame;
+		BOOST_CHECK( !buffer.nextFrame( frame, &fixedFrames ) );
+		writeChunk( buffer, position, 1 );
+		BOOST_REQUIRE( buffer.nextFrame( frame, &fixedFrames ) );
+		BOOST_CHECK_EQUAL( frame.size, 13u );
+		BOOST_CHECK_EQUAL( frame.time, 13u );
+		buffer.consume( frame.size );
+	}
+
+	// producer and consumer threads
+	{
+		const std::size_t nBytes( 2000000 );
+		std::vector< std::size_t > chunkSizes( 1000 );
+		for ( std::size_t i( 0 ); i < chunkSizes.size(); i++ )
+			chunkSizes[ i ] = Math::Random::distribute_uniform< int >( 1, 300 );
+
+		Util::TimestampedRingBuffer buffer( 4096, 64 );
+		boost::thread thread( boost::bind( &producer, boost::ref( buffer ), nBytes, boost::ref( chunkSizes ) ) );
+
+		std::size_t readPos( 0 );
+		std::size_t nErrors( 0 );
+		Measurement::Timestamp lastTime( 0 );
+		while ( readPos + 13 <= nBytes - nBytes % 13 )
+		{
+			Util::TimestampedFrame frame;
+			if ( !buffer.nextFrame( frame, &fixedFrames ) )
+			{
+				boost::this_thread::yield();
+				continue;
+			}
+
+			for ( std::size_t i( 0 ); i < frame.size; i++ )
+				if ( frame.data[ i ] != streamByte( readPos + i ) )
+					nErrors++;
+			if ( frame.time < readPos + frame.size || frame.time > readPos + frame.size + 300 || frame.time < lastTime )
+				nErrors++;
+			lastTime = frame.time;
+
+			readPos += frame.size;
+			buffer.consume( frame.size );
+		}
+		thread.join();
+
+		BOOST_CHECK_EQUAL( nErrors, 0u );
+		BOOST_CHECK_EQUAL( buffer.available(), nBytes % 13 );
+		BOOST_CHECK_EQUAL( buffer.overflowBytes(), 0u );
+	}
+}
+
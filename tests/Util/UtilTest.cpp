@@ -0,0 +1,17 @@
+#include "UtilTest.h"
+
+// declare external tests here, to save us some trivial header files
+void TestAsyncLogAppender();
+void TestNumberConversion();
+void TestSerialPort();
+void TestTimestampedRingBuffer();
+
+UtilTest::UtilTest()
+	: boost::unit_test::test_suite( "Util test suite" )
+{
+	add( BOOST_TEST_CASE( &TestAsyncLogAppender ) );
+	add( BOOST_TEST_CASE( &TestNumberConversion ) );
+	add( BOOST_TEST_CASE( &TestSerialPort ) );
+	add( BOOST_TEST_CASE( &TestTimestampedRingBuffer ) );
+}
+
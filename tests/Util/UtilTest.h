@@ -0,0 +1,8 @@
+#include <boost/test/unit_test.hpp>
+
+struct UtilTest
+	: public boost::unit_test::test_suite
+{
+	UtilTest();
+};
+
@@ -2,6 +2,8 @@
 #include <utUtil/Logging.h>
 #include "Math/MathTest.h"
 #include "Calibration/CalibTest.h"
+#include "Util/UtilTest.h"
+#include "Measurement/MeasurementTest.h"
 
 using boost::unit_test::test_suite;
 
@@ -17,6 +19,8 @@ test_suite* init_unit_test_suite( int, char* [] )
 	// this example will pass cause we know ahead of time number of expected failures
 	allTests->add( new MathTest );
 	allTests->add( new CalibrationTest );
+	allTests->add( new UtilTest );
+	allTests->add( new MeasurementTest );
 
 	return allTests;
 }